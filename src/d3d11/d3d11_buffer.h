@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../dxvk/dxvk_cs.h"
 #include "../dxvk/dxvk_device.h"
 
 #include "../d3d10/d3d10_buffer.h"
@@ -110,6 +111,19 @@ namespace dxvk {
       return m_mapped;
     }
 
+    uint64_t GetSequenceNumber() const {
+      return m_desc.Usage == D3D11_USAGE_STAGING
+        ? m_seq.load() : DxvkCsThread::SynchronizeAll;
+    }
+
+    void TrackSequenceNumber(uint64_t Seq) {
+      // Deferred contexts may call this concurrently
+      uint64_t seq = m_seq.load();
+
+      while (seq < Seq && !m_seq.compare_exchange_weak(seq, Seq))
+        continue;
+    }
+
     D3D10Buffer* GetD3D10Iface() {
       return &m_d3d10;
     }
@@ -131,6 +145,7 @@ namespace dxvk {
     Rc<DxvkBuffer>              m_buffer;
     Rc<DxvkBuffer>              m_soCounter;
     DxvkBufferSliceHandle       m_mapped;
+    std::atomic<uint64_t>       m_seq = { 0ull };
 
     D3D11DXGIResource           m_resource;
     D3D10Buffer                 m_d3d10;
@@ -54,6 +54,16 @@ namespace dxvk {
   }
 
 
+  void D3D11CommandList::MarkSingleUse() {
+    m_singleUse = true;
+  }
+
+
+  void D3D11CommandList::MarkDiscard() {
+    m_discard = true;
+  }
+
+
   void D3D11CommandList::EmitToCommandList(ID3D11CommandList* pCommandList) {
     auto cmdList = static_cast<D3D11CommandList*>(pCommandList);
     
@@ -63,6 +73,9 @@ namespace dxvk {
     for (const auto& query : m_queries)
       cmdList->m_queries.push_back(query);
 
+    cmdList->m_singleUse |= m_singleUse;
+    cmdList->m_discard   |= m_discard;
+
     MarkSubmitted();
   }
   
@@ -71,6 +84,8 @@ namespace dxvk {
     for (const auto& query : m_queries)
       query->DoDeferredEnd();
 
+    // Chunks are immutable once recorded, so we can
+    // share them with the CS thread instead of copying
     for (const auto& chunk : m_chunks)
       CsThread->dispatchChunk(DxvkCsChunkRef(chunk));
     
@@ -78,9 +93,42 @@ namespace dxvk {
   }
   
   
+  void D3D11CommandList::EmitToRecorder(
+          DxvkCsThread*       CsThread,
+          DxvkCsRecorder*     Recorder) {
+    // The recorder needs to flush the CS thread's context
+    // in order to preserve submission order, so it has to
+    // be invoked from the CS thread itself
+    DxvkCsChunkRef chunk = m_device->AllocCsChunk(0);
+
+    auto cmd = [
+      cRecorder = Recorder,
+      cChunks   = m_chunks
+    ] (DxvkContext* ctx) {
+      cRecorder->record(ctx, cChunks);
+    };
+
+    chunk->push(cmd);
+    CsThread->dispatchChunk(std::move(chunk));
+
+    MarkSubmitted();
+  }
+
+
+  bool D3D11CommandList::CanRecordInParallel() const {
+    // Queries are managed by the context that begins
+    // them, so they have to run on the CS thread. The
+    // same goes for buffer invalidations, since only
+    // the CS thread may rename buffers.
+    return m_queries.empty() && !m_discard;
+  }
+
+
   void D3D11CommandList::MarkSubmitted() {
-    if (m_submitted.exchange(true) && !m_warned.exchange(true)
-     && m_device->GetOptions()->dcSingleUseMode) {
+    // Only buffers mapped directly in single-use mode
+    // prevent the command list from being replayed
+    if (m_submitted.exchange(true) && m_singleUse
+     && !m_warned.exchange(true)) {
       Logger::warn(
         "D3D11: Command list submitted multiple times,\n"
         "       but d3d11.dcSingleUseMode is enabled");
@@ -2,6 +2,8 @@
 
 #include "d3d11_context.h"
 
+#include "../dxvk/dxvk_cs_recorder.h"
+
 namespace dxvk {
   
   class D3D11CommandList : public D3D11DeviceChild<ID3D11CommandList> {
@@ -28,6 +30,10 @@ namespace dxvk {
 
     void AddQuery(
             D3D11Query*         pQuery);
+
+    void MarkSingleUse();
+
+    void MarkDiscard();
     
     void EmitToCommandList(
             ID3D11CommandList*  pCommandList);
@@ -35,6 +41,12 @@ namespace dxvk {
     void EmitToCsThread(
             DxvkCsThread*       CsThread);
     
+    void EmitToRecorder(
+            DxvkCsThread*       CsThread,
+            DxvkCsRecorder*     Recorder);
+    
+    bool CanRecordInParallel() const;
+    
   private:
     
     D3D11Device* const m_device;
@@ -43,6 +55,9 @@ namespace dxvk {
     std::vector<DxvkCsChunkRef>         m_chunks;
     std::vector<Com<D3D11Query, false>> m_queries;
 
+    bool              m_singleUse = false;
+    bool              m_discard   = false;
+
     std::atomic<bool> m_submitted = { false };
     std::atomic<bool> m_warned    = { false };
 
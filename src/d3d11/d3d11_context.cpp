@@ -19,7 +19,7 @@ namespace dxvk {
     m_multithread(this, false),
     m_device    (Device),
     m_csFlags   (CsFlags),
-    m_csChunk   (AllocCsChunk()),
+    m_csChunk   (AllocCsChunk(0)),
     m_cmdData   (nullptr) {
 
   }
@@ -82,6 +82,8 @@ namespace dxvk {
       DiscardBuffer(static_cast<D3D11Buffer*>(pResource));
     else if (resType != D3D11_RESOURCE_DIMENSION_UNKNOWN)
       DiscardTexture(GetCommonTexture(pResource));
+
+    TrackResourceSequenceNumber(pResource);
   }
 
 
@@ -532,6 +534,9 @@ namespace dxvk {
       if (dstTextureInfo->CanUpdateMappedBufferEarly())
         UpdateMappedBuffer(dstTextureInfo, dstSubresource);
     }
+
+    TrackResourceSequenceNumber(pDstResource);
+    TrackResourceSequenceNumber(pSrcResource);
   }
   
   
@@ -639,6 +644,9 @@ namespace dxvk {
         }
       }
     }
+
+    TrackResourceSequenceNumber(pDstResource);
+    TrackResourceSequenceNumber(pSrcResource);
   }
 
 
@@ -669,6 +677,8 @@ namespace dxvk {
         cSrcSlice.offset(),
         sizeof(uint32_t));
     });
+
+    TrackResourceSequenceNumber(pDstBuffer);
   }
 
 
@@ -1166,19 +1176,45 @@ namespace dxvk {
         if (CopyFlags & D3D11_COPY_DISCARD)
           DiscardBuffer(bufferResource);
         
-        DxvkDataSlice dataSlice = AllocUpdateBufferSlice(size);
-        std::memcpy(dataSlice.ptr(), pSrcData, size);
-        
-        EmitCs([
-          cDataBuffer   = std::move(dataSlice),
-          cBufferSlice  = bufferSlice.subSlice(offset, size)
-        ] (DxvkContext* ctx) {
-          ctx->updateBuffer(
-            cBufferSlice.buffer(),
-            cBufferSlice.offset(),
-            cBufferSlice.length(),
-            cDataBuffer.ptr());
-        });
+        // Small updates get written to the command buffer
+        // directly, so staging memory would not help there
+        bool useStaging = size > 4096 || (size & 0x3) || (offset & 0x3);
+
+        DxvkBufferSlice stagingSlice;
+
+        if (useStaging)
+          stagingSlice = AllocStagingBuffer(size);
+
+        if (stagingSlice.defined()) {
+          std::memcpy(stagingSlice.mapPtr(0), pSrcData, size);
+
+          EmitCs([
+            cStagingSlice = std::move(stagingSlice),
+            cBufferSlice  = bufferSlice.subSlice(offset, size)
+          ] (DxvkContext* ctx) {
+            ctx->updateBuffer(
+              cBufferSlice.buffer(),
+              cBufferSlice.offset(),
+              cBufferSlice.length(),
+              cStagingSlice);
+
+            DxvkStagingRing::release(cStagingSlice);
+          });
+        } else {
+          DxvkDataSlice dataSlice = AllocUpdateBufferSlice(size);
+          std::memcpy(dataSlice.ptr(), pSrcData, size);
+          
+          EmitCs([
+            cDataBuffer   = std::move(dataSlice),
+            cBufferSlice  = bufferSlice.subSlice(offset, size)
+          ] (DxvkContext* ctx) {
+            ctx->updateBuffer(
+              cBufferSlice.buffer(),
+              cBufferSlice.offset(),
+              cBufferSlice.length(),
+              cDataBuffer.ptr());
+          });
+        }
       }
     } else {
       const D3D11CommonTexture* textureInfo = GetCommonTexture(pDstResource);
@@ -1226,38 +1262,66 @@ namespace dxvk {
       const VkDeviceSize bytesPerLayer = regionExtent.height * bytesPerRow;
       const VkDeviceSize bytesTotal    = regionExtent.depth  * bytesPerLayer;
       
-      DxvkDataSlice imageDataBuffer = AllocUpdateBufferSlice(bytesTotal);
-      
-      util::packImageData(imageDataBuffer.ptr(), pSrcData,
-        regionExtent, formatInfo->elementSize,
-        SrcRowPitch, SrcDepthPitch);
+      // Packed depth-stencil data needs to be converted on the GPU
+      // first, so only use staging memory for plain image copies
+      DxvkBufferSlice stagingSlice;
+
+      if (layers.aspectMask != (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT))
+        stagingSlice = AllocStagingBuffer(bytesTotal);
       
-      EmitCs([
-        cDstImage         = textureInfo->GetImage(),
-        cDstLayers        = layers,
-        cDstOffset        = offset,
-        cDstExtent        = extent,
-        cSrcData          = std::move(imageDataBuffer),
-        cSrcBytesPerRow   = bytesPerRow,
-        cSrcBytesPerLayer = bytesPerLayer,
-        cPackedFormat     = packedFormat
-      ] (DxvkContext* ctx) {
-        if (cDstLayers.aspectMask != (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)) {
+      if (stagingSlice.defined()) {
+        util::packImageData(stagingSlice.mapPtr(0), pSrcData,
+          regionExtent, formatInfo->elementSize,
+          SrcRowPitch, SrcDepthPitch);
+
+        EmitCs([
+          cDstImage         = textureInfo->GetImage(),
+          cDstLayers        = layers,
+          cDstOffset        = offset,
+          cDstExtent        = extent,
+          cStagingSlice     = std::move(stagingSlice)
+        ] (DxvkContext* ctx) {
           ctx->updateImage(cDstImage, cDstLayers,
-            cDstOffset, cDstExtent, cSrcData.ptr(),
-            cSrcBytesPerRow, cSrcBytesPerLayer);
-        } else {
-          ctx->updateDepthStencilImage(cDstImage, cDstLayers,
-            VkOffset2D { cDstOffset.x,     cDstOffset.y      },
-            VkExtent2D { cDstExtent.width, cDstExtent.height },
-            cSrcData.ptr(), cSrcBytesPerRow, cSrcBytesPerLayer,
-            cPackedFormat);
-        }
-      });
+            cDstOffset, cDstExtent, cStagingSlice);
+
+          DxvkStagingRing::release(cStagingSlice);
+        });
+      } else {
+        DxvkDataSlice imageDataBuffer = AllocUpdateBufferSlice(bytesTotal);
+        
+        util::packImageData(imageDataBuffer.ptr(), pSrcData,
+          regionExtent, formatInfo->elementSize,
+          SrcRowPitch, SrcDepthPitch);
+        
+        EmitCs([
+          cDstImage         = textureInfo->GetImage(),
+          cDstLayers        = layers,
+          cDstOffset        = offset,
+          cDstExtent        = extent,
+          cSrcData          = std::move(imageDataBuffer),
+          cSrcBytesPerRow   = bytesPerRow,
+          cSrcBytesPerLayer = bytesPerLayer,
+          cPackedFormat     = packedFormat
+        ] (DxvkContext* ctx) {
+          if (cDstLayers.aspectMask != (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)) {
+            ctx->updateImage(cDstImage, cDstLayers,
+              cDstOffset, cDstExtent, cSrcData.ptr(),
+              cSrcBytesPerRow, cSrcBytesPerLayer);
+          } else {
+            ctx->updateDepthStencilImage(cDstImage, cDstLayers,
+              VkOffset2D { cDstOffset.x,     cDstOffset.y      },
+              VkExtent2D { cDstExtent.width, cDstExtent.height },
+              cSrcData.ptr(), cSrcBytesPerRow, cSrcBytesPerLayer,
+              cPackedFormat);
+          }
+        });
+      }
 
       if (textureInfo->CanUpdateMappedBufferEarly())
         UpdateMappedBuffer(textureInfo, subresource);
     }
+
+    TrackResourceSequenceNumber(pDstResource);
   }
 
 
@@ -1425,6 +1489,7 @@ namespace dxvk {
   
   void STDMETHODCALLTYPE D3D11DeviceContext::DrawAuto() {
     D3D10DeviceLock lock = LockContext();
+    ApplyShaderVariant();
 
     D3D11Buffer* buffer = m_state.ia.vertexBuffers[0].buffer.ptr();
 
@@ -1449,6 +1514,7 @@ namespace dxvk {
           UINT            VertexCount,
           UINT            StartVertexLocation) {
     D3D10DeviceLock lock = LockContext();
+    ApplyShaderVariant();
 
     EmitCs([=] (DxvkContext* ctx) {
       ctx->draw(
@@ -1463,6 +1529,7 @@ namespace dxvk {
           UINT            StartIndexLocation,
           INT             BaseVertexLocation) {
     D3D10DeviceLock lock = LockContext();
+    ApplyShaderVariant();
     
     EmitCs([=] (DxvkContext* ctx) {
       ctx->drawIndexed(
@@ -1479,6 +1546,7 @@ namespace dxvk {
           UINT            StartVertexLocation,
           UINT            StartInstanceLocation) {
     D3D10DeviceLock lock = LockContext();
+    ApplyShaderVariant();
     
     EmitCs([=] (DxvkContext* ctx) {
       ctx->draw(
@@ -1497,6 +1565,7 @@ namespace dxvk {
           INT             BaseVertexLocation,
           UINT            StartInstanceLocation) {
     D3D10DeviceLock lock = LockContext();
+    ApplyShaderVariant();
     
     EmitCs([=] (DxvkContext* ctx) {
       ctx->drawIndexed(
@@ -1513,6 +1582,7 @@ namespace dxvk {
           ID3D11Buffer*   pBufferForArgs,
           UINT            AlignedByteOffsetForArgs) {
     D3D10DeviceLock lock = LockContext();
+    ApplyShaderVariant();
     SetDrawBuffers(pBufferForArgs, nullptr);
     
     // If possible, batch up multiple indirect draw calls of
@@ -1544,6 +1614,7 @@ namespace dxvk {
           ID3D11Buffer*   pBufferForArgs,
           UINT            AlignedByteOffsetForArgs) {
     D3D10DeviceLock lock = LockContext();
+    ApplyShaderVariant();
     SetDrawBuffers(pBufferForArgs, nullptr);
 
     // If possible, batch up multiple indirect draw calls of
@@ -3355,6 +3426,94 @@ namespace dxvk {
   }
 
   
+  void D3D11DeviceContext::ApplyShaderVariant() {
+    if (likely(!m_variantDirty))
+      return;
+
+    // Don't look up a pending variant again until
+    // the compiler thread has finished another one
+    if (m_variantPending != nullptr
+     && m_variantPending->GetCompiledCount() == m_variantPendingCount)
+      return;
+
+    m_variantDirty   = false;
+    m_variantPending = nullptr;
+
+    auto getShader = [this] (DxbcProgramType programType) {
+      switch (programType) {
+        case DxbcProgramType::VertexShader:   return GetCommonShader(m_state.vs.shader.ptr());
+        case DxbcProgramType::DomainShader:   return GetCommonShader(m_state.ds.shader.ptr());
+        case DxbcProgramType::GeometryShader: return GetCommonShader(m_state.gs.shader.ptr());
+        default: return static_cast<const D3D11CommonShader*>(nullptr);
+      }
+    };
+
+    // Only the last stage before the rasterizer
+    // is specialized for the pixel shader's inputs
+    DxbcProgramType programType = DxbcProgramType::GeometryShader;
+    const D3D11CommonShader* shader = getShader(programType);
+
+    if (shader == nullptr)
+      shader = getShader(programType = DxbcProgramType::DomainShader);
+
+    if (shader == nullptr)
+      shader = getShader(programType = DxbcProgramType::VertexShader);
+
+    Rc<DxvkShader> variant;
+
+    if (shader != nullptr && shader->GetVariants() != nullptr) {
+      const D3D11CommonShader* ps = GetCommonShader(m_state.ps.shader.ptr());
+
+      DxbcSpecInfo specInfo;
+      specInfo.outputMask = ps != nullptr
+        ? ps->GetShader()->interfaceSlots().inputSlots
+        : 0u;
+
+      // Use the generic shader and check again once
+      // the compiler thread has finished a variant
+      uint32_t compiledCount = shader->GetVariants()->GetCompiledCount();
+      variant = shader->GetVariants()->GetVariant(specInfo);
+
+      if (variant == nullptr) {
+        m_variantDirty        = true;
+        m_variantPending      = shader->GetVariants();
+        m_variantPendingCount = compiledCount;
+      }
+    }
+
+    if (m_variantShader == variant && m_variantStage == programType)
+      return;
+
+    // A variant that was requested for a different pixel shader
+    // or stage setup may not export all required outputs, and the
+    // context keeps using it until the new variant is ready
+    if (m_variantShader != nullptr) {
+      const D3D11CommonShader* generic = getShader(m_variantStage);
+
+      EmitCs([
+        cStage  = GetShaderStage(m_variantStage),
+        cShader = generic != nullptr ? generic->GetShader() : nullptr
+      ] (DxvkContext* ctx) {
+        ctx->bindShader(cStage, cShader);
+      });
+    }
+
+    // The context only swaps in the variant once its
+    // pipeline has been compiled for the current state
+    if (variant != nullptr) {
+      EmitCs([
+        cStage  = GetShaderStage(programType),
+        cShader = variant
+      ] (DxvkContext* ctx) {
+        ctx->bindShaderVariant(cStage, cShader);
+      });
+    }
+
+    m_variantStage  = programType;
+    m_variantShader = std::move(variant);
+  }
+
+
   template<DxbcProgramType ShaderStage>
   void D3D11DeviceContext::BindShader(
     const D3D11CommonShader*    pShaderModule) {
@@ -3376,6 +3535,16 @@ namespace dxvk {
       ctx->bindShader        (cStage, cShader);
       ctx->bindResourceBuffer(cSlotId, cSlice);
     });
+
+    // This binds the generic shader, so we may have
+    // to look up a specialized variant again
+    if (ShaderStage != DxbcProgramType::ComputeShader) {
+      m_variantDirty   = true;
+      m_variantPending = nullptr;
+    }
+
+    if (ShaderStage == m_variantStage)
+      m_variantShader = nullptr;
   }
 
 
@@ -3994,6 +4163,20 @@ namespace dxvk {
       }
     });
   }
+
+
+  void D3D11DeviceContext::TrackResourceSequenceNumber(
+          ID3D11Resource*                   pResource) {
+    // Must be called after emitting the commands
+    // that use the resource, since emitting commands
+    // may cause the current chunk to be dispatched
+    uint64_t sequenceNumber = GetCurrentSequenceNumber();
+
+    if (auto buffer = GetCommonBuffer(pResource))
+      buffer->TrackSequenceNumber(sequenceNumber);
+    else if (auto texture = GetCommonTexture(pResource))
+      texture->TrackSequenceNumber(sequenceNumber);
+  }
   
   
   bool D3D11DeviceContext::TestRtvUavHazards(
@@ -4240,8 +4423,14 @@ namespace dxvk {
   }
   
   
-  DxvkCsChunkRef D3D11DeviceContext::AllocCsChunk() {
-    return m_parent->AllocCsChunk(m_csFlags);
+  DxvkCsChunkRef D3D11DeviceContext::AllocCsChunk(size_t CmdSize) {
+    return m_parent->AllocCsChunk(m_csSizer.getSizeClass(CmdSize));
+  }
+  
+  
+  void D3D11DeviceContext::EndCsFrame() {
+    m_device->addStatCounters(m_csSizer.statCounters());
+    m_csSizer.endFrame();
   }
   
 
@@ -711,10 +711,17 @@ namespace dxvk {
     Rc<DxvkDataBuffer>          m_updateBuffer;
     
     DxvkCsChunkFlags            m_csFlags;
+    DxvkCsChunkSizer            m_csSizer;
     DxvkCsChunkRef              m_csChunk;
     
     D3D11ContextState           m_state;
     D3D11CmdData*               m_cmdData;
+
+    bool                        m_variantDirty = false;
+    DxbcProgramType             m_variantStage = DxbcProgramType::VertexShader;
+    Rc<DxvkShader>              m_variantShader;
+    Rc<D3D11ShaderVariantSet>   m_variantPending;
+    uint32_t                    m_variantPendingCount = 0;
     
     void ApplyInputLayout();
     
@@ -732,6 +739,8 @@ namespace dxvk {
     
     void ApplyViewportState();
 
+    void ApplyShaderVariant();
+
     template<DxbcProgramType ShaderStage>
     void BindShader(
       const D3D11CommonShader*                pShaderModule);
@@ -853,6 +862,9 @@ namespace dxvk {
     void UpdateMappedBuffer(
       const D3D11CommonTexture*               pTexture,
             VkImageSubresource                Subresource);
+
+    void TrackResourceSequenceNumber(
+            ID3D11Resource*                   pResource);
     
     bool TestRtvUavHazards(
             UINT                              NumRTVs,
@@ -894,7 +906,9 @@ namespace dxvk {
     
     DxvkDataSlice AllocUpdateBufferSlice(size_t Size);
     
-    DxvkCsChunkRef AllocCsChunk();
+    DxvkCsChunkRef AllocCsChunk(size_t CmdSize);
+    
+    void EndCsFrame();
     
     static void InitDefaultPrimitiveTopology(
             DxvkInputAssemblyState*           pIaState);
@@ -925,9 +939,7 @@ namespace dxvk {
       m_cmdData = nullptr;
 
       if (unlikely(!m_csChunk->push(command))) {
-        EmitCsChunk(std::move(m_csChunk));
-        
-        m_csChunk = AllocCsChunk();
+        SubmitCsChunk(sizeof(DxvkCsTypedCmd<Cmd>));
         m_csChunk->push(command);
       }
     }
@@ -938,9 +950,7 @@ namespace dxvk {
         command, std::forward<Args>(args)...);
 
       if (unlikely(!data)) {
-        EmitCsChunk(std::move(m_csChunk));
-        
-        m_csChunk = AllocCsChunk();
+        SubmitCsChunk(sizeof(DxvkCsDataCmd<Cmd, M>));
         data = m_csChunk->pushCmd<M, Cmd, Args...>(
           command, std::forward<Args>(args)...);
       }
@@ -951,13 +961,23 @@ namespace dxvk {
     
     void FlushCsChunk() {
       if (likely(!m_csChunk->empty())) {
-        EmitCsChunk(std::move(m_csChunk));
-        m_csChunk = AllocCsChunk();
+        SubmitCsChunk(0);
         m_cmdData = nullptr;
       }
     }
     
+    void SubmitCsChunk(size_t CmdSize) {
+      m_csSizer.addChunk(m_csChunk);
+      EmitCsChunk(std::move(m_csChunk));
+      m_csChunk = AllocCsChunk(CmdSize);
+    }
+    
     virtual void EmitCsChunk(DxvkCsChunkRef&& chunk) = 0;
+
+    virtual uint64_t GetCurrentSequenceNumber() = 0;
+
+    virtual DxvkBufferSlice AllocStagingBuffer(
+            VkDeviceSize                      Size) = 0;
     
   };
   
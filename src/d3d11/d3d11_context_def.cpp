@@ -143,6 +143,10 @@ namespace dxvk {
     FinalizeQueries();
     FlushCsChunk();
     
+    // Treat each command list like a frame
+    // for the purpose of chunk size tracking
+    EndCsFrame();
+    
     if (ppCommandList != nullptr)
       *ppCommandList = m_commandList.ref();
     m_commandList = CreateCommandList();
@@ -249,6 +253,9 @@ namespace dxvk {
     pMapEntry->MapType      = D3D11_MAP_WRITE_DISCARD;
     pMapEntry->RowPitch     = pBuffer->Desc()->ByteWidth;
     pMapEntry->DepthPitch   = pBuffer->Desc()->ByteWidth;
+
+    // Both paths rename the buffer at execution time
+    m_commandList->MarkDiscard();
     
     if (likely(pBuffer->Desc()->Usage == D3D11_USAGE_DYNAMIC && m_csFlags.test(DxvkCsChunkFlag::SingleUse))) {
       // For resources that cannot be written by the GPU,
@@ -257,6 +264,9 @@ namespace dxvk {
       auto bufferSlice = pBuffer->AllocSlice();
       pMapEntry->MapPointer = bufferSlice.mapPtr;
 
+      // The slice can only be swapped in once
+      m_commandList->MarkSingleUse();
+
       EmitCs([
         cDstBuffer = pBuffer->GetBuffer(),
         cPhysSlice = bufferSlice
@@ -391,6 +401,22 @@ namespace dxvk {
   }
 
 
+  uint64_t D3D11DeferredContext::GetCurrentSequenceNumber() {
+    // We do not know when the command list will be
+    // executed, so we have to synchronize with any
+    // chunk that may use the resource
+    return DxvkCsThread::SynchronizeAll;
+  }
+
+
+  DxvkBufferSlice D3D11DeferredContext::AllocStagingBuffer(
+          VkDeviceSize                      Size) {
+    // Command lists may be executed any number of times,
+    // so update data has to be stored within the list
+    return DxvkBufferSlice();
+  }
+
+
   DxvkCsChunkFlags D3D11DeferredContext::GetCsChunkFlags(
           D3D11Device*                  pDevice) {
     return pDevice->GetOptions()->dcSingleUseMode
@@ -115,6 +115,11 @@ namespace dxvk {
     
     void EmitCsChunk(DxvkCsChunkRef&& chunk);
 
+    uint64_t GetCurrentSequenceNumber();
+
+    DxvkBufferSlice AllocStagingBuffer(
+            VkDeviceSize                      Size);
+
     static DxvkCsChunkFlags GetCsChunkFlags(
             D3D11Device*                  pDevice);
     
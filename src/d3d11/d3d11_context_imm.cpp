@@ -13,7 +13,8 @@ namespace dxvk {
           D3D11Device*    pParent,
     const Rc<DxvkDevice>& Device)
   : D3D11DeviceContext(pParent, Device, DxvkCsChunkFlag::SingleUse),
-    m_csThread(Device->createContext()) {
+    m_csThread(Device->createContext()),
+    m_staging(Device) {
     EmitCs([
       cDevice          = m_device,
       cRelaxedBarriers = pParent->GetOptions()->relaxedBarriers
@@ -25,12 +26,30 @@ namespace dxvk {
     });
     
     ClearState();
+
+    int32_t numRecordingThreads = pParent->GetOptions()->numRecordingThreads;
+
+    if (numRecordingThreads > 0) {
+      DxvkBarrierControlFlags barrierControl;
+
+      if (pParent->GetOptions()->relaxedBarriers)
+        barrierControl.set(DxvkBarrierControl::IgnoreWriteAfterWrite);
+
+      m_recorder = std::make_unique<DxvkCsRecorder>(
+        Device, uint32_t(numRecordingThreads), barrierControl);
+
+      EmitCs([
+        cRecorder = m_recorder.get()
+      ] (DxvkContext* ctx) {
+        ctx->setRecorder(cRecorder);
+      });
+    }
   }
   
   
   D3D11ImmediateContext::~D3D11ImmediateContext() {
     Flush();
-    SynchronizeCsThread();
+    SynchronizeCsThread(DxvkCsThread::SynchronizeAll);
     SynchronizeDevice();
   }
   
@@ -205,7 +224,10 @@ namespace dxvk {
     
     // Dispatch command list to the CS thread and
     // restore the immediate context's state
-    commandList->EmitToCsThread(&m_csThread);
+    if (m_recorder && commandList->CanRecordInParallel())
+      commandList->EmitToRecorder(&m_csThread, m_recorder.get());
+    else
+      commandList->EmitToCsThread(&m_csThread);
     
     if (RestoreContextState)
       RestoreState();
@@ -367,7 +389,7 @@ namespace dxvk {
     } else {
       // Wait until the resource is no longer in use
       if (MapType != D3D11_MAP_WRITE_NO_OVERWRITE) {
-        if (!WaitForResource(pResource->GetBuffer(), MapType, MapFlags))
+        if (!WaitForResource(pResource->GetBuffer(), pResource->GetSequenceNumber(), MapType, MapFlags))
           return DXGI_ERROR_WAS_STILL_DRAWING;
       }
 
@@ -422,7 +444,7 @@ namespace dxvk {
       const VkImageType imageType = mappedImage->info().type;
       
       // Wait for the resource to become available
-      if (!WaitForResource(mappedImage, MapType, MapFlags))
+      if (!WaitForResource(mappedImage, pResource->GetSequenceNumber(), MapType, MapFlags))
         return DXGI_ERROR_WAS_STILL_DRAWING;
       
       // Mark the given subresource as mapped
@@ -462,11 +484,12 @@ namespace dxvk {
         if (pResource->Desc()->Usage == D3D11_USAGE_STAGING
          && !pResource->CanUpdateMappedBufferEarly()) {
           UpdateMappedBuffer(pResource, subresource);
+          pResource->TrackSequenceNumber(GetCurrentSequenceNumber());
           MapFlags &= ~D3D11_MAP_FLAG_DO_NOT_WAIT;
         }
         
         // Wait for mapped buffer to become available
-        if (!WaitForResource(mappedBuffer, MapType, MapFlags))
+        if (!WaitForResource(mappedBuffer, pResource->GetSequenceNumber(), MapType, MapFlags))
           return DXGI_ERROR_WAS_STILL_DRAWING;
         
         physSlice = mappedBuffer->getSliceHandle();
@@ -537,6 +560,8 @@ namespace dxvk {
             cSrcBuffer, 0, cPackedFormat);
         }
       });
+
+      pResource->TrackSequenceNumber(GetCurrentSequenceNumber());
     }
   }
   
@@ -567,15 +592,37 @@ namespace dxvk {
   }
 
 
-  void D3D11ImmediateContext::SynchronizeCsThread() {
+  void D3D11ImmediateContext::SynchronizeCsThread(uint64_t SequenceNumber) {
     D3D10DeviceLock lock = LockContext();
 
     // Dispatch current chunk so that all commands
-    // recorded prior to this function will be run
-    FlushCsChunk();
+    // recorded prior to this function will be run,
+    // unless the chunk we wait for is already queued
+    if (SequenceNumber > m_csThread.lastSequenceNumber())
+      FlushCsChunk();
     
     if (m_csThread.isBusy())
-      m_csThread.synchronize();
+      m_csThread.synchronize(SequenceNumber);
+
+    // Command lists dispatched to the recorder only
+    // track their resources once they are recorded
+    if (m_recorder)
+      m_recorder->synchronize();
+  }
+  
+  
+  void D3D11ImmediateContext::EndFrame() {
+    D3D10DeviceLock lock = LockContext();
+
+    // Defragmentation must run on the CS thread since it
+    // replaces the backing storage of device-local buffers
+    if (m_device->memoryDefrag()) {
+      EmitCs([] (DxvkContext* ctx) {
+        ctx->defragMemory();
+      });
+    }
+
+    EndCsFrame();
   }
   
   
@@ -586,6 +633,7 @@ namespace dxvk {
   
   bool D3D11ImmediateContext::WaitForResource(
     const Rc<DxvkResource>&                 Resource,
+          uint64_t                          SequenceNumber,
           D3D11_MAP                         MapType,
           UINT                              MapFlags) {
     // Some games might not work correctly when a map
@@ -598,11 +646,11 @@ namespace dxvk {
       ? DxvkAccess::Write
       : DxvkAccess::Read;
     
-    // Wait for the any pending D3D11 command to be executed
-    // on the CS thread so that we can determine whether the
-    // resource is currently in use or not.
+    // Wait for the last D3D11 command using the resource to
+    // be executed on the CS thread so that we can determine
+    // whether the resource is currently in use or not.
     if (!Resource->isInUse(access))
-      SynchronizeCsThread();
+      SynchronizeCsThread(SequenceNumber);
     
     if (Resource->isInUse(access)) {
       if (MapFlags & D3D11_MAP_FLAG_DO_NOT_WAIT) {
@@ -613,12 +661,19 @@ namespace dxvk {
         return false;
       } else {
         // Make sure pending commands using the resource get
-        // executed on the the GPU if we have to wait for it
+        // executed on the the GPU if we have to wait for it.
+        // The submission is done by the chunk that Flush just
+        // dispatched, so wait for that rather than the chunk
+        // that last used the resource.
         Flush();
-        SynchronizeCsThread();
+        SynchronizeCsThread(m_csThread.lastSequenceNumber());
         
-        while (Resource->isInUse(access))
-          dxvk::this_thread::yield();
+        // Block until a submission that uses the resource
+        // completes rather than spinning on the use count
+        if (!m_device->waitForResource(Resource, access)) {
+          while (Resource->isInUse(access))
+            dxvk::this_thread::yield();
+        }
       }
     }
     
@@ -632,6 +687,18 @@ namespace dxvk {
   }
 
 
+  uint64_t D3D11ImmediateContext::GetCurrentSequenceNumber() {
+    // The current chunk will be dispatched next
+    return m_csThread.lastSequenceNumber() + 1;
+  }
+
+
+  DxvkBufferSlice D3D11ImmediateContext::AllocStagingBuffer(
+          VkDeviceSize                      Size) {
+    return m_staging.alloc(CACHE_LINE_SIZE, Size);
+  }
+
+
   void D3D11ImmediateContext::FlushImplicit(BOOL StrongHint) {
     // Flush only if the GPU is about to go idle, in
     // order to keep the number of submissions low.
@@ -5,6 +5,8 @@
 #include "d3d11_context.h"
 #include "d3d11_state_object.h"
 
+#include "../dxvk/dxvk_cs_recorder.h"
+
 namespace dxvk {
   
   class D3D11Buffer;
@@ -107,12 +109,19 @@ namespace dxvk {
            ID3DDeviceContextState*           pState,
            ID3DDeviceContextState**          ppPreviousState);
 
-    void SynchronizeCsThread();
+    void SynchronizeCsThread(
+            uint64_t                          SequenceNumber);
+    
+    void EndFrame();
     
   private:
     
-    DxvkCsThread m_csThread;
-    bool         m_csIsBusy = false;
+    DxvkCsThread    m_csThread;
+    bool            m_csIsBusy = false;
+
+    DxvkStagingRing m_staging;
+
+    std::unique_ptr<DxvkCsRecorder> m_recorder;
 
     std::atomic<uint32_t> m_refCount = { 0 };
 
@@ -142,11 +151,17 @@ namespace dxvk {
     
     bool WaitForResource(
       const Rc<DxvkResource>&                 Resource,
+            uint64_t                          SequenceNumber,
             D3D11_MAP                         MapType,
             UINT                              MapFlags);
     
     void EmitCsChunk(DxvkCsChunkRef&& chunk);
 
+    uint64_t GetCurrentSequenceNumber();
+
+    DxvkBufferSlice AllocStagingBuffer(
+            VkDeviceSize                      Size);
+
     void FlushImplicit(BOOL StrongHint);
     
   };
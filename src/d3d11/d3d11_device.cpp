@@ -43,10 +43,14 @@ namespace dxvk {
     m_initializer = new D3D11Initializer(this);
     m_context     = new D3D11ImmediateContext(this, m_dxvkDevice);
     m_d3d10Device = new D3D10Device(this, m_context);
+
+    if (m_d3d11Options.specializeShaders)
+      m_variantCompiler = new D3D11ShaderVariantCompiler(this);
   }
   
   
   D3D11Device::~D3D11Device() {
+    delete m_variantCompiler;
     delete m_d3d10Device;
     delete m_context;
     delete m_initializer;
@@ -713,6 +717,7 @@ namespace dxvk {
     moduleInfo.options = m_dxbcOptions;
     moduleInfo.tess    = nullptr;
     moduleInfo.xfb     = nullptr;
+    moduleInfo.spec    = nullptr;
 
     Sha1Hash hash = Sha1Hash::compute(
       pShaderBytecode, BytecodeLength);
@@ -745,6 +750,7 @@ namespace dxvk {
     moduleInfo.options = m_dxbcOptions;
     moduleInfo.tess    = nullptr;
     moduleInfo.xfb     = nullptr;
+    moduleInfo.spec    = nullptr;
 
     Sha1Hash hash = Sha1Hash::compute(
       pShaderBytecode, BytecodeLength);
@@ -850,6 +856,7 @@ namespace dxvk {
     moduleInfo.options = m_dxbcOptions;
     moduleInfo.tess    = nullptr;
     moduleInfo.xfb     = &xfb;
+    moduleInfo.spec    = nullptr;
     
     HRESULT hr = CreateShaderModule(&module,
       DxvkShaderKey(VK_SHADER_STAGE_GEOMETRY_BIT, hash),
@@ -879,6 +886,7 @@ namespace dxvk {
     moduleInfo.options = m_dxbcOptions;
     moduleInfo.tess    = nullptr;
     moduleInfo.xfb     = nullptr;
+    moduleInfo.spec    = nullptr;
 
     Sha1Hash hash = Sha1Hash::compute(
       pShaderBytecode, BytecodeLength);
@@ -915,6 +923,7 @@ namespace dxvk {
     moduleInfo.options = m_dxbcOptions;
     moduleInfo.tess    = nullptr;
     moduleInfo.xfb     = nullptr;
+    moduleInfo.spec    = nullptr;
 
     if (tessInfo.maxTessFactor >= 8.0f)
       moduleInfo.tess = &tessInfo;
@@ -949,6 +958,7 @@ namespace dxvk {
     moduleInfo.options = m_dxbcOptions;
     moduleInfo.tess    = nullptr;
     moduleInfo.xfb     = nullptr;
+    moduleInfo.spec    = nullptr;
 
     Sha1Hash hash = Sha1Hash::compute(
       pShaderBytecode, BytecodeLength);
@@ -980,6 +990,7 @@ namespace dxvk {
     moduleInfo.options = m_dxbcOptions;
     moduleInfo.tess    = nullptr;
     moduleInfo.xfb     = nullptr;
+    moduleInfo.spec    = nullptr;
 
     Sha1Hash hash = Sha1Hash::compute(
       pShaderBytecode, BytecodeLength);
@@ -407,8 +407,8 @@ namespace dxvk {
             DXGI_FORMAT           Format,
             DXGI_VK_FORMAT_MODE   Mode) const;
     
-    DxvkCsChunkRef AllocCsChunk(DxvkCsChunkFlags flags) {
-      DxvkCsChunk* chunk = m_csChunkPool.allocChunk(flags);
+    DxvkCsChunkRef AllocCsChunk(uint32_t sizeClass) {
+      DxvkCsChunk* chunk = m_csChunkPool.allocChunk(sizeClass);
       return DxvkCsChunkRef(chunk, &m_csChunkPool);
     }
     
@@ -416,6 +416,10 @@ namespace dxvk {
       return &m_d3d11Options;
     }
 
+    D3D11ShaderVariantCompiler* GetShaderVariantCompiler() const {
+      return m_variantCompiler;
+    }
+
     D3D10Device* GetD3D10Interface() const {
       return m_d3d10Device;
     }
@@ -445,6 +449,7 @@ namespace dxvk {
     DxvkCsChunkPool                 m_csChunkPool;
     
     D3D11Initializer*               m_initializer = nullptr;
+    D3D11ShaderVariantCompiler*     m_variantCompiler = nullptr;
     D3D11ImmediateContext*          m_context     = nullptr;
     D3D10Device*                    m_d3d10Device = nullptr;
 
@@ -8,10 +8,12 @@ namespace dxvk {
   D3D11Initializer::D3D11Initializer(
           D3D11Device*                pParent)
   : m_parent(pParent),
-    m_device(pParent->GetDXVKDevice()),
-    m_context(m_device->createContext()) {
-    m_context->beginRecording(
-      m_device->createCommandList());
+    m_device(pParent->GetDXVKDevice()) {
+    // Contexts are only created when multiple threads
+    // initialize resources at the same time, so there
+    // is no overhead for single-threaded applications
+    m_contextCount = std::max<size_t>(1, std::min<size_t>(
+      MaxContexts, dxvk::thread::hardware_concurrency()));
   }
 
   
@@ -21,10 +23,13 @@ namespace dxvk {
 
 
   void D3D11Initializer::Flush() {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_contextCount; i++) {
+      D3D11InitContext* ctx = &m_contexts[i];
+      std::lock_guard<std::mutex> lock(ctx->mutex);
 
-    if (m_transferCommands != 0)
-      FlushInternal();
+      if (ctx->transferCommands != 0)
+        FlushInternal(ctx);
+    }
   }
 
   void D3D11Initializer::InitBuffer(
@@ -50,28 +55,29 @@ namespace dxvk {
   void D3D11Initializer::InitDeviceLocalBuffer(
           D3D11Buffer*                pBuffer,
     const D3D11_SUBRESOURCE_DATA*     pInitialData) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_lock<std::mutex> lock;
+    D3D11InitContext* ctx = AcquireContext(lock);
 
     DxvkBufferSlice bufferSlice = pBuffer->GetBufferSlice();
 
     if (pInitialData != nullptr && pInitialData->pSysMem != nullptr) {
-      m_transferMemory   += bufferSlice.length();
-      m_transferCommands += 1;
+      ctx->transferMemory   += bufferSlice.length();
+      ctx->transferCommands += 1;
       
-      m_context->uploadBuffer(
+      ctx->context->uploadBuffer(
         bufferSlice.buffer(),
         pInitialData->pSysMem);
     } else {
-      m_transferCommands += 1;
+      ctx->transferCommands += 1;
 
-      m_context->clearBuffer(
+      ctx->context->clearBuffer(
         bufferSlice.buffer(),
         bufferSlice.offset(),
         bufferSlice.length(),
         0u);
     }
 
-    FlushImplicit();
+    FlushImplicit(ctx);
   }
 
 
@@ -99,7 +105,8 @@ namespace dxvk {
   void D3D11Initializer::InitDeviceLocalTexture(
           D3D11CommonTexture*         pTexture,
     const D3D11_SUBRESOURCE_DATA*     pInitialData) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_lock<std::mutex> lock;
+    D3D11InitContext* ctx = AcquireContext(lock);
     
     Rc<DxvkImage> image = pTexture->GetImage();
 
@@ -126,18 +133,18 @@ namespace dxvk {
           VkOffset3D mipLevelOffset = { 0, 0, 0 };
           VkExtent3D mipLevelExtent = image->mipLevelExtent(level);
 
-          m_transferCommands += 1;
-          m_transferMemory   += util::computeImageDataSize(
+          ctx->transferCommands += 1;
+          ctx->transferMemory   += util::computeImageDataSize(
             image->info().format, mipLevelExtent);
           
           if (formatInfo->aspectMask != (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)) {
-            m_context->uploadImage(
+            ctx->context->uploadImage(
               image, subresourceLayers,
               pInitialData[id].pSysMem,
               pInitialData[id].SysMemPitch,
               pInitialData[id].SysMemSlicePitch);
           } else {
-            m_context->updateDepthStencilImage(
+            ctx->context->updateDepthStencilImage(
               image, subresourceLayers,
               VkOffset2D { mipLevelOffset.x,     mipLevelOffset.y      },
               VkExtent2D { mipLevelExtent.width, mipLevelExtent.height },
@@ -155,7 +162,7 @@ namespace dxvk {
         }
       }
     } else {
-      m_transferCommands += 1;
+      ctx->transferCommands += 1;
       
       // While the Microsoft docs state that resource contents are
       // undefined if no initial data is provided, some applications
@@ -169,25 +176,25 @@ namespace dxvk {
       subresources.layerCount     = image->info().numLayers;
 
       if (formatInfo->flags.test(DxvkFormatFlag::BlockCompressed)) {
-        m_context->clearCompressedColorImage(image, subresources);
+        ctx->context->clearCompressedColorImage(image, subresources);
       } else {
         if (subresources.aspectMask == VK_IMAGE_ASPECT_COLOR_BIT) {
           VkClearColorValue value = { };
 
-          m_context->clearColorImage(
+          ctx->context->clearColorImage(
             image, value, subresources);
         } else {
           VkClearDepthStencilValue value;
           value.depth   = 0.0f;
           value.stencil = 0;
           
-          m_context->clearDepthStencilImage(
+          ctx->context->clearDepthStencilImage(
             image, value, subresources);
         }
       }
     }
 
-    FlushImplicit();
+    FlushImplicit(ctx);
   }
 
 
@@ -232,7 +239,8 @@ namespace dxvk {
     }
 
     // Initialize the image on the GPU
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_lock<std::mutex> lock;
+    D3D11InitContext* ctx = AcquireContext(lock);
 
     VkImageSubresourceRange subresources;
     subresources.aspectMask     = image->formatInfo()->aspectMask;
@@ -241,25 +249,55 @@ namespace dxvk {
     subresources.baseArrayLayer = 0;
     subresources.layerCount     = image->info().numLayers;
     
-    m_context->initImage(image, subresources, VK_IMAGE_LAYOUT_PREINITIALIZED);
+    ctx->context->initImage(image, subresources, VK_IMAGE_LAYOUT_PREINITIALIZED);
+
+    ctx->transferCommands += 1;
+    FlushImplicit(ctx);
+  }
+
+
+  D3D11InitContext* D3D11Initializer::AcquireContext(
+          std::unique_lock<std::mutex>& Lock) {
+    // Pick the first context that is not in use by
+    // another thread, and only block if all are busy
+    D3D11InitContext* ctx = nullptr;
+
+    for (size_t i = 0; i < m_contextCount && !ctx; i++) {
+      Lock = std::unique_lock<std::mutex>(m_contexts[i].mutex, std::try_to_lock);
+
+      if (Lock.owns_lock())
+        ctx = &m_contexts[i];
+    }
+
+    if (!ctx) {
+      ctx = &m_contexts[(m_contextIndex++) % m_contextCount];
+      Lock = std::unique_lock<std::mutex>(ctx->mutex);
+    }
+
+    if (unlikely(ctx->context == nullptr)) {
+      ctx->context = m_device->createContext();
+      ctx->context->beginRecording(
+        m_device->createCommandList());
+    }
 
-    m_transferCommands += 1;
-    FlushImplicit();
+    return ctx;
   }
 
 
-  void D3D11Initializer::FlushImplicit() {
-    if (m_transferCommands > MaxTransferCommands
-     || m_transferMemory   > MaxTransferMemory)
-      FlushInternal();
+  void D3D11Initializer::FlushImplicit(
+          D3D11InitContext*           pContext) {
+    if (pContext->transferCommands > MaxTransferCommands
+     || pContext->transferMemory   > MaxTransferMemory)
+      FlushInternal(pContext);
   }
 
 
-  void D3D11Initializer::FlushInternal() {
-    m_context->flushCommandList();
+  void D3D11Initializer::FlushInternal(
+          D3D11InitContext*           pContext) {
+    pContext->context->flushCommandList();
     
-    m_transferCommands = 0;
-    m_transferMemory   = 0;
+    pContext->transferCommands = 0;
+    pContext->transferMemory   = 0;
   }
 
 }
\ No newline at end of file
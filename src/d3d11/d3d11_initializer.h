@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
+
 #include "d3d11_buffer.h"
 #include "d3d11_texture.h"
 
@@ -7,17 +11,42 @@ namespace dxvk {
 
   class D3D11Device;
 
+  /**
+   * \brief Initialization context
+   * 
+   * Context used by a single thread at a time
+   * to record resource initialization commands.
+   */
+  struct D3D11InitContext {
+    std::mutex        mutex;
+    Rc<DxvkContext>   context;
+
+    size_t            transferCommands  = 0;
+    size_t            transferMemory    = 0;
+  };
+
   /**
    * \brief Resource initialization context
    * 
-   * Manages a context which is used for resource
-   * initialization. This includes initialization
+   * Manages a set of contexts which are used for
+   * resource initialization. This includes init
    * with application-defined data, as well as
    * zero-initialization for buffers and images.
+   * 
+   * Threads creating resources concurrently will
+   * record their commands into different contexts,
+   * which are created on demand. Uploads are
+   * recorded into the transfer command buffer, so
+   * they run on the dedicated transfer queue if
+   * the device has one. All pending commands are
+   * submitted before any commands that the
+   * immediate context submits, so resources are
+   * always initialized before their first use.
    */
   class D3D11Initializer {
     constexpr static size_t MaxTransferMemory    = 32 * 1024 * 1024;
     constexpr static size_t MaxTransferCommands  = 512;
+    constexpr static size_t MaxContexts          = 4;
   public:
 
     D3D11Initializer(
@@ -37,14 +66,13 @@ namespace dxvk {
     
   private:
 
-    std::mutex        m_mutex;
-
     D3D11Device*      m_parent;
     Rc<DxvkDevice>    m_device;
-    Rc<DxvkContext>   m_context;
 
-    size_t            m_transferCommands  = 0;
-    size_t            m_transferMemory    = 0;
+    size_t                    m_contextCount = 1;
+    std::atomic<size_t>       m_contextIndex = { 0u };
+
+    std::array<D3D11InitContext, MaxContexts> m_contexts;
 
     void InitDeviceLocalBuffer(
             D3D11Buffer*                pBuffer,
@@ -62,8 +90,14 @@ namespace dxvk {
             D3D11CommonTexture*         pTexture,
       const D3D11_SUBRESOURCE_DATA*     pInitialData);
     
-    void FlushImplicit();
-    void FlushInternal();
+    D3D11InitContext* AcquireContext(
+            std::unique_lock<std::mutex>& Lock);
+
+    void FlushImplicit(
+            D3D11InitContext*           pContext);
+
+    void FlushInternal(
+            D3D11InitContext*           pContext);
 
   };
 
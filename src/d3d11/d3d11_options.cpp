@@ -9,8 +9,11 @@ namespace dxvk {
 
     this->allowMapFlagNoWait    = config.getOption<bool>("d3d11.allowMapFlagNoWait", true);
     this->dcSingleUseMode       = config.getOption<bool>("d3d11.dcSingleUseMode", true);
+    this->numRecordingThreads   = config.getOption<int32_t>("d3d11.numRecordingThreads", 0);
     this->strictDivision           = config.getOption<bool>("d3d11.strictDivision", false);
     this->zeroInitWorkgroupMemory  = config.getOption<bool>("d3d11.zeroInitWorkgroupMemory", false);
+    this->optimizeShaders          = config.getOption<bool>("d3d11.optimizeShaders", false);
+    this->specializeShaders        = config.getOption<bool>("d3d11.specializeShaders", false);
     this->relaxedBarriers       = config.getOption<bool>("d3d11.relaxedBarriers", false);
     this->maxTessFactor         = config.getOption<int32_t>("d3d11.maxTessFactor", 0);
     this->samplerAnisotropy     = config.getOption<int32_t>("d3d11.samplerAnisotropy", -1);
@@ -27,6 +27,15 @@ namespace dxvk {
     /// than once.
     bool dcSingleUseMode;
 
+    /// Number of threads that record command lists
+    ///
+    /// Command lists executed on the immediate context are
+    /// recorded into separate Vulkan command buffers on
+    /// worker threads. May cause issues if command lists
+    /// depend on buffers discarded by other command lists.
+    /// A value of 0 disables parallel recording.
+    int32_t numRecordingThreads;
+
     /// Enables sm4-compliant division-by-zero behaviour
     /// Windows drivers don't normally do this, but some
     /// games may expect correct behaviour.
@@ -43,6 +52,14 @@ namespace dxvk {
     /// TGSM in compute shaders before reading it.
     bool zeroInitWorkgroupMemory;
 
+    /// Run SPIR-V optimization passes on translated
+    /// shaders before passing them to the driver
+    bool optimizeShaders;
+
+    /// Compile specialized variants of shaders in the
+    /// background and use them once they are ready
+    bool specializeShaders;
+
     /// Use relaxed memory barriers
     ///
     /// May improve performance in some games,
@@ -14,39 +14,58 @@ namespace dxvk {
     const void*           pShaderBytecode,
           size_t          BytecodeLength) {
     const std::string name = pShaderKey->toString();
-    Logger::debug(str::format("Compiling shader ", name));
     
-    DxbcReader reader(
-      reinterpret_cast<const char*>(pShaderBytecode),
-      BytecodeLength);
-    
-    DxbcModule module(reader);
-    
-    // If requested by the user, dump both the raw DXBC
-    // shader and the compiled SPIR-V module to a file.
-    const std::string dumpPath = env::getEnvVar("DXVK_SHADER_DUMP_PATH");
-    
-    if (dumpPath.size() != 0) {
-      reader.store(std::ofstream(str::format(dumpPath, "/", name, ".dxbc"),
-        std::ios_base::binary | std::ios_base::trunc));
+    // Check the persistent shader cache first, this
+    // allows us to skip shader compilation entirely
+    Rc<DxvkShaderCache> shaderCache = pDevice->GetDXVKDevice()->shaderCache();
+
+    DxvkShaderCacheKey cacheKey;
+
+    if (shaderCache != nullptr) {
+      cacheKey.shader  = *pShaderKey;
+      cacheKey.variant = ComputeModuleInfoHash(pDxbcModuleInfo);
+
+      m_shader = shaderCache->lookup(cacheKey);
     }
-    
-    // Decide whether we need to create a pass-through
-    // geometry shader for vertex shader stream output
-    bool passthroughShader = pDxbcModuleInfo->xfb != nullptr
-      && module.programInfo().type() != DxbcProgramType::GeometryShader;
-
-    m_shader = passthroughShader
-      ? module.compilePassthroughShader(*pDxbcModuleInfo, name)
-      : module.compile                 (*pDxbcModuleInfo, name);
-    m_shader->setShaderKey(*pShaderKey);
-    
-    if (dumpPath.size() != 0) {
-      std::ofstream dumpStream(
-        str::format(dumpPath, "/", name, ".spv"),
-        std::ios_base::binary | std::ios_base::trunc);
+
+    if (m_shader == nullptr) {
+      Logger::debug(str::format("Compiling shader ", name));
+      
+      DxbcReader reader(
+        reinterpret_cast<const char*>(pShaderBytecode),
+        BytecodeLength);
+      
+      DxbcModule module(reader);
       
-      m_shader->dump(dumpStream);
+      // If requested by the user, dump both the raw DXBC
+      // shader and the compiled SPIR-V module to a file.
+      const std::string dumpPath = env::getEnvVar("DXVK_SHADER_DUMP_PATH");
+      
+      if (dumpPath.size() != 0) {
+        reader.store(std::ofstream(str::format(dumpPath, "/", name, ".dxbc"),
+          std::ios_base::binary | std::ios_base::trunc));
+      }
+      
+      // Decide whether we need to create a pass-through
+      // geometry shader for vertex shader stream output
+      bool passthroughShader = pDxbcModuleInfo->xfb != nullptr
+        && module.programInfo().type() != DxbcProgramType::GeometryShader;
+
+      m_shader = passthroughShader
+        ? module.compilePassthroughShader(*pDxbcModuleInfo, name)
+        : module.compile                 (*pDxbcModuleInfo, name);
+      m_shader->setShaderKey(*pShaderKey);
+      
+      if (dumpPath.size() != 0) {
+        std::ofstream dumpStream(
+          str::format(dumpPath, "/", name, ".spv"),
+          std::ios_base::binary | std::ios_base::trunc);
+        
+        m_shader->dump(dumpStream);
+      }
+
+      if (shaderCache != nullptr)
+        shaderCache->add(cacheKey, m_shader);
     }
     
     // Create shader constant buffer if necessary
@@ -69,9 +88,99 @@ namespace dxvk {
         m_shader->shaderConstants().sizeInBytes());
     }
 
+    // Shaders that feed the rasterizer can be specialized
+    // for the pixel shader that they are used with
+    D3D11ShaderVariantCompiler* variantCompiler = pDevice->GetShaderVariantCompiler();
+
+    bool hasVariants = variantCompiler != nullptr
+      && pDxbcModuleInfo->xfb  == nullptr
+      && pDxbcModuleInfo->spec == nullptr
+      && (m_shader->stage() == VK_SHADER_STAGE_VERTEX_BIT
+       || m_shader->stage() == VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT
+       || m_shader->stage() == VK_SHADER_STAGE_GEOMETRY_BIT);
+
+    if (hasVariants) {
+      m_variants = new D3D11ShaderVariantSet(variantCompiler,
+        m_shader, pDxbcModuleInfo->options,
+        pShaderBytecode, BytecodeLength);
+    }
+
     pDevice->GetDXVKDevice()->registerShader(m_shader);
   }
 
+
+  Sha1Hash D3D11CommonShader::ComputeModuleInfoHash(
+    const DxbcModuleInfo* pDxbcModuleInfo) {
+    // Hash all members explicitly rather than the raw structs,
+    // since padding bytes may contain uninitialized data.
+    // This must be updated whenever new options are added.
+    const DxbcOptions& options = pDxbcModuleInfo->options;
+    std::vector<uint32_t> data;
+
+    data.push_back(options.useDepthClipWorkaround);
+    data.push_back(options.useStorageImageReadWithoutFormat);
+    data.push_back(options.useSubgroupOpsForAtomicCounters);
+    data.push_back(options.useDemoteToHelperInvocation);
+    data.push_back(options.useSubgroupOpsForEarlyDiscard);
+    data.push_back(options.useSdivForBufferIndex);
+    data.push_back(options.strictDivision);
+    data.push_back(options.dynamicIndexedConstantBufferAsSsbo);
+    data.push_back(options.zeroInitWorkgroupMemory);
+    data.push_back(options.optimizeSpirv);
+    data.push_back(uint32_t(options.minSsboAlignment));
+
+    // Tag each optional block so that different combinations
+    // of blocks cannot produce the same sequence of dwords
+    constexpr uint32_t TagTess = 1;
+    constexpr uint32_t TagSpec = 2;
+    constexpr uint32_t TagXfb  = 3;
+
+    if (pDxbcModuleInfo->tess != nullptr) {
+      data.push_back(TagTess);
+
+      float maxTessFactor = pDxbcModuleInfo->tess->maxTessFactor;
+
+      uint32_t dword;
+      std::memcpy(&dword, &maxTessFactor, sizeof(dword));
+      data.push_back(dword);
+    }
+
+    if (pDxbcModuleInfo->spec != nullptr) {
+      data.push_back(TagSpec);
+      data.push_back(pDxbcModuleInfo->spec->outputMask);
+    }
+
+    if (pDxbcModuleInfo->xfb != nullptr) {
+      const DxbcXfbInfo* xfb = pDxbcModuleInfo->xfb;
+      data.push_back(TagXfb);
+
+      data.push_back(xfb->entryCount);
+      data.push_back(uint32_t(xfb->rasterizedStream));
+
+      for (uint32_t i = 0; i < 4; i++)
+        data.push_back(xfb->strides[i]);
+
+      for (uint32_t i = 0; i < xfb->entryCount; i++) {
+        const DxbcXfbEntry& e = xfb->entries[i];
+
+        size_t nameLength = e.semanticName ? std::strlen(e.semanticName) : 0;
+        data.push_back(uint32_t(nameLength));
+
+        for (size_t c = 0; c < nameLength; c++)
+          data.push_back(uint32_t(e.semanticName[c]));
+
+        data.push_back(e.semanticIndex);
+        data.push_back(e.componentIndex);
+        data.push_back(e.componentCount);
+        data.push_back(e.streamId);
+        data.push_back(e.bufferId);
+        data.push_back(e.offset);
+      }
+    }
+
+    return Sha1Hash::compute(data.data(), data.size() * sizeof(uint32_t));
+  }
+
   
   D3D11ShaderModuleSet:: D3D11ShaderModuleSet() { }
   D3D11ShaderModuleSet::~D3D11ShaderModuleSet() { }
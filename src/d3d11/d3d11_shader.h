@@ -14,6 +14,7 @@
 
 #include "d3d11_device_child.h"
 #include "d3d11_interfaces.h"
+#include "d3d11_shader_variants.h"
 
 namespace dxvk {
   
@@ -46,6 +47,10 @@ namespace dxvk {
     Rc<DxvkBuffer> GetIcb() const {
       return m_buffer;
     }
+
+    D3D11ShaderVariantSet* GetVariants() const {
+      return m_variants.ptr();
+    }
     
     std::string GetName() const {
       return m_shader->debugName();
@@ -55,6 +60,11 @@ namespace dxvk {
     
     Rc<DxvkShader> m_shader;
     Rc<DxvkBuffer> m_buffer;
+
+    Rc<D3D11ShaderVariantSet> m_variants;
+    
+    static Sha1Hash ComputeModuleInfoHash(
+      const DxbcModuleInfo* pDxbcModuleInfo);
     
   };
   
@@ -0,0 +1,140 @@
+#include "d3d11_device.h"
+#include "d3d11_shader_variants.h"
+
+namespace dxvk {
+
+  D3D11ShaderVariantSet::D3D11ShaderVariantSet(
+          D3D11ShaderVariantCompiler* pCompiler,
+    const Rc<DxvkShader>&             Shader,
+    const DxbcOptions&                Options,
+    const void*                       pShaderBytecode,
+          size_t                      BytecodeLength)
+  : m_compiler(pCompiler), m_shader(Shader), m_options(Options),
+    m_bytecode(
+      reinterpret_cast<const char*>(pShaderBytecode),
+      reinterpret_cast<const char*>(pShaderBytecode) + BytecodeLength) {
+
+  }
+
+
+  D3D11ShaderVariantSet::~D3D11ShaderVariantSet() {
+
+  }
+
+
+  Rc<DxvkShader> D3D11ShaderVariantSet::GetVariant(
+    const DxbcSpecInfo&               SpecInfo) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Insert a null entry for pending variants so
+    // that each variant only gets queued once
+    auto entry = m_variants.insert({ SpecInfo, nullptr });
+
+    if (entry.second) {
+      lock.unlock();
+      m_compiler->QueueVariant(this, SpecInfo);
+      return nullptr;
+    }
+
+    return entry.first->second;
+  }
+
+
+  void D3D11ShaderVariantSet::CompileVariant(
+          D3D11Device*                pDevice,
+    const DxbcSpecInfo&               SpecInfo) {
+    // Variants get their own shader key so that the state
+    // cache and the shader cache can tell them apart from
+    // the generic shader and from each other
+    const std::array<Sha1Data, 2> chunks = {{
+      { m_bytecode.data(), m_bytecode.size() },
+      { &SpecInfo.outputMask, sizeof(SpecInfo.outputMask) },
+    }};
+
+    DxvkShaderKey shaderKey(m_shader->stage(),
+      Sha1Hash::compute(chunks.size(), chunks.data()));
+
+    DxbcSpecInfo specInfo = SpecInfo;
+
+    DxbcModuleInfo moduleInfo;
+    moduleInfo.options = m_options;
+    moduleInfo.tess    = nullptr;
+    moduleInfo.xfb     = nullptr;
+    moduleInfo.spec    = &specInfo;
+
+    Rc<DxvkShader> shader = m_shader;
+
+    try {
+      D3D11CommonShader variant(pDevice, &shaderKey, &moduleInfo,
+        m_bytecode.data(), m_bytecode.size());
+      shader = variant.GetShader();
+    } catch (const DxvkError& e) {
+      Logger::err(str::format("D3D11: Failed to compile variant of ",
+        m_shader->debugName(), ": ", e.message()));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_variants[SpecInfo] = shader;
+
+    m_compiledCount.fetch_add(1, std::memory_order_release);
+  }
+
+
+  D3D11ShaderVariantCompiler::D3D11ShaderVariantCompiler(
+          D3D11Device*                pDevice)
+  : m_device(pDevice) {
+    m_thread = dxvk::thread([this] { ThreadFunc(); });
+
+#ifndef DXVK_NATIVE
+    m_thread.set_priority(ThreadPriority::Lowest);
+#endif
+  }
+
+
+  D3D11ShaderVariantCompiler::~D3D11ShaderVariantCompiler() {
+    // Pending variants are simply dropped, since the
+    // generic shaders remain valid in any case
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopped = true;
+    }
+
+    m_cond.notify_one();
+    m_thread.join();
+  }
+
+
+  void D3D11ShaderVariantCompiler::QueueVariant(
+          D3D11ShaderVariantSet*      pVariantSet,
+    const DxbcSpecInfo&               SpecInfo) {
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      m_queue.push({ pVariantSet, SpecInfo });
+    }
+
+    m_cond.notify_one();
+  }
+
+
+  void D3D11ShaderVariantCompiler::ThreadFunc() {
+    env::setThreadName("dxvk-shader-variant");
+
+    while (true) {
+      Job job;
+
+      { std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_cond.wait(lock, [this] {
+          return m_stopped || !m_queue.empty();
+        });
+
+        if (m_stopped)
+          return;
+
+        job = std::move(m_queue.front());
+        m_queue.pop();
+      }
+
+      job.variantSet->CompileVariant(m_device, job.specInfo);
+    }
+  }
+
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "../dxbc/dxbc_modinfo.h"
+#include "../dxvk/dxvk_shader.h"
+
+#include "../util/thread.h"
+
+namespace dxvk {
+
+  class D3D11Device;
+  class D3D11ShaderVariantCompiler;
+
+  /**
+   * \brief Shader variant set
+   *
+   * Stores the specialized variants of a generic shader,
+   * as well as everything needed to compile them. Since
+   * variants are compiled asynchronously, the generic
+   * shader must be used until a variant is available.
+   * This class is thread-safe.
+   */
+  class D3D11ShaderVariantSet : public RcObject {
+
+  public:
+
+    D3D11ShaderVariantSet(
+            D3D11ShaderVariantCompiler* pCompiler,
+      const Rc<DxvkShader>&             Shader,
+      const DxbcOptions&                Options,
+      const void*                       pShaderBytecode,
+            size_t                      BytecodeLength);
+
+    ~D3D11ShaderVariantSet();
+
+    /**
+     * \brief Looks up a shader variant
+     *
+     * Queues the variant for compilation if it
+     * has not been requested before. If the
+     * variant could not be compiled, this will
+     * return the generic shader.
+     * \param [in] SpecInfo Specialization info
+     * \returns The variant, or \c nullptr if it
+     *    has not been compiled yet
+     */
+    Rc<DxvkShader> GetVariant(
+      const DxbcSpecInfo&               SpecInfo);
+
+    /**
+     * \brief Number of compiled variants
+     *
+     * Can be used to check whether a pending variant may
+     * have become available without locking the set.
+     * \returns Number of variants compiled so far
+     */
+    uint32_t GetCompiledCount() const {
+      return m_compiledCount.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief Compiles a shader variant
+     *
+     * Called by the variant compiler.
+     * \param [in] pDevice The device
+     * \param [in] SpecInfo Specialization info
+     */
+    void CompileVariant(
+            D3D11Device*                pDevice,
+      const DxbcSpecInfo&               SpecInfo);
+
+  private:
+
+    D3D11ShaderVariantCompiler* m_compiler;
+
+    Rc<DxvkShader>              m_shader;
+    DxbcOptions                 m_options;
+    std::vector<char>           m_bytecode;
+
+    std::mutex                  m_mutex;
+    std::atomic<uint32_t>       m_compiledCount = { 0u };
+
+    std::unordered_map<
+      DxbcSpecInfo,
+      Rc<DxvkShader>,
+      DxvkHash, DxvkEq>         m_variants;
+
+  };
+
+
+  /**
+   * \brief Shader variant compiler
+   *
+   * Compiles shader variants on a low-priority
+   * worker thread, so that requesting a variant
+   * never stalls the calling thread.
+   */
+  class D3D11ShaderVariantCompiler {
+
+  public:
+
+    D3D11ShaderVariantCompiler(
+            D3D11Device*                pDevice);
+
+    ~D3D11ShaderVariantCompiler();
+
+    D3D11ShaderVariantCompiler             (const D3D11ShaderVariantCompiler&) = delete;
+    D3D11ShaderVariantCompiler& operator = (const D3D11ShaderVariantCompiler&) = delete;
+
+    /**
+     * \brief Queues a shader variant for compilation
+     *
+     * \param [in] pVariantSet The shader's variant set
+     * \param [in] SpecInfo Specialization info
+     */
+    void QueueVariant(
+            D3D11ShaderVariantSet*      pVariantSet,
+      const DxbcSpecInfo&               SpecInfo);
+
+  private:
+
+    struct Job {
+      Rc<D3D11ShaderVariantSet> variantSet;
+      DxbcSpecInfo              specInfo;
+    };
+
+    D3D11Device*                m_device;
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_cond;
+    std::queue<Job>             m_queue;
+    bool                        m_stopped = false;
+
+    dxvk::thread                m_thread;
+
+    void ThreadFunc();
+
+  };
+
+}
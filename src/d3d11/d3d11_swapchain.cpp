@@ -204,9 +204,10 @@ namespace dxvk {
     // Flush pending rendering commands before
     auto immediateContext = static_cast<D3D11ImmediateContext*>(deviceContext.ptr());
     immediateContext->Flush();
+    immediateContext->EndFrame();
 
     if (!m_device->hasAsyncPresent())
-      immediateContext->SynchronizeCsThread();
+      immediateContext->SynchronizeCsThread(DxvkCsThread::SynchronizeAll);
 
     // Wait for the sync event so that we respect the maximum frame latency
     auto syncEvent = m_dxgiDevice->GetFrameSyncEvent(m_desc.BufferCount);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../dxvk/dxvk_cs.h"
 #include "../dxvk/dxvk_device.h"
 
 #include "../d3d10/d3d10_texture.h"
@@ -115,6 +116,37 @@ namespace dxvk {
       if (Subresource < m_mapTypes.size())
         m_mapTypes[Subresource] = MapType;
     }
+
+    /**
+     * \brief Sequence number of the last CS chunk using the texture
+     *
+     * Staging textures can only be accessed through a small
+     * set of context methods, which record the sequence
+     * number of the CS chunk they emit commands into. Other
+     * textures may be used by any pending chunk at any time.
+     * \returns CS chunk sequence number to synchronize with
+     */
+    uint64_t GetSequenceNumber() const {
+      return m_desc.Usage == D3D11_USAGE_STAGING
+        ? m_seq.load() : DxvkCsThread::SynchronizeAll;
+    }
+
+    /**
+     * \brief Records CS chunk sequence number
+     *
+     * Sequence numbers never decrease, so that a texture
+     * used by a deferred context, whose command list may
+     * be executed at any point in the future, will always
+     * synchronize with the entire CS thread.
+     * \param [in] Seq Sequence number of the chunk
+     */
+    void TrackSequenceNumber(uint64_t Seq) {
+      // Deferred contexts may call this concurrently
+      uint64_t seq = m_seq.load();
+
+      while (seq < Seq && !m_seq.compare_exchange_weak(seq, Seq))
+        continue;
+    }
     
     /**
      * \brief The DXVK image
@@ -214,6 +246,7 @@ namespace dxvk {
     Rc<DxvkImage>                 m_image;
     std::vector<Rc<DxvkBuffer>>   m_buffers;
     std::vector<D3D11_MAP>        m_mapTypes;
+    std::atomic<uint64_t>         m_seq = { 0ull };
     
     Rc<DxvkBuffer> CreateMappedBuffer(
             UINT                  MipLevel) const;
@@ -252,13 +252,25 @@ namespace dxvk {
         shaderOptions.xfbStrides[i] = m_moduleInfo.xfb->strides[i];
     }
 
+    SpirvCodeBuffer code = m_module.compile();
+
+    if (m_moduleInfo.options.optimizeSpirv) {
+      SpirvOptimizer optimizer(code);
+      optimizer.run(SpirvOptimizerPasses(
+        SpirvOptimizerPass::ForwardLoads,
+        SpirvOptimizerPass::FoldConstants,
+        SpirvOptimizerPass::EliminateDeadCode,
+        SpirvOptimizerPass::PruneVariables));
+      code = optimizer.getCode();
+    }
+
     // Create the shader module object
     return new DxvkShader(
       m_programInfo.shaderStage(),
       m_resourceSlots.size(),
       m_resourceSlots.data(),
       m_interfaceSlots,
-      m_module.compile(),
+      std::move(code),
       shaderOptions,
       std::move(m_immConstData));
   }
@@ -729,6 +741,15 @@ namespace dxvk {
       if (m_programInfo.type() == DxbcProgramType::GeometryShader && sv != DxbcSystemValue::None)
         info.sclass = spv::StorageClassPrivate;
 
+      // In specialized shaders, outputs that the pixel shader
+      // does not read are not exported, so that the code that
+      // computes them can be removed. System values are still
+      // written through the built-in variables.
+      if (m_moduleInfo.spec != nullptr
+       && m_programInfo.type() != DxbcProgramType::PixelShader
+       && !(m_moduleInfo.spec->outputMask & (1u << regIdx)))
+        info.sclass = spv::StorageClassPrivate;
+
       const uint32_t varId = this->emitNewVariable(info);
       m_module.setDebugName(varId, str::format("o", regIdx).c_str());
       
@@ -44,6 +44,31 @@ namespace dxvk {
     int32_t       rasterizedStream;
   };
 
+  /**
+   * \brief Specialization info
+   * 
+   * Stores pipeline state that a shader variant is
+   * specialized for. Generic shaders, i.e. shaders
+   * compiled without this info, must work with any
+   * state, whereas specialized shaders must only be
+   * used if the state matches.
+   */
+  struct DxbcSpecInfo {
+    /// Output registers read by the pixel shader. Only
+    /// used for the last pre-rasterization stage.
+    uint32_t outputMask;
+
+    bool eq(const DxbcSpecInfo& other) const {
+      return this->outputMask == other.outputMask;
+    }
+
+    size_t hash() const {
+      DxvkHashState result;
+      result.add(this->outputMask);
+      return result;
+    }
+  };
+
   /**
    * \brief Shader module info
    * 
@@ -54,6 +79,7 @@ namespace dxvk {
     DxbcOptions   options;
     DxbcTessInfo* tess;
     DxbcXfbInfo*  xfb;
+    DxbcSpecInfo* spec;
   };
 
 }
\ No newline at end of file
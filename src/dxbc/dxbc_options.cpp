@@ -39,6 +39,7 @@ namespace dxvk {
     
     strictDivision           = options.strictDivision;
     zeroInitWorkgroupMemory  = options.zeroInitWorkgroupMemory;
+    optimizeSpirv            = options.optimizeShaders;
     dynamicIndexedConstantBufferAsSsbo = options.constantBufferRangeCheck;
     
     // Disable early discard on RADV (with LLVM) due to GPU hangs
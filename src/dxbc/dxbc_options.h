@@ -42,6 +42,9 @@ namespace dxvk {
     /// Clear thread-group shared memory to zero
     bool zeroInitWorkgroupMemory = false;
 
+    /// Run the SPIR-V optimizer on generated code
+    bool optimizeSpirv = false;
+
     /// Minimum storage buffer alignment
     VkDeviceSize minSsboAlignment = 0;
   };
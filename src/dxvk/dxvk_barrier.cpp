@@ -31,7 +31,7 @@ namespace dxvk {
     m_srcAccess |= srcAccess;
     m_dstAccess |= dstAccess;
 
-    m_bufSlices.push_back({ bufSlice, access });
+    this->addBufSlice(bufSlice, access);
   }
   
   
@@ -73,7 +73,7 @@ namespace dxvk {
       m_imgBarriers.push_back(barrier);
     }
 
-    m_imgSlices.push_back({ image.ptr(), subresources, access });
+    this->addImgSlice(image.ptr(), subresources, access);
   }
 
 
@@ -257,6 +257,8 @@ namespace dxvk {
         m_imgBarriers.size(),
         m_imgBarriers.data());
       
+      commandList->addStatCtr(DxvkStatCounter::CmdBarrierCount, 1);
+      
       this->reset();
     }
   }
@@ -277,6 +279,64 @@ namespace dxvk {
   }
   
   
+  void DxvkBarrierSet::addBufSlice(
+    const DxvkBufferSliceHandle&    bufSlice,
+          DxvkAccessFlags           access) {
+    // Consecutive draws and dispatches tend to access the
+    // same resources, so merge ranges of the same buffer
+    // where this does not make hazard checks any more
+    // conservative, in order to keep lookups cheap.
+    for (auto& entry : m_bufSlices) {
+      DxvkBufferSliceHandle& dstSlice = entry.slice;
+
+      if (bufSlice.handle != dstSlice.handle)
+        continue;
+
+      if (bufSlice.offset == dstSlice.offset
+       && bufSlice.length == dstSlice.length) {
+        entry.access = entry.access | access;
+        return;
+      }
+
+      if (entry.access == access
+       && bufSlice.offset <= dstSlice.offset + dstSlice.length
+       && bufSlice.offset + bufSlice.length >= dstSlice.offset) {
+        VkDeviceSize end = std::max(
+          bufSlice.offset + bufSlice.length,
+          dstSlice.offset + dstSlice.length);
+
+        dstSlice.offset = std::min(bufSlice.offset, dstSlice.offset);
+        dstSlice.length = end - dstSlice.offset;
+        return;
+      }
+    }
+
+    m_bufSlices.push_back({ bufSlice, access });
+  }
+
+
+  void DxvkBarrierSet::addImgSlice(
+          DxvkImage*                image,
+    const VkImageSubresourceRange&  subres,
+          DxvkAccessFlags           access) {
+    for (auto& entry : m_imgSlices) {
+      const VkImageSubresourceRange& dstSubres = entry.subres;
+
+      if (image == entry.image
+       && subres.aspectMask     == dstSubres.aspectMask
+       && subres.baseArrayLayer == dstSubres.baseArrayLayer
+       && subres.layerCount     == dstSubres.layerCount
+       && subres.baseMipLevel   == dstSubres.baseMipLevel
+       && subres.levelCount     == dstSubres.levelCount) {
+        entry.access = entry.access | access;
+        return;
+      }
+    }
+
+    m_imgSlices.push_back({ image, subres, access });
+  }
+
+
   DxvkAccessFlags DxvkBarrierSet::getAccessTypes(VkAccessFlags flags) const {
     const VkAccessFlags rflags
       = VK_ACCESS_INDIRECT_COMMAND_READ_BIT
@@ -112,6 +112,15 @@ namespace dxvk {
     std::vector<BufSlice> m_bufSlices;
     std::vector<ImgSlice> m_imgSlices;
     
+    void addBufSlice(
+      const DxvkBufferSliceHandle&    bufSlice,
+            DxvkAccessFlags           access);
+
+    void addImgSlice(
+            DxvkImage*                image,
+      const VkImageSubresourceRange&  subres,
+            DxvkAccessFlags           access);
+
     DxvkAccessFlags getAccessTypes(VkAccessFlags flags) const;
     
   };
@@ -3,6 +3,20 @@
 
 namespace dxvk {
   
+  DxvkBufferStorage::DxvkBufferStorage(
+          DxvkDevice*           device,
+          DxvkBufferHandle&&    handle)
+  : m_device(device), m_handle(std::move(handle)) {
+
+  }
+
+
+  DxvkBufferStorage::~DxvkBufferStorage() {
+    auto vkd = m_device->vkd();
+    vkd->vkDestroyBuffer(vkd->device(), m_handle.buffer, nullptr);
+  }
+
+
   DxvkBuffer::DxvkBuffer(
           DxvkDevice*           device,
     const DxvkBufferCreateInfo& createInfo,
@@ -19,32 +33,81 @@ namespace dxvk {
     m_physSliceStride = align(createInfo.size, sliceAlignment);
     m_physSliceCount  = std::max<VkDeviceSize>(1, 256 / m_physSliceStride);
 
+    // Small host-visible buffers share backing storage
+    DxvkBufferArena* arena = m_device->bufferArena();
+
+    if (arena && DxvkBufferArena::isCompatible(createInfo, memFlags))
+      m_arena = arena;
+
     // Limit size of multi-slice buffers to reduce fragmentation
-    constexpr VkDeviceSize MaxBufferSize = 4 << 20;
+    VkDeviceSize maxBufferSize = m_arena
+      ? DxvkBufferArena::MaxBlockSize
+      : VkDeviceSize(4 << 20);
 
-    m_physSliceMaxCount = MaxBufferSize >= m_physSliceStride
-      ? MaxBufferSize / m_physSliceStride
+    m_physSliceMaxCount = maxBufferSize >= m_physSliceStride
+      ? maxBufferSize / m_physSliceStride
       : 1;
 
     // Allocate the initial set of buffer slices
-    m_buffer = allocBuffer(m_physSliceCount);
+    m_physSliceTotal = m_physSliceCount;
+    m_discardFrameId = m_device->getCurrentFrameId();
+    m_discardPeakFrameId = m_discardFrameId;
+
+    if (!m_arena) {
+      m_buffer = allocBuffer(m_physSliceCount);
+
+      DxvkBufferSliceHandle slice;
+      slice.handle = m_buffer.buffer;
+      slice.offset = 0;
+      slice.length = m_physSliceLength;
+      slice.mapPtr = m_buffer.memory.mapPtr(0);
+
+      m_physSlice.store(slice);
+      m_lazyAlloc = m_physSliceCount > 1;
+    } else {
+      // Arena blocks are tracked like any other backing
+      // buffer, so that they can be trimmed and freed.
+      SliceBuffer buffer = allocSliceBuffer(m_physSliceCount);
 
-    DxvkBufferSliceHandle slice;
-    slice.handle = m_buffer.buffer;
-    slice.offset = 0;
-    slice.length = m_physSliceLength;
-    slice.mapPtr = m_buffer.memory.mapPtr(0);
+      DxvkBufferSliceHandle slice = buffer.base;
+      slice.length = m_physSliceLength;
 
-    m_physSlice = slice;
-    m_lazyAlloc = m_physSliceCount > 1;
+      m_physSlice.store(slice);
+
+      for (uint32_t i = 1; i < m_physSliceCount; i++)
+        pushSlice(buffer.base, i);
+
+      m_buffers.push_back(std::move(buffer));
+    }
+
+    // Host-visible buffers may be mapped, so they
+    // can never be moved by the defragmenter
+    DxvkMemoryDefrag* defrag = m_device->memoryDefrag();
+
+    if (defrag && !(m_memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+      defrag->registerBuffer(this);
   }
 
 
   DxvkBuffer::~DxvkBuffer() {
+    bool trimRegistered;
+
+    { std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+      trimRegistered = m_trimRegistered;
+    }
+
+    if (trimRegistered)
+      m_device->bufferTrimmer().unregisterBuffer(this);
+
+    DxvkMemoryDefrag* defrag = m_device->memoryDefrag();
+
+    if (defrag && !(m_memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+      defrag->unregisterBuffer(this);
+
     auto vkd = m_device->vkd();
 
     for (const auto& buffer : m_buffers)
-      vkd->vkDestroyBuffer(vkd->device(), buffer.buffer, nullptr);
+      freeSliceBuffer(buffer);
     vkd->vkDestroyBuffer(vkd->device(), m_buffer.buffer, nullptr);
   }
   
@@ -115,6 +178,267 @@ namespace dxvk {
   }
 
 
+  DxvkBuffer::SliceBuffer DxvkBuffer::allocSliceBuffer(VkDeviceSize sliceCount) const {
+    SliceBuffer result;
+    result.sliceCount  = sliceCount;
+    result.base.length = m_physSliceStride * sliceCount;
+
+    if (m_arena) {
+      DxvkBufferArenaBlock block = m_arena->alloc(
+        m_memFlags, result.base.length, computeSliceAlignment());
+
+      result.base.handle = block.buffer;
+      result.base.offset = block.offset;
+      result.base.mapPtr = block.mapPtr;
+    } else {
+      result.handle = allocBuffer(sliceCount);
+
+      result.base.handle = result.handle.buffer;
+      result.base.offset = 0;
+      result.base.mapPtr = result.handle.memory.mapPtr(0);
+    }
+
+    return result;
+  }
+
+
+  void DxvkBuffer::freeSliceBuffer(const SliceBuffer& buffer) const {
+    if (m_arena) {
+      DxvkBufferArenaBlock block;
+      block.buffer = buffer.base.handle;
+      block.offset = buffer.base.offset;
+      block.length = buffer.base.length;
+      block.mapPtr = buffer.base.mapPtr;
+
+      m_arena->free(block);
+    } else {
+      auto vkd = m_device->vkd();
+      vkd->vkDestroyBuffer(vkd->device(), buffer.handle.buffer, nullptr);
+    }
+  }
+
+
+  DxvkBufferSliceHandle DxvkBuffer::allocSlice() {
+    std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+    // Count slice allocations per frame
+    uint32_t frameId = m_device->getCurrentFrameId();
+
+    if (unlikely(frameId != m_discardFrameId))
+      this->updateDiscardStats(frameId);
+
+    m_discardCount += 1;
+
+    bool registerTrim = false;
+    
+    // If no slices are available, swap the two free lists.
+    if (unlikely(m_freeSlices.empty())) {
+      std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
+      std::swap(m_freeSlices, m_nextSlices);
+    }
+
+    // If there are still no slices available, create a new
+    // backing buffer and add all slices to the free list.
+    if (unlikely(m_freeSlices.empty())) {
+      if (likely(!m_lazyAlloc)) {
+        // Slices only get freed once the GPU is done with them, so
+        // we need enough for a few frames' worth of discards. Size
+        // the new buffer accordingly instead of growing it in small
+        // steps, which would otherwise take several allocations.
+        VkDeviceSize demand = std::max(m_discardCount, m_discardPeak) * FrameLatency;
+        VkDeviceSize sliceCount = m_physSliceCount;
+
+        if (demand > m_physSliceTotal)
+          sliceCount = std::max(sliceCount, demand - m_physSliceTotal);
+
+        sliceCount = std::min(sliceCount, m_physSliceMaxCount);
+
+        SliceBuffer buffer = allocSliceBuffer(sliceCount);
+
+        for (uint32_t i = 0; i < sliceCount; i++)
+          pushSlice(buffer.base, i);
+
+        m_buffers.push_back(std::move(buffer));
+        m_physSliceTotal += sliceCount;
+        m_physSliceCount = std::min(m_physSliceCount * 2, m_physSliceMaxCount);
+
+        // Let the trimmer release the new buffer if the
+        // application stops discarding this buffer
+        registerTrim = !m_trimRegistered && !m_hasViews.load();
+        m_trimRegistered |= registerTrim;
+      } else {
+        DxvkBufferSliceHandle base;
+        base.handle = m_buffer.buffer;
+        base.offset = 0;
+        base.length = m_physSliceStride * m_physSliceCount;
+        base.mapPtr = m_buffer.memory.mapPtr(0);
+
+        for (uint32_t i = 1; i < m_physSliceCount; i++)
+          pushSlice(base, i);
+
+        m_lazyAlloc = false;
+      }
+    }
+    
+    // Take the first slice from the queue
+    DxvkBufferSliceHandle result = m_freeSlices.back();
+    m_freeSlices.pop_back();
+
+    if (unlikely(registerTrim)) {
+      freeLock.unlock();
+      m_device->bufferTrimmer().registerBuffer(this);
+    }
+
+    return result;
+  }
+
+
+  bool DxvkBuffer::trim(uint32_t frameId) {
+    std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+    if (frameId != m_discardFrameId)
+      this->updateDiscardStats(frameId);
+
+    // Buffers with views never release backing buffers
+    m_trimRegistered = !m_buffers.empty() && !m_hasViews.load();
+    return m_trimRegistered;
+  }
+
+
+  void DxvkBuffer::updateDiscardStats(uint32_t frameId) {
+    // If the buffer was not used in the previous frame,
+    // the most recent discard count is effectively zero
+    uint32_t count = frameId - m_discardFrameId == 1
+      ? m_discardCount : 0;
+
+    if (count >= m_discardPeak) {
+      m_discardPeak        = count;
+      m_discardPeakFrameId = frameId;
+    } else if (frameId - m_discardPeakFrameId >= TrimFrameCount) {
+      // Demand has stayed below the peak for a while,
+      // so release backing buffers that we no longer need
+      m_discardPeak        = count;
+      m_discardPeakFrameId = frameId;
+
+      this->trimSlices();
+    }
+
+    m_discardFrameId = frameId;
+    m_discardCount   = 0;
+  }
+
+
+  void DxvkBuffer::trimSlices() {
+    // Views cache handles to all backing buffers
+    // they have seen, so we cannot destroy any
+    if (m_buffers.empty() || m_hasViews.load())
+      return;
+
+    std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
+
+    m_freeSlices.insert(m_freeSlices.end(),
+      m_nextSlices.begin(), m_nextSlices.end());
+    m_nextSlices.clear();
+
+    VkDeviceSize demand = VkDeviceSize(m_discardPeak) * FrameLatency;
+
+    // Start with the most recently allocated buffers since
+    // those are the largest. A buffer can only be released
+    // if none of its slices are in use by the GPU.
+    for (size_t i = m_buffers.size(); i > 0; i--) {
+      const SliceBuffer& buffer = m_buffers[i - 1];
+
+      if (m_physSliceTotal - buffer.sliceCount < demand)
+        continue;
+
+      // Arena blocks share their Vulkan buffer with
+      // other blocks, so we need to check the range
+      auto isBufferSlice = [&buffer] (const DxvkBufferSliceHandle& slice) {
+        return slice.handle == buffer.base.handle
+            && slice.offset >= buffer.base.offset
+            && slice.offset <  buffer.base.offset + buffer.base.length;
+      };
+
+      size_t freeCount = std::count_if(
+        m_freeSlices.begin(), m_freeSlices.end(), isBufferSlice);
+
+      if (freeCount != buffer.sliceCount)
+        continue;
+
+      m_freeSlices.erase(std::remove_if(
+        m_freeSlices.begin(), m_freeSlices.end(), isBufferSlice),
+        m_freeSlices.end());
+
+      freeSliceBuffer(buffer);
+
+      m_physSliceTotal -= buffer.sliceCount;
+      m_buffers.erase(m_buffers.begin() + (i - 1));
+    }
+
+    m_physSliceCount = std::max<VkDeviceSize>(1,
+      std::min<VkDeviceSize>(m_discardPeak, m_physSliceMaxCount));
+  }
+
+
+  bool DxvkBuffer::isRelocatable() const {
+    std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+    return this->canRelocate();
+  }
+
+
+  Rc<DxvkBufferStorage> DxvkBuffer::relocate(
+          DxvkBufferSliceHandle& prevSlice) {
+    Rc<DxvkBufferStorage> storage;
+
+    { // Check again under the lock since another thread may
+      // have allocated slices from the current backing buffer
+      std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+      if (!this->canRelocate())
+        return nullptr;
+
+      DxvkBufferHandle handle = allocBuffer(m_physSliceCount);
+
+      DxvkBufferSliceHandle slice;
+      slice.handle = handle.buffer;
+      slice.offset = 0;
+      slice.length = m_physSliceLength;
+      slice.mapPtr = nullptr;
+
+      prevSlice = m_physSlice.exchange(slice);
+
+      storage = new DxvkBufferStorage(m_device,
+        std::exchange(m_buffer, std::move(handle)));
+    }
+
+    // The defragmenter calls isRelocatable while holding its
+    // own lock, so we must not hold ours when updating it
+    DxvkMemoryDefrag* defrag = m_device->memoryDefrag();
+
+    if (defrag)
+      defrag->updateBuffer(this);
+
+    return storage;
+  }
+
+
+  bool DxvkBuffer::canRelocate() const {
+    // The copy needs to read the old backing buffer and write
+    // the new one, and any allocated slice other than the current
+    // one may still be owned by a command list or the free lists.
+    VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                                     | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    return (m_info.usage & transferUsage) == transferUsage
+        && !(m_memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        && !m_hasViews.load()
+        && m_buffers.empty()
+        && (m_lazyAlloc || m_physSliceTotal == 1)
+        && m_physSlice.load().handle == m_buffer.buffer
+        && m_buffer.memory.chunk() != nullptr;
+  }
+
+
   VkDeviceSize DxvkBuffer::computeSliceAlignment() const {
     const auto& devInfo = m_device->properties().core.properties;
 
@@ -151,7 +475,9 @@ namespace dxvk {
   : m_vkd(vkd), m_info(info), m_buffer(buffer),
     m_bufferSlice (getSliceHandle()),
     m_bufferView  (createBufferView(m_bufferSlice)) {
-    
+    // Views cache handles to the backing buffers,
+    // so the buffer must not be relocated anymore
+    m_buffer->m_hasViews.store(true);
   }
   
   
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 
@@ -11,6 +12,8 @@
 
 namespace dxvk {
 
+  class DxvkBufferArena;
+
   /**
    * \brief Buffer create info
    * 
@@ -91,7 +94,91 @@ namespace dxvk {
     }
   };
 
+
+  /**
+   * \brief Current buffer slice
+   *
+   * Stores the slice that a buffer currently uses. The CS
+   * thread may rename buffers while recorder threads read
+   * the slice, so readers retry until they observe a slice
+   * that was not modified while it was being read. Only
+   * one thread may replace the slice at any given time.
+   */
+  class DxvkBufferSliceStorage {
+
+  public:
+
+    DxvkBufferSliceHandle load() const {
+      DxvkBufferSliceHandle result;
+      uint32_t seq;
+
+      do {
+        seq = m_seq.load(std::memory_order_acquire);
+        result.handle = m_handle.load(std::memory_order_relaxed);
+        result.offset = m_offset.load(std::memory_order_relaxed);
+        result.length = m_length.load(std::memory_order_relaxed);
+        result.mapPtr = m_mapPtr.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+      } while ((seq & 1) || seq != m_seq.load(std::memory_order_relaxed));
+
+      return result;
+    }
+
+    void store(const DxvkBufferSliceHandle& slice) {
+      uint32_t seq = m_seq.load(std::memory_order_relaxed);
+      m_seq.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      m_handle.store(slice.handle, std::memory_order_relaxed);
+      m_offset.store(slice.offset, std::memory_order_relaxed);
+      m_length.store(slice.length, std::memory_order_relaxed);
+      m_mapPtr.store(slice.mapPtr, std::memory_order_relaxed);
+
+      m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    DxvkBufferSliceHandle exchange(const DxvkBufferSliceHandle& slice) {
+      DxvkBufferSliceHandle result = load();
+      store(slice);
+      return result;
+    }
+
+  private:
+
+    std::atomic<uint32_t>     m_seq     = { 0u };
+    std::atomic<VkBuffer>     m_handle  = { VK_NULL_HANDLE };
+    std::atomic<VkDeviceSize> m_offset  = { 0ull };
+    std::atomic<VkDeviceSize> m_length  = { 0ull };
+    std::atomic<void*>        m_mapPtr  = { nullptr };
+
+  };
+
   
+  /**
+   * \brief Buffer storage
+   * 
+   * Owns a backing buffer that has been replaced by
+   * a relocation, so that it can be kept alive by the
+   * command lists that still access it.
+   */
+  class DxvkBufferStorage : public DxvkResource {
+
+  public:
+
+    DxvkBufferStorage(
+            DxvkDevice*           device,
+            DxvkBufferHandle&&    handle);
+
+    ~DxvkBufferStorage();
+
+  private:
+
+    DxvkDevice*       m_device;
+    DxvkBufferHandle  m_handle;
+
+  };
+
+
   /**
    * \brief Virtual buffer resource
    * 
@@ -101,6 +188,9 @@ namespace dxvk {
    */
   class DxvkBuffer : public DxvkResource {
     friend class DxvkBufferView;
+
+    constexpr static VkDeviceSize FrameLatency   = 3;
+    constexpr static uint32_t     TrimFrameCount = 120;
   public:
     
     DxvkBuffer(
@@ -140,7 +230,7 @@ namespace dxvk {
      * \returns Pointer to mapped memory region
      */
     void* mapPtr(VkDeviceSize offset) const {
-      return reinterpret_cast<char*>(m_physSlice.mapPtr) + offset;
+      return reinterpret_cast<char*>(m_physSlice.load().mapPtr) + offset;
     }
     
     /**
@@ -148,7 +238,7 @@ namespace dxvk {
      * \returns Buffer slice handle
      */
     DxvkBufferSliceHandle getSliceHandle() const {
-      return m_physSlice;
+      return m_physSlice.load();
     }
 
     /**
@@ -159,11 +249,13 @@ namespace dxvk {
      * \returns Buffer slice handle
      */
     DxvkBufferSliceHandle getSliceHandle(VkDeviceSize offset, VkDeviceSize length) const {
+      DxvkBufferSliceHandle slice = m_physSlice.load();
+
       DxvkBufferSliceHandle result;
-      result.handle = m_physSlice.handle;
-      result.offset = m_physSlice.offset + offset;
+      result.handle = slice.handle;
+      result.offset = slice.offset + offset;
       result.length = length;
-      result.mapPtr = mapPtr(offset);
+      result.mapPtr = reinterpret_cast<char*>(slice.mapPtr) + offset;
       return result;
     }
 
@@ -175,9 +267,11 @@ namespace dxvk {
      * \returns Buffer slice descriptor
      */
     DxvkDescriptorInfo getDescriptor(VkDeviceSize offset, VkDeviceSize length) const {
+      DxvkBufferSliceHandle slice = m_physSlice.load();
+
       DxvkDescriptorInfo result;
-      result.buffer.buffer = m_physSlice.handle;
-      result.buffer.offset = m_physSlice.offset + offset;
+      result.buffer.buffer = slice.handle;
+      result.buffer.offset = slice.offset + offset;
       result.buffer.range  = length;
       return result;
     }
@@ -189,7 +283,7 @@ namespace dxvk {
      * \returns Offset for dynamic descriptors
      */
     VkDeviceSize getDynamicOffset(VkDeviceSize offset) const {
-      return m_physSlice.offset + offset;
+      return m_physSlice.load().offset + offset;
     }
     
     /**
@@ -198,14 +292,52 @@ namespace dxvk {
      * Replaces the underlying buffer and implicitly marks
      * any buffer views using this resource as dirty. Do
      * not call this directly as this is called implicitly
-     * by the context's \c invalidateBuffer method.
+     * by the context's \c invalidateBuffer method, which
+     * must only be used on the CS thread, since the previous
+     * slice gets freed by the calling context's command list.
      * \param [in] slice The new backing resource
      * \returns Previous buffer slice
      */
     DxvkBufferSliceHandle rename(const DxvkBufferSliceHandle& slice) {
-      return std::exchange(m_physSlice, slice);
+      return m_physSlice.exchange(slice);
     }
     
+    /**
+     * \brief Memory chunk of the backing buffer
+     * 
+     * Used by the defragmenter to find buffers
+     * allocated from a given memory chunk.
+     * \returns Memory chunk, or \c nullptr
+     */
+    const DxvkMemoryChunk* getMemoryChunk() const {
+      return m_buffer.memory.chunk();
+    }
+    
+    /**
+     * \brief Checks whether the buffer can be relocated
+     * 
+     * Only buffers that never used more than one physical
+     * slice and have no views can be moved, since the old
+     * backing buffer may be referenced otherwise.
+     * \returns \c true if the buffer can be relocated
+     */
+    bool isRelocatable() const;
+    
+    /**
+     * \brief Moves buffer to new memory
+     * 
+     * Allocates a new backing buffer and makes it the current
+     * physical slice. The caller is responsible for copying
+     * the buffer contents and for keeping the returned storage
+     * alive until the GPU is done with it. Do not call this
+     * directly, use the context's \c relocateBuffer method.
+     * \param [out] prevSlice Previous buffer slice
+     * \returns Previous backing storage, or \c nullptr
+     *    if the buffer cannot be relocated
+     */
+    Rc<DxvkBufferStorage> relocate(
+            DxvkBufferSliceHandle& prevSlice);
+    
     /**
      * \brief Transform feedback vertex stride
      * 
@@ -230,41 +362,15 @@ namespace dxvk {
     
     /**
      * \brief Allocates new buffer slice
+     * 
+     * Keeps track of how many slices are allocated per
+     * frame, so that the number of backing buffers can
+     * follow the recent peak demand. Backing buffers
+     * that are not needed anymore get released once
+     * demand has been lower for a number of frames.
      * \returns The new buffer slice
      */
-    DxvkBufferSliceHandle allocSlice() {
-      std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
-      
-      // If no slices are available, swap the two free lists.
-      if (unlikely(m_freeSlices.empty())) {
-        std::unique_lock<sync::Spinlock> swapLock(m_swapMutex);
-        std::swap(m_freeSlices, m_nextSlices);
-      }
-
-      // If there are still no slices available, create a new
-      // backing buffer and add all slices to the free list.
-      if (unlikely(m_freeSlices.empty())) {
-        if (likely(!m_lazyAlloc)) {
-          DxvkBufferHandle handle = allocBuffer(m_physSliceCount);
-
-          for (uint32_t i = 0; i < m_physSliceCount; i++)
-            pushSlice(handle, i);
-
-          m_buffers.push_back(std::move(handle));
-          m_physSliceCount = std::min(m_physSliceCount * 2, m_physSliceMaxCount);
-        } else {
-          for (uint32_t i = 1; i < m_physSliceCount; i++)
-            pushSlice(m_buffer, i);
-
-          m_lazyAlloc = false;
-        }
-      }
-      
-      // Take the first slice from the queue
-      DxvkBufferSliceHandle result = m_freeSlices.back();
-      m_freeSlices.pop_back();
-      return result;
-    }
+    DxvkBufferSliceHandle allocSlice();
     
     /**
      * \brief Frees a buffer slice
@@ -280,23 +386,44 @@ namespace dxvk {
       m_nextSlices.push_back(slice);
     }
     
+    /**
+     * \brief Releases unneeded backing buffers
+     * 
+     * Called periodically by the buffer trimmer, so that
+     * buffers which are no longer discarded still get to
+     * release their backing buffers after some time.
+     * \param [in] frameId Current frame ID
+     * \returns \c true if the buffer still owns backing
+     *    buffers that may be released at a later point
+     */
+    bool trim(uint32_t frameId);
+    
   private:
 
     DxvkDevice*             m_device;
     DxvkBufferCreateInfo    m_info;
     DxvkMemoryAllocator*    m_memAlloc;
     VkMemoryPropertyFlags   m_memFlags;
+    DxvkBufferArena*        m_arena = nullptr;
     
     DxvkBufferHandle        m_buffer;
-    DxvkBufferSliceHandle   m_physSlice;
+    DxvkBufferSliceStorage  m_physSlice;
 
     uint32_t                m_vertexStride = 0;
     uint32_t                m_lazyAlloc = false;
+
+    std::atomic<bool>       m_hasViews = { false };
     
-    sync::Spinlock m_freeMutex;
+    mutable sync::Spinlock m_freeMutex;
     sync::Spinlock m_swapMutex;
     
-    std::vector<DxvkBufferHandle>        m_buffers;
+    struct SliceBuffer {
+      DxvkBufferHandle      handle;
+      DxvkBufferSliceHandle base;
+      VkDeviceSize          sliceCount;
+    };
+
+    std::vector<SliceBuffer>             m_buffers;
     std::vector<DxvkBufferSliceHandle>   m_freeSlices;
     std::vector<DxvkBufferSliceHandle>   m_nextSlices;
     
@@ -304,19 +431,40 @@ namespace dxvk {
     VkDeviceSize m_physSliceStride   = 0;
     VkDeviceSize m_physSliceCount    = 1;
     VkDeviceSize m_physSliceMaxCount = 1;
+    VkDeviceSize m_physSliceTotal    = 1;
+
+    uint32_t     m_discardFrameId     = 0;
+    uint32_t     m_discardCount       = 0;
+    uint32_t     m_discardPeak        = 0;
+    uint32_t     m_discardPeakFrameId = 0;
+
+    bool         m_trimRegistered     = false;
 
-    void pushSlice(const DxvkBufferHandle& handle, uint32_t index) {
+    void pushSlice(const DxvkBufferSliceHandle& base, uint32_t index) {
       DxvkBufferSliceHandle slice;
-      slice.handle = handle.buffer;
+      slice.handle = base.handle;
       slice.length = m_physSliceLength;
-      slice.offset = m_physSliceStride * index;
-      slice.mapPtr = handle.memory.mapPtr(slice.offset);
+      slice.offset = base.offset + m_physSliceStride * index;
+      slice.mapPtr = reinterpret_cast<char*>(base.mapPtr) + m_physSliceStride * index;
       m_freeSlices.push_back(slice);
     }
 
     DxvkBufferHandle allocBuffer(
             VkDeviceSize          sliceCount) const;
 
+    SliceBuffer allocSliceBuffer(
+            VkDeviceSize          sliceCount) const;
+
+    void freeSliceBuffer(
+      const SliceBuffer&          buffer) const;
+
+    void updateDiscardStats(
+            uint32_t              frameId);
+
+    void trimSlices();
+
+    bool canRelocate() const;
+
     VkDeviceSize computeSliceAlignment() const;
     
   };
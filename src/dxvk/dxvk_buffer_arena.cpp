@@ -0,0 +1,170 @@
+#include "dxvk_buffer_arena.h"
+#include "dxvk_device.h"
+
+namespace dxvk {
+
+  DxvkBufferArena::DxvkBufferArena(
+          DxvkDevice*           device,
+          DxvkMemoryAllocator&  memAlloc)
+  : m_device(device), m_memAlloc(&memAlloc) {
+
+  }
+
+
+  DxvkBufferArena::~DxvkBufferArena() {
+    for (auto& chunk : m_chunks)
+      this->destroyChunk(std::move(chunk));
+  }
+
+
+  bool DxvkBufferArena::isCompatible(
+    const DxvkBufferCreateInfo& info,
+          VkMemoryPropertyFlags memFlags) {
+    constexpr VkBufferUsageFlags supportedUsage =
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT  |
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT  |
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT  |
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+
+    return (memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        && !(info.usage & ~supportedUsage)
+        && info.size <= MaxBufferSize;
+  }
+
+
+  DxvkBufferArenaBlock DxvkBufferArena::alloc(
+          VkMemoryPropertyFlags memFlags,
+          VkDeviceSize          size,
+          VkDeviceSize          align) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    DxvkBufferArenaBlock result;
+    result.length = size;
+
+    for (const auto& chunk : m_chunks) {
+      if (chunk->memFlags == memFlags
+       && chunk->ranges.alloc(size, align, result.offset)) {
+        result.buffer = chunk->handle.buffer;
+        result.mapPtr = chunk->handle.memory.mapPtr(result.offset);
+        return result;
+      }
+    }
+
+    std::unique_ptr<Chunk> chunk = this->createChunk(memFlags);
+
+    if (!chunk->ranges.alloc(size, align, result.offset))
+      throw DxvkError("DxvkBufferArena: Failed to allocate block");
+
+    result.buffer = chunk->handle.buffer;
+    result.mapPtr = chunk->handle.memory.mapPtr(result.offset);
+
+    m_chunks.push_back(std::move(chunk));
+    return result;
+  }
+
+
+  void DxvkBufferArena::free(
+    const DxvkBufferArenaBlock& block) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+      Chunk* chunk = m_chunks[i].get();
+
+      if (chunk->handle.buffer != block.buffer)
+        continue;
+
+      chunk->ranges.free(block.offset, block.length);
+
+      // Keep one chunk per memory type around
+      // so that we don't thrash allocations
+      if (chunk->ranges.freeSize() == ChunkSize) {
+        bool hasOtherChunk = false;
+
+        for (const auto& other : m_chunks)
+          hasOtherChunk |= other.get() != chunk && other->memFlags == chunk->memFlags;
+
+        if (hasOtherChunk) {
+          this->destroyChunk(std::move(m_chunks[i]));
+          m_chunks.erase(m_chunks.begin() + i);
+        }
+      }
+
+      return;
+    }
+
+    Logger::err("DxvkBufferArena: Block not found");
+  }
+
+
+  std::unique_ptr<DxvkBufferArena::Chunk> DxvkBufferArena::createChunk(
+          VkMemoryPropertyFlags memFlags) {
+    auto vkd = m_device->vkd();
+
+    auto chunk = std::make_unique<Chunk>(memFlags);
+
+    VkBufferCreateInfo info;
+    info.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.pNext                 = nullptr;
+    info.flags                 = 0;
+    info.size                  = ChunkSize;
+    info.usage                 = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                               | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+                               | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+                               | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+                               | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    info.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
+    info.queueFamilyIndexCount = 0;
+    info.pQueueFamilyIndices   = nullptr;
+
+    if (vkd->vkCreateBuffer(vkd->device(),
+          &info, nullptr, &chunk->handle.buffer) != VK_SUCCESS) {
+      throw DxvkError(str::format(
+        "DxvkBufferArena: Failed to create buffer:"
+        "\n  size:  ", info.size,
+        "\n  usage: ", info.usage));
+    }
+
+    VkMemoryDedicatedRequirementsKHR dedicatedRequirements;
+    dedicatedRequirements.sType                       = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS_KHR;
+    dedicatedRequirements.pNext                       = VK_NULL_HANDLE;
+    dedicatedRequirements.prefersDedicatedAllocation  = VK_FALSE;
+    dedicatedRequirements.requiresDedicatedAllocation = VK_FALSE;
+
+    VkMemoryRequirements2KHR memReq;
+    memReq.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2_KHR;
+    memReq.pNext = &dedicatedRequirements;
+
+    VkBufferMemoryRequirementsInfo2KHR memReqInfo;
+    memReqInfo.sType  = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2_KHR;
+    memReqInfo.buffer = chunk->handle.buffer;
+    memReqInfo.pNext  = VK_NULL_HANDLE;
+
+    VkMemoryDedicatedAllocateInfoKHR dedMemoryAllocInfo;
+    dedMemoryAllocInfo.sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO_KHR;
+    dedMemoryAllocInfo.pNext  = VK_NULL_HANDLE;
+    dedMemoryAllocInfo.buffer = chunk->handle.buffer;
+    dedMemoryAllocInfo.image  = VK_NULL_HANDLE;
+
+    vkd->vkGetBufferMemoryRequirements2KHR(
+       vkd->device(), &memReqInfo, &memReq);
+
+    chunk->handle.memory = m_memAlloc->alloc(&memReq.memoryRequirements,
+      dedicatedRequirements, dedMemoryAllocInfo, memFlags, 0.5f);
+
+    if (vkd->vkBindBufferMemory(vkd->device(), chunk->handle.buffer,
+        chunk->handle.memory.memory(), chunk->handle.memory.offset()) != VK_SUCCESS)
+      throw DxvkError("DxvkBufferArena: Failed to bind device memory");
+
+    return chunk;
+  }
+
+
+  void DxvkBufferArena::destroyChunk(
+          std::unique_ptr<Chunk>&& chunk) {
+    auto vkd = m_device->vkd();
+    vkd->vkDestroyBuffer(vkd->device(), chunk->handle.buffer, nullptr);
+    chunk = nullptr;
+  }
+
+}
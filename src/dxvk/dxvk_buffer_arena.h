@@ -0,0 +1,118 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "dxvk_buffer.h"
+#include "dxvk_memory_range.h"
+
+namespace dxvk {
+
+  class DxvkDevice;
+
+  /**
+   * \brief Buffer arena block
+   *
+   * Range of a shared arena buffer that
+   * has been allocated for a single buffer.
+   */
+  struct DxvkBufferArenaBlock {
+    VkBuffer      buffer = VK_NULL_HANDLE;
+    VkDeviceSize  offset = 0;
+    VkDeviceSize  length = 0;
+    void*         mapPtr = nullptr;
+  };
+
+
+  /**
+   * \brief Buffer arena
+   *
+   * Sub-allocates backing storage for small host-visible
+   * buffers, such as dynamic constant buffers, from a few
+   * large, persistently mapped Vulkan buffers. This reduces
+   * the number of Vulkan buffer objects, avoids per-buffer
+   * memory alignment padding, and since many buffers share
+   * the same handle, discarding a buffer usually only needs
+   * to update dynamic offsets rather than descriptor sets.
+   */
+  class DxvkBufferArena {
+    constexpr static VkDeviceSize ChunkSize = 4 << 20;
+  public:
+
+    /// Largest buffer that can use the arena
+    constexpr static VkDeviceSize MaxBufferSize = 1 << 16;
+
+    /// Largest block that can be allocated
+    constexpr static VkDeviceSize MaxBlockSize  = 1 << 20;
+
+    DxvkBufferArena(
+            DxvkDevice*           device,
+            DxvkMemoryAllocator&  memAlloc);
+
+    ~DxvkBufferArena();
+
+    /**
+     * \brief Checks whether a buffer can use the arena
+     *
+     * Only small host-visible buffers that are used as
+     * vertex, index or uniform buffers, or for transfer
+     * operations, are supported. Buffer views require
+     * dedicated buffers and are therefore not allowed.
+     * \param [in] info Buffer properties
+     * \param [in] memFlags Memory properties
+     * \returns \c true if the arena can be used
+     */
+    static bool isCompatible(
+      const DxvkBufferCreateInfo& info,
+            VkMemoryPropertyFlags memFlags);
+
+    /**
+     * \brief Allocates a block
+     *
+     * \param [in] memFlags Memory properties
+     * \param [in] size Block size, at most \c MaxBlockSize
+     * \param [in] align Required alignment
+     * \returns The allocated block
+     */
+    DxvkBufferArenaBlock alloc(
+            VkMemoryPropertyFlags memFlags,
+            VkDeviceSize          size,
+            VkDeviceSize          align);
+
+    /**
+     * \brief Frees a block
+     *
+     * The block must not be in use by the GPU.
+     * \param [in] block The block to free
+     */
+    void free(
+      const DxvkBufferArenaBlock& block);
+
+  private:
+
+    struct Chunk {
+      Chunk(VkMemoryPropertyFlags f)
+      : memFlags(f), ranges(ChunkSize) { }
+
+      VkMemoryPropertyFlags     memFlags;
+      DxvkBufferHandle          handle;
+      DxvkMemoryRangeAllocator  ranges;
+    };
+
+    DxvkDevice*             m_device;
+    DxvkMemoryAllocator*    m_memAlloc;
+
+    std::mutex              m_mutex;
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+
+    std::unique_ptr<Chunk> createChunk(
+            VkMemoryPropertyFlags memFlags);
+
+    void destroyChunk(
+            std::unique_ptr<Chunk>&& chunk);
+
+  };
+
+}
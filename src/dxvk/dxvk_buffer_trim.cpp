@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include "dxvk_buffer.h"
+#include "dxvk_buffer_trim.h"
+
+namespace dxvk {
+
+  DxvkBufferTrimmer::DxvkBufferTrimmer() {
+
+  }
+
+
+  DxvkBufferTrimmer::~DxvkBufferTrimmer() {
+
+  }
+
+
+  void DxvkBufferTrimmer::registerBuffer(
+          DxvkBuffer*           buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers.push_back(buffer);
+  }
+
+
+  void DxvkBufferTrimmer::unregisterBuffer(
+          DxvkBuffer*           buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto entry = std::find(m_buffers.begin(), m_buffers.end(), buffer);
+
+    if (entry != m_buffers.end()) {
+      *entry = m_buffers.back();
+      m_buffers.pop_back();
+    }
+  }
+
+
+  void DxvkBufferTrimmer::endFrame(
+          uint32_t              frameId) {
+    if (frameId % FramesPerPass)
+      return;
+
+    // Buffers being destroyed block in unregisterBuffer
+    // until we are done, so all pointers remain valid.
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t i = 0; i < m_buffers.size(); ) {
+      if (m_buffers[i]->trim(frameId)) {
+        i += 1;
+      } else {
+        m_buffers[i] = m_buffers.back();
+        m_buffers.pop_back();
+      }
+    }
+  }
+
+}
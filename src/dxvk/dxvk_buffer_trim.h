@@ -0,0 +1,69 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "dxvk_include.h"
+
+namespace dxvk {
+
+  class DxvkBuffer;
+
+  /**
+   * \brief Buffer trimmer
+   * 
+   * Keeps track of buffers that own more than one backing
+   * buffer for discards, and periodically lets them release
+   * backing buffers they do not need anymore. Buffers only
+   * update their discard statistics when allocating a slice,
+   * so without this, a buffer that stops being discarded
+   * entirely would hold on to its backing buffers forever.
+   */
+  class DxvkBufferTrimmer {
+    constexpr static uint32_t FramesPerPass = 16;
+  public:
+
+    DxvkBufferTrimmer();
+
+    ~DxvkBufferTrimmer();
+
+    /**
+     * \brief Registers a buffer
+     * 
+     * Called by the buffer when it allocates
+     * an additional backing buffer.
+     * \param [in] buffer The buffer
+     */
+    void registerBuffer(
+            DxvkBuffer*           buffer);
+
+    /**
+     * \brief Unregisters a buffer
+     * 
+     * Must be called before destroying a
+     * buffer that has been registered.
+     * \param [in] buffer The buffer
+     */
+    void unregisterBuffer(
+            DxvkBuffer*           buffer);
+
+    /**
+     * \brief Trims registered buffers
+     * 
+     * Called once per frame. Every few frames, this
+     * updates the discard statistics of all registered
+     * buffers and removes the ones that no longer own
+     * any additional backing buffers.
+     * \param [in] frameId Current frame ID
+     */
+    void endFrame(
+            uint32_t              frameId);
+
+  private:
+
+    std::mutex                m_mutex;
+    std::vector<DxvkBuffer*>  m_buffers;
+
+  };
+
+}
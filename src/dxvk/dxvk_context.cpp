@@ -2,6 +2,7 @@
 
 #include "dxvk_device.h"
 #include "dxvk_context.h"
+#include "dxvk_cs_recorder.h"
 #include "dxvk_main.h"
 
 namespace dxvk {
@@ -33,6 +34,10 @@ namespace dxvk {
     // Mark all resources as untracked
     m_vbTracked.clear();
     m_rcTracked.clear();
+
+    // Cached descriptor sets may reference
+    // resources that are no longer alive
+    m_descCache.clear();
     
     // The current state of the internal command buffer is
     // undefined, so we have to bind and set up everything
@@ -213,6 +218,16 @@ namespace dxvk {
     
     *shaderStage = shader;
 
+    // A pending variant is only valid for the shader that
+    // was bound when it was requested, and the pipeline
+    // depends on the shaders bound to all other stages
+    if (unlikely(m_variantShader != nullptr)) {
+      if (stage == m_variantStage)
+        this->resetShaderVariant();
+      else if (stage != VK_SHADER_STAGE_COMPUTE_BIT)
+        this->bindShaderVariant(m_variantStage, m_variantShader);
+    }
+
     if (stage == VK_SHADER_STAGE_COMPUTE_BIT) {
       m_flags.set(
         DxvkContextFlag::CpDirtyPipeline,
@@ -227,6 +242,23 @@ namespace dxvk {
   }
   
   
+  void DxvkContext::bindShaderVariant(
+          VkShaderStageFlagBits stage,
+    const Rc<DxvkShader>&       shader) {
+    // Take a reference first in case the
+    // variant is already bound to the stage
+    Rc<DxvkShader> variant = shader;
+
+    this->resetShaderVariant();
+
+    m_variantStage  = stage;
+    m_variantShader = std::move(variant);
+
+    // The variant gets checked when the pipeline state is updated
+    m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+  }
+  
+  
   void DxvkContext::bindVertexBuffer(
           uint32_t              binding,
     const DxvkBufferSlice&      buffer,
@@ -1331,7 +1363,7 @@ namespace dxvk {
 
   void DxvkContext::discardBuffer(
     const Rc<DxvkBuffer>&       buffer) {
-    if (m_execBarriers.isBufferDirty(buffer->getSliceHandle(), DxvkAccess::Write))
+    if (m_renameBuffers && m_execBarriers.isBufferDirty(buffer->getSliceHandle(), DxvkAccess::Write))
       this->invalidateBuffer(buffer, buffer->allocSlice());
   }
 
@@ -1671,46 +1703,93 @@ namespace dxvk {
   void DxvkContext::invalidateBuffer(
     const Rc<DxvkBuffer>&           buffer,
     const DxvkBufferSliceHandle&    slice) {
+    // Command lists that are still being recorded must
+    // see the slice that was current when they were queued
+    if (m_recorder != nullptr)
+      m_recorder->synchronize();
+
     // Allocate new backing resource
     DxvkBufferSliceHandle prevSlice = buffer->rename(slice);
     m_cmd->freeBufferSlice(buffer, prevSlice);
+
+    m_cmd->addStatCtr(DxvkStatCounter::BufferDiscardCount, 1);
+    m_cmd->addStatCtr(DxvkStatCounter::BufferDiscardBytes, slice.length);
     
     // We also need to update all bindings that the buffer
     // may be bound to either directly or through views.
-    VkBufferUsageFlags usage = buffer->info().usage &
-      ~(VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    this->invalidateBufferBindings(buffer,
+      prevSlice.handle == slice.handle);
+  }
 
-    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
-      m_flags.set(prevSlice.handle == slice.handle
-        ? DxvkContextFlags(DxvkContextFlag::GpDirtyDescriptorBinding,
-                           DxvkContextFlag::CpDirtyDescriptorBinding)
-        : DxvkContextFlags(DxvkContextFlag::GpDirtyResources,
-                           DxvkContextFlag::CpDirtyResources));
-    }
 
-    // Fast early-out for uniform buffers, very common
-    if (likely(usage == VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT))
+  bool DxvkContext::relocateBuffer(
+    const Rc<DxvkBuffer>&           buffer) {
+    if (m_recorder != nullptr)
+      m_recorder->synchronize();
+
+    DxvkBufferSliceHandle srcSlice;
+    Rc<DxvkBufferStorage> storage = buffer->relocate(srcSlice);
+
+    if (storage == nullptr)
+      return false;
+
+    this->spillRenderPass();
+
+    // The new backing buffer is not used by anything
+    // yet, so we only need to synchronize the read
+    DxvkBufferSliceHandle dstSlice = buffer->getSliceHandle();
+
+    if (m_execBarriers.isBufferDirty(srcSlice, DxvkAccess::Read))
+      m_execBarriers.recordCommands(m_cmd);
+
+    VkBufferCopy bufferRegion;
+    bufferRegion.srcOffset = srcSlice.offset;
+    bufferRegion.dstOffset = dstSlice.offset;
+    bufferRegion.size      = dstSlice.length;
+
+    m_cmd->cmdCopyBuffer(DxvkCmdBuffer::ExecBuffer,
+      srcSlice.handle, dstSlice.handle, 1, &bufferRegion);
+
+    m_execBarriers.accessBuffer(srcSlice,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_READ_BIT,
+      buffer->info().stages,
+      buffer->info().access);
+
+    m_execBarriers.accessBuffer(dstSlice,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      buffer->info().stages,
+      buffer->info().access);
+
+    m_cmd->trackResource<DxvkAccess::Write>(buffer);
+    m_cmd->trackResource<DxvkAccess::Read>(storage);
+
+    this->invalidateBufferBindings(buffer, false);
+    return true;
+  }
+
+
+  void DxvkContext::defragMemory() {
+    DxvkMemoryDefrag* defrag = m_device->memoryDefrag();
+
+    if (defrag == nullptr)
       return;
-    
-    if (usage & (VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
-               | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT
-               | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
-      m_flags.set(DxvkContextFlag::GpDirtyResources,
-                  DxvkContextFlag::CpDirtyResources);
-    }
 
-    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
-      m_flags.set(DxvkContextFlag::GpDirtyIndexBuffer);
-    
-    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
-      m_flags.set(DxvkContextFlag::GpDirtyVertexBuffers);
-    
-    if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
-      m_flags.set(DxvkContextFlag::DirtyDrawBuffer);
+    std::vector<Rc<DxvkBuffer>> buffers = defrag->pickBuffers();
 
-    if (usage & VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_BUFFER_BIT_EXT)
-      m_flags.set(DxvkContextFlag::GpDirtyXfbBuffers);
+    if (buffers.empty())
+      return;
+
+    // Recording may have added GPU writes to some of the
+    // buffers, so complete it before checking for those
+    if (m_recorder != nullptr)
+      m_recorder->synchronize();
+
+    for (const auto& buffer : buffers) {
+      if (!buffer->isInUse(DxvkAccess::Write))
+        this->relocateBuffer(buffer);
+    }
   }
 
 
@@ -1829,76 +1908,18 @@ namespace dxvk {
           VkDeviceSize              offset,
           VkDeviceSize              size,
     const void*                     data) {
-    bool replaceBuffer = (size == buffer->info().size)
-                      && (size <= (1 << 20)); /* 1 MB */
-    
-    DxvkBufferSliceHandle bufferSlice;
-    DxvkCmdBuffer         cmdBuffer;
-
-    if (replaceBuffer) {
-      // Pause transform feedback so that we don't mess
-      // with the currently bound counter buffers
-      if (m_flags.test(DxvkContextFlag::GpXfbActive))
-        this->pauseTransformFeedback();
-
-      // As an optimization, allocate a free slice and perform
-      // the copy in the initialization command buffer instead
-      // interrupting the render pass and stalling the pipeline.
-      bufferSlice = buffer->allocSlice();
-      cmdBuffer   = DxvkCmdBuffer::InitBuffer;
-
-      this->invalidateBuffer(buffer, bufferSlice);
-    } else {
-      this->spillRenderPass();
-    
-      bufferSlice = buffer->getSliceHandle(offset, size);
-      cmdBuffer   = DxvkCmdBuffer::ExecBuffer;
-
-      if (m_execBarriers.isBufferDirty(bufferSlice, DxvkAccess::Write))
-        m_execBarriers.recordCommands(m_cmd);
-    }
-
-    // Vulkan specifies that small amounts of data (up to 64kB) can
-    // be copied to a buffer directly if the size is a multiple of
-    // four. Anything else must be copied through a staging buffer.
-    // We'll limit the size to 4kB in order to keep command buffers
-    // reasonably small, we do not know how much data apps may upload.
-    if ((size <= 4096) && ((size & 0x3) == 0) && ((offset & 0x3) == 0)) {
-      m_cmd->cmdUpdateBuffer(
-        cmdBuffer,
-        bufferSlice.handle,
-        bufferSlice.offset,
-        bufferSlice.length,
-        data);
-    } else {
-      auto stagingSlice  = m_staging.alloc(CACHE_LINE_SIZE, size);
-      auto stagingHandle = stagingSlice.getSliceHandle();
-
-      std::memcpy(stagingHandle.mapPtr, data, size);
-
-      VkBufferCopy region;
-      region.srcOffset = stagingHandle.offset;
-      region.dstOffset = bufferSlice.offset;
-      region.size      = size;
-
-      m_cmd->cmdCopyBuffer(cmdBuffer,
-        stagingHandle.handle, bufferSlice.handle, 1, &region);
-      
-      m_cmd->trackResource<DxvkAccess::Read>(stagingSlice.buffer());
-    }
-
-    auto& barriers = replaceBuffer
-      ? m_initBarriers
-      : m_execBarriers;
-
-    barriers.accessBuffer(
-      bufferSlice,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_ACCESS_TRANSFER_WRITE_BIT,
-      buffer->info().stages,
-      buffer->info().access);
-
-    m_cmd->trackResource<DxvkAccess::Write>(buffer);
+    this->updateBufferInternal(buffer,
+      offset, size, data, DxvkBufferSlice());
+  }
+  
+  
+  void DxvkContext::updateBuffer(
+    const Rc<DxvkBuffer>&           buffer,
+          VkDeviceSize              offset,
+          VkDeviceSize              size,
+    const DxvkBufferSlice&          source) {
+    this->updateBufferInternal(buffer,
+      offset, size, nullptr, source);
   }
   
   
@@ -1910,8 +1931,6 @@ namespace dxvk {
     const void*                     data,
           VkDeviceSize              pitchPerRow,
           VkDeviceSize              pitchPerLayer) {
-    this->spillRenderPass();
-    
     // Upload data through a staging buffer. Special care needs to
     // be taken when dealing with compressed image formats: Rather
     // than copying pixels, we'll be copying blocks of pixels.
@@ -1933,6 +1952,22 @@ namespace dxvk {
       elementCount, formatInfo->elementSize,
       pitchPerRow, pitchPerLayer);
     
+    this->updateImage(image, subresources,
+      imageOffset, imageExtent, stagingSlice);
+  }
+  
+  
+  void DxvkContext::updateImage(
+    const Rc<DxvkImage>&            image,
+    const VkImageSubresourceLayers& subresources,
+          VkOffset3D                imageOffset,
+          VkExtent3D                imageExtent,
+    const DxvkBufferSlice&          source) {
+    this->spillRenderPass();
+    
+    const DxvkFormatInfo* formatInfo = image->formatInfo();
+    auto stagingHandle = source.getSliceHandle();
+    
     // Prepare the image layout. If the given extent covers
     // the entire image, we may discard its previous contents.
     auto subresourceRange = vk::makeSubresourceRange(subresources);
@@ -1983,7 +2018,91 @@ namespace dxvk {
       image->info().access);
     
     m_cmd->trackResource<DxvkAccess::Write>(image);
-    m_cmd->trackResource<DxvkAccess::Read>(stagingSlice.buffer());
+    m_cmd->trackResource<DxvkAccess::Read>(source.buffer());
+  }
+  
+  
+  void DxvkContext::updateBufferInternal(
+    const Rc<DxvkBuffer>&           buffer,
+          VkDeviceSize              offset,
+          VkDeviceSize              size,
+    const void*                     data,
+    const DxvkBufferSlice&          source) {
+    bool replaceBuffer = (size == buffer->info().size)
+                      && (size <= (1 << 20)) /* 1 MB */
+                      && (m_renameBuffers);
+    
+    DxvkBufferSliceHandle bufferSlice;
+    DxvkCmdBuffer         cmdBuffer;
+
+    if (replaceBuffer) {
+      // Pause transform feedback so that we don't mess
+      // with the currently bound counter buffers
+      if (m_flags.test(DxvkContextFlag::GpXfbActive))
+        this->pauseTransformFeedback();
+
+      // As an optimization, allocate a free slice and perform
+      // the copy in the initialization command buffer instead
+      // interrupting the render pass and stalling the pipeline.
+      bufferSlice = buffer->allocSlice();
+      cmdBuffer   = DxvkCmdBuffer::InitBuffer;
+
+      this->invalidateBuffer(buffer, bufferSlice);
+    } else {
+      this->spillRenderPass();
+    
+      bufferSlice = buffer->getSliceHandle(offset, size);
+      cmdBuffer   = DxvkCmdBuffer::ExecBuffer;
+
+      if (m_execBarriers.isBufferDirty(bufferSlice, DxvkAccess::Write))
+        m_execBarriers.recordCommands(m_cmd);
+    }
+
+    // Vulkan specifies that small amounts of data (up to 64kB) can
+    // be copied to a buffer directly if the size is a multiple of
+    // four. Anything else must be copied through a staging buffer.
+    // We'll limit the size to 4kB in order to keep command buffers
+    // reasonably small, we do not know how much data apps may upload.
+    if (!source.defined() && (size <= 4096) && ((size & 0x3) == 0) && ((offset & 0x3) == 0)) {
+      m_cmd->cmdUpdateBuffer(
+        cmdBuffer,
+        bufferSlice.handle,
+        bufferSlice.offset,
+        bufferSlice.length,
+        data);
+    } else {
+      auto stagingSlice = source;
+
+      if (!stagingSlice.defined()) {
+        stagingSlice = m_staging.alloc(CACHE_LINE_SIZE, size);
+        std::memcpy(stagingSlice.mapPtr(0), data, size);
+      }
+
+      auto stagingHandle = stagingSlice.getSliceHandle();
+
+      VkBufferCopy region;
+      region.srcOffset = stagingHandle.offset;
+      region.dstOffset = bufferSlice.offset;
+      region.size      = size;
+
+      m_cmd->cmdCopyBuffer(cmdBuffer,
+        stagingHandle.handle, bufferSlice.handle, 1, &region);
+      
+      m_cmd->trackResource<DxvkAccess::Read>(stagingSlice.buffer());
+    }
+
+    auto& barriers = replaceBuffer
+      ? m_initBarriers
+      : m_execBarriers;
+
+    barriers.accessBuffer(
+      bufferSlice,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      buffer->info().stages,
+      buffer->info().access);
+
+    m_cmd->trackResource<DxvkAccess::Write>(buffer);
   }
   
   
@@ -2340,6 +2459,16 @@ namespace dxvk {
   void DxvkContext::setBarrierControl(DxvkBarrierControlFlags control) {
     m_barrierControl = control;
   }
+
+
+  void DxvkContext::setBufferRenaming(bool enable) {
+    m_renameBuffers = enable;
+  }
+
+
+  void DxvkContext::setRecorder(DxvkCsRecorder* recorder) {
+    m_recorder = recorder;
+  }
   
   
   void DxvkContext::signalGpuEvent(const Rc<DxvkGpuEvent>& event) {
@@ -3837,7 +3966,12 @@ namespace dxvk {
       : DxvkContextFlag::GpDirtyStencilRef);
     
     // Retrieve and bind actual Vulkan pipeline handle
-    m_gpActivePipeline = m_state.gp.pipeline->getPipelineHandle(m_state.gp.state, m_state.om.framebuffer->getRenderPass());
+    const DxvkRenderPass* renderPass = m_state.om.framebuffer->getRenderPass();
+
+    if (unlikely(m_variantShader != nullptr))
+      this->updateShaderVariant(renderPass);
+
+    m_gpActivePipeline = m_state.gp.pipeline->getPipelineHandle(m_state.gp.state, renderPass);
 
     if (unlikely(!m_gpActivePipeline))
       return false;
@@ -3851,6 +3985,85 @@ namespace dxvk {
   }
   
   
+  void DxvkContext::updateShaderVariant(
+    const DxvkRenderPass*       renderPass) {
+    DxvkGraphicsPipelineShaders shaders = m_state.gp.shaders;
+
+    switch (m_variantStage) {
+      case VK_SHADER_STAGE_VERTEX_BIT:                  shaders.vs  = m_variantShader; break;
+      case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:    shaders.tcs = m_variantShader; break;
+      case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: shaders.tes = m_variantShader; break;
+      case VK_SHADER_STAGE_GEOMETRY_BIT:                shaders.gs  = m_variantShader; break;
+      case VK_SHADER_STAGE_FRAGMENT_BIT:                shaders.fs  = m_variantShader; break;
+      default: m_variantShader = nullptr; return;
+    }
+
+    if (!m_variantPipeline) {
+      m_variantPipeline = lookupGraphicsPipeline(shaders);
+
+      if (unlikely(m_variantPipeline == nullptr)) {
+        this->resetShaderVariant();
+        return;
+      }
+    }
+
+    // Read the count before checking the status so
+    // that we do not miss pipelines compiled in between
+    m_variantInstances = m_variantPipeline->getInstanceCount();
+
+    auto status = m_variantPipeline->getPipelineStatus(m_state.gp.state, renderPass);
+
+    // Resources have already been bound for the current pipeline
+    // layout at this point, so the variant is bound on the next draw
+    if (status == DxvkGraphicsPipelineStatus::Ready) {
+      m_variantReady = true;
+      return;
+    }
+
+    // The variant will never be usable with this state
+    if (status == DxvkGraphicsPipelineStatus::Failed) {
+      this->resetShaderVariant();
+      return;
+    }
+
+    // Only queue the pipeline once for each state vector, and
+    // only for a few of them in case the state keeps changing
+    constexpr size_t MaxVariantStates = 16;
+
+    for (const auto& entry : m_variantStates) {
+      if (entry.first == renderPass && entry.second == m_state.gp.state)
+        return;
+    }
+
+    if (m_variantStates.size() >= MaxVariantStates)
+      return;
+
+    m_variantStates.emplace_back(renderPass, m_state.gp.state);
+
+    // Compile the pipeline synchronously if there is no
+    // compiler thread, there is no point in waiting then
+    if (!m_common->pipelineManager().compileGraphicsPipeline(shaders, m_state.gp.state, renderPass))
+      m_variantReady = true;
+  }
+
+
+  void DxvkContext::applyShaderVariant() {
+    Rc<DxvkShader> shader = std::move(m_variantShader);
+    this->resetShaderVariant();
+
+    this->bindShader(m_variantStage, shader);
+  }
+
+
+  void DxvkContext::resetShaderVariant() {
+    m_variantShader    = nullptr;
+    m_variantPipeline  = nullptr;
+    m_variantInstances = 0;
+    m_variantReady     = false;
+    m_variantStates.clear();
+  }
+  
+  
   void DxvkContext::updateComputeShaderResources() {
     if ((m_flags.test(DxvkContextFlag::CpDirtyResources))
      || (m_flags.test(DxvkContextFlag::CpDirtyDescriptorBinding)
@@ -3896,7 +4109,7 @@ namespace dxvk {
   
   
   template<VkPipelineBindPoint BindPoint>
-  bool DxvkContext::updateShaderResources(const DxvkPipelineLayout* layout) {
+  bool DxvkContext::updateShaderResources(DxvkPipelineLayout* layout) {
     std::array<DxvkDescriptorInfo, MaxNumActiveBindings> descriptors;
 
     // Assume that all bindings are active as a fast path
@@ -4062,10 +4275,23 @@ namespace dxvk {
     auto& set = BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS ? m_gpSet : m_cpSet;
 
     if (layout->bindingCount()) {
-      set = allocateDescriptorSet(layout->descriptorSetLayout());
+      // Reuse a previously written set if
+      // all descriptors are the same
+      size_t hash = DxvkDescriptorSetCache::hash(layout, descriptors.data());
+      set = m_descCache.lookup(layout, descriptors.data(), hash);
+
+      if (set) {
+        m_cmd->addStatCtr(DxvkStatCounter::DescriptorSetCacheHits, 1);
+        m_cmd->addStatCtr(DxvkStatCounter::DescriptorWritesSaved, layout->bindingCount());
+      } else {
+        set = allocateDescriptorSet(layout);
+
+        m_cmd->updateDescriptorSetWithTemplate(set,
+          layout->descriptorTemplate(), descriptors.data());
+        m_cmd->addStatCtr(DxvkStatCounter::DescriptorSetCacheMisses, 1);
 
-      m_cmd->updateDescriptorSetWithTemplate(set,
-        layout->descriptorTemplate(), descriptors.data());
+        m_descCache.insert(layout, descriptors.data(), hash, set);
+      }
     } else {
       set = VK_NULL_HANDLE;
     }
@@ -4136,6 +4362,46 @@ namespace dxvk {
   }
   
   
+  void DxvkContext::invalidateBufferBindings(
+    const Rc<DxvkBuffer>&           buffer,
+          bool                      sameHandle) {
+    VkBufferUsageFlags usage = buffer->info().usage &
+      ~(VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+      m_flags.set(sameHandle
+        ? DxvkContextFlags(DxvkContextFlag::GpDirtyDescriptorBinding,
+                           DxvkContextFlag::CpDirtyDescriptorBinding)
+        : DxvkContextFlags(DxvkContextFlag::GpDirtyResources,
+                           DxvkContextFlag::CpDirtyResources));
+    }
+
+    // Fast early-out for uniform buffers, very common
+    if (likely(usage == VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT))
+      return;
+    
+    if (usage & (VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
+               | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT
+               | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+      m_flags.set(DxvkContextFlag::GpDirtyResources,
+                  DxvkContextFlag::CpDirtyResources);
+    }
+
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+      m_flags.set(DxvkContextFlag::GpDirtyIndexBuffer);
+    
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+      m_flags.set(DxvkContextFlag::GpDirtyVertexBuffers);
+    
+    if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
+      m_flags.set(DxvkContextFlag::DirtyDrawBuffer);
+
+    if (usage & VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_BUFFER_BIT_EXT)
+      m_flags.set(DxvkContextFlag::GpDirtyXfbBuffers);
+  }
+  
+  
   void DxvkContext::updateIndexBufferBinding() {
     m_flags.clr(DxvkContextFlag::GpDirtyIndexBuffer);
     
@@ -4351,6 +4617,16 @@ namespace dxvk {
   
   template<bool Indexed, bool Indirect>
   bool DxvkContext::commitGraphicsState() {
+    if (unlikely(m_variantShader != nullptr)) {
+      // Pipelines for pending variants get compiled by a
+      // different thread, so only check them again once
+      // a new pipeline instance has been added
+      if (m_variantReady)
+        this->applyShaderVariant();
+      else if (m_variantPipeline && m_variantPipeline->getInstanceCount() != m_variantInstances)
+        m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+    }
+
     if (m_flags.test(DxvkContextFlag::GpDirtyPipeline)) {
       if (unlikely(!this->updateGraphicsPipeline()))
         return false;
@@ -4413,6 +4689,7 @@ namespace dxvk {
     auto layout = m_state.cp.pipeline->layout();
 
     bool requiresBarrier = false;
+    bool hasPendingAccess = false;
 
     for (uint32_t i = 0; i < layout->bindingCount() && !requiresBarrier; i++) {
       if (m_state.cp.state.bsBindingMask.test(i)) {
@@ -4463,6 +4740,8 @@ namespace dxvk {
         if (srcAccess == 0)
           continue;
 
+        hasPendingAccess = true;
+
         // Skip write-after-write barriers if explicitly requested
         if ((m_barrierControl.test(DxvkBarrierControl::IgnoreWriteAfterWrite))
          && (m_execBarriers.getSrcStages() == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
@@ -4474,8 +4753,13 @@ namespace dxvk {
       }
     }
 
+    // Resources that were only read by previous dispatches,
+    // or not accessed at all, do not need a barrier, so
+    // keep accumulating accesses until a hazard occurs
     if (requiresBarrier)
       m_execBarriers.recordCommands(m_cmd);
+    else if (hasPendingAccess)
+      m_cmd->addStatCtr(DxvkStatCounter::CmdBarrierSkipped, 1);
   }
   
 
@@ -4553,6 +4837,7 @@ namespace dxvk {
     constexpr auto storageImageUsage  = VK_IMAGE_USAGE_STORAGE_BIT;
 
     bool requiresBarrier = false;
+    bool hasPendingAccess = false;
 
     // Check the draw buffer for indirect draw calls
     if (m_flags.test(DxvkContextFlag::DirtyDrawBuffer) && Indirect) {
@@ -4673,6 +4958,8 @@ namespace dxvk {
       if (srcAccess == 0)
         continue;
 
+      hasPendingAccess = true;
+
       // Skip write-after-write barriers if explicitly requested
       if ((m_barrierControl.test(DxvkBarrierControl::IgnoreWriteAfterWrite))
         && (srcAccess.test(DxvkAccess::Write))
@@ -4687,6 +4974,8 @@ namespace dxvk {
     // inter-stage synchronization.
     if (requiresBarrier)
       this->spillRenderPass();
+    else if (hasPendingAccess)
+      m_cmd->addStatCtr(DxvkStatCounter::CmdBarrierSkipped, 1);
   }
 
 
@@ -4742,6 +5031,7 @@ namespace dxvk {
     m_cmd->cmdPipelineBarrier(
       DxvkCmdBuffer::ExecBuffer, srcStages, dstStages,
       flags, 1, &barrier, 0, nullptr, 0, nullptr);
+    m_cmd->addStatCtr(DxvkStatCounter::CmdBarrierCount, 1);
   }
 
 
@@ -4753,15 +5043,111 @@ namespace dxvk {
     VkDescriptorSet set = m_descPool->alloc(layout);
 
     if (set == VK_NULL_HANDLE) {
-      m_cmd->trackDescriptorPool(std::move(m_descPool));
+      this->retireDescriptorPool(std::move(m_descPool));
+
+      m_descPool = m_device->createDescriptorPool();
+      set = m_descPool->alloc(layout);
+
+      // Layouts without a pipeline layout are only used by meta
+      // operations, and pools always reserve some descriptors
+      // of the types that those use, so this should not happen
+      if (set == VK_NULL_HANDLE)
+        throw DxvkError("DxvkContext: Failed to allocate descriptor set");
+    }
+
+    return set;
+  }
+
+
+  VkDescriptorSet DxvkContext::allocateDescriptorSet(
+          DxvkPipelineLayout*       layout) {
+    for (auto& entry : m_layoutPools) {
+      if (entry.layout.ptr() == layout) {
+        VkDescriptorSet set = entry.pool->alloc(layout);
+
+        if (set == VK_NULL_HANDLE) {
+          this->retireDescriptorPool(std::move(entry.pool));
+
+          entry.pool = m_device->createDescriptorPool(layout);
+          set = entry.pool->alloc(layout);
+
+          if (set == VK_NULL_HANDLE)
+            throw DxvkError("DxvkContext: Failed to allocate descriptor set");
+        }
+
+        return set;
+      }
+    }
 
+    if (m_descPool == nullptr)
+      m_descPool = m_device->createDescriptorPool();
+    
+    VkDescriptorSet set = m_descPool->alloc(layout);
+
+    if (set != VK_NULL_HANDLE) {
+      // Find the layout that allocates the majority of
+      // sets from the pool using a majority vote, which
+      // does not require any per-layout bookkeeping
+      if (m_hotLayout == layout) {
+        m_hotLayoutScore += 1;
+      } else if (m_hotLayoutScore) {
+        m_hotLayoutScore -= 1;
+      } else {
+        m_hotLayout      = layout;
+        m_hotLayoutScore = 1;
+      }
+
+      return set;
+    }
+
+    // If the layout that exhausted the pool has been using
+    // most of it, give it a dedicated pool so that the
+    // general-purpose pools get used more evenly.
+    bool promote = m_hotLayout == layout
+      && 4 * m_hotLayoutScore >= m_descPool->usage().sets;
+
+    m_hotLayout      = nullptr;
+    m_hotLayoutScore = 0;
+
+    this->retireDescriptorPool(std::move(m_descPool));
+
+    if (!promote) {
       m_descPool = m_device->createDescriptorPool();
       set = m_descPool->alloc(layout);
+
+      // General-purpose pools are sized for the average set,
+      // so a layout that uses a lot of descriptors of one type
+      // may not fit into an empty pool. Give it its own pool.
+      if (set != VK_NULL_HANDLE)
+        return set;
     }
 
+    auto& entry = m_layoutPools[m_layoutPoolIndex];
+    m_layoutPoolIndex = (m_layoutPoolIndex + 1) % m_layoutPools.size();
+
+    if (entry.pool != nullptr)
+      this->retireDescriptorPool(std::move(entry.pool));
+
+    entry.layout = layout;
+    entry.pool   = m_device->createDescriptorPool(layout);
+    set = entry.pool->alloc(layout);
+
+    if (set == VK_NULL_HANDLE)
+      throw DxvkError("DxvkContext: Failed to allocate descriptor set");
+
     return set;
   }
 
+
+  void DxvkContext::retireDescriptorPool(
+          Rc<DxvkDescriptorPool>&&  pool) {
+    m_cmd->trackDescriptorPool(std::move(pool));
+
+    // Cached sets may have been allocated from the
+    // pool, which gets reset once the GPU is done
+    m_descCache.clear();
+  }
+
   
   void DxvkContext::trackDrawBuffer() {
     if (m_flags.test(DxvkContextFlag::DirtyDrawBuffer)) {
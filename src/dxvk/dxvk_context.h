@@ -9,6 +9,8 @@
 #include "dxvk_util.h"
 
 namespace dxvk {
+
+  class DxvkCsRecorder;
   
   /**
    * \brief DXVk context
@@ -152,6 +154,22 @@ namespace dxvk {
             VkShaderStageFlagBits stage,
       const Rc<DxvkShader>&       shader);
     
+    /**
+     * \brief Binds a specialized shader variant
+     * 
+     * The variant replaces the shader bound to the given
+     * stage as soon as a pipeline using the variant has
+     * been compiled for the current state. Until then,
+     * the pipeline gets compiled asynchronously and the
+     * current shader remains in use. Binding a different
+     * shader to the stage discards the variant.
+     * \param [in] stage Target shader stage
+     * \param [in] shader The shader variant
+     */
+    void bindShaderVariant(
+            VkShaderStageFlagBits stage,
+      const Rc<DxvkShader>&       shader);
+    
     /**
      * \brief Binds vertex buffer
      * 
@@ -659,6 +677,32 @@ namespace dxvk {
       const Rc<DxvkBuffer>&           buffer,
       const DxvkBufferSliceHandle&    slice);
     
+    /**
+     * \brief Moves a buffer to new memory
+     * 
+     * Replaces the buffer's backing resource and copies
+     * the buffer contents, so that the old memory can be
+     * freed once the GPU is done with it. Used to compact
+     * device memory. Buffers that cannot be relocated are
+     * left untouched.
+     * 
+     * \warning If the buffer is used by another context,
+     * relocating it will result in undefined behaviour.
+     * \param [in] buffer The buffer to relocate
+     * \returns \c true if the buffer was relocated
+     */
+    bool relocateBuffer(
+      const Rc<DxvkBuffer>&           buffer);
+    
+    /**
+     * \brief Runs a memory defragmentation pass
+     * 
+     * Relocates buffers picked by the device's memory
+     * defragmenter, if enabled. Should be called once
+     * per frame by the context that owns all buffers.
+     */
+    void defragMemory();
+    
     /**
      * \brief Updates push constants
      * 
@@ -737,6 +781,23 @@ namespace dxvk {
             VkDeviceSize              size,
       const void*                     data);
     
+    /**
+     * \brief Updates a buffer from a staging buffer
+     * 
+     * Behaves like \ref updateBuffer, but takes the data
+     * from a host-visible buffer slice that the caller
+     * has already written to, which avoids a copy.
+     * \param [in] buffer Destination buffer
+     * \param [in] offset Offset of sub range to update
+     * \param [in] size Length of sub range to update
+     * \param [in] source Staging buffer slice
+     */
+    void updateBuffer(
+      const Rc<DxvkBuffer>&           buffer,
+            VkDeviceSize              offset,
+            VkDeviceSize              size,
+      const DxvkBufferSlice&          source);
+    
     /**
      * \brief Updates an image
      * 
@@ -758,6 +819,25 @@ namespace dxvk {
             VkDeviceSize              pitchPerRow,
             VkDeviceSize              pitchPerLayer);
     
+    /**
+     * \brief Updates an image from a staging buffer
+     * 
+     * Behaves like \ref updateImage, but takes tightly
+     * packed data from a host-visible buffer slice that
+     * the caller has already written to.
+     * \param [in] image Destination image
+     * \param [in] subsresources Image subresources to update
+     * \param [in] imageOffset Offset of the image area to update
+     * \param [in] imageExtent Size of the image area to update
+     * \param [in] source Staging buffer slice
+     */
+    void updateImage(
+      const Rc<DxvkImage>&            image,
+      const VkImageSubresourceLayers& subresources,
+            VkOffset3D                imageOffset,
+            VkExtent3D                imageExtent,
+      const DxvkBufferSlice&          source);
+    
     /**
      * \brief Updates an depth-stencil image
      * 
@@ -959,6 +1039,31 @@ namespace dxvk {
     void setBarrierControl(
             DxvkBarrierControlFlags control);
     
+    /**
+     * \brief Enables or disables buffer renaming
+     *
+     * Renaming is used as an optimization by \c discardBuffer
+     * and \c updateBuffer. Contexts that record concurrently
+     * with the CS thread must not rename buffers, since the
+     * previous slice would be freed by their own command list
+     * while other command lists may still use it.
+     * \param [in] enable Whether to rename buffers
+     */
+    void setBufferRenaming(
+            bool                    enable);
+    
+    /**
+     * \brief Sets the recorder used by this context
+     *
+     * Command lists that are recorded on other threads read
+     * the backing storage of buffers at record time, so any
+     * pending recordings are completed before this context
+     * renames or relocates a buffer.
+     * \param [in] recorder The recorder, or \c nullptr
+     */
+    void setRecorder(
+            DxvkCsRecorder*         recorder);
+    
     /**
      * \brief Signals a GPU event
      * \param [in] event The event
@@ -1012,6 +1117,13 @@ namespace dxvk {
     
     Rc<DxvkCommandList>     m_cmd;
     Rc<DxvkDescriptorPool>  m_descPool;
+    DxvkDescriptorSetCache  m_descCache;
+
+    std::array<DxvkLayoutDescriptorPool, MaxNumLayoutDescriptorPools> m_layoutPools;
+    uint32_t                  m_layoutPoolIndex = 0;
+
+    const DxvkPipelineLayout* m_hotLayout      = nullptr;
+    uint32_t                  m_hotLayoutScore = 0;
 
     DxvkContextFlags        m_flags;
     DxvkContextState        m_state;
@@ -1023,6 +1135,17 @@ namespace dxvk {
     DxvkBarrierSet          m_execBarriers;
     DxvkBarrierSet          m_gfxBarriers;
     DxvkBarrierControlFlags m_barrierControl;
+    bool                    m_renameBuffers = true;
+    DxvkCsRecorder*         m_recorder      = nullptr;
+
+    VkShaderStageFlagBits         m_variantStage     = VK_SHADER_STAGE_VERTEX_BIT;
+    Rc<DxvkShader>                m_variantShader;
+    DxvkGraphicsPipeline*         m_variantPipeline  = nullptr;
+    uint32_t                      m_variantInstances = 0;
+    bool                          m_variantReady     = false;
+
+    std::vector<std::pair<const DxvkRenderPass*,
+      DxvkGraphicsPipelineStateInfo>> m_variantStates;
     
     DxvkGpuQueryManager     m_queryManager;
     DxvkStagingDataAlloc    m_staging;
@@ -1109,6 +1232,13 @@ namespace dxvk {
             VkResolveModeFlagBitsKHR  depthMode,
             VkResolveModeFlagBitsKHR  stencilMode);
     
+    void updateBufferInternal(
+      const Rc<DxvkBuffer>&           buffer,
+            VkDeviceSize              offset,
+            VkDeviceSize              size,
+      const void*                     data,
+      const DxvkBufferSlice&          source);
+    
     void updatePredicate(
       const DxvkBufferSliceHandle&    predicate,
       const DxvkGpuQueryHandle&       query);
@@ -1145,6 +1275,11 @@ namespace dxvk {
     bool updateGraphicsPipeline();
     bool updateGraphicsPipelineState();
     
+    void updateShaderVariant(
+      const DxvkRenderPass*       renderPass);
+    void applyShaderVariant();
+    void resetShaderVariant();
+    
     void updateComputeShaderResources();
     void updateComputeShaderDescriptors();
     
@@ -1153,7 +1288,7 @@ namespace dxvk {
 
     template<VkPipelineBindPoint BindPoint>
     bool updateShaderResources(
-      const DxvkPipelineLayout*     layout);
+            DxvkPipelineLayout*     layout);
     
     template<VkPipelineBindPoint BindPoint>
     void updateShaderDescriptorSetBinding(
@@ -1162,6 +1297,10 @@ namespace dxvk {
 
     void updateFramebuffer();
     
+    void invalidateBufferBindings(
+      const Rc<DxvkBuffer>&           buffer,
+            bool                      sameHandle);
+    
     void updateIndexBufferBinding();
     void updateVertexBufferBindings();
 
@@ -1206,6 +1345,12 @@ namespace dxvk {
     VkDescriptorSet allocateDescriptorSet(
             VkDescriptorSetLayout     layout);
 
+    VkDescriptorSet allocateDescriptorSet(
+            DxvkPipelineLayout*       layout);
+
+    void retireDescriptorPool(
+            Rc<DxvkDescriptorPool>&&  pool);
+
     void trackDrawBuffer();
 
     DxvkGraphicsPipeline* lookupGraphicsPipeline(
@@ -1,26 +1,30 @@
+#include <new>
+
 #include "dxvk_cs.h"
 
 namespace dxvk {
   
-  DxvkCsChunk::DxvkCsChunk() {
+  DxvkCsChunk::DxvkCsChunk(uint32_t sizeClass)
+  : m_sizeClass (sizeClass),
+    m_capacity  (getClassSize(sizeClass)),
+    m_data      (static_cast<char*>(::operator new(m_capacity, std::align_val_t(64)))) {
     
   }
   
   
   DxvkCsChunk::~DxvkCsChunk() {
     this->reset();
+
+    ::operator delete(m_data, std::align_val_t(64));
   }
   
   
-  void DxvkCsChunk::init(DxvkCsChunkFlags flags) {
-    m_flags = flags;
-  }
-
-
   void DxvkCsChunk::executeAll(DxvkContext* ctx) {
     auto cmd = m_head;
     
-    if (m_flags.test(DxvkCsChunkFlag::SingleUse)) {
+    // If nobody else holds a reference, e.g. a command
+    // list, the chunk will not be executed again
+    if (isUnique()) {
       m_commandOffset = 0;
       
       while (cmd != nullptr) {
@@ -63,26 +67,35 @@ namespace dxvk {
   
   
   DxvkCsChunkPool::~DxvkCsChunkPool() {
-    for (DxvkCsChunk* chunk : m_chunks)
-      delete chunk;
+    for (auto& sizeClass : m_sizeClasses) {
+      freeChunkList(sizeClass.allocList);
+      freeChunkList(sizeClass.freeList.load());
+    }
   }
   
   
-  DxvkCsChunk* DxvkCsChunkPool::allocChunk(DxvkCsChunkFlags flags) {
+  DxvkCsChunk* DxvkCsChunkPool::allocChunk(
+          uint32_t                  sizeClass) {
+    SizeClass& pool = m_sizeClasses[sizeClass];
     DxvkCsChunk* chunk = nullptr;
 
-    { std::lock_guard<sync::Spinlock> lock(m_mutex);
+    { std::lock_guard<sync::Spinlock> lock(pool.allocLock);
       
-      if (m_chunks.size() != 0) {
-        chunk = m_chunks.back();
-        m_chunks.pop_back();
+      // Take all chunks that have been freed since the
+      // last refill, so that we don't have to touch the
+      // shared list for every single allocation
+      if (!pool.allocList)
+        pool.allocList = pool.freeList.exchange(nullptr, std::memory_order_acquire);
+
+      if (pool.allocList) {
+        chunk = pool.allocList;
+        pool.allocList = chunk->m_nextFree;
       }
     }
     
     if (!chunk)
-      chunk = new DxvkCsChunk();
+      chunk = new DxvkCsChunk(sizeClass);
     
-    chunk->init(flags);
     return chunk;
   }
   
@@ -90,8 +103,54 @@ namespace dxvk {
   void DxvkCsChunkPool::freeChunk(DxvkCsChunk* chunk) {
     chunk->reset();
     
-    std::lock_guard<sync::Spinlock> lock(m_mutex);
-    m_chunks.push_back(chunk);
+    SizeClass& pool = m_sizeClasses[chunk->sizeClass()];
+    DxvkCsChunk* head = pool.freeList.load(std::memory_order_relaxed);
+
+    do {
+      chunk->m_nextFree = head;
+    } while (!pool.freeList.compare_exchange_weak(head, chunk,
+      std::memory_order_release, std::memory_order_relaxed));
+  }
+
+
+  void DxvkCsChunkPool::freeChunkList(DxvkCsChunk* chunk) {
+    while (chunk != nullptr) {
+      DxvkCsChunk* next = chunk->m_nextFree;
+      delete chunk;
+      chunk = next;
+    }
+  }
+  
+  
+  DxvkCsChunkSizer::DxvkCsChunkSizer()
+  : m_avgBytes(DxvkCsChunk::getClassSize(DxvkCsChunk::DefaultSizeClass) * TargetChunksPerFrame) {
+
+  }
+
+
+  DxvkCsChunkSizer::~DxvkCsChunkSizer() {
+
+  }
+
+
+  void DxvkCsChunkSizer::addChunk(const DxvkCsChunkRef& chunk) {
+    m_frameBytes += chunk->size();
+
+    m_statCounters.addCtr(DxvkStatCounter::CsChunkCount, 1);
+    m_statCounters.addCtr(DxvkStatCounter::CsChunkBytesUsed, chunk->size());
+    m_statCounters.addCtr(DxvkStatCounter::CsChunkBytesTotal, chunk->capacity());
+  }
+
+
+  void DxvkCsChunkSizer::endFrame() {
+    // Use a moving average so that a single frame with
+    // an unusual amount of commands, e.g. a loading
+    // screen, does not immediately change the size
+    m_avgBytes   = (3 * m_avgBytes + m_frameBytes) / 4;
+    m_frameBytes = 0;
+
+    m_sizeClass = DxvkCsChunk::getSizeClass(m_avgBytes / TargetChunksPerFrame);
+    m_statCounters.reset();
   }
   
   
@@ -111,22 +170,84 @@ namespace dxvk {
   }
   
   
-  void DxvkCsThread::dispatchChunk(DxvkCsChunkRef&& chunk) {
-    { std::unique_lock<std::mutex> lock(m_mutex);
-      m_chunksQueued.push(std::move(chunk));
-      m_chunksPending += 1;
+  uint64_t DxvkCsThread::dispatchChunk(DxvkCsChunkRef&& chunk) {
+    // Increment the counter first so that the worker
+    // cannot decrement it before we have added to it
+    m_chunksPending += 1;
+
+    uint64_t seq = ++m_chunksDispatched;
+
+    if (unlikely(!m_chunksQueued.tryPush(std::move(chunk)))) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_producersWaiting += 1;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      m_condOnPop.wait(lock, [this, &chunk] {
+        return m_chunksQueued.tryPush(std::move(chunk));
+      });
+
+      m_producersWaiting -= 1;
     }
-    
-    m_condOnAdd.notify_one();
+
+    // Only take the lock if the worker is asleep. The fence
+    // pairs with the one in popChunk, so that either we see
+    // the flag, or the worker sees the newly added chunk.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_consumerWaiting.load()) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_condOnAdd.notify_one();
+    }
+
+    return seq;
   }
   
   
-  void DxvkCsThread::synchronize() {
+  void DxvkCsThread::synchronize(uint64_t seq) {
+    seq = std::min(seq, m_chunksDispatched.load());
+
+    if (m_chunksExecuted.load() >= seq)
+      return;
+
     std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_syncWaiting += 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
     
-    m_condOnSync.wait(lock, [this] {
-      return !m_chunksPending.load();
+    m_condOnSync.wait(lock, [this, seq] {
+      return m_chunksExecuted.load() >= seq;
+    });
+
+    m_syncWaiting -= 1;
+  }
+
+
+  bool DxvkCsThread::popChunk(DxvkCsChunkRef& chunk) {
+    // Spin for a short while since the application
+    // thread is likely to submit more chunks soon
+    for (uint32_t i = 0; i < SpinCount; i++) {
+      if (m_chunksQueued.tryPop(chunk))
+        return true;
+
+      if (m_stopped.load())
+        return false;
+
+      dxvk::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_consumerWaiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    m_condOnAdd.wait(lock, [this, &chunk] {
+      return m_chunksQueued.tryPop(chunk)
+          || m_stopped.load();
     });
+
+    m_consumerWaiting.store(false);
+    return !m_stopped.load();
   }
   
   
@@ -135,31 +256,30 @@ namespace dxvk {
 
     DxvkCsChunkRef chunk;
     
-    while (!m_stopped.load()) {
-      { std::unique_lock<std::mutex> lock(m_mutex);
-        if (chunk) {
-          if (--m_chunksPending == 0)
-            m_condOnSync.notify_one();
-          
-          chunk = DxvkCsChunkRef();
-        }
-        
-        if (m_chunksQueued.size() == 0) {
-          m_condOnAdd.wait(lock, [this] {
-            return (m_chunksQueued.size() != 0)
-                || (m_stopped.load());
-          });
-        }
-        
-        if (m_chunksQueued.size() != 0) {
-          chunk = std::move(m_chunksQueued.front());
-          m_chunksQueued.pop();
-        }
+    while (popChunk(chunk)) {
+      // Wake up producers that are waiting for a free slot
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (unlikely(m_producersWaiting.load())) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condOnPop.notify_all();
+      }
+
+      chunk->executeAll(m_context.ptr());
+      chunk = DxvkCsChunkRef();
+
+      // Threads may wait for any chunk to complete,
+      // not just for the queue to run empty
+      m_chunksExecuted += 1;
+      m_chunksPending  -= 1;
+
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (m_syncWaiting.load()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condOnSync.notify_all();
       }
-      
-      if (chunk)
-        chunk->executeAll(m_context.ptr());
     }
   }
   
-}
\ No newline at end of file
+}
@@ -3,10 +3,11 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
-#include <queue>
 
 #include "../util/thread.h"
+#include "../util/sync/sync_ring.h"
 #include "dxvk_context.h"
+#include "dxvk_stats.h"
 
 namespace dxvk {
   
@@ -122,8 +123,9 @@ namespace dxvk {
    * \brief Submission flags
    */
   enum class DxvkCsChunkFlag : uint32_t {
-    /// Indicates that the submitted chunk will
-    /// no longer be needed after one submission.
+    /// Indicates that commands in the chunk reference
+    /// data that is only valid for one submission, such
+    /// as buffer slices written directly by the client.
     SingleUse,
   };
 
@@ -133,15 +135,46 @@ namespace dxvk {
   /**
    * \brief Command chunk
    * 
-   * Stores a list of commands.
+   * Stores a list of commands. Chunks come in
+   * a number of power-of-two size classes, so
+   * that the chunk size can be adjusted to the
+   * amount of commands recorded by the client.
    */
   class DxvkCsChunk : public RcObject {
-    constexpr static size_t MaxBlockSize = 16384;
+    friend class DxvkCsChunkPool;
   public:
+
+    constexpr static size_t   MinBlockSize      = 4096;
+    constexpr static uint32_t SizeClassCount    = 7;
+    constexpr static uint32_t DefaultSizeClass  = 2;
     
-    DxvkCsChunk();
+    DxvkCsChunk(uint32_t sizeClass);
     ~DxvkCsChunk();
     
+    /**
+     * \brief Chunk size class
+     * \returns Size class index
+     */
+    uint32_t sizeClass() const {
+      return m_sizeClass;
+    }
+
+    /**
+     * \brief Number of bytes used by commands
+     * \returns Size of recorded commands
+     */
+    size_t size() const {
+      return m_commandOffset;
+    }
+
+    /**
+     * \brief Total size of the command buffer
+     * \returns Chunk capacity, in bytes
+     */
+    size_t capacity() const {
+      return m_capacity;
+    }
+
     /**
      * \brief Checks whether the chunk is empty
      * \returns \c true if the chunk is empty
@@ -164,7 +197,7 @@ namespace dxvk {
     bool push(T& command) {
       using FuncType = DxvkCsTypedCmd<T>;
       
-      if (unlikely(m_commandOffset > MaxBlockSize - sizeof(FuncType)))
+      if (unlikely(m_commandOffset + sizeof(FuncType) > m_capacity))
         return false;
       
       DxvkCsCmd* tail = m_tail;
@@ -192,7 +225,7 @@ namespace dxvk {
     M* pushCmd(T& command, Args&&... args) {
       using FuncType = DxvkCsDataCmd<T, M>;
       
-      if (unlikely(m_commandOffset > MaxBlockSize - sizeof(FuncType)))
+      if (unlikely(m_commandOffset + sizeof(FuncType) > m_capacity))
         return nullptr;
       
       FuncType* func = new (m_data + m_commandOffset)
@@ -208,17 +241,15 @@ namespace dxvk {
       return func->data();
     }
     
-    /**
-     * \brief Initializes chunk for recording
-     * \param [in] flags Chunk flags
-     */
-    void init(DxvkCsChunkFlags flags);
-    
     /**
      * \brief Executes all commands
      * 
-     * This will also reset the chunk
-     * so that it can be reused.
+     * Commands are never modified during execution,
+     * so that chunks can be shared and executed any
+     * number of times. If the caller holds the only
+     * reference to the chunk, commands are destroyed
+     * as they are executed in order to release the
+     * resources they reference as early as possible.
      * \param [in] ctx The context
      */
     void executeAll(DxvkContext* ctx);
@@ -231,18 +262,47 @@ namespace dxvk {
      * that it can be reused later.
      */
     void reset();
+
+    /**
+     * \brief Computes size of a size class
+     * 
+     * \param [in] sizeClass Size class index
+     * \returns Capacity of chunks in that class
+     */
+    static size_t getClassSize(uint32_t sizeClass) {
+      return MinBlockSize << sizeClass;
+    }
+
+    /**
+     * \brief Finds size class for a given size
+     * 
+     * \param [in] size Required chunk capacity
+     * \returns Smallest size class that can hold
+     *    the given amount of data, or the largest
+     *    size class if none is large enough
+     */
+    static uint32_t getSizeClass(size_t size) {
+      uint32_t sizeClass = 0;
+
+      while (sizeClass + 1 < SizeClassCount && getClassSize(sizeClass) < size)
+        sizeClass += 1;
+
+      return sizeClass;
+    }
     
   private:
     
+    uint32_t m_sizeClass;
+    size_t   m_capacity;
+
     size_t m_commandOffset = 0;
     
     DxvkCsCmd* m_head = nullptr;
     DxvkCsCmd* m_tail = nullptr;
 
-    DxvkCsChunkFlags m_flags;
+    DxvkCsChunk* m_nextFree = nullptr;
     
-    alignas(64)
-    char m_data[MaxBlockSize];
+    char* m_data;
     
   };
   
@@ -253,6 +313,14 @@ namespace dxvk {
    * Implements a pool of CS chunks which can be
    * recycled. The goal is to reduce the number
    * of dynamic memory allocations.
+   * 
+   * Chunks are typically allocated on an application
+   * thread and freed on the CS thread, so freed chunks
+   * are pushed to a lock-free intrusive list. Allocating
+   * threads take that entire list at once when their own
+   * list runs empty, so the CS thread never has to wait
+   * for a lock, and the list is not subject to ABA. Each
+   * chunk size class has its own set of lists.
    */
   class DxvkCsChunkPool {
     
@@ -269,10 +337,11 @@ namespace dxvk {
      * 
      * Takes an existing chunk from the pool,
      * or creates a new one if necessary.
-     * \param [in] flags Chunk flags
+     * \param [in] sizeClass Chunk size class
      * \returns Allocated chunk object
      */
-    DxvkCsChunk* allocChunk(DxvkCsChunkFlags flags);
+    DxvkCsChunk* allocChunk(
+            uint32_t                  sizeClass);
     
     /**
      * \brief Releases a chunk
@@ -284,8 +353,17 @@ namespace dxvk {
     
   private:
     
-    sync::Spinlock            m_mutex;
-    std::vector<DxvkCsChunk*> m_chunks;
+    struct SizeClass {
+      sync::Spinlock            allocLock;
+      DxvkCsChunk*              allocList = nullptr;
+
+      alignas(64)
+      std::atomic<DxvkCsChunk*> freeList  = { nullptr };
+    };
+
+    std::array<SizeClass, DxvkCsChunk::SizeClassCount> m_sizeClasses;
+
+    static void freeChunkList(DxvkCsChunk* chunk);
     
   };
   
@@ -370,15 +448,93 @@ namespace dxvk {
   };
 
 
+  /**
+   * \brief Chunk size heuristic
+   * 
+   * Tracks the amount of command data recorded
+   * per frame and picks a chunk size class such
+   * that a frame is split into a roughly fixed
+   * number of chunks. This keeps the number of
+   * chunk submissions low for draw-heavy frames,
+   * while light frames do not waste memory and
+   * the CS thread can start working early.
+   * 
+   * Also collects chunk statistics, which the
+   * client API can forward to the device.
+   */
+  class DxvkCsChunkSizer {
+    constexpr static size_t TargetChunksPerFrame = 32;
+  public:
+
+    DxvkCsChunkSizer();
+    ~DxvkCsChunkSizer();
+
+    /**
+     * \brief Picks size class for a new chunk
+     * 
+     * \param [in] cmdSize Size of the command that
+     *    needs to fit into the chunk, if any
+     * \returns Chunk size class
+     */
+    uint32_t getSizeClass(size_t cmdSize) const {
+      return std::max(m_sizeClass, DxvkCsChunk::getSizeClass(cmdSize));
+    }
+
+    /**
+     * \brief Records a chunk
+     * 
+     * Must be called with every chunk that
+     * gets submitted before it is executed.
+     * \param [in] chunk The chunk
+     */
+    void addChunk(const DxvkCsChunkRef& chunk);
+
+    /**
+     * \brief Ends the current frame
+     * 
+     * Updates the size class based on the amount of data
+     * recorded in the last few frames and resets counters.
+     */
+    void endFrame();
+
+    /**
+     * \brief Retrieves chunk stat counters
+     * 
+     * Counters for all chunks that were
+     * recorded since the last frame ended.
+     * \returns Stat counters
+     */
+    const DxvkStatCounters& statCounters() const {
+      return m_statCounters;
+    }
+
+  private:
+
+    uint32_t          m_sizeClass = DxvkCsChunk::DefaultSizeClass;
+    size_t            m_avgBytes;
+    size_t            m_frameBytes = 0;
+
+    DxvkStatCounters  m_statCounters;
+
+  };
+  
+  
   /**
    * \brief Command stream thread
    * 
    * Spawns a thread that will execute
-   * commands on a DXVK context. 
+   * commands on a DXVK context. Chunks
+   * are handed to the worker through a
+   * lock-free ring, and the mutex is only
+   * taken when one of the threads has to
+   * go to sleep.
    */
   class DxvkCsThread {
-    
+    constexpr static size_t   MaxChunksInFlight = 1024;
+    constexpr static uint32_t SpinCount         = 16;
   public:
+
+    constexpr static uint64_t SynchronizeAll = ~0ull;
     
     DxvkCsThread(const Rc<DxvkContext>& context);
     ~DxvkCsThread();
@@ -389,18 +545,32 @@ namespace dxvk {
      * Can be used to efficiently play back large
      * command lists recorded on another thread.
      * \param [in] chunk The chunk to dispatch
+     * \returns Sequence number of the chunk
      */
-    void dispatchChunk(DxvkCsChunkRef&& chunk);
+    uint64_t dispatchChunk(DxvkCsChunkRef&& chunk);
     
     /**
      * \brief Synchronizes with the thread
      * 
-     * This waits for all chunks in the dispatch
-     * queue to be processed by the thread. Note
-     * that this does \e not implicitly call
-     * \ref flush.
+     * This waits for all chunks up to and including
+     * the one with the given sequence number to be
+     * processed by the thread. Note that this does
+     * \e not implicitly call \ref flush.
+     * \param [in] seq Sequence number to wait for,
+     *    or \c SynchronizeAll to wait for all chunks
      */
-    void synchronize();
+    void synchronize(uint64_t seq = SynchronizeAll);
+
+    /**
+     * \brief Sequence number of the last dispatched chunk
+     *
+     * Sequence numbers start at 1 and are only ordered
+     * if chunks are dispatched from a single thread.
+     * \returns Last sequence number
+     */
+    uint64_t lastSequenceNumber() const {
+      return m_chunksDispatched.load();
+    }
     
     /**
      * \brief Checks whether the worker thread is busy
@@ -421,11 +591,22 @@ namespace dxvk {
     std::atomic<bool>           m_stopped = { false };
     std::mutex                  m_mutex;
     std::condition_variable     m_condOnAdd;
+    std::condition_variable     m_condOnPop;
     std::condition_variable     m_condOnSync;
-    std::queue<DxvkCsChunkRef>  m_chunksQueued;
     std::atomic<uint32_t>       m_chunksPending = { 0u };
+    std::atomic<uint64_t>       m_chunksDispatched = { 0ull };
+    std::atomic<uint64_t>       m_chunksExecuted = { 0ull };
+
+    std::atomic<bool>           m_consumerWaiting = { false };
+    std::atomic<uint32_t>       m_producersWaiting = { 0u };
+    std::atomic<uint32_t>       m_syncWaiting = { 0u };
+
+    sync::MpscRing<DxvkCsChunkRef, MaxChunksInFlight> m_chunksQueued;
+
     dxvk::thread                m_thread;
     
+    bool popChunk(DxvkCsChunkRef& chunk);
+
     void threadFunc();
     
   };
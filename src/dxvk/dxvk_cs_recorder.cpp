@@ -0,0 +1,109 @@
+#include "dxvk_cs_recorder.h"
+
+namespace dxvk {
+
+  DxvkCsRecorder::DxvkCsRecorder(
+    const Rc<DxvkDevice>&         device,
+          uint32_t                threadCount,
+          DxvkBarrierControlFlags barrierControl)
+  : m_device(device), m_barrierControl(barrierControl) {
+    for (uint32_t i = 0; i < threadCount; i++)
+      m_threads.emplace_back([this] { threadFunc(); });
+  }
+
+
+  DxvkCsRecorder::~DxvkCsRecorder() {
+    // Workers finish all queued recordings before
+    // exiting since the submission thread waits
+    // for the pending command lists
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      m_stopped = true;
+    }
+
+    m_condOnAdd.notify_all();
+
+    for (auto& thread : m_threads)
+      thread.join();
+  }
+
+
+  void DxvkCsRecorder::record(
+          DxvkContext*                  ctx,
+    const std::vector<DxvkCsChunkRef>&  chunks) {
+    // Submit everything recorded so far so that the
+    // new command list gets executed after it
+    ctx->flushCommandList();
+
+    Recording recording;
+    recording.chunks  = chunks;
+    recording.cmdList = new DxvkPendingCommandList();
+
+    m_device->submitCommandList(recording.cmdList);
+
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      m_queue.push(std::move(recording));
+      m_pending += 1;
+    }
+
+    m_condOnAdd.notify_one();
+  }
+
+
+  void DxvkCsRecorder::synchronize() {
+    if (!m_pending.load())
+      return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_condOnDone.wait(lock, [this] {
+      return !m_pending;
+    });
+  }
+
+
+  void DxvkCsRecorder::threadFunc() {
+    env::setThreadName("dxvk-recorder");
+
+    Rc<DxvkContext> context = m_device->createContext();
+    context->setBarrierControl(m_barrierControl);
+    context->setBufferRenaming(false);
+
+    while (true) {
+      Recording recording;
+
+      { std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_condOnAdd.wait(lock, [this] {
+          return m_stopped || !m_queue.empty();
+        });
+
+        if (m_queue.empty())
+          return;
+
+        recording = std::move(m_queue.front());
+        m_queue.pop();
+      }
+
+      context->beginRecording(m_device->createCommandList());
+
+      for (const auto& chunk : recording.chunks)
+        chunk->executeAll(context.ptr());
+
+      Rc<DxvkCommandList> cmdList = context->endRecording();
+      m_device->addStatCounters(cmdList->statCounters());
+
+      recording.cmdList->complete(std::move(cmdList));
+
+      // Release chunk references before signaling
+      // completion so that resources can be freed
+      recording = Recording();
+
+      { std::unique_lock<std::mutex> lock(m_mutex);
+        m_pending -= 1;
+      }
+
+      m_condOnDone.notify_all();
+    }
+  }
+
+}
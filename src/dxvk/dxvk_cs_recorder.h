@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "../util/thread.h"
+
+#include "dxvk_cs.h"
+#include "dxvk_device.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Parallel command list recorder
+   *
+   * Executes sequences of CS chunks on a pool of worker
+   * threads, each of which records into its own context
+   * and command list. The command lists are passed to
+   * the submission queue in the order in which they were
+   * queued, so that they are executed in between the
+   * command lists recorded by the calling context.
+   *
+   * Chunks recorded this way must not depend on any
+   * context state, since workers start recording with
+   * whatever state the previous recording left behind.
+   * They must also not invalidate any buffers, since
+   * the previous buffer slice could still be in use by
+   * command lists that get submitted later. Workers do
+   * not rename buffers in \c discardBuffer and
+   * \c updateBuffer for the same reason.
+   *
+   * Chunks resolve buffer slices when they are recorded,
+   * so the calling context must be given the recorder
+   * via \c setRecorder in order to wait for pending
+   * recordings before it renames or relocates a buffer.
+   */
+  class DxvkCsRecorder {
+
+  public:
+
+    DxvkCsRecorder(
+      const Rc<DxvkDevice>&         device,
+            uint32_t                threadCount,
+            DxvkBarrierControlFlags barrierControl);
+
+    ~DxvkCsRecorder();
+
+    DxvkCsRecorder             (const DxvkCsRecorder&) = delete;
+    DxvkCsRecorder& operator = (const DxvkCsRecorder&) = delete;
+
+    /**
+     * \brief Records chunks into a separate command list
+     *
+     * Submits the command list that is currently being
+     * recorded by the given context, and reserves the
+     * next position in the submission queue for the
+     * chunks, which will be recorded asynchronously.
+     * Must be called on the thread that owns \c ctx.
+     * \param [in] ctx The calling context
+     * \param [in] chunks Chunks to record
+     */
+    void record(
+            DxvkContext*                  ctx,
+      const std::vector<DxvkCsChunkRef>&  chunks);
+
+    /**
+     * \brief Waits for all queued recordings
+     *
+     * Resources used by queued chunks are only tracked
+     * once the chunks have been recorded, so this must
+     * be called before checking whether any resource
+     * is still in use by the GPU. Returns immediately
+     * if no recordings are pending.
+     */
+    void synchronize();
+
+  private:
+
+    struct Recording {
+      std::vector<DxvkCsChunkRef> chunks;
+      Rc<DxvkPendingCommandList>  cmdList;
+    };
+
+    Rc<DxvkDevice>            m_device;
+    DxvkBarrierControlFlags   m_barrierControl;
+
+    std::mutex                m_mutex;
+    std::condition_variable   m_condOnAdd;
+    std::condition_variable   m_condOnDone;
+    std::queue<Recording>     m_queue;
+    std::atomic<uint32_t>     m_pending = { 0u };
+    bool                      m_stopped = false;
+
+    std::vector<dxvk::thread> m_threads;
+
+    void threadFunc();
+
+  };
+
+}
@@ -3,27 +3,28 @@
 
 namespace dxvk {
   
-  DxvkDescriptorPool::DxvkDescriptorPool(const Rc<vk::DeviceFn>& vkd)
-  : m_vkd(vkd) {
-    constexpr uint32_t MaxSets = 2048;
+  DxvkDescriptorPool::DxvkDescriptorPool(
+    const Rc<vk::DeviceFn>&     vkd,
+    const DxvkDescriptorCounts& capacity,
+          bool                  layoutSpecific)
+  : m_vkd(vkd), m_capacity(capacity), m_layoutSpecific(layoutSpecific) {
+    std::array<VkDescriptorPoolSize, DxvkDescriptorTypeCount> pools;
+    uint32_t poolCount = 0;
 
-    std::array<VkDescriptorPoolSize, 9> pools = {{
-      { VK_DESCRIPTOR_TYPE_SAMPLER,                MaxSets * 2 },
-      { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          MaxSets / 8 },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         MaxSets / 8 },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,   MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,   MaxSets / 8 },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MaxSets * 3 },
-      { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxSets * 2 } }};
+    for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++) {
+      if (capacity.descriptors[i]) {
+        pools[poolCount].type            = VkDescriptorType(i);
+        pools[poolCount].descriptorCount = capacity.descriptors[i];
+        poolCount += 1;
+      }
+    }
     
     VkDescriptorPoolCreateInfo info;
     info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     info.pNext         = nullptr;
     info.flags         = 0;
-    info.maxSets       = MaxSets;
-    info.poolSizeCount = pools.size();
+    info.maxSets       = capacity.sets;
+    info.poolSizeCount = poolCount;
     info.pPoolSizes    = pools.data();
     
     if (m_vkd->vkCreateDescriptorPool(m_vkd->device(), &info, nullptr, &m_pool) != VK_SUCCESS)
@@ -38,6 +39,34 @@ namespace dxvk {
   
   
   VkDescriptorSet DxvkDescriptorPool::alloc(VkDescriptorSetLayout layout) {
+    VkDescriptorSet set = allocSet(layout);
+
+    if (set != VK_NULL_HANDLE)
+      m_usage.sets += 1;
+    
+    return set;
+  }
+  
+  
+  VkDescriptorSet DxvkDescriptorPool::alloc(const DxvkPipelineLayout* layout) {
+    VkDescriptorSet set = allocSet(layout->descriptorSetLayout());
+
+    if (set != VK_NULL_HANDLE)
+      m_usage.add(layout->descriptorCounts());
+    
+    return set;
+  }
+  
+  
+  void DxvkDescriptorPool::reset() {
+    m_vkd->vkResetDescriptorPool(
+      m_vkd->device(), m_pool, 0);
+    
+    m_usage = DxvkDescriptorCounts();
+  }
+
+
+  VkDescriptorSet DxvkDescriptorPool::allocSet(VkDescriptorSetLayout layout) {
     VkDescriptorSetAllocateInfo info;
     info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     info.pNext              = nullptr;
@@ -50,11 +79,181 @@ namespace dxvk {
       return VK_NULL_HANDLE;
     return set;
   }
-  
-  
-  void DxvkDescriptorPool::reset() {
-    m_vkd->vkResetDescriptorPool(
-      m_vkd->device(), m_pool, 0);
+
+
+
+
+  DxvkDescriptorPoolManager::DxvkDescriptorPoolManager(
+    const Rc<vk::DeviceFn>&     vkd)
+  : m_vkd(vkd), m_capacity(getDefaultCapacity()) {
+
+  }
+
+
+  DxvkDescriptorPoolManager::~DxvkDescriptorPoolManager() {
+
+  }
+
+
+  Rc<DxvkDescriptorPool> DxvkDescriptorPoolManager::createPool() {
+    DxvkDescriptorCounts capacity;
+
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      capacity = m_capacity;
+    }
+
+    return retrievePool(capacity, false);
+  }
+
+
+  Rc<DxvkDescriptorPool> DxvkDescriptorPoolManager::createPool(
+    const DxvkPipelineLayout*   layout) {
+    DxvkDescriptorCounts capacity;
+    capacity.sets = LayoutPoolSets;
+
+    for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++)
+      capacity.descriptors[i] = layout->descriptorCounts().descriptors[i] * LayoutPoolSets;
+
+    return retrievePool(capacity, true);
+  }
+
+
+  void DxvkDescriptorPoolManager::recyclePool(
+    const Rc<DxvkDescriptorPool>& pool) {
+    DxvkDescriptorCounts usage = pool->usage();
+    pool->reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!pool->isLayoutSpecific())
+      m_usage.add(usage);
+
+    // Pools that no longer match the current capacity will
+    // eventually be pushed out by pools that are reused
+    if (m_pools.size() >= MaxRecycledPools)
+      m_pools.erase(m_pools.begin());
+
+    m_pools.push_back(pool);
+    m_poolsReset += 1;
+  }
+
+
+  void DxvkDescriptorPoolManager::endFrame() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (++m_frameCount >= UpdateInterval)
+      this->updateCapacity();
+  }
+
+
+  DxvkDescriptorPoolStats DxvkDescriptorPoolManager::getStats() const {
+    DxvkDescriptorPoolStats result;
+    result.poolsCreated = m_poolsCreated.load();
+    result.poolsReset   = m_poolsReset.load();
+    return result;
+  }
+
+
+  Rc<DxvkDescriptorPool> DxvkDescriptorPoolManager::retrievePool(
+    const DxvkDescriptorCounts& capacity,
+          bool                  layoutSpecific) {
+    { std::lock_guard<std::mutex> lock(m_mutex);
+
+      for (auto p = m_pools.rbegin(); p != m_pools.rend(); p++) {
+        if ((*p)->isLayoutSpecific() == layoutSpecific
+         && (*p)->capacity() == capacity) {
+          Rc<DxvkDescriptorPool> pool = std::move(*p);
+          m_pools.erase(std::next(p).base());
+          return pool;
+        }
+      }
+    }
+
+    m_poolsCreated += 1;
+    return new DxvkDescriptorPool(m_vkd, capacity, layoutSpecific);
+  }
+
+
+  void DxvkDescriptorPoolManager::updateCapacity() {
+    // Pools are only recycled once the GPU is done with
+    // them, so statistics lag behind by a few frames,
+    // which does not matter for a running average.
+    if (m_usage.sets) {
+      float frameCount = float(m_frameCount);
+      bool  firstUpdate = m_avgSets == 0.0f;
+
+      float sets = float(m_usage.sets) / frameCount;
+      m_avgSets = firstUpdate ? sets : (3.0f * m_avgSets + sets) / 4.0f;
+
+      for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++) {
+        float count = float(m_usage.descriptors[i]) / frameCount;
+        m_avgDescriptors[i] = firstUpdate ? count : (3.0f * m_avgDescriptors[i] + count) / 4.0f;
+      }
+    }
+
+    m_usage      = DxvkDescriptorCounts();
+    m_frameCount = 0;
+
+    if (m_avgSets == 0.0f)
+      return;
+
+    // Size pools so that one frame needs about four of
+    // them, and only shrink them if they are too large
+    // by a wide margin in order to avoid thrashing.
+    uint32_t maxSets = 256;
+
+    while (maxSets < 8192 && 4.0f * float(maxSets) < m_avgSets)
+      maxSets *= 2;
+
+    if (maxSets < m_capacity.sets && 4 * maxSets > m_capacity.sets)
+      maxSets = m_capacity.sets;
+
+    // Reserve some headroom for each descriptor type, and
+    // keep a minimum amount for the types that meta ops
+    // use, since those do not show up in the statistics.
+    DxvkDescriptorCounts defaults = getDefaultCapacity();
+    DxvkDescriptorCounts capacity;
+    capacity.sets = maxSets;
+
+    uint32_t granularity = maxSets / 16;
+    bool needsUpdate = capacity.sets != m_capacity.sets;
+
+    for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++) {
+      float perSet = m_avgDescriptors[i] / m_avgSets;
+      uint32_t count = align(uint32_t(1.25f * perSet * float(maxSets)), granularity);
+
+      if (defaults.descriptors[i])
+        count = std::max(count, granularity);
+
+      capacity.descriptors[i] = count;
+
+      if (count > m_capacity.descriptors[i]
+       || count * 2 < m_capacity.descriptors[i])
+        needsUpdate = true;
+    }
+
+    if (needsUpdate) {
+      Logger::debug(str::format("DxvkDescriptorPoolManager: Pool capacity set to ", maxSets, " sets"));
+      m_capacity = capacity;
+    }
+  }
+
+
+  DxvkDescriptorCounts DxvkDescriptorPoolManager::getDefaultCapacity() {
+    constexpr uint32_t MaxSets = 2048;
+
+    DxvkDescriptorCounts capacity;
+    capacity.sets = MaxSets;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_SAMPLER]                = MaxSets * 2;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE]          = MaxSets * 3;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE]          = MaxSets / 8;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER]         = MaxSets * 3;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER]         = MaxSets / 8;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER]   = MaxSets * 3;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER]   = MaxSets / 8;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC] = MaxSets * 3;
+    capacity.descriptors[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER] = MaxSets * 2;
+    return capacity;
   }
 
 
@@ -77,12 +276,162 @@ namespace dxvk {
 
   
   void DxvkDescriptorPoolTracker::reset() {
-    for (const auto& pool : m_pools) {
-      pool->reset();
+    for (const auto& pool : m_pools)
       m_device->recycleDescriptorPool(pool);
-    }
 
     m_pools.clear();
   }
+
+
+
+
+  DxvkDescriptorSetCache::DxvkDescriptorSetCache() {
+
+  }
+
+
+  DxvkDescriptorSetCache::~DxvkDescriptorSetCache() {
+
+  }
+
+
+  size_t DxvkDescriptorSetCache::hash(
+    const DxvkPipelineLayout*     layout,
+    const DxvkDescriptorInfo*     descriptors) {
+    DxvkHashState state;
+    state.add(std::hash<const DxvkPipelineLayout*>()(layout));
+
+    for (uint32_t i = 0; i < layout->bindingCount(); i++)
+      state.add(hashDescriptor(layout->binding(i).type, descriptors[i]));
+
+    return state;
+  }
+
+
+  VkDescriptorSet DxvkDescriptorSetCache::lookup(
+    const DxvkPipelineLayout*     layout,
+    const DxvkDescriptorInfo*     descriptors,
+          size_t                  hash) const {
+    auto range = m_entries.equal_range(hash);
+
+    for (auto e = range.first; e != range.second; e++) {
+      const Entry& entry = e->second;
+
+      if (entry.layout != layout)
+        continue;
+
+      bool eq = true;
+
+      for (uint32_t i = 0; i < layout->bindingCount() && eq; i++) {
+        eq = eqDescriptor(layout->binding(i).type,
+          descriptors[i], m_descriptors[entry.index + i]);
+      }
+
+      if (eq)
+        return entry.set;
+    }
+
+    return VK_NULL_HANDLE;
+  }
+
+
+  void DxvkDescriptorSetCache::insert(
+    const DxvkPipelineLayout*     layout,
+    const DxvkDescriptorInfo*     descriptors,
+          size_t                  hash,
+          VkDescriptorSet         set) {
+    Entry entry;
+    entry.layout = layout;
+    entry.set    = set;
+    entry.index  = m_descriptors.size();
+
+    m_descriptors.insert(m_descriptors.end(),
+      descriptors, descriptors + layout->bindingCount());
+    m_entries.insert({ hash, entry });
+  }
+
+
+  void DxvkDescriptorSetCache::clear() {
+    m_entries.clear();
+    m_descriptors.clear();
+  }
+
+
+  size_t DxvkDescriptorSetCache::hashDescriptor(
+          VkDescriptorType        type,
+    const DxvkDescriptorInfo&     info) {
+    // Only hash the members that are actually used by the
+    // given descriptor type, since the rest is undefined
+    DxvkHashState state;
+
+    switch (type) {
+      case VK_DESCRIPTOR_TYPE_SAMPLER:
+        state.add(std::hash<VkSampler>()(info.image.sampler));
+        break;
+
+      case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        state.add(std::hash<VkSampler>()(info.image.sampler));
+        /* fall through */
+
+      case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+      case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        state.add(std::hash<VkImageView>()(info.image.imageView));
+        state.add(uint32_t(info.image.imageLayout));
+        break;
+
+      case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        state.add(std::hash<VkBufferView>()(info.texelBuffer));
+        break;
+
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        state.add(std::hash<VkBuffer>()(info.buffer.buffer));
+        state.add(std::hash<VkDeviceSize>()(info.buffer.offset));
+        state.add(std::hash<VkDeviceSize>()(info.buffer.range));
+        break;
+
+      default:
+        break;
+    }
+
+    return state;
+  }
+
+
+  bool DxvkDescriptorSetCache::eqDescriptor(
+          VkDescriptorType        type,
+    const DxvkDescriptorInfo&     a,
+    const DxvkDescriptorInfo&     b) {
+    switch (type) {
+      case VK_DESCRIPTOR_TYPE_SAMPLER:
+        return a.image.sampler == b.image.sampler;
+
+      case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        return a.image.sampler     == b.image.sampler
+            && a.image.imageView   == b.image.imageView
+            && a.image.imageLayout == b.image.imageLayout;
+
+      case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+      case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        return a.image.imageView   == b.image.imageView
+            && a.image.imageLayout == b.image.imageLayout;
+
+      case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        return a.texelBuffer == b.texelBuffer;
+
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        return a.buffer.buffer == b.buffer.buffer
+            && a.buffer.offset == b.buffer.offset
+            && a.buffer.range  == b.buffer.range;
+
+      default:
+        return false;
+    }
+  }
   
 }
\ No newline at end of file
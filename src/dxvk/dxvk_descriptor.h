@@ -1,8 +1,14 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
+#include "dxvk_hash.h"
 #include "dxvk_include.h"
+#include "dxvk_pipelayout.h"
 
 namespace dxvk {
 
@@ -32,9 +38,47 @@ namespace dxvk {
   public:
     
     DxvkDescriptorPool(
-      const Rc<vk::DeviceFn>& vkd);
+      const Rc<vk::DeviceFn>&     vkd,
+      const DxvkDescriptorCounts& capacity,
+            bool                  layoutSpecific);
     ~DxvkDescriptorPool();
     
+    /**
+     * \brief Checks whether the pool is layout-specific
+     * 
+     * Layout-specific pools are sized for a single
+     * pipeline layout and do not contribute to the
+     * usage statistics of general-purpose pools.
+     * \returns \c true for layout-specific pools
+     */
+    bool isLayoutSpecific() const {
+      return m_layoutSpecific;
+    }
+    
+    /**
+     * \brief Pool capacity
+     * 
+     * Maximum number of sets and descriptors
+     * of each type that the pool can provide.
+     * \returns Pool capacity
+     */
+    const DxvkDescriptorCounts& capacity() const {
+      return m_capacity;
+    }
+    
+    /**
+     * \brief Pool usage
+     * 
+     * Number of sets and descriptors of each type
+     * allocated since the pool was last reset.
+     * Descriptors of sets allocated without a
+     * pipeline layout are not included.
+     * \returns Pool usage
+     */
+    const DxvkDescriptorCounts& usage() const {
+      return m_usage;
+    }
+    
     /**
      * \brief Allocates a descriptor set
      * 
@@ -44,6 +88,18 @@ namespace dxvk {
     VkDescriptorSet alloc(
       VkDescriptorSetLayout layout);
     
+    /**
+     * \brief Allocates a descriptor set
+     * 
+     * Allocates a set for the pipeline layout's
+     * descriptor set layout and records the
+     * descriptors it uses in the pool usage.
+     * \param [in] layout Pipeline layout
+     * \returns The descriptor set
+     */
+    VkDescriptorSet alloc(
+      const DxvkPipelineLayout*   layout);
+    
     /**
      * \brief Resets descriptor set allocator
      * 
@@ -54,9 +110,139 @@ namespace dxvk {
     
   private:
     
-    Rc<vk::DeviceFn> m_vkd;
-    VkDescriptorPool m_pool;
+    Rc<vk::DeviceFn>      m_vkd;
+    VkDescriptorPool      m_pool;
+    
+    DxvkDescriptorCounts  m_capacity;
+    DxvkDescriptorCounts  m_usage;
+    bool                  m_layoutSpecific;
     
+    VkDescriptorSet allocSet(
+      VkDescriptorSetLayout layout);
+    
+  };
+
+
+  /**
+   * \brief Layout-specific descriptor pool
+   * 
+   * Descriptor pool that only provides sets for a
+   * single pipeline layout. Keeps the layout alive
+   * so that it can be identified by its address.
+   */
+  struct DxvkLayoutDescriptorPool {
+    Rc<DxvkPipelineLayout> layout;
+    Rc<DxvkDescriptorPool> pool;
+  };
+
+
+  /**
+   * \brief Descriptor pool statistics
+   */
+  struct DxvkDescriptorPoolStats {
+    uint64_t poolsCreated;
+    uint64_t poolsReset;
+  };
+
+
+  /**
+   * \brief Descriptor pool manager
+   * 
+   * Creates and recycles descriptor pools. The size of
+   * general-purpose pools is derived from the number of
+   * descriptors of each type that retired pools have
+   * actually handed out per frame, so that pools neither
+   * run out of one descriptor type early nor reserve
+   * driver memory for types that are never used.
+   * 
+   * Pools dedicated to a single pipeline layout are
+   * sized for that layout only, and are recycled
+   * along with the general-purpose pools.
+   */
+  class DxvkDescriptorPoolManager {
+    /// Number of frames between size updates
+    constexpr static uint32_t UpdateInterval = 64;
+    /// Maximum number of pools kept for reuse
+    constexpr static uint32_t MaxRecycledPools = 32;
+    /// Number of sets in layout-specific pools
+    constexpr static uint32_t LayoutPoolSets = 1024;
+  public:
+
+    DxvkDescriptorPoolManager(
+      const Rc<vk::DeviceFn>&     vkd);
+    ~DxvkDescriptorPoolManager();
+
+    /**
+     * \brief Retrieves a general-purpose pool
+     * 
+     * Reuses a recycled pool if one with the current
+     * capacity is available, or creates a new one.
+     * \returns Descriptor pool
+     */
+    Rc<DxvkDescriptorPool> createPool();
+
+    /**
+     * \brief Retrieves a layout-specific pool
+     * 
+     * Creates a pool that can only provide descriptor
+     * sets for the given pipeline layout, or for
+     * layouts that use the same descriptor counts.
+     * \param [in] layout Pipeline layout
+     * \returns Descriptor pool
+     */
+    Rc<DxvkDescriptorPool> createPool(
+      const DxvkPipelineLayout*   layout);
+
+    /**
+     * \brief Resets and recycles a pool
+     * 
+     * Adds the pool's usage to the statistics
+     * and resets it so that it can be reused.
+     * \param [in] pool The descriptor pool
+     */
+    void recyclePool(
+      const Rc<DxvkDescriptorPool>& pool);
+
+    /**
+     * \brief Notifies the manager about a new frame
+     * 
+     * Periodically recomputes the capacity of
+     * general-purpose pools from the usage
+     * statistics gathered since the last update.
+     */
+    void endFrame();
+
+    /**
+     * \brief Retrieves pool statistics
+     * \returns Pool statistics
+     */
+    DxvkDescriptorPoolStats getStats() const;
+
+  private:
+
+    Rc<vk::DeviceFn>      m_vkd;
+
+    std::mutex            m_mutex;
+    DxvkDescriptorCounts  m_capacity;
+    DxvkDescriptorCounts  m_usage;
+    uint32_t              m_frameCount = 0;
+
+    float                 m_avgSets = 0.0f;
+    std::array<float, DxvkDescriptorTypeCount> m_avgDescriptors = { };
+
+    std::vector<Rc<DxvkDescriptorPool>> m_pools;
+
+    std::atomic<uint64_t> m_poolsCreated = { 0ull };
+    std::atomic<uint64_t> m_poolsReset   = { 0ull };
+
+    Rc<DxvkDescriptorPool> retrievePool(
+      const DxvkDescriptorCounts& capacity,
+            bool                  layoutSpecific);
+
+    void updateCapacity();
+
+    static DxvkDescriptorCounts getDefaultCapacity();
+
   };
 
 
@@ -84,8 +270,8 @@ namespace dxvk {
     /**
      * \brief Resets event tracker
      * 
-     * Resets all tracked descriptor pools
-     * and returns them to the device.
+     * Returns all tracked descriptor pools to the
+     * device, which resets them for later reuse.
      */
     void reset();
 
@@ -96,5 +282,96 @@ namespace dxvk {
     std::vector<Rc<DxvkDescriptorPool>> m_pools;
 
   };
+
+
+  /**
+   * \brief Descriptor set cache
+   * 
+   * Remembers descriptor sets that have been written
+   * with a given set of descriptors, so that draws
+   * that use identical resources can reuse a set
+   * instead of allocating and writing a new one.
+   * 
+   * Descriptors reference resources by their Vulkan
+   * handles, which may be reused once a resource gets
+   * destroyed. Resources are only guaranteed to stay
+   * alive while the command list tracks them, so the
+   * cache must be cleared whenever a new command list
+   * begins, as well as when the descriptor pool that
+   * the cached sets were allocated from is retired.
+   */
+  class DxvkDescriptorSetCache {
+
+  public:
+
+    DxvkDescriptorSetCache();
+    ~DxvkDescriptorSetCache();
+
+    /**
+     * \brief Computes hash of a descriptor array
+     * 
+     * \param [in] layout Pipeline layout
+     * \param [in] descriptors Descriptor array
+     * \returns Hash to pass to other methods
+     */
+    static size_t hash(
+      const DxvkPipelineLayout*     layout,
+      const DxvkDescriptorInfo*     descriptors);
+
+    /**
+     * \brief Looks up a descriptor set
+     * 
+     * \param [in] layout Pipeline layout
+     * \param [in] descriptors Descriptor array
+     * \param [in] hash Descriptor array hash
+     * \returns Matching descriptor set, or
+     *    \c VK_NULL_HANDLE if none was found
+     */
+    VkDescriptorSet lookup(
+      const DxvkPipelineLayout*     layout,
+      const DxvkDescriptorInfo*     descriptors,
+            size_t                  hash) const;
+
+    /**
+     * \brief Adds a descriptor set
+     * 
+     * \param [in] layout Pipeline layout
+     * \param [in] descriptors Descriptor array
+     * \param [in] hash Descriptor array hash
+     * \param [in] set Descriptor set that has
+     *    been written with the given descriptors
+     */
+    void insert(
+      const DxvkPipelineLayout*     layout,
+      const DxvkDescriptorInfo*     descriptors,
+            size_t                  hash,
+            VkDescriptorSet         set);
+
+    /**
+     * \brief Removes all descriptor sets
+     */
+    void clear();
+
+  private:
+
+    struct Entry {
+      const DxvkPipelineLayout* layout;
+      VkDescriptorSet           set;
+      size_t                    index;
+    };
+
+    std::unordered_multimap<size_t, Entry> m_entries;
+    std::vector<DxvkDescriptorInfo>        m_descriptors;
+
+    static size_t hashDescriptor(
+            VkDescriptorType        type,
+      const DxvkDescriptorInfo&     info);
+
+    static bool eqDescriptor(
+            VkDescriptorType        type,
+      const DxvkDescriptorInfo&     a,
+      const DxvkDescriptorInfo&     b);
+
+  };
   
 }
\ No newline at end of file
@@ -18,10 +18,24 @@ namespace dxvk {
     m_properties        (adapter->devicePropertiesExt()),
     m_perfHints         (getPerfHints()),
     m_objects           (this),
+    m_descriptorPools   (vkd),
     m_submissionQueue   (this) {
     auto queueFamilies = m_adapter->findQueueFamilies();
     m_queues.graphics = getQueue(queueFamilies.graphics, 0);
     m_queues.transfer = getQueue(queueFamilies.transfer, 0);
+
+    std::string useShaderCache = env::getEnvVar("DXVK_SHADER_CACHE");
+
+    if (useShaderCache == "1" || (useShaderCache != "0" && m_options.enableShaderCache))
+      m_shaderCache = new DxvkShaderCache();
+
+    std::string useMemoryDefrag = env::getEnvVar("DXVK_MEMORY_DEFRAG");
+
+    if (useMemoryDefrag == "1" || (useMemoryDefrag != "0" && m_options.enableMemoryDefrag))
+      m_memoryDefrag = std::make_unique<DxvkMemoryDefrag>(this, m_objects.memoryManager());
+
+    if (m_options.enableBufferArena)
+      m_bufferArena = std::make_unique<DxvkBufferArena>(this, m_objects.memoryManager());
   }
   
   
@@ -68,12 +82,13 @@ namespace dxvk {
 
 
   Rc<DxvkDescriptorPool> DxvkDevice::createDescriptorPool() {
-    Rc<DxvkDescriptorPool> pool = m_recycledDescriptorPools.retrieveObject();
-
-    if (pool == nullptr)
-      pool = new DxvkDescriptorPool(m_vkd);
-    
-    return pool;
+    return m_descriptorPools.createPool();
+  }
+  
+  
+  Rc<DxvkDescriptorPool> DxvkDevice::createDescriptorPool(
+    const DxvkPipelineLayout*   layout) {
+    return m_descriptorPools.createPool(layout);
   }
   
   
@@ -162,12 +177,20 @@ namespace dxvk {
     DxvkPipelineCount pipe = m_objects.pipelineManager().getPipelineCount();
     
     DxvkStatCounters result;
-    result.setCtr(DxvkStatCounter::MemoryAllocated,   mem.memoryAllocated);
-    result.setCtr(DxvkStatCounter::MemoryUsed,        mem.memoryUsed);
-    result.setCtr(DxvkStatCounter::PipeCountGraphics, pipe.numGraphicsPipelines);
-    result.setCtr(DxvkStatCounter::PipeCountCompute,  pipe.numComputePipelines);
-    result.setCtr(DxvkStatCounter::PipeCompilerBusy,  m_objects.pipelineManager().isCompilingShaders());
-    result.setCtr(DxvkStatCounter::GpuIdleTicks,      m_submissionQueue.gpuIdleTicks());
+    result.setCtr(DxvkStatCounter::MemoryAllocated,      mem.memoryAllocated);
+    result.setCtr(DxvkStatCounter::MemoryUsed,           mem.memoryUsed);
+    result.setCtr(DxvkStatCounter::PipeCountGraphics,    pipe.numGraphicsPipelines);
+    result.setCtr(DxvkStatCounter::PipeCountCompute,     pipe.numComputePipelines);
+    result.setCtr(DxvkStatCounter::PipeCompilerBusy,     m_objects.pipelineManager().isCompilingShaders());
+    result.setCtr(DxvkStatCounter::PipeQueueCount,       pipe.numQueuedPipelines);
+    result.setCtr(DxvkStatCounter::PipeQueuePrioritized, pipe.numPrioritizedPipelines);
+    result.setCtr(DxvkStatCounter::PipeQueueDequeued,    pipe.numDequeuedPipelines);
+    result.setCtr(DxvkStatCounter::PipeQueueWaitTicks,   pipe.queueWaitTimeUs);
+    result.setCtr(DxvkStatCounter::GpuIdleTicks,         m_submissionQueue.gpuIdleTicks());
+
+    DxvkDescriptorPoolStats pool = m_descriptorPools.getStats();
+    result.setCtr(DxvkStatCounter::DescriptorPoolCreated, pool.poolsCreated);
+    result.setCtr(DxvkStatCounter::DescriptorPoolReset,   pool.poolsReset);
 
     std::lock_guard<sync::Spinlock> lock(m_statLock);
     result.merge(m_statCounters);
@@ -175,6 +198,17 @@ namespace dxvk {
   }
 
 
+  std::vector<DxvkMemoryTypeStats> DxvkDevice::getMemoryTypeStats() {
+    return m_objects.memoryManager().getMemoryTypeStats();
+  }
+
+
+  void DxvkDevice::addStatCounters(const DxvkStatCounters& counters) {
+    std::lock_guard<sync::Spinlock> lock(m_statLock);
+    m_statCounters.merge(counters);
+  }
+
+
   uint32_t DxvkDevice::getCurrentFrameId() const {
     return m_statCounters.getCtr(DxvkStatCounter::QueuePresentCount);
   }
@@ -200,9 +234,14 @@ namespace dxvk {
     presentInfo.presenter = presenter;
     presentInfo.waitSync  = semaphore;
     m_submissionQueue.present(presentInfo, status);
+    m_descriptorPools.endFrame();
+    m_objects.memoryManager().updateMemoryReport();
     
-    std::lock_guard<sync::Spinlock> statLock(m_statLock);
-    m_statCounters.addCtr(DxvkStatCounter::QueuePresentCount, 1);
+    { std::lock_guard<sync::Spinlock> statLock(m_statLock);
+      m_statCounters.addCtr(DxvkStatCounter::QueuePresentCount, 1);
+    }
+
+    m_bufferTrimmer.endFrame(getCurrentFrameId());
   }
 
 
@@ -222,6 +261,19 @@ namespace dxvk {
   }
   
   
+  void DxvkDevice::submitCommandList(
+    const Rc<DxvkPendingCommandList>& commandList) {
+    DxvkSubmitInfo submitInfo;
+    submitInfo.pending  = commandList;
+    submitInfo.waitSync = VK_NULL_HANDLE;
+    submitInfo.wakeSync = VK_NULL_HANDLE;
+    m_submissionQueue.submit(submitInfo);
+
+    std::lock_guard<sync::Spinlock> statLock(m_statLock);
+    m_statCounters.addCtr(DxvkStatCounter::QueueSubmitCount, 1);
+  }
+  
+  
   VkResult DxvkDevice::waitForSubmission(DxvkSubmitStatus* status) {
     VkResult result = status->result.load();
 
@@ -234,6 +286,16 @@ namespace dxvk {
   }
   
   
+  bool DxvkDevice::waitForResource(
+    const Rc<DxvkResource>&   resource,
+          DxvkAccess          access) {
+    if (!resource->isInUse(access))
+      return true;
+
+    return m_submissionQueue.waitForResource(resource, access);
+  }
+  
+  
   void DxvkDevice::waitForIdle() {
     m_submissionQueue.synchronize();
 
@@ -256,7 +318,7 @@ namespace dxvk {
   
 
   void DxvkDevice::recycleDescriptorPool(const Rc<DxvkDescriptorPool>& pool) {
-    m_recycledDescriptorPools.returnObject(pool);
+    m_descriptorPools.recyclePool(pool);
   }
 
 
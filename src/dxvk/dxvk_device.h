@@ -2,6 +2,8 @@
 
 #include "dxvk_adapter.h"
 #include "dxvk_buffer.h"
+#include "dxvk_buffer_arena.h"
+#include "dxvk_buffer_trim.h"
 #include "dxvk_compute.h"
 #include "dxvk_constant_state.h"
 #include "dxvk_context.h"
@@ -9,6 +11,7 @@
 #include "dxvk_framebuffer.h"
 #include "dxvk_image.h"
 #include "dxvk_memory.h"
+#include "dxvk_memory_defrag.h"
 #include "dxvk_meta_clear.h"
 #include "dxvk_objects.h"
 #include "dxvk_options.h"
@@ -19,6 +22,7 @@
 #include "dxvk_renderpass.h"
 #include "dxvk_sampler.h"
 #include "dxvk_shader.h"
+#include "dxvk_shader_cache.h"
 #include "dxvk_stats.h"
 #include "dxvk_unbound.h"
 
@@ -220,6 +224,18 @@ namespace dxvk {
      */
     Rc<DxvkDescriptorPool> createDescriptorPool();
     
+    /**
+     * \brief Creates a layout-specific descriptor pool
+     * 
+     * Same as \ref createDescriptorPool, except that
+     * the pool is sized to only provide descriptor
+     * sets for the given pipeline layout.
+     * \param [in] layout Pipeline layout
+     * \returns Descriptor pool
+     */
+    Rc<DxvkDescriptorPool> createDescriptorPool(
+      const DxvkPipelineLayout*   layout);
+    
     /**
      * \brief Creates a context
      * 
@@ -329,6 +345,52 @@ namespace dxvk {
       const DxvkInterfaceSlots&       iface,
       const SpirvCodeBuffer&          code);
     
+    /**
+     * \brief Persistent shader cache
+     * 
+     * Client APIs can use this to store compiled shaders
+     * across application runs. Will be \c nullptr if the
+     * shader cache is disabled.
+     * \returns The shader cache, or \c nullptr
+     */
+    Rc<DxvkShaderCache> shaderCache() const {
+      return m_shaderCache;
+    }
+    
+    /**
+     * \brief Memory defragmenter
+     * 
+     * Moves device-local buffers out of sparsely used
+     * memory chunks. Will be \c nullptr if memory
+     * defragmentation is disabled.
+     * \returns The defragmenter, or \c nullptr
+     */
+    DxvkMemoryDefrag* memoryDefrag() const {
+      return m_memoryDefrag.get();
+    }
+    
+    /**
+     * \brief Buffer arena
+     * 
+     * Shared storage for small host-visible buffers.
+     * Will be \c nullptr if the arena is disabled.
+     * \returns The buffer arena, or \c nullptr
+     */
+    DxvkBufferArena* bufferArena() const {
+      return m_bufferArena.get();
+    }
+    
+    /**
+     * \brief Buffer trimmer
+     * 
+     * Releases backing buffers of buffers
+     * that are no longer being discarded.
+     * \returns The buffer trimmer
+     */
+    DxvkBufferTrimmer& bufferTrimmer() {
+      return m_bufferTrimmer;
+    }
+    
     /**
      * \brief Retrieves stat counters
      * 
@@ -338,6 +400,26 @@ namespace dxvk {
      */
     DxvkStatCounters getStatCounters();
 
+    /**
+     * \brief Retrieves memory type stats
+     * 
+     * Detailed per-memory type statistics, which
+     * are useful to diagnose memory fragmentation.
+     * This is relatively expensive to query.
+     * \returns Stats for each used memory type
+     */
+    std::vector<DxvkMemoryTypeStats> getMemoryTypeStats();
+
+    /**
+     * \brief Adds stat counters
+     * 
+     * Merges counters that are collected outside
+     * of DXVK command lists, e.g. by the client
+     * API's command stream implementation.
+     * \param [in] counters Counters to add
+     */
+    void addStatCounters(const DxvkStatCounters& counters);
+
     /**
      * \brief Retreves current frame ID
      * \returns Current frame ID
@@ -388,6 +470,18 @@ namespace dxvk {
       const Rc<DxvkCommandList>&      commandList,
             VkSemaphore               waitSync,
             VkSemaphore               wakeSync);
+    
+    /**
+     * \brief Submits a pending command list
+     * 
+     * Reserves a position in the submission queue for a
+     * command list that is being recorded on another
+     * thread. Stat counters of the command list must be
+     * added by the recording thread.
+     * \param [in] commandList The pending command list
+     */
+    void submitCommandList(
+      const Rc<DxvkPendingCommandList>& commandList);
 
     /**
      * \brief Checks for async presentation support
@@ -440,6 +534,21 @@ namespace dxvk {
      * \returns Result of the submission
      */
     VkResult waitForSubmission(DxvkSubmitStatus* status);
+
+    /**
+     * \brief Waits for a resource to become idle
+     *
+     * Blocks the calling thread instead of spinning
+     * until all submitted command lists that use the
+     * resource for the given access type have completed.
+     * \param [in] resource The resource to wait for
+     * \param [in] access Access type to wait for
+     * \returns \c false if the resource is still in use
+     *    by a command list that was not submitted yet
+     */
+    bool waitForResource(
+      const Rc<DxvkResource>&   resource,
+            DxvkAccess          access);
     
     /**
      * \brief Waits until the device becomes idle
@@ -464,15 +573,23 @@ namespace dxvk {
     DxvkDeviceInfo              m_properties;
     
     DxvkDevicePerfHints         m_perfHints;
+
+    std::unique_ptr<DxvkMemoryDefrag> m_memoryDefrag;
+    DxvkBufferTrimmer                 m_bufferTrimmer;
+
     DxvkObjects                 m_objects;
 
+    std::unique_ptr<DxvkBufferArena> m_bufferArena;
+
+    Rc<DxvkShaderCache>         m_shaderCache;
+
     sync::Spinlock              m_statLock;
     DxvkStatCounters            m_statCounters;
     
     DxvkDeviceQueueSet          m_queues;
     
-    DxvkRecycler<DxvkCommandList,    16> m_recycledCommandLists;
-    DxvkRecycler<DxvkDescriptorPool, 16> m_recycledDescriptorPools;
+    DxvkRecycler<DxvkCommandList, 16> m_recycledCommandLists;
+    DxvkDescriptorPoolManager         m_descriptorPools;
     
     DxvkSubmissionQueue m_submissionQueue;
 
@@ -86,10 +86,42 @@ namespace dxvk {
   void DxvkGraphicsPipeline::compilePipeline(
     const DxvkGraphicsPipelineStateInfo& state,
     const DxvkRenderPass*                renderPass) {
-    std::lock_guard<sync::Spinlock> lock(m_mutex);
+    DxvkGraphicsPipelineInstance* instance = nullptr;
+
+    { std::lock_guard<sync::Spinlock> lock(m_mutex);
+
+      if (!this->findInstance(state, renderPass))
+        instance = this->createInstance(state, renderPass);
+    }
 
-    if (!this->findInstance(state, renderPass))
-      this->createInstance(state, renderPass);
+    // Pipelines that were not loaded from the state
+    // cache need to be written to it, since they will
+    // not go through getPipelineHandle on first use
+    if (instance)
+      this->writePipelineStateToCache(state, renderPass->format());
+  }
+
+
+  DxvkGraphicsPipelineStatus DxvkGraphicsPipeline::getPipelineStatus(
+    const DxvkGraphicsPipelineStateInfo& state,
+    const DxvkRenderPass*                renderPass) {
+    if (!this->validatePipelineState(state))
+      return DxvkGraphicsPipelineStatus::Failed;
+
+    // The lock is held while compiling pipelines
+    std::unique_lock<sync::Spinlock> lock(m_mutex, std::try_to_lock);
+
+    if (!lock.owns_lock())
+      return DxvkGraphicsPipelineStatus::Pending;
+
+    DxvkGraphicsPipelineInstance* instance = this->findInstance(state, renderPass);
+
+    if (!instance)
+      return DxvkGraphicsPipelineStatus::Pending;
+
+    return instance->pipeline() != VK_NULL_HANDLE
+      ? DxvkGraphicsPipelineStatus::Ready
+      : DxvkGraphicsPipelineStatus::Failed;
   }
 
 
@@ -104,7 +136,12 @@ namespace dxvk {
     VkPipeline newPipelineHandle = this->createPipeline(state, renderPass);
 
     m_pipeMgr->m_numGraphicsPipelines += 1;
-    return &m_pipelines.emplace_back(state, renderPass, newPipelineHandle);
+
+    DxvkGraphicsPipelineInstance* instance =
+      &m_pipelines.emplace_back(state, renderPass, newPipelineHandle);
+
+    m_instanceCount += 1;
+    return instance;
   }
   
   
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
 
 #include "dxvk_bind_mask.h"
@@ -28,6 +29,16 @@ namespace dxvk {
   using DxvkGraphicsPipelineFlags = Flags<DxvkGraphicsPipelineFlag>;
 
 
+  /**
+   * \brief Compilation status of a pipeline instance
+   */
+  enum class DxvkGraphicsPipelineStatus {
+    Pending,
+    Ready,
+    Failed,
+  };
+
+
   /**
    * \brief Shaders used in graphics pipelines
    */
@@ -203,6 +214,33 @@ namespace dxvk {
       const DxvkGraphicsPipelineStateInfo&    state,
       const DxvkRenderPass*                   renderPass);
     
+    /**
+     * \brief Checks whether a pipeline is available
+     * 
+     * Never compiles a pipeline, and does not wait for
+     * pipelines that are being compiled by another thread.
+     * Pipelines with an invalid state vector, or which the
+     * driver failed to create, are reported as failed.
+     * \param [in] state Pipeline state vector
+     * \param [in] renderPass The render pass
+     * \returns Pipeline status
+     */
+    DxvkGraphicsPipelineStatus getPipelineStatus(
+      const DxvkGraphicsPipelineStateInfo&    state,
+      const DxvkRenderPass*                   renderPass);
+    
+    /**
+     * \brief Number of pipeline instances
+     * 
+     * Increases whenever a pipeline instance gets added,
+     * which allows polling for asynchronously compiled
+     * pipelines without taking the lock.
+     * \returns Number of pipeline instances
+     */
+    uint32_t getInstanceCount() const {
+      return m_instanceCount.load();
+    }
+    
   private:
     
     Rc<vk::DeviceFn>            m_vkd;
@@ -222,6 +260,7 @@ namespace dxvk {
     // List of pipeline instances, shared between threads
     alignas(CACHE_LINE_SIZE) sync::Spinlock   m_mutex;
     std::vector<DxvkGraphicsPipelineInstance> m_pipelines;
+    std::atomic<uint32_t>                     m_instanceCount = { 0u };
     
     DxvkGraphicsPipelineInstance* createInstance(
       const DxvkGraphicsPipelineStateInfo& state,
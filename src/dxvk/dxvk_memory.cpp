@@ -1,8 +1,25 @@
+#include <iomanip>
+
 #include "dxvk_device.h"
 #include "dxvk_memory.h"
 
 namespace dxvk {
   
+  uint32_t DxvkMemoryTypeStats::getBucket(VkDeviceSize size) {
+    uint32_t msb = size ? bit::bsr(size) : 0;
+
+    if (msb < 12)
+      return 0;
+
+    return std::min(msb - 11, BucketCount - 1);
+  }
+
+
+  VkDeviceSize DxvkMemoryTypeStats::getBucketSize(uint32_t bucket) {
+    return bucket ? VkDeviceSize(1) << (bucket + 11) : 0;
+  }
+
+
   DxvkMemory::DxvkMemory() { }
   DxvkMemory::DxvkMemory(
           DxvkMemoryAllocator*  alloc,
@@ -59,15 +76,15 @@ namespace dxvk {
           DxvkMemoryAllocator*  alloc,
           DxvkMemoryType*       type,
           DxvkDeviceMemory      memory)
-  : m_alloc(alloc), m_type(type), m_memory(memory) {
-    // Mark the entire chunk as free
-    m_freeList.push_back(FreeSlice { 0, memory.memSize });
+  : m_alloc(alloc), m_type(type), m_memory(memory),
+    m_ranges(memory.memSize) {
+    
   }
   
   
   DxvkMemoryChunk::~DxvkMemoryChunk() {
-    // This call is technically not thread-safe, but it
-    // doesn't need to be since we don't free chunks
+    // Chunks are only destroyed by the allocator itself
+    // with its lock held, or when the allocator is gone
     m_alloc->freeDeviceMemory(m_type, m_memory);
   }
   
@@ -80,49 +97,21 @@ namespace dxvk {
     // Property flags must be compatible. This could
     // be refined a bit in the future if necessary.
     if (m_memory.memFlags != flags
-     || m_memory.priority != priority)
-      return DxvkMemory();
-    
-    // If the chunk is full, return
-    if (m_freeList.size() == 0)
+     || m_memory.priority != priority
+     || m_evacuating)
       return DxvkMemory();
     
-    // Select the slice to allocate from in a worst-fit
-    // manner. This may help keep fragmentation low.
-    auto bestSlice = m_freeList.begin();
-    
-    for (auto slice = m_freeList.begin(); slice != m_freeList.end(); slice++) {
-      if (slice->length == size) {
-        bestSlice = slice;
-        break;
-      } else if (slice->length > bestSlice->length) {
-        bestSlice = slice;
-      }
-    }
-    
-    // We need to align the allocation to the requested alignment
-    const VkDeviceSize sliceStart = bestSlice->offset;
-    const VkDeviceSize sliceEnd   = bestSlice->offset + bestSlice->length;
-    
-    const VkDeviceSize allocStart = dxvk::align(sliceStart,        align);
-    const VkDeviceSize allocEnd   = dxvk::align(allocStart + size, align);
-    
-    if (allocEnd > sliceEnd)
+    // Allocations are padded to the requested alignment
+    // so that the end of the slice is aligned as well
+    const VkDeviceSize allocSize = dxvk::align(size, align);
+    VkDeviceSize allocStart = 0;
+
+    if (!m_ranges.alloc(allocSize, align, allocStart))
       return DxvkMemory();
     
-    // We can use this slice, but we'll have to add
-    // the unused parts of it back to the free list.
-    m_freeList.erase(bestSlice);
-    
-    if (allocStart != sliceStart)
-      m_freeList.push_back({ sliceStart, allocStart - sliceStart });
-    
-    if (allocEnd != sliceEnd)
-      m_freeList.push_back({ allocEnd, sliceEnd - allocEnd });
-    
     // Create the memory object with the aligned slice
     return DxvkMemory(m_alloc, this, m_type,
-      m_memory.memHandle, allocStart, allocEnd - allocStart,
+      m_memory.memHandle, allocStart, allocSize,
       reinterpret_cast<char*>(m_memory.memPointer) + allocStart);
   }
   
@@ -130,25 +119,21 @@ namespace dxvk {
   void DxvkMemoryChunk::free(
           VkDeviceSize  offset,
           VkDeviceSize  length) {
-    // Remove adjacent entries from the free list and then add
-    // a new slice that covers all those entries. Without doing
-    // so, the slice could not be reused for larger allocations.
-    auto curr = m_freeList.begin();
-    
-    while (curr != m_freeList.end()) {
-      if (curr->offset == offset + length) {
-        length += curr->length;
-        curr = m_freeList.erase(curr);
-      } else if (curr->offset + curr->length == offset) {
-        offset -= curr->length;
-        length += curr->length;
-        curr = m_freeList.erase(curr);
-      } else {
-        curr++;
-      }
-    }
-    
-    m_freeList.push_back({ offset, length });
+    m_ranges.free(offset, length);
+  }
+  
+  
+  void DxvkMemoryChunk::getStats(
+          DxvkMemoryTypeStats& stats) const {
+    stats.chunkCount     += 1;
+    stats.chunkAllocated += m_ranges.size();
+    stats.chunkUsed      += m_ranges.size() - m_ranges.freeSize();
+    stats.freeRangeCount += m_ranges.freeRangeCount();
+    stats.maxFreeRange    = std::max(stats.maxFreeRange, m_ranges.maxFreeRangeSize());
+
+    m_ranges.forEachFreeRange([&stats] (VkDeviceSize offset, VkDeviceSize size) {
+      stats.freeRanges[DxvkMemoryTypeStats::getBucket(size)] += 1;
+    });
   }
   
   
@@ -168,12 +153,39 @@ namespace dxvk {
       m_memTypes[i].memType    = m_memProps.memoryTypes[i];
       m_memTypes[i].memTypeId  = i;
       m_memTypes[i].chunkSize  = pickChunkSize(i);
+
+      m_memTypes[i].stats.memTypeId = i;
+      m_memTypes[i].stats.heapId    = m_memProps.memoryTypes[i].heapIndex;
+      m_memTypes[i].stats.memFlags  = m_memProps.memoryTypes[i].propertyFlags;
+    }
+
+    m_reportPath = env::getEnvVar("DXVK_MEMORY_REPORT");
+
+    std::string reportInterval = env::getEnvVar("DXVK_MEMORY_REPORT_INTERVAL");
+
+    if (!m_reportPath.empty() && !reportInterval.empty()) {
+      m_reportInterval = std::chrono::seconds(std::strtoul(reportInterval.c_str(), nullptr, 10));
+      m_reportStart    = ReportClock::now();
+      m_reportNext     = m_reportInterval.count();
+
+      // Periodic reports get appended to the file, so
+      // discard any reports from previous sessions
+      std::ofstream(m_reportPath, std::ios_base::trunc);
+    }
+
+    std::string tracePath = env::getEnvVar("DXVK_MEMORY_TRACE");
+
+    if (!tracePath.empty()) {
+      m_trace = std::ofstream(tracePath, std::ios_base::trunc);
+
+      if (!m_trace)
+        Logger::warn(str::format("DxvkMemoryAllocator: Failed to open ", tracePath));
     }
   }
   
   
   DxvkMemoryAllocator::~DxvkMemoryAllocator() {
-    
+    this->dumpMemoryReport(this->getMemoryReportLocked());
   }
   
   
@@ -225,6 +237,8 @@ namespace dxvk {
                 (m_memHeaps[i].properties.size        >> 20), " MB total")));
       }
 
+      this->dumpMemoryReport(this->getMemoryReportLocked());
+
       throw DxvkError("DxvkMemoryAllocator: Memory allocation failed");
     }
     
@@ -246,6 +260,116 @@ namespace dxvk {
   }
   
   
+  std::vector<DxvkMemoryTypeStats> DxvkMemoryAllocator::getMemoryTypeStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return this->getMemoryTypeStatsLocked();
+  }
+  
+  
+  void DxvkMemoryAllocator::writeMemoryReport(
+          std::ostream&         stream) {
+    Report report;
+
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      report = this->getMemoryReportLocked();
+    }
+
+    writeMemoryReport(stream, report);
+  }
+
+
+  void DxvkMemoryAllocator::updateMemoryReport() {
+    if (!m_reportInterval.count())
+      return;
+
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+      ReportClock::now() - m_reportStart).count();
+    int64_t next = m_reportNext.load();
+
+    if (elapsed < next || !m_reportNext.compare_exchange_strong(
+        next, elapsed + m_reportInterval.count()))
+      return;
+
+    // Only copy the stats while holding the lock, since
+    // writing the report file can take a while
+    Report report;
+
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      report = this->getMemoryReportLocked();
+    }
+
+    this->dumpMemoryReport(report);
+  }
+  
+  
+  const DxvkMemoryChunk* DxvkMemoryAllocator::getEvacuationChunk() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_evacuationChunk)
+      return m_evacuationChunk;
+
+    for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
+      DxvkMemoryType& type = m_memTypes[i];
+
+      // Host-visible memory may be mapped, so only
+      // device-local memory can be defragmented
+      VkMemoryPropertyFlags flags = type.memType.propertyFlags;
+
+      if (!(flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+       || (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+       || type.chunks.size() < 2)
+        continue;
+
+      VkDeviceSize freeSize = 0;
+
+      for (const auto& chunk : type.chunks)
+        freeSize += chunk->size() - chunk->usedSize();
+
+      // Pick the least used chunk that is at most a quarter full,
+      // and require twice the space elsewhere to leave some room
+      // for alignment and for allocations made in the meantime.
+      DxvkMemoryChunk* best = nullptr;
+
+      for (const auto& chunk : type.chunks) {
+        VkDeviceSize usedSize = chunk->usedSize();
+        VkDeviceSize freeElsewhere = freeSize - (chunk->size() - usedSize);
+
+        if (chunk->m_pinned
+         || usedSize * 4 > chunk->size()
+         || usedSize * 2 > freeElsewhere)
+          continue;
+
+        if (!best || usedSize < best->usedSize())
+          best = chunk.ptr();
+      }
+
+      if (best) {
+        Logger::debug(str::format("DxvkMemoryAllocator: Evacuating chunk on memory type ", i, ", ",
+          best->usedSize() >> 10, " kB of ", best->size() >> 10, " kB used"));
+
+        best->m_evacuating = true;
+        m_evacuationChunk = best;
+        return best;
+      }
+    }
+
+    return nullptr;
+  }
+  
+  
+  void DxvkMemoryAllocator::cancelEvacuation(
+    const DxvkMemoryChunk*      chunk) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_evacuationChunk != chunk)
+      return;
+
+    m_evacuationChunk->m_evacuating = false;
+    m_evacuationChunk->m_pinned     = true;
+    m_evacuationChunk = nullptr;
+  }
+  
+  
   DxvkMemory DxvkMemoryAllocator::tryAlloc(
     const VkMemoryRequirements*             req,
     const VkMemoryDedicatedAllocateInfoKHR* dedAllocInfo,
@@ -286,8 +410,12 @@ namespace dxvk {
       DxvkDeviceMemory devMem = this->tryAllocDeviceMemory(
         type, flags, size, priority, dedAllocInfo);
 
-      if (devMem.memHandle != VK_NULL_HANDLE)
+      if (devMem.memHandle != VK_NULL_HANDLE) {
         memory = DxvkMemory(this, nullptr, type, devMem.memHandle, 0, size, devMem.memPointer);
+
+        type->stats.dedicatedCount += 1;
+        type->stats.dedicatedSize  += size;
+      }
     } else {
       for (uint32_t i = 0; i < type->chunks.size() && !memory; i++)
         memory = type->chunks[i]->alloc(flags, size, align, priority);
@@ -300,6 +428,10 @@ namespace dxvk {
 
         if (devMem.memHandle) {
           Rc<DxvkMemoryChunk> chunk = new DxvkMemoryChunk(this, type, devMem);
+
+          if (m_trace)
+            m_trace << "c " << chunk.ptr() << " " << devMem.memSize << "\n";
+
           memory = chunk->alloc(flags, size, align, priority);
 
           type->chunks.push_back(std::move(chunk));
@@ -307,8 +439,15 @@ namespace dxvk {
       }
     }
 
-    if (memory)
+    if (memory) {
       type->heap->stats.memoryUsed += memory.m_length;
+      type->stats.allocations[DxvkMemoryTypeStats::getBucket(memory.m_length)] += 1;
+    }
+
+    if (m_trace && memory.m_chunk) {
+      m_trace << "a " << memory.m_chunk << " " << size << " "
+              << align << " " << memory.m_offset << "\n";
+    }
 
     return memory;
   }
@@ -362,6 +501,7 @@ namespace dxvk {
     const DxvkMemory&           memory) {
     std::lock_guard<std::mutex> lock(m_mutex);
     memory.m_type->heap->stats.memoryUsed -= memory.m_length;
+    memory.m_type->stats.allocations[DxvkMemoryTypeStats::getBucket(memory.m_length)] -= 1;
 
     if (memory.m_chunk != nullptr) {
       this->freeChunkMemory(
@@ -375,6 +515,9 @@ namespace dxvk {
       devMem.memPointer = nullptr;
       devMem.memSize    = memory.m_length;
       this->freeDeviceMemory(memory.m_type, devMem);
+
+      memory.m_type->stats.dedicatedCount -= 1;
+      memory.m_type->stats.dedicatedSize  -= memory.m_length;
     }
   }
 
@@ -384,7 +527,26 @@ namespace dxvk {
           DxvkMemoryChunk*      chunk,
           VkDeviceSize          offset,
           VkDeviceSize          length) {
+    if (m_trace)
+      m_trace << "f " << chunk << " " << offset << " " << length << "\n";
+
     chunk->free(offset, length);
+
+    // Return evacuated chunks to the driver as soon as
+    // they are empty. This destroys the chunk object.
+    if (chunk == m_evacuationChunk && !chunk->usedSize()) {
+      m_evacuationChunk = nullptr;
+
+      for (auto i = type->chunks.begin(); i != type->chunks.end(); i++) {
+        if (i->ptr() == chunk) {
+          Logger::debug(str::format("DxvkMemoryAllocator: Freeing evacuated chunk of ",
+            chunk->size() >> 10, " kB on memory type ", type->memTypeId));
+
+          type->chunks.erase(i);
+          break;
+        }
+      }
+    }
   }
   
 
@@ -397,6 +559,107 @@ namespace dxvk {
   }
 
 
+  std::vector<DxvkMemoryTypeStats> DxvkMemoryAllocator::getMemoryTypeStatsLocked() const {
+    std::vector<DxvkMemoryTypeStats> result;
+
+    for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
+      const DxvkMemoryType& type = m_memTypes[i];
+
+      if (type.chunks.empty() && !type.stats.dedicatedCount)
+        continue;
+
+      DxvkMemoryTypeStats stats = type.stats;
+
+      for (const auto& chunk : type.chunks)
+        chunk->getStats(stats);
+
+      result.push_back(stats);
+    }
+
+    return result;
+  }
+
+
+  DxvkMemoryAllocator::Report DxvkMemoryAllocator::getMemoryReportLocked() const {
+    Report report;
+    report.heaps.assign(m_memHeaps.begin(),
+      m_memHeaps.begin() + m_memProps.memoryHeapCount);
+    report.types = this->getMemoryTypeStatsLocked();
+    return report;
+  }
+
+
+  void DxvkMemoryAllocator::writeMemoryReport(
+          std::ostream&         stream,
+    const Report&               report) {
+    constexpr VkDeviceSize kib = 1 << 10;
+    constexpr VkDeviceSize mib = 1 << 20;
+
+    for (uint32_t i = 0; i < report.heaps.size(); i++) {
+      stream << "Heap " << i << ": "
+             << (report.heaps[i].stats.memoryAllocated / mib) << " MB allocated, "
+             << (report.heaps[i].stats.memoryUsed      / mib) << " MB used, "
+             << (report.heaps[i].properties.size       / mib) << " MB total" << std::endl;
+    }
+
+    for (const auto& stats : report.types) {
+      stream << std::endl
+             << "Memory type " << stats.memTypeId
+             << " (heap " << stats.heapId << ", flags 0x" << std::hex << stats.memFlags << std::dec << ")" << std::endl
+             << "  Chunks:           " << stats.chunkCount << ", "
+                                       << (stats.chunkUsed / mib) << " / "
+                                       << (stats.chunkAllocated / mib) << " MB used" << std::endl
+             << "  Free ranges:      " << stats.freeRangeCount << ", largest "
+                                       << (stats.maxFreeRange / kib) << " kB" << std::endl
+             << "  Dedicated:        " << stats.dedicatedCount << ", "
+                                       << (stats.dedicatedSize / mib) << " MB" << std::endl
+             << "  Size       Allocations  Free ranges" << std::endl;
+
+      for (uint32_t j = 0; j < DxvkMemoryTypeStats::BucketCount; j++) {
+        if (!stats.allocations[j] && !stats.freeRanges[j])
+          continue;
+
+        std::string label = j
+          ? str::format(">= ", DxvkMemoryTypeStats::getBucketSize(j) / kib, " kB")
+          : std::string("< 4 kB");
+
+        stream << "  " << label << std::string(label.size() < 11 ? 11 - label.size() : 1, ' ')
+               << std::setw(11) << stats.allocations[j] << "  "
+               << std::setw(11) << stats.freeRanges[j] << std::endl;
+      }
+    }
+  }
+
+
+  void DxvkMemoryAllocator::dumpMemoryReport(
+    const Report&               report) const {
+    if (m_reportPath.empty())
+      return;
+
+    bool periodic = m_reportInterval.count() != 0;
+
+    std::ofstream file(m_reportPath, periodic
+      ? std::ios_base::app
+      : std::ios_base::trunc);
+
+    if (!file) {
+      Logger::warn(str::format("DxvkMemoryAllocator: Failed to open ", m_reportPath));
+      return;
+    }
+
+    if (periodic) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+        ReportClock::now() - m_reportStart);
+      file << "=== Report after " << elapsed.count() << " s ===" << std::endl;
+    }
+
+    writeMemoryReport(file, report);
+
+    if (periodic)
+      file << std::endl;
+  }
+
+
   VkDeviceSize DxvkMemoryAllocator::pickChunkSize(uint32_t memTypeId) const {
     VkMemoryType type = m_memProps.memoryTypes[memTypeId];
     VkMemoryHeap heap = m_memProps.memoryHeaps[type.heapIndex];
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
+
 #include "dxvk_adapter.h"
+#include "dxvk_memory_range.h"
 
 namespace dxvk {
   
@@ -19,6 +24,50 @@ namespace dxvk {
   };
   
   
+  /**
+   * \brief Memory type stats
+   * 
+   * Detailed statistics for a single memory type,
+   * used to diagnose fragmentation and overcommitment.
+   * Histograms count ranges by power-of-two size, where
+   * the first bucket contains everything below 4 kB and
+   * the last bucket everything above 64 MB.
+   */
+  struct DxvkMemoryTypeStats {
+    constexpr static uint32_t BucketCount = 16;
+
+    uint32_t              memTypeId       = 0;
+    uint32_t              heapId          = 0;
+    VkMemoryPropertyFlags memFlags        = 0;
+    uint32_t              chunkCount      = 0;
+    VkDeviceSize          chunkAllocated  = 0;
+    VkDeviceSize          chunkUsed       = 0;
+    uint32_t              freeRangeCount  = 0;
+    VkDeviceSize          maxFreeRange    = 0;
+    uint32_t              dedicatedCount  = 0;
+    VkDeviceSize          dedicatedSize   = 0;
+
+    std::array<uint32_t, BucketCount> freeRanges  = { };
+    std::array<uint32_t, BucketCount> allocations = { };
+
+    /**
+     * \brief Computes histogram bucket for a size
+     * 
+     * \param [in] size Range size, in bytes
+     * \returns Histogram bucket index
+     */
+    static uint32_t getBucket(VkDeviceSize size);
+
+    /**
+     * \brief Computes lower bound of a bucket
+     * 
+     * \param [in] bucket Histogram bucket index
+     * \returns Smallest size in that bucket
+     */
+    static VkDeviceSize getBucketSize(uint32_t bucket);
+  };
+  
+  
   /**
    * \brief Device memory object
    * 
@@ -63,6 +112,8 @@ namespace dxvk {
 
     VkDeviceSize      chunkSize;
 
+    DxvkMemoryTypeStats stats;
+
     std::vector<Rc<DxvkMemoryChunk>> chunks;
   };
   
@@ -122,6 +173,17 @@ namespace dxvk {
       return reinterpret_cast<char*>(m_mapPtr) + offset;
     }
 
+    /**
+     * \brief Memory chunk
+     * 
+     * Identifies the chunk that the slice was sub-allocated
+     * from. Must only be used for comparisons.
+     * \returns The chunk, or \c nullptr for dedicated allocations
+     */
+    const DxvkMemoryChunk* chunk() const {
+      return m_chunk;
+    }
+
     /**
      * \brief Checks whether the memory slice is defined
      * 
@@ -152,9 +214,10 @@ namespace dxvk {
    * 
    * A single chunk of memory that provides a
    * sub-allocator. This is not thread-safe.
+   * \sa DxvkMemoryRangeAllocator
    */
   class DxvkMemoryChunk : public RcObject {
-    
+    friend class DxvkMemoryAllocator;
   public:
     
     DxvkMemoryChunk(
@@ -164,11 +227,29 @@ namespace dxvk {
     
     ~DxvkMemoryChunk();
 
+    /**
+     * \brief Chunk size
+     * \returns Chunk size, in bytes
+     */
+    VkDeviceSize size() const {
+      return m_ranges.size();
+    }
+
+    /**
+     * \brief Amount of used memory
+     * \returns Allocated bytes within the chunk
+     */
+    VkDeviceSize usedSize() const {
+      return m_ranges.size() - m_ranges.freeSize();
+    }
+
     /**
      * \brief Allocates memory from the chunk
      * 
      * On failure, this returns a slice with
      * \c VK_NULL_HANDLE as the memory handle.
+     * Chunks that are being evacuated by the
+     * defragmenter will not serve allocations.
      * \param [in] flags Requested memory flags
      * \param [in] size Number of bytes to allocate
      * \param [in] align Required alignment
@@ -194,18 +275,26 @@ namespace dxvk {
             VkDeviceSize  offset,
             VkDeviceSize  length);
     
-  private:
+    /**
+     * \brief Adds chunk statistics
+     * 
+     * Adds the size and free ranges of
+     * this chunk to the given stats.
+     * \param [out] stats Memory type stats
+     */
+    void getStats(
+            DxvkMemoryTypeStats& stats) const;
     
-    struct FreeSlice {
-      VkDeviceSize offset;
-      VkDeviceSize length;
-    };
+  private:
     
     DxvkMemoryAllocator*  m_alloc;
     DxvkMemoryType*       m_type;
     DxvkDeviceMemory      m_memory;
     
-    std::vector<FreeSlice> m_freeList;
+    DxvkMemoryRangeAllocator m_ranges;
+
+    bool                  m_evacuating = false;
+    bool                  m_pinned     = false;
     
   };
   
@@ -262,8 +351,68 @@ namespace dxvk {
      */
     DxvkMemoryStats getMemoryStats();
     
+    /**
+     * \brief Queries detailed memory type stats
+     * 
+     * Walks all chunks of all memory types, so this
+     * is relatively expensive. Only memory types that
+     * have any memory allocated are returned.
+     * \returns Stats for each used memory type
+     */
+    std::vector<DxvkMemoryTypeStats> getMemoryTypeStats();
+    
+    /**
+     * \brief Writes memory report
+     * 
+     * Writes detailed stats for all memory
+     * types in a human-readable format.
+     * \param [in] stream Output stream
+     */
+    void writeMemoryReport(
+            std::ostream&         stream);
+    
+    /**
+     * \brief Writes periodic memory report
+     * 
+     * Called once per frame. If a report interval is set
+     * via \c DXVK_MEMORY_REPORT_INTERVAL, this appends a
+     * report to the report file whenever the interval has
+     * passed, so that long sessions can be diagnosed.
+     */
+    void updateMemoryReport();
+    
+    /**
+     * \brief Picks a chunk to evacuate
+     * 
+     * If no chunk is being evacuated yet, this looks for a
+     * sparsely used device-local chunk whose allocations fit
+     * into the other chunks of the same memory type, and stops
+     * sub-allocating from it. Once the last allocation is freed,
+     * the chunk's memory is returned to the driver.
+     * \returns The chunk being evacuated, or \c nullptr
+     */
+    const DxvkMemoryChunk* getEvacuationChunk();
+    
+    /**
+     * \brief Stops evacuating a chunk
+     * 
+     * Called when the remaining allocations in the chunk
+     * cannot be moved. The chunk becomes available for
+     * allocations again and will not be picked again.
+     * \param [in] chunk The chunk being evacuated
+     */
+    void cancelEvacuation(
+      const DxvkMemoryChunk*      chunk);
+    
   private:
 
+    using ReportClock = std::chrono::high_resolution_clock;
+
+    struct Report {
+      std::vector<DxvkMemoryHeap>      heaps;
+      std::vector<DxvkMemoryTypeStats> types;
+    };
+
     const Rc<vk::DeviceFn>                 m_vkd;
     const DxvkDevice*                      m_device;
     const VkPhysicalDeviceProperties       m_devProps;
@@ -272,6 +421,25 @@ namespace dxvk {
     std::mutex                                      m_mutex;
     std::array<DxvkMemoryHeap, VK_MAX_MEMORY_HEAPS> m_memHeaps;
     std::array<DxvkMemoryType, VK_MAX_MEMORY_TYPES> m_memTypes;
+
+    std::ofstream                                   m_trace;
+    std::string                                     m_reportPath;
+    std::chrono::seconds                            m_reportInterval = std::chrono::seconds(0);
+    ReportClock::time_point                         m_reportStart;
+    std::atomic<int64_t>                            m_reportNext = { 0 };
+
+    DxvkMemoryChunk*                                m_evacuationChunk = nullptr;
+    
+    std::vector<DxvkMemoryTypeStats> getMemoryTypeStatsLocked() const;
+    
+    Report getMemoryReportLocked() const;
+    
+    static void writeMemoryReport(
+            std::ostream&         stream,
+      const Report&               report);
+    
+    void dumpMemoryReport(
+      const Report&               report) const;
     
     DxvkMemory tryAlloc(
       const VkMemoryRequirements*             req,
@@ -0,0 +1,171 @@
+#include "dxvk_device.h"
+#include "dxvk_memory_defrag.h"
+
+namespace dxvk {
+
+  DxvkMemoryDefrag::DxvkMemoryDefrag(
+          DxvkDevice*           device,
+          DxvkMemoryAllocator&  memAlloc)
+  : m_device(device), m_memAlloc(&memAlloc),
+    m_prevTime(Clock::now()) {
+
+  }
+
+
+  DxvkMemoryDefrag::~DxvkMemoryDefrag() {
+
+  }
+
+
+  void DxvkMemoryDefrag::registerBuffer(
+          DxvkBuffer*           buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    BufferInfo info;
+    info.passId = m_passId;
+    info.chunk  = buffer->getMemoryChunk();
+
+    m_buffers.insert({ buffer, info });
+    addChunkBuffer(info.chunk, buffer);
+  }
+
+
+  void DxvkMemoryDefrag::unregisterBuffer(
+          DxvkBuffer*           buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto entry = m_buffers.find(buffer);
+
+    if (entry == m_buffers.end())
+      return;
+
+    removeChunkBuffer(entry->second.chunk, buffer);
+    m_buffers.erase(entry);
+  }
+
+
+  void DxvkMemoryDefrag::updateBuffer(
+          DxvkBuffer*           buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto entry = m_buffers.find(buffer);
+
+    if (entry == m_buffers.end())
+      return;
+
+    const DxvkMemoryChunk* chunk = buffer->getMemoryChunk();
+
+    if (entry->second.chunk != chunk) {
+      removeChunkBuffer(entry->second.chunk, buffer);
+      addChunkBuffer(chunk, buffer);
+
+      entry->second.chunk = chunk;
+    }
+  }
+
+
+  std::vector<Rc<DxvkBuffer>> DxvkMemoryDefrag::pickBuffers() {
+    std::vector<Rc<DxvkBuffer>> result;
+
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      m_passId += 1;
+    }
+
+    if (!this->isGpuIdle())
+      return result;
+
+    const DxvkMemoryChunk* chunk = m_memAlloc->getEvacuationChunk();
+
+    if (!chunk)
+      return result;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    VkDeviceSize totalSize = 0;
+    bool         anyFound  = false;
+
+    auto chunkBuffers = m_chunkBuffers.find(chunk);
+
+    if (chunkBuffers != m_chunkBuffers.end()) {
+      for (DxvkBuffer* buffer : chunkBuffers->second) {
+        if (!buffer->isRelocatable())
+          continue;
+
+        anyFound = true;
+
+        // Skip buffers that were created since the last pass,
+        // since they may still be getting initialized by another
+        // context, as well as buffers with pending GPU writes.
+        // Initialization contexts track their writes as soon
+        // as they are recorded, so this also covers writes
+        // that have not been submitted yet.
+        if (m_buffers.at(buffer).passId + 1 >= m_passId
+         || buffer->isInUse(DxvkAccess::Write)
+         || totalSize >= MaxBytesPerPass)
+          continue;
+
+        // The buffer may be in the process of being destroyed,
+        // in which case it will unregister itself shortly.
+        if (!buffer->tryIncRef())
+          continue;
+
+        result.push_back(buffer);
+        buffer->decRef();
+
+        totalSize += buffer->info().size;
+      }
+    }
+
+    // If no movable buffers remain, wait for previously relocated
+    // buffers to release their old storage. If the chunk does not
+    // get freed anyway, the remaining allocations are not buffers
+    // that we can move, so keep using it instead of wasting memory.
+    if (chunk != m_chunk || anyFound) {
+      m_chunk       = chunk;
+      m_emptyPasses = 0;
+    } else if (++m_emptyPasses == MaxEmptyPasses) {
+      m_memAlloc->cancelEvacuation(chunk);
+    }
+
+    return result;
+  }
+
+
+  void DxvkMemoryDefrag::addChunkBuffer(
+    const DxvkMemoryChunk*      chunk,
+          DxvkBuffer*           buffer) {
+    if (chunk != nullptr)
+      m_chunkBuffers[chunk].insert(buffer);
+  }
+
+
+  void DxvkMemoryDefrag::removeChunkBuffer(
+    const DxvkMemoryChunk*      chunk,
+          DxvkBuffer*           buffer) {
+    auto entry = m_chunkBuffers.find(chunk);
+
+    if (entry == m_chunkBuffers.end())
+      return;
+
+    entry->second.erase(buffer);
+
+    if (entry->second.empty())
+      m_chunkBuffers.erase(entry);
+  }
+
+
+  bool DxvkMemoryDefrag::isGpuIdle() {
+    auto time = Clock::now();
+
+    uint64_t idleTicks = m_device->getStatCounters().getCtr(DxvkStatCounter::GpuIdleTicks);
+    uint64_t timeTicks = std::chrono::duration_cast<std::chrono::microseconds>(time - m_prevTime).count();
+
+    uint64_t idleDiff = idleTicks - m_prevIdleTicks;
+
+    m_prevIdleTicks = idleTicks;
+    m_prevTime      = time;
+
+    return idleDiff * 100 >= timeTicks * MinIdlePercent;
+  }
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dxvk_buffer.h"
+
+namespace dxvk {
+
+  class DxvkDevice;
+
+  /**
+   * \brief Memory defragmenter
+   * 
+   * Keeps track of device-local buffers and picks the ones
+   * that should be moved out of the memory chunk currently
+   * being evacuated, so that the chunk can be freed once it
+   * is empty. Buffers are only moved while the GPU has been
+   * idle for some time, and only a limited amount of memory
+   * is moved at a time, in order to not cause stutter.
+   */
+  class DxvkMemoryDefrag {
+    constexpr static VkDeviceSize MaxBytesPerPass = 16ull << 20;
+    constexpr static uint32_t     MinIdlePercent  = 25;
+    constexpr static uint32_t     MaxEmptyPasses  = 16;
+  public:
+
+    DxvkMemoryDefrag(
+            DxvkDevice*           device,
+            DxvkMemoryAllocator&  memAlloc);
+
+    ~DxvkMemoryDefrag();
+
+    /**
+     * \brief Registers a buffer
+     * 
+     * Must be called when creating a buffer
+     * that may be relocated at some point.
+     * \param [in] buffer The buffer
+     */
+    void registerBuffer(
+            DxvkBuffer*           buffer);
+
+    /**
+     * \brief Unregisters a buffer
+     * 
+     * Must be called before destroying a
+     * buffer that has been registered.
+     * \param [in] buffer The buffer
+     */
+    void unregisterBuffer(
+            DxvkBuffer*           buffer);
+
+    /**
+     * \brief Updates the memory chunk of a buffer
+     * 
+     * Must be called after a registered buffer
+     * has been moved to a different chunk.
+     * \param [in] buffer The buffer
+     */
+    void updateBuffer(
+            DxvkBuffer*           buffer);
+
+    /**
+     * \brief Picks buffers to relocate
+     * 
+     * Should be called once per frame on the thread that owns
+     * the context used to relocate the buffers. Returns an
+     * empty list if the GPU was busy since the last call or
+     * if there is nothing to defragment. If the chunk being
+     * evacuated does not become empty after all its buffers
+     * have been moved, evacuation of that chunk is cancelled.
+     * \returns Buffers to relocate
+     */
+    std::vector<Rc<DxvkBuffer>> pickBuffers();
+
+  private:
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    DxvkDevice*             m_device;
+    DxvkMemoryAllocator*    m_memAlloc;
+
+    struct BufferInfo {
+      uint64_t                passId;
+      const DxvkMemoryChunk*  chunk;
+    };
+
+    std::mutex              m_mutex;
+
+    std::unordered_map<DxvkBuffer*, BufferInfo> m_buffers;
+
+    std::unordered_map<
+      const DxvkMemoryChunk*,
+      std::unordered_set<DxvkBuffer*>> m_chunkBuffers;
+
+    uint64_t                m_passId        = 0;
+
+    const DxvkMemoryChunk*  m_chunk         = nullptr;
+    uint32_t                m_emptyPasses   = 0;
+
+    uint64_t                m_prevIdleTicks = 0;
+    Clock::time_point       m_prevTime;
+
+    bool isGpuIdle();
+
+    void addChunkBuffer(
+      const DxvkMemoryChunk*      chunk,
+            DxvkBuffer*           buffer);
+
+    void removeChunkBuffer(
+      const DxvkMemoryChunk*      chunk,
+            DxvkBuffer*           buffer);
+
+  };
+
+}
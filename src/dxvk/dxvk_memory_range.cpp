@@ -0,0 +1,226 @@
+#include "dxvk_memory_range.h"
+
+namespace dxvk {
+
+  DxvkMemoryRangeAllocator::DxvkMemoryRangeAllocator(VkDeviceSize size)
+  : m_size(size) {
+    m_lists.fill(InvalidRange);
+
+    // Mark the entire block as free
+    this->insertFreeRange(0, size);
+  }
+
+
+  DxvkMemoryRangeAllocator::~DxvkMemoryRangeAllocator() {
+
+  }
+
+
+  VkDeviceSize DxvkMemoryRangeAllocator::maxFreeRangeSize() const {
+    if (!m_flMask)
+      return 0;
+
+    // All ranges in the highest non-empty list are larger
+    // than any other range, but they are not sorted
+    uint32_t fl = bit::bsr(m_flMask);
+    uint32_t sl = bit::bsr(uint64_t(m_slMasks[fl]));
+
+    VkDeviceSize result = 0;
+
+    for (uint32_t id = m_lists[fl * SlCount + sl]; id != InvalidRange; id = m_ranges[id].next)
+      result = std::max(result, m_ranges[id].size);
+
+    return result;
+  }
+
+
+  bool DxvkMemoryRangeAllocator::alloc(
+          VkDeviceSize          size,
+          VkDeviceSize          align,
+          VkDeviceSize&         offset) {
+    uint32_t rangeId = this->findFreeRange(size);
+
+    // The range we found is large enough to hold the
+    // allocation, but may not be once we align it. In
+    // that case, look for a range that is guaranteed
+    // to be large enough regardless of its alignment.
+    if (rangeId != InvalidRange && align > 1) {
+      const Range& range = m_ranges[rangeId];
+
+      if (dxvk::align(range.offset, align) + size > range.offset + range.size)
+        rangeId = this->findFreeRange(size + align - 1);
+    }
+
+    if (rangeId == InvalidRange)
+      return false;
+
+    Range range = m_ranges[rangeId];
+    this->removeFreeRange(rangeId);
+
+    // Return the unused parts of the range to the free lists
+    const VkDeviceSize rangeEnd   = range.offset + range.size;
+    const VkDeviceSize allocStart = dxvk::align(range.offset, align);
+    const VkDeviceSize allocEnd   = allocStart + size;
+
+    if (allocStart != range.offset)
+      this->insertFreeRange(range.offset, allocStart - range.offset);
+
+    if (allocEnd != rangeEnd)
+      this->insertFreeRange(allocEnd, rangeEnd - allocEnd);
+
+    offset = allocStart;
+    return true;
+  }
+
+
+  void DxvkMemoryRangeAllocator::free(
+          VkDeviceSize          offset,
+          VkDeviceSize          size) {
+    // Merge the range with adjacent free ranges, so that
+    // the memory can be reused for larger allocations
+    auto prev = m_freeByEnd.find(offset);
+
+    if (prev != m_freeByEnd.end()) {
+      uint32_t prevId = prev->second;
+
+      offset -= m_ranges[prevId].size;
+      size   += m_ranges[prevId].size;
+
+      this->removeFreeRange(prevId);
+    }
+
+    auto next = m_freeByStart.find(offset + size);
+
+    if (next != m_freeByStart.end()) {
+      uint32_t nextId = next->second;
+
+      size += m_ranges[nextId].size;
+
+      this->removeFreeRange(nextId);
+    }
+
+    this->insertFreeRange(offset, size);
+  }
+
+
+  uint32_t DxvkMemoryRangeAllocator::findList(
+          VkDeviceSize          size) const {
+    // Round the size up to the next list boundary, so that
+    // any range in the resulting list is large enough.
+    if (size < SmallSize)
+      size += SmallSize / SlCount - 1;
+    else
+      size += (VkDeviceSize(1) << (bit::bsr(size) - SlBits)) - 1;
+
+    return getListId(size);
+  }
+
+
+  uint32_t DxvkMemoryRangeAllocator::findFreeRange(
+          VkDeviceSize          size) const {
+    uint32_t listId = this->findList(size);
+
+    uint32_t fl = listId / SlCount;
+    uint32_t sl = listId % SlCount;
+
+    if (fl >= FlCount)
+      return InvalidRange;
+
+    uint32_t slMask = m_slMasks[fl] & (~0u << sl);
+
+    if (!slMask) {
+      uint64_t flMask = m_flMask & (~uint64_t(0) << (fl + 1));
+
+      if (!flMask)
+        return InvalidRange;
+
+      fl     = bit::tzcnt(flMask);
+      slMask = m_slMasks[fl];
+    }
+
+    sl = bit::tzcnt(slMask);
+    return m_lists[fl * SlCount + sl];
+  }
+
+
+  void DxvkMemoryRangeAllocator::insertFreeRange(
+          VkDeviceSize          offset,
+          VkDeviceSize          size) {
+    uint32_t rangeId;
+
+    if (!m_unusedRanges.empty()) {
+      rangeId = m_unusedRanges.back();
+      m_unusedRanges.pop_back();
+    } else {
+      rangeId = uint32_t(m_ranges.size());
+      m_ranges.emplace_back();
+    }
+
+    uint32_t listId = getListId(size);
+
+    Range& range = m_ranges[rangeId];
+    range.offset = offset;
+    range.size   = size;
+    range.prev   = InvalidRange;
+    range.next   = m_lists[listId];
+    range.listId = listId;
+
+    if (range.next != InvalidRange)
+      m_ranges[range.next].prev = rangeId;
+
+    m_lists[listId] = rangeId;
+
+    m_slMasks[listId / SlCount] |= 1u << (listId % SlCount);
+    m_flMask |= uint64_t(1) << (listId / SlCount);
+
+    m_freeByStart.insert({ offset,        rangeId });
+    m_freeByEnd  .insert({ offset + size, rangeId });
+
+    m_freeSize += size;
+  }
+
+
+  void DxvkMemoryRangeAllocator::removeFreeRange(
+          uint32_t              rangeId) {
+    const Range& range = m_ranges[rangeId];
+
+    if (range.prev != InvalidRange)
+      m_ranges[range.prev].next = range.next;
+    else
+      m_lists[range.listId] = range.next;
+
+    if (range.next != InvalidRange)
+      m_ranges[range.next].prev = range.prev;
+
+    if (m_lists[range.listId] == InvalidRange) {
+      uint32_t fl = range.listId / SlCount;
+      uint32_t sl = range.listId % SlCount;
+
+      m_slMasks[fl] &= ~(1u << sl);
+
+      if (!m_slMasks[fl])
+        m_flMask &= ~(uint64_t(1) << fl);
+    }
+
+    m_freeByStart.erase(range.offset);
+    m_freeByEnd  .erase(range.offset + range.size);
+
+    m_freeSize -= range.size;
+    m_unusedRanges.push_back(rangeId);
+  }
+
+
+  uint32_t DxvkMemoryRangeAllocator::getListId(
+          VkDeviceSize          size) {
+    if (size < SmallSize)
+      return uint32_t(size / (SmallSize / SlCount));
+
+    uint32_t msb = bit::bsr(size);
+
+    uint32_t fl = msb - FlShift + 1;
+    uint32_t sl = uint32_t(size >> (msb - SlBits)) & (SlCount - 1);
+
+    return fl * SlCount + sl;
+  }
+
+}
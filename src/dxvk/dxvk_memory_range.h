@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "../util/util_bit.h"
+
+#include "dxvk_include.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Memory range allocator
+   *
+   * Sub-allocates ranges from a block of memory of a
+   * fixed size, using a two-level segregated fit scheme.
+   * Free ranges are sorted into lists by size class, and
+   * bit masks are used to find a non-empty list which is
+   * large enough, so that allocations run in constant time.
+   * Free ranges are also indexed by their start and end
+   * offsets, so that they can be merged with neighbouring
+   * ranges as soon as they are freed.
+   *
+   * Only manages offsets and never touches the underlying
+   * memory, so this can be used and tested on its own.
+   * This class is not thread-safe.
+   */
+  class DxvkMemoryRangeAllocator {
+    constexpr static uint32_t SlBits  = 4;
+    constexpr static uint32_t SlCount = 1u << SlBits;
+    constexpr static uint32_t FlShift = SlBits + 4;
+    constexpr static uint32_t FlCount = 64 - FlShift + 1;
+
+    constexpr static VkDeviceSize SmallSize = VkDeviceSize(1) << FlShift;
+
+    constexpr static uint32_t InvalidRange = ~0u;
+  public:
+
+    DxvkMemoryRangeAllocator(VkDeviceSize size);
+    ~DxvkMemoryRangeAllocator();
+
+    /**
+     * \brief Total size of the managed memory
+     * \returns Memory size, in bytes
+     */
+    VkDeviceSize size() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Amount of free memory
+     * \returns Free memory, in bytes
+     */
+    VkDeviceSize freeSize() const {
+      return m_freeSize;
+    }
+
+    /**
+     * \brief Number of free ranges
+     * \returns Free range count
+     */
+    size_t freeRangeCount() const {
+      return m_freeByStart.size();
+    }
+
+    /**
+     * \brief Size of the largest free range
+     *
+     * Does not take alignment into account, so this
+     * is an upper bound for the largest allocation
+     * that may succeed.
+     * \returns Largest free range, in bytes
+     */
+    VkDeviceSize maxFreeRangeSize() const;
+
+    /**
+     * \brief Iterates over free ranges
+     *
+     * Ranges are visited in no particular order.
+     * \param [in] fn Function that takes the offset
+     *    and size of each free range
+     */
+    template<typename Fn>
+    void forEachFreeRange(const Fn& fn) const {
+      for (const auto& entry : m_freeByStart) {
+        const Range& range = m_ranges[entry.second];
+        fn(range.offset, range.size);
+      }
+    }
+
+    /**
+     * \brief Allocates a range
+     *
+     * \param [in] size Number of bytes to allocate
+     * \param [in] align Required alignment, must
+     *    be a power of two
+     * \param [out] offset Offset of the range
+     * \returns \c true on success, \c false if
+     *    no suitable free range exists
+     */
+    bool alloc(
+            VkDeviceSize          size,
+            VkDeviceSize          align,
+            VkDeviceSize&         offset);
+
+    /**
+     * \brief Frees a range
+     *
+     * The range must have been allocated from
+     * this allocator with the same size.
+     * \param [in] offset Range offset
+     * \param [in] size Range size
+     */
+    void free(
+            VkDeviceSize          offset,
+            VkDeviceSize          size);
+
+  private:
+
+    struct Range {
+      VkDeviceSize offset;
+      VkDeviceSize size;
+      uint32_t     prev;
+      uint32_t     next;
+      uint32_t     listId;
+    };
+
+    VkDeviceSize m_size;
+    VkDeviceSize m_freeSize = 0;
+
+    std::vector<Range>    m_ranges;
+    std::vector<uint32_t> m_unusedRanges;
+
+    std::unordered_map<VkDeviceSize, uint32_t> m_freeByStart;
+    std::unordered_map<VkDeviceSize, uint32_t> m_freeByEnd;
+
+    uint64_t                                    m_flMask = 0;
+    std::array<uint32_t, FlCount>               m_slMasks = { };
+    std::array<uint32_t, FlCount * SlCount>     m_lists;
+
+    uint32_t findList(
+            VkDeviceSize          size) const;
+
+    uint32_t findFreeRange(
+            VkDeviceSize          size) const;
+
+    void insertFreeRange(
+            VkDeviceSize          offset,
+            VkDeviceSize          size);
+
+    void removeFreeRange(
+            uint32_t              rangeId);
+
+    static uint32_t getListId(
+            VkDeviceSize          size);
+
+  };
+
+}
@@ -4,6 +4,9 @@ namespace dxvk {
 
   DxvkOptions::DxvkOptions(const Config& config) {
     enableStateCache      = config.getOption<bool>    ("dxvk.enableStateCache",       true);
+    enableShaderCache     = config.getOption<bool>    ("dxvk.enableShaderCache",      false);
+    enableMemoryDefrag    = config.getOption<bool>    ("dxvk.enableMemoryDefrag",     false);
+    enableBufferArena     = config.getOption<bool>    ("dxvk.enableBufferArena",      true);
     enableTransferQueue   = config.getOption<bool>    ("dxvk.enableTransferQueue",    true);
     numCompilerThreads    = config.getOption<int32_t> ("dxvk.numCompilerThreads",     0);
     asyncPresent          = config.getOption<Tristate>("dxvk.asyncPresent",           Tristate::Auto);
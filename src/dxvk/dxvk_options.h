@@ -11,6 +11,15 @@ namespace dxvk {
     /// Enable state cache
     bool enableStateCache;
 
+    /// Enable persistent shader cache
+    bool enableShaderCache;
+
+    /// Move buffers out of sparse memory chunks
+    bool enableMemoryDefrag;
+
+    /// Sub-allocate small host-visible buffers
+    bool enableBufferArena;
+
     /// Use transfer queue if available
     bool enableTransferQueue;
 
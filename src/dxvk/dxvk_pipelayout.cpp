@@ -116,8 +116,11 @@ namespace dxvk {
         m_dynamicSlots.push_back(i);
       
       m_descriptorTypes.set(bindingInfos[i].type);
+      m_descriptorCounts.descriptors[bindingInfos[i].type] += 1;
     }
     
+    m_descriptorCounts.sets = 1;
+    
     // Create descriptor set layout. We do not need to
     // create one if there are no active resource bindings.
     if (bindingCount > 0) {
@@ -1,11 +1,51 @@
 #pragma once
 
+#include <array>
 #include <vector>
 
 #include "dxvk_include.h"
 
 namespace dxvk {
 
+  /**
+   * \brief Number of descriptor types used by DXVK
+   * 
+   * All descriptor types that DXVK uses have
+   * values smaller than this, so that they
+   * can be used as array indices directly.
+   */
+  constexpr uint32_t DxvkDescriptorTypeCount = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC + 1;
+  
+  /**
+   * \brief Descriptor counts
+   * 
+   * Number of descriptor sets and the number of
+   * descriptors of each type. Used to describe
+   * both the requirements of a descriptor set
+   * layout and the capacity or the usage of a
+   * descriptor pool.
+   */
+  struct DxvkDescriptorCounts {
+    uint32_t sets = 0;
+    std::array<uint32_t, DxvkDescriptorTypeCount> descriptors = { };
+    
+    void add(const DxvkDescriptorCounts& other) {
+      sets += other.sets;
+      
+      for (uint32_t i = 0; i < DxvkDescriptorTypeCount; i++)
+        descriptors[i] += other.descriptors[i];
+    }
+    
+    bool operator == (const DxvkDescriptorCounts& other) const {
+      return sets == other.sets && descriptors == other.descriptors;
+    }
+    
+    bool operator != (const DxvkDescriptorCounts& other) const {
+      return !this->operator == (other);
+    }
+  };
+  
+
   /**
    * \brief Resource slot
    * 
@@ -231,6 +271,18 @@ namespace dxvk {
       return this->binding(m_dynamicSlots[id]);
     }
     
+    /**
+     * \brief Descriptor counts
+     * 
+     * Number of descriptors of each type that a
+     * single descriptor set of this layout uses.
+     * The set count is always one.
+     * \returns Descriptor counts for one set
+     */
+    const DxvkDescriptorCounts& descriptorCounts() const {
+      return m_descriptorCounts;
+    }
+    
     /**
      * \brief Checks for static buffer bindings
      * 
@@ -275,6 +327,7 @@ namespace dxvk {
     std::vector<uint32_t>           m_dynamicSlots;
 
     Flags<VkDescriptorType>         m_descriptorTypes;
+    DxvkDescriptorCounts            m_descriptorCounts;
     
   };
   
@@ -26,17 +26,27 @@ namespace dxvk {
     if (shaders.cs == nullptr)
       return nullptr;
     
-    std::lock_guard<std::mutex> lock(m_mutex);
+    DxvkComputePipeline* pipeline;
+
+    { std::lock_guard<std::mutex> lock(m_mutex);
     
-    auto pair = m_computePipelines.find(shaders);
-    if (pair != m_computePipelines.end())
-      return &pair->second;
+      auto pair = m_computePipelines.find(shaders);
+      if (pair != m_computePipelines.end())
+        return &pair->second;
     
-    auto iter = m_computePipelines.emplace(
-      std::piecewise_construct,
-      std::tuple(shaders),
-      std::tuple(this, shaders));
-    return &iter.first->second;
+      auto iter = m_computePipelines.emplace(
+        std::piecewise_construct,
+        std::tuple(shaders),
+        std::tuple(this, shaders));
+      pipeline = &iter.first->second;
+    }
+
+    // Pipelines for shaders that are about to be used should
+    // be compiled before anything else in the state cache
+    if (m_stateCache != nullptr)
+      m_stateCache->prioritizePipelines(shaders);
+
+    return pipeline;
   }
   
   
@@ -45,17 +55,25 @@ namespace dxvk {
     if (shaders.vs == nullptr)
       return nullptr;
     
-    std::lock_guard<std::mutex> lock(m_mutex);
+    DxvkGraphicsPipeline* pipeline;
+
+    { std::lock_guard<std::mutex> lock(m_mutex);
     
-    auto pair = m_graphicsPipelines.find(shaders);
-    if (pair != m_graphicsPipelines.end())
-      return &pair->second;
+      auto pair = m_graphicsPipelines.find(shaders);
+      if (pair != m_graphicsPipelines.end())
+        return &pair->second;
     
-    auto iter = m_graphicsPipelines.emplace(
-      std::piecewise_construct,
-      std::tuple(shaders),
-      std::tuple(this, shaders));
-    return &iter.first->second;
+      auto iter = m_graphicsPipelines.emplace(
+        std::piecewise_construct,
+        std::tuple(shaders),
+        std::tuple(this, shaders));
+      pipeline = &iter.first->second;
+    }
+
+    if (m_stateCache != nullptr)
+      m_stateCache->prioritizePipelines(shaders);
+
+    return pipeline;
   }
 
   
@@ -66,10 +84,26 @@ namespace dxvk {
   }
 
 
+  bool DxvkPipelineManager::compileGraphicsPipeline(
+    const DxvkGraphicsPipelineShaders&    shaders,
+    const DxvkGraphicsPipelineStateInfo&  state,
+    const DxvkRenderPass*                 renderPass) {
+    if (m_stateCache == nullptr)
+      return false;
+
+    m_stateCache->compilePipeline(shaders, state, renderPass);
+    return true;
+  }
+
+
   DxvkPipelineCount DxvkPipelineManager::getPipelineCount() const {
     DxvkPipelineCount result;
     result.numComputePipelines  = m_numComputePipelines.load();
     result.numGraphicsPipelines = m_numGraphicsPipelines.load();
+
+    if (m_stateCache != nullptr)
+      m_stateCache->getQueueStats(result);
+
     return result;
   }
 
@@ -15,11 +15,19 @@ namespace dxvk {
    * \brief Pipeline count
    * 
    * Stores number of graphics and
-   * compute pipelines, individually.
+   * compute pipelines, individually,
+   * as well as state cache compiler
+   * queue statistics. Wait times are
+   * accumulated over all work items
+   * that have left the queue.
    */
   struct DxvkPipelineCount {
     uint32_t numGraphicsPipelines;
     uint32_t numComputePipelines;
+    uint32_t numQueuedPipelines       = 0;
+    uint32_t numPrioritizedPipelines  = 0;
+    uint32_t numDequeuedPipelines     = 0;
+    uint64_t queueWaitTimeUs          = 0;
   };
   
   
@@ -78,6 +86,21 @@ namespace dxvk {
     void registerShader(
       const Rc<DxvkShader>&         shader);
     
+    /**
+     * \brief Compiles a graphics pipeline asynchronously
+     * 
+     * Queues the pipeline on the state cache's compiler
+     * threads, ahead of pipelines loaded from the cache.
+     * \param [in] shaders Shaders for the pipeline
+     * \param [in] state Pipeline state vector
+     * \param [in] renderPass The render pass
+     * \returns \c false if there are no compiler threads
+     */
+    bool compileGraphicsPipeline(
+      const DxvkGraphicsPipelineShaders&    shaders,
+      const DxvkGraphicsPipelineStateInfo&  state,
+      const DxvkRenderPass*                 renderPass);
+    
     /**
      * \brief Retrieves total pipeline count
      * \returns Number of compute/graphics pipelines
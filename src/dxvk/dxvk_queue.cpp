@@ -3,6 +3,37 @@
 
 namespace dxvk {
   
+  DxvkPendingCommandList::DxvkPendingCommandList() {
+
+  }
+
+
+  DxvkPendingCommandList::~DxvkPendingCommandList() {
+
+  }
+
+
+  void DxvkPendingCommandList::complete(Rc<DxvkCommandList>&& cmdList) {
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      m_cmdList = std::move(cmdList);
+      m_done    = true;
+    }
+
+    m_cond.notify_all();
+  }
+
+
+  Rc<DxvkCommandList> DxvkPendingCommandList::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_cond.wait(lock, [this] {
+      return m_done;
+    });
+
+    return m_cmdList;
+  }
+
+
   DxvkSubmissionQueue::DxvkSubmissionQueue(DxvkDevice* device)
   : m_device(device),
     m_submitThread([this] () { submitCmdLists(); }),
@@ -85,6 +116,23 @@ namespace dxvk {
   }
 
 
+  bool DxvkSubmissionQueue::waitForResource(
+    const Rc<DxvkResource>&   resource,
+          DxvkAccess          access) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Resources are released before the finish condition
+    // gets signaled, so we cannot miss a wake-up here. If
+    // nothing is pending, the resource is being used by a
+    // command list that has not been submitted yet.
+    m_finishCond.wait(lock, [this, &resource, access] {
+      return !resource->isInUse(access) || !m_pending.load();
+    });
+
+    return !resource->isInUse(access);
+  }
+
+
   void DxvkSubmissionQueue::lockDeviceQueue() {
     m_mutexQueue.lock();
   }
@@ -111,6 +159,11 @@ namespace dxvk {
       DxvkSubmitEntry entry = std::move(m_submitQueue.front());
       lock.unlock();
 
+      // Command lists recorded on worker threads may not be
+      // ready yet, but must be submitted in queue order
+      if (entry.submit.pending != nullptr)
+        entry.submit.cmdList = entry.submit.pending->wait();
+
       // Submit command buffer to device
       VkResult status = VK_NOT_READY;
 
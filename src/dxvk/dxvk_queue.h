@@ -25,16 +25,60 @@ namespace dxvk {
   };
 
 
+  /**
+   * \brief Pending command list
+   * 
+   * Placeholder for a command list that is still being
+   * recorded on another thread. This allows reserving
+   * a position in the submission queue before the
+   * command list itself is available.
+   */
+  class DxvkPendingCommandList : public RcObject {
+
+  public:
+
+    DxvkPendingCommandList();
+    ~DxvkPendingCommandList();
+
+    /**
+     * \brief Provides the recorded command list
+     * 
+     * Must be called exactly once, even if recording
+     * failed, since the submission thread will wait
+     * for the command list to become available.
+     * \param [in] cmdList The command list
+     */
+    void complete(Rc<DxvkCommandList>&& cmdList);
+
+    /**
+     * \brief Waits for the command list
+     * \returns The recorded command list
+     */
+    Rc<DxvkCommandList> wait();
+
+  private:
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    Rc<DxvkCommandList>     m_cmdList;
+    bool                    m_done = false;
+
+  };
+
+
   /**
    * \brief Queue submission info
    * 
-   * Stores parameters used to submit
-   * a command buffer to the device.
+   * Stores parameters used to submit a command
+   * buffer to the device. If \c pending is set,
+   * the command list will be retrieved from it
+   * right before submission.
    */
   struct DxvkSubmitInfo {
-    Rc<DxvkCommandList> cmdList;
-    VkSemaphore         waitSync;
-    VkSemaphore         wakeSync;
+    Rc<DxvkCommandList>         cmdList;
+    Rc<DxvkPendingCommandList>  pending;
+    VkSemaphore                 waitSync;
+    VkSemaphore                 wakeSync;
   };
   
   
@@ -154,6 +198,23 @@ namespace dxvk {
      */
     void synchronize();
 
+    /**
+     * \brief Waits for a resource to become idle
+     *
+     * Blocks until the resource is no longer in use for
+     * the given access type. The calling thread sleeps
+     * until a command list finishes execution, so the
+     * command list using the resource must have been
+     * submitted already.
+     * \param [in] resource The resource to wait for
+     * \param [in] access Access type to wait for
+     * \returns \c false if the resource is still in use
+     *    while there are no more pending submissions
+     */
+    bool waitForResource(
+      const Rc<DxvkResource>&   resource,
+            DxvkAccess          access);
+
     /**
      * \brief Locks device queue
      *
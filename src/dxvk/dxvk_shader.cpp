@@ -41,56 +41,40 @@ namespace dxvk {
 
 
   DxvkShaderModule::DxvkShaderModule()
-  : m_vkd(nullptr), m_stage() {
+  : m_stage() {
 
   }
 
 
-  DxvkShaderModule::DxvkShaderModule(DxvkShaderModule&& other)
-  : m_vkd(std::move(other.m_vkd)) {
-    this->m_stage = other.m_stage;
-    other.m_stage = VkPipelineShaderStageCreateInfo();
-  }
-
-
   DxvkShaderModule::DxvkShaderModule(
-    const Rc<vk::DeviceFn>&     vkd,
-    const Rc<DxvkShader>&       shader,
-    const SpirvCodeBuffer&      code)
-  : m_vkd(vkd), m_stage() {
+          VkShaderStageFlagBits       stage,
+    const Rc<DxvkCachedShaderModule>& module)
+  : m_module(module), m_stage() {
     m_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     m_stage.pNext = nullptr;
     m_stage.flags = 0;
-    m_stage.stage = shader->stage();
-    m_stage.module = VK_NULL_HANDLE;
+    m_stage.stage = stage;
+    m_stage.module = module->handle();
     m_stage.pName = "main";
     m_stage.pSpecializationInfo = nullptr;
-
-    VkShaderModuleCreateInfo info;
-    info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    info.pNext    = nullptr;
-    info.flags    = 0;
-    info.codeSize = code.size();
-    info.pCode    = code.data();
-    
-    if (m_vkd->vkCreateShaderModule(m_vkd->device(), &info, nullptr, &m_stage.module) != VK_SUCCESS)
-      throw DxvkError("DxvkComputePipeline::DxvkComputePipeline: Failed to create shader module");
   }
   
   
   DxvkShaderModule::~DxvkShaderModule() {
-    if (m_vkd != nullptr) {
-      m_vkd->vkDestroyShaderModule(
-        m_vkd->device(), m_stage.module, nullptr);
-    }
+
   }
-  
-  
-  DxvkShaderModule& DxvkShaderModule::operator = (DxvkShaderModule&& other) {
-    this->m_vkd   = std::move(other.m_vkd);
-    this->m_stage = other.m_stage;
-    other.m_stage = VkPipelineShaderStageCreateInfo();
-    return *this;
+
+
+  DxvkCachedShaderModule::DxvkCachedShaderModule(
+    const Rc<vk::DeviceFn>&     vkd,
+          VkShaderModule        module)
+  : m_vkd(vkd), m_module(module) {
+
+  }
+
+
+  DxvkCachedShaderModule::~DxvkCachedShaderModule() {
+    m_vkd->vkDestroyShaderModule(m_vkd->device(), m_module, nullptr);
   }
 
 
@@ -115,8 +99,10 @@ namespace dxvk {
     for (auto ins : code) {
       if (ins.opCode() == spv::OpDecorate) {
         if (ins.arg(2) == spv::DecorationBinding
-         || ins.arg(2) == spv::DecorationSpecId)
+         || ins.arg(2) == spv::DecorationSpecId) {
           m_idOffsets.push_back(ins.offset() + 3);
+          m_idValues.push_back(ins.arg(3));
+        }
         
         if (ins.arg(2) == spv::DecorationLocation && ins.arg(3) == 1) {
           m_o1LocOffset = ins.offset() + 3;
@@ -134,7 +120,7 @@ namespace dxvk {
   
   
   DxvkShader::~DxvkShader() {
-    
+
   }
   
   
@@ -164,21 +150,69 @@ namespace dxvk {
     const Rc<vk::DeviceFn>&          vkd,
     const DxvkDescriptorSlotMapping& mapping,
     const DxvkShaderModuleCreateInfo& info) {
+    DxvkShaderModuleKey key;
+    key.bindingIds.resize(m_idValues.size());
+    key.fsDualSrcBlend = info.fsDualSrcBlend && m_o1IdxOffset && m_o1LocOffset;
+
+    // Remap resource binding IDs
+    for (size_t i = 0; i < m_idValues.size(); i++) {
+      key.bindingIds[i] = m_idValues[i] < MaxNumResourceSlots
+        ? mapping.getBindingId(m_idValues[i])
+        : m_idValues[i];
+    }
+
+    // Pipelines may be compiled on multiple threads, so
+    // creating the module while holding the lock ensures
+    // that we do not create the same module twice.
+    std::lock_guard<std::mutex> lock(m_moduleMutex);
+
+    // Keep the most recently used module at the end
+    // of the list, so that we evict the oldest one.
+    for (size_t i = 0; i < m_modules.size(); i++) {
+      if (m_modules[i].first.eq(key)) {
+        std::rotate(m_modules.begin() + i, m_modules.begin() + i + 1, m_modules.end());
+        return DxvkShaderModule(m_stage, m_modules.back().second);
+      }
+    }
+
+    Rc<DxvkCachedShaderModule> module = new DxvkCachedShaderModule(
+      vkd, createVkModule(vkd, key));
+
+    if (m_modules.size() == MaxCachedModules)
+      m_modules.erase(m_modules.begin());
+
+    m_modules.push_back({ std::move(key), module });
+    return DxvkShaderModule(m_stage, module);
+  }
+
+
+  VkShaderModule DxvkShader::createVkModule(
+    const Rc<vk::DeviceFn>&           vkd,
+    const DxvkShaderModuleKey&        key) const {
     SpirvCodeBuffer spirvCode = m_code.decompress();
     uint32_t* code = spirvCode.data();
     
-    // Remap resource binding IDs
-    for (uint32_t ofs : m_idOffsets) {
-      if (code[ofs] < MaxNumResourceSlots)
-        code[ofs] = mapping.getBindingId(code[ofs]);
-    }
+    for (size_t i = 0; i < m_idOffsets.size(); i++)
+      code[m_idOffsets[i]] = key.bindingIds[i];
 
     // For dual-source blending we need to re-map
     // location 1, index 0 to location 0, index 1
-    if (info.fsDualSrcBlend && m_o1IdxOffset && m_o1LocOffset)
+    if (key.fsDualSrcBlend)
       std::swap(code[m_o1IdxOffset], code[m_o1LocOffset]);
     
-    return DxvkShaderModule(vkd, this, spirvCode);
+    VkShaderModuleCreateInfo info;
+    info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.pNext    = nullptr;
+    info.flags    = 0;
+    info.codeSize = spirvCode.size();
+    info.pCode    = spirvCode.data();
+    
+    VkShaderModule module = VK_NULL_HANDLE;
+
+    if (vkd->vkCreateShaderModule(vkd->device(), &info, nullptr, &module) != VK_SUCCESS)
+      throw DxvkError("DxvkShader: Failed to create shader module");
+    
+    return module;
   }
   
   
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <vector>
 
 #include "dxvk_include.h"
@@ -109,6 +110,58 @@ namespace dxvk {
   struct DxvkShaderModuleCreateInfo {
     bool fsDualSrcBlend;
   };
+
+
+  /**
+   * \brief Shader module key
+   *
+   * Stores the remapped binding IDs of a shader
+   * as well as any other state that affects the
+   * patched code, so that identical modules can
+   * be shared between pipelines.
+   */
+  struct DxvkShaderModuleKey {
+    std::vector<uint32_t> bindingIds;
+    bool                  fsDualSrcBlend;
+
+    bool eq(const DxvkShaderModuleKey& other) const {
+      return this->bindingIds     == other.bindingIds
+          && this->fsDualSrcBlend == other.fsDualSrcBlend;
+    }
+  };
+
+
+  /**
+   * \brief Cached shader module
+   *
+   * Owns a Vulkan shader module. Modules evicted from
+   * a shader's module cache remain valid until all
+   * pipelines being compiled with them are done.
+   */
+  class DxvkCachedShaderModule : public RcObject {
+
+  public:
+
+    DxvkCachedShaderModule(
+      const Rc<vk::DeviceFn>&     vkd,
+            VkShaderModule        module);
+
+    ~DxvkCachedShaderModule();
+
+    /**
+     * \brief Vulkan shader module
+     * \returns Shader module handle
+     */
+    VkShaderModule handle() const {
+      return m_module;
+    }
+
+  private:
+
+    Rc<vk::DeviceFn>  m_vkd;
+    VkShaderModule    m_module;
+
+  };
   
   
   /**
@@ -120,6 +173,7 @@ namespace dxvk {
    * needs to be created from he shader object.
    */
   class DxvkShader : public RcObject {
+    constexpr static size_t MaxCachedModules = 4;
     
   public:
     
@@ -164,10 +218,23 @@ namespace dxvk {
     void defineResourceSlots(
             DxvkDescriptorSlotMapping& mapping) const;
     
+    /**
+     * \brief Resource slot definitions
+     * \returns Resource slots used by the shader
+     */
+    const std::vector<DxvkResourceSlot>& resourceSlots() const {
+      return m_slots;
+    }
+    
     /**
      * \brief Creates a shader module
      * 
-     * Maps the binding slot numbers 
+     * Maps the binding slot numbers to the binding IDs
+     * of the given mapping. The most recently used modules
+     * are cached, so that pipelines which use the same
+     * shader with the same mapping share one Vulkan shader
+     * module. The cache is kept small since each module
+     * holds an uncompressed copy of the code in the driver.
      * \param [in] vkd Vulkan device functions
      * \param [in] mapping Resource slot mapping
      * \param [in] info Module create info
@@ -217,6 +284,17 @@ namespace dxvk {
      */
     void dump(std::ostream& outputStream) const;
     
+    /**
+     * \brief Retrieves SPIR-V code
+     * 
+     * Decompresses the unmodified SPIR-V code,
+     * without remapping any binding IDs.
+     * \returns Uncompressed SPIR-V code
+     */
+    SpirvCodeBuffer getCode() const {
+      return m_code.decompress();
+    }
+    
     /**
      * \brief Sets the shader key
      * \param [in] key Unique key
@@ -273,6 +351,7 @@ namespace dxvk {
     
     std::vector<DxvkResourceSlot> m_slots;
     std::vector<size_t>           m_idOffsets;
+    std::vector<uint32_t>         m_idValues;
     DxvkInterfaceSlots            m_interface;
     DxvkShaderOptions             m_options;
     DxvkShaderConstData           m_constData;
@@ -284,15 +363,26 @@ namespace dxvk {
     size_t m_o1IdxOffset = 0;
     size_t m_o1LocOffset = 0;
 
+    std::mutex                    m_moduleMutex;
+
+    std::vector<std::pair<
+      DxvkShaderModuleKey,
+      Rc<DxvkCachedShaderModule>>> m_modules;
+
+    VkShaderModule createVkModule(
+      const Rc<vk::DeviceFn>&           vkd,
+      const DxvkShaderModuleKey&        key) const;
+
   };
   
 
   /**
    * \brief Shader module object
    * 
-   * Manages a Vulkan shader module. This will not
-   * perform any shader compilation. Instead, the
-   * context will create pipeline objects on the
+   * References a cached Vulkan shader module and
+   * keeps it alive while it is being used. This
+   * will not perform any shader compilation. Instead,
+   * the context will create pipeline objects on the
    * fly when executing draw calls.
    */
   class DxvkShaderModule {
@@ -301,16 +391,11 @@ namespace dxvk {
 
     DxvkShaderModule();
 
-    DxvkShaderModule(DxvkShaderModule&& other);
-    
     DxvkShaderModule(
-      const Rc<vk::DeviceFn>&     vkd,
-      const Rc<DxvkShader>&       shader,
-      const SpirvCodeBuffer&      code);
+            VkShaderStageFlagBits       stage,
+      const Rc<DxvkCachedShaderModule>& module);
     
     ~DxvkShaderModule();
-
-    DxvkShaderModule& operator = (DxvkShaderModule&& other);
     
     /**
      * \brief Shader stage creation info
@@ -335,7 +420,7 @@ namespace dxvk {
     
   private:
     
-    Rc<vk::DeviceFn>                m_vkd;
+    Rc<DxvkCachedShaderModule>      m_module;
     VkPipelineShaderStageCreateInfo m_stage;
     
   };
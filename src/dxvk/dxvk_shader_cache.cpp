@@ -0,0 +1,439 @@
+#include <algorithm>
+
+#include <version.h>
+
+#include "dxvk_shader_cache.h"
+
+namespace dxvk {
+
+  constexpr static size_t g_pendingEntry = ~size_t(0);
+
+
+  /**
+   * \brief Packed entry header
+   *
+   * Precedes the serialized shader data of
+   * each entry. The hash is computed over
+   * the serialized data only.
+   */
+  struct DxvkShaderCacheEntryHeader {
+    DxvkShaderCacheKey  key;
+    uint32_t            size;
+    Sha1Hash            hash;
+  };
+
+
+  /**
+   * \brief Serialized shader reader
+   *
+   * Reads shader data from a memory range,
+   * with bounds checking on every access.
+   */
+  class DxvkShaderCacheReader {
+
+  public:
+
+    DxvkShaderCacheReader(const char* data, size_t size)
+    : m_data(data), m_size(size) { }
+
+    template<typename T>
+    bool read(T& data) {
+      return readArray(1, &data);
+    }
+
+    template<typename T>
+    bool readArray(size_t count, T* data) {
+      size_t size = count * sizeof(T);
+
+      if (m_read + size > m_size)
+        return false;
+
+      std::memcpy(data, &m_data[m_read], size);
+      m_read += size;
+      return true;
+    }
+
+    bool atEnd() const {
+      return m_read == m_size;
+    }
+
+  private:
+
+    const char* m_data;
+    size_t      m_size;
+    size_t      m_read = 0;
+
+  };
+
+
+  /**
+   * \brief Serialized shader writer
+   */
+  class DxvkShaderCacheWriter {
+
+  public:
+
+    template<typename T>
+    void write(const T& data) {
+      writeArray(1, &data);
+    }
+
+    template<typename T>
+    void writeArray(size_t count, const T* data) {
+      auto ptr = reinterpret_cast<const char*>(data);
+      m_data.insert(m_data.end(), ptr, ptr + count * sizeof(T));
+    }
+
+    const char* data() const {
+      return m_data.data();
+    }
+
+    size_t size() const {
+      return m_data.size();
+    }
+
+  private:
+
+    std::vector<char> m_data;
+
+  };
+
+
+  bool DxvkShaderCacheKey::eq(const DxvkShaderCacheKey& key) const {
+    return this->shader.eq(key.shader)
+        && this->variant == key.variant;
+  }
+
+
+  size_t DxvkShaderCacheKey::hash() const {
+    DxvkHashState hash;
+    hash.add(this->shader.hash());
+
+    for (uint32_t i = 0; i < 5; i++)
+      hash.add(this->variant.dword(i));
+
+    return hash;
+  }
+
+
+  DxvkShaderCache::DxvkShaderCache() {
+    if (!readCacheFile()) {
+      Logger::warn("DXVK: Creating new shader cache file");
+
+      std::ofstream file(getCacheFileName(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
+
+      if (!file && env::createDirectory(getCacheDir())) {
+        file = std::ofstream(getCacheFileName(),
+          std::ios_base::binary |
+          std::ios_base::trunc);
+      }
+
+      DxvkShaderCacheHeader header;
+      header.build = getBuildHash();
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+      // Keep all entries that were read successfully in
+      // case we are recovering from a truncated file
+      size_t validSize = sizeof(header);
+
+      for (const auto& e : m_entries)
+        validSize = std::max(validSize, e.second.offset + e.second.size);
+
+      if (validSize > sizeof(header)) {
+        file.write(&m_fileData[sizeof(header)],
+          validSize - sizeof(header));
+      }
+    }
+
+    m_writerThread = dxvk::thread([this] () { writerFunc(); });
+  }
+
+
+  DxvkShaderCache::~DxvkShaderCache() {
+    { std::lock_guard<std::mutex> lock(m_writerLock);
+      m_stopThreads.store(true);
+      m_writerCond.notify_one();
+    }
+
+    m_writerThread.join();
+  }
+
+
+  Rc<DxvkShader> DxvkShaderCache::lookup(
+    const DxvkShaderCacheKey&       key) {
+    Entry entry;
+
+    { std::lock_guard<std::mutex> lock(m_entryLock);
+
+      auto e = m_entries.find(key);
+
+      if (e == m_entries.end() || e->second.offset == g_pendingEntry)
+        return nullptr;
+
+      entry = e->second;
+    }
+
+    // The file data is never modified after the constructor
+    // has run, so we can safely read it without the lock
+    Rc<DxvkShader> shader = readCacheEntry(entry);
+
+    if (shader == nullptr) {
+      Logger::warn(str::format("DXVK: Invalid shader cache entry for ", key.shader.toString()));
+
+      // Remove the entry so that the shader
+      // will be written to the file again
+      std::lock_guard<std::mutex> lock(m_entryLock);
+      m_entries.erase(key);
+      return nullptr;
+    }
+
+    shader->setShaderKey(key.shader);
+    return shader;
+  }
+
+
+  void DxvkShaderCache::add(
+    const DxvkShaderCacheKey&       key,
+    const Rc<DxvkShader>&           shader) {
+    { std::lock_guard<std::mutex> lock(m_entryLock);
+
+      Entry entry = { g_pendingEntry, 0, Sha1Hash() };
+
+      if (!m_entries.insert({ key, entry }).second)
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_writerLock);
+    m_writerQueue.push({ key, shader });
+    m_writerCond.notify_one();
+  }
+
+
+  bool DxvkShaderCache::readCacheFile() {
+    std::ifstream ifile(getCacheFileName(), std::ios_base::binary);
+
+    if (!ifile) {
+      Logger::warn("DXVK: No shader cache file found");
+      return false;
+    }
+
+    // Read the entire file at once, lookups
+    // will then just copy data out of it
+    ifile.seekg(0, std::ios_base::end);
+    size_t fileSize = size_t(ifile.tellg());
+    ifile.seekg(0, std::ios_base::beg);
+
+    m_fileData.resize(fileSize);
+
+    if (!ifile.read(m_fileData.data(), fileSize)) {
+      Logger::warn("DXVK: Failed to read shader cache file");
+      m_fileData.clear();
+      return false;
+    }
+
+    DxvkShaderCacheHeader expected;
+    expected.build = getBuildHash();
+
+    DxvkShaderCacheHeader header;
+
+    if (fileSize < sizeof(header)) {
+      Logger::warn("DXVK: Failed to read shader cache header");
+      m_fileData.clear();
+      return false;
+    }
+
+    std::memcpy(&header, m_fileData.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic))
+     || header.version != expected.version
+     || header.build   != expected.build) {
+      Logger::warn("DXVK: Shader cache version not supported");
+      m_fileData.clear();
+      return false;
+    }
+
+    // Build the index. Entries are only validated on
+    // the first lookup in order to keep startup fast.
+    // Later entries for the same key take precedence.
+    size_t offset = sizeof(header);
+
+    while (offset + sizeof(DxvkShaderCacheEntryHeader) <= fileSize) {
+      DxvkShaderCacheEntryHeader entryHeader;
+      std::memcpy(&entryHeader, &m_fileData[offset], sizeof(entryHeader));
+
+      Entry entry;
+      entry.offset = offset + sizeof(entryHeader);
+      entry.size   = entryHeader.size;
+      entry.hash   = entryHeader.hash;
+
+      if (entry.offset + entry.size > fileSize)
+        break;
+
+      m_entries[entryHeader.key] = entry;
+      offset = entry.offset + entry.size;
+    }
+
+    Logger::info(str::format("DXVK: Read ", m_entries.size(), " shader cache entries"));
+
+    if (offset != fileSize) {
+      Logger::warn("DXVK: Shader cache file truncated");
+      return false;
+    }
+
+    return true;
+  }
+
+
+  Rc<DxvkShader> DxvkShaderCache::readCacheEntry(
+    const Entry&                    entry) const {
+    const char* data = &m_fileData[entry.offset];
+
+    if (entry.hash != Sha1Hash::compute(data, entry.size))
+      return nullptr;
+
+    DxvkShaderCacheReader reader(data, entry.size);
+
+    VkShaderStageFlagBits stage;
+    DxvkInterfaceSlots    iface;
+    DxvkShaderOptions     options;
+    uint32_t              slotCount  = 0;
+    uint32_t              constCount = 0;
+    uint32_t              codeCount  = 0;
+
+    if (!reader.read(stage)
+     || !reader.read(iface)
+     || !reader.read(options)
+     || !reader.read(slotCount))
+      return nullptr;
+
+    std::vector<DxvkResourceSlot> slots(slotCount);
+
+    if (!reader.readArray(slotCount, slots.data())
+     || !reader.read(constCount))
+      return nullptr;
+
+    std::vector<uint32_t> constData(constCount);
+
+    if (!reader.readArray(constCount, constData.data())
+     || !reader.read(codeCount))
+      return nullptr;
+
+    SpirvCodeBuffer code(codeCount);
+
+    if (!reader.readArray(codeCount, code.data())
+     || !reader.atEnd())
+      return nullptr;
+
+    return new DxvkShader(stage,
+      slots.size(), slots.data(), iface,
+      std::move(code), options, constCount
+        ? DxvkShaderConstData(constData.size(), constData.data())
+        : DxvkShaderConstData());
+  }
+
+
+  void DxvkShaderCache::writeCacheEntry(
+          std::ostream&             stream,
+    const WriterItem&               item) const {
+    DxvkShaderCacheWriter writer;
+
+    const auto& slots     = item.shader->resourceSlots();
+    const auto& constData = item.shader->shaderConstants();
+    SpirvCodeBuffer code  = item.shader->getCode();
+
+    writer.write(item.shader->stage());
+    writer.write(item.shader->interfaceSlots());
+    writer.write(item.shader->shaderOptions());
+
+    writer.write(uint32_t(slots.size()));
+    writer.writeArray(slots.size(), slots.data());
+
+    writer.write(uint32_t(constData.sizeInBytes() / sizeof(uint32_t)));
+    writer.writeArray(constData.sizeInBytes() / sizeof(uint32_t), constData.data());
+
+    writer.write(uint32_t(code.dwords()));
+    writer.writeArray(code.dwords(), code.data());
+
+    // General layout: key -> size -> hash -> data
+    DxvkShaderCacheEntryHeader header;
+    header.key  = item.key;
+    header.size = writer.size();
+    header.hash = Sha1Hash::compute(writer.data(), writer.size());
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(writer.data(), writer.size());
+    stream.flush();
+  }
+
+
+  void DxvkShaderCache::writerFunc() {
+    env::setThreadName("dxvk-shader-writer");
+
+    std::ofstream file;
+
+    while (true) {
+      WriterItem item;
+
+      { std::unique_lock<std::mutex> lock(m_writerLock);
+
+        m_writerCond.wait(lock, [this] () {
+          return m_writerQueue.size()
+              || m_stopThreads.load();
+        });
+
+        // Drain the queue before exiting so that shaders
+        // compiled right before shutdown are not lost
+        if (m_writerQueue.size() == 0)
+          break;
+
+        item = std::move(m_writerQueue.front());
+        m_writerQueue.pop();
+      }
+
+      if (!file) {
+        file = std::ofstream(getCacheFileName(),
+          std::ios_base::binary |
+          std::ios_base::app);
+      }
+
+      writeCacheEntry(file, item);
+    }
+  }
+
+
+  std::string DxvkShaderCache::getCacheFileName() const {
+    std::string path = getCacheDir();
+
+    if (!path.empty() && *path.rbegin() != '/')
+      path += '/';
+
+    std::string exeName = env::getExeName();
+    auto extp = exeName.find_last_of('.');
+
+    if (extp != std::string::npos && exeName.substr(extp + 1) == "exe")
+      exeName.erase(extp);
+
+    path += exeName + ".dxvk-shaders";
+    return path;
+  }
+
+
+  std::string DxvkShaderCache::getCacheDir() const {
+    std::string path = env::getEnvVar("DXVK_SHADER_CACHE_PATH");
+
+    if (path.empty())
+      path = env::getEnvVar("DXVK_STATE_CACHE_PATH");
+
+    return path;
+  }
+
+
+  Sha1Hash DxvkShaderCache::getBuildHash() {
+    const char* version = DXVK_VERSION;
+    return Sha1Hash::compute(version, std::strlen(version));
+  }
+
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "dxvk_shader.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Shader cache key
+   *
+   * Identifies a compiled shader. In addition to the
+   * shader key, this stores a hash of all the options
+   * that the client API passed to its shader compiler,
+   * since those can affect the generated SPIR-V code.
+   */
+  struct DxvkShaderCacheKey {
+    DxvkShaderKey shader;
+    Sha1Hash      variant;
+
+    bool eq(const DxvkShaderCacheKey& key) const;
+
+    size_t hash() const;
+  };
+
+
+  /**
+   * \brief Shader cache header
+   *
+   * Stores the shader cache format version as well
+   * as a hash of the DXVK version that wrote the
+   * file, since the generated code may change
+   * between versions even if the format does not.
+   */
+  struct DxvkShaderCacheHeader {
+    char     magic[4]   = { 'D', 'X', 'S', 'C' };
+    uint32_t version    = 1;
+    Sha1Hash build;
+  };
+
+  static_assert(sizeof(DxvkShaderCacheHeader) == 28);
+
+
+  /**
+   * \brief Shader cache
+   *
+   * Persistently stores shaders compiled by the client
+   * API so that subsequent runs of an application can
+   * skip shader compilation entirely. The cache file is
+   * read into memory in one go and indexed on startup,
+   * so that looking up a shader only requires a hash
+   * lookup and a copy of the serialized shader data.
+   * New shaders are appended to the file on a separate
+   * thread. This class is thread-safe.
+   */
+  class DxvkShaderCache : public RcObject {
+
+  public:
+
+    DxvkShaderCache();
+
+    ~DxvkShaderCache();
+
+    /**
+     * \brief Looks up a shader
+     *
+     * Validates and deserializes the shader. Entries
+     * that are corrupted are treated as a cache miss.
+     * \param [in] key Shader cache key
+     * \returns The shader, or \c nullptr if not cached
+     */
+    Rc<DxvkShader> lookup(
+      const DxvkShaderCacheKey&       key);
+
+    /**
+     * \brief Adds a shader to the cache
+     *
+     * If the shader is not already cached, this will queue
+     * it to be written to the cache file. The shader key
+     * will be set to the one stored in the cache key.
+     * \param [in] key Shader cache key
+     * \param [in] shader The shader
+     */
+    void add(
+      const DxvkShaderCacheKey&       key,
+      const Rc<DxvkShader>&           shader);
+
+  private:
+
+    struct Entry {
+      size_t    offset;
+      size_t    size;
+      Sha1Hash  hash;
+    };
+
+    struct WriterItem {
+      DxvkShaderCacheKey  key;
+      Rc<DxvkShader>      shader;
+    };
+
+    std::vector<char>                 m_fileData;
+
+    std::mutex                        m_entryLock;
+
+    std::unordered_map<
+      DxvkShaderCacheKey, Entry,
+      DxvkHash, DxvkEq> m_entries;
+
+    std::atomic<bool>                 m_stopThreads = { false };
+
+    std::mutex                        m_writerLock;
+    std::condition_variable           m_writerCond;
+    std::queue<WriterItem>            m_writerQueue;
+    dxvk::thread                      m_writerThread;
+
+    bool readCacheFile();
+
+    Rc<DxvkShader> readCacheEntry(
+      const Entry&                    entry) const;
+
+    void writeCacheEntry(
+            std::ostream&             stream,
+      const WriterItem&               item) const;
+
+    void writerFunc();
+
+    std::string getCacheFileName() const;
+
+    std::string getCacheDir() const;
+
+    static Sha1Hash getBuildHash();
+
+  };
+
+}
@@ -66,5 +66,68 @@ namespace dxvk {
       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
   }
+
+
+  DxvkStagingRing::DxvkStagingRing(const Rc<DxvkDevice>& device)
+  : m_device(device) {
+
+  }
+
+
+  DxvkStagingRing::~DxvkStagingRing() {
+
+  }
+
+
+  DxvkBufferSlice DxvkStagingRing::alloc(VkDeviceSize align, VkDeviceSize size) {
+    if (size > MaxAllocSize) {
+      Rc<DxvkBuffer> buffer = createBuffer(size);
+      buffer->acquire(DxvkAccess::Read);
+      return DxvkBufferSlice(buffer);
+    }
+
+    if (m_buffer == nullptr)
+      m_buffer = createBuffer(BufferSize);
+    
+    // The buffer is only idle once all slices have
+    // been released and the GPU no longer reads it
+    if (!m_buffer->isInUse())
+      m_offset = 0;
+    
+    m_offset = dxvk::align(m_offset, align);
+
+    if (m_offset + size > BufferSize) {
+      m_offset = 0;
+
+      if (m_buffers.size() < MaxBufferCount)
+        m_buffers.push(std::move(m_buffer));
+
+      if (!m_buffers.front()->isInUse()) {
+        m_buffer = std::move(m_buffers.front());
+        m_buffers.pop();
+      } else {
+        m_buffer = createBuffer(BufferSize);
+      }
+    }
+
+    m_buffer->acquire(DxvkAccess::Read);
+
+    DxvkBufferSlice slice(m_buffer, m_offset, size);
+    m_offset = dxvk::align(m_offset + size, align);
+    return slice;
+  }
+
+
+  Rc<DxvkBuffer> DxvkStagingRing::createBuffer(VkDeviceSize size) {
+    DxvkBufferCreateInfo info;
+    info.size   = size;
+    info.usage  = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    info.access = VK_ACCESS_TRANSFER_READ_BIT;
+
+    return m_device->createBuffer(info,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  }
   
 }
@@ -52,5 +52,63 @@ namespace dxvk {
     Rc<DxvkBuffer> createBuffer(VkDeviceSize size);
 
   };
+
+
+  /**
+   * \brief Staging buffer ring
+   *
+   * Allocates slices of persistently mapped buffers
+   * which the caller writes data to directly, so that
+   * uploads do not need an intermediate copy. Unlike
+   * \ref DxvkStagingDataAlloc, this is meant to be used
+   * on a thread that records commands for a different
+   * thread, so each allocated slice keeps its buffer
+   * marked as in use until the caller releases it.
+   */
+  class DxvkStagingRing {
+    constexpr static VkDeviceSize BufferSize     = 1 << 22; // 4 MiB
+    constexpr static VkDeviceSize MaxAllocSize   = 1 << 20; // 1 MiB
+    constexpr static uint32_t     MaxBufferCount = 4;
+  public:
+
+    DxvkStagingRing(const Rc<DxvkDevice>& device);
+
+    ~DxvkStagingRing();
+
+    /**
+     * \brief Allocates a staging buffer slice
+     *
+     * Large allocations get a dedicated buffer. In either
+     * case, the buffer is acquired for reading, and the
+     * caller must call \ref release once it has recorded
+     * all commands reading from the slice, so that the
+     * memory does not get reused before the GPU is done.
+     * \param [in] align Alignment of the allocation
+     * \param [in] size Size of the allocation
+     * \returns Mapped staging buffer slice
+     */
+    DxvkBufferSlice alloc(VkDeviceSize align, VkDeviceSize size);
+
+    /**
+     * \brief Releases a staging buffer slice
+     *
+     * May be called from any thread.
+     * \param [in] slice Slice returned by \ref alloc
+     */
+    static void release(const DxvkBufferSlice& slice) {
+      slice.buffer()->release(DxvkAccess::Read);
+    }
+
+  private:
+
+    Rc<DxvkDevice>  m_device;
+    Rc<DxvkBuffer>  m_buffer;
+    VkDeviceSize    m_offset = 0;
+
+    std::queue<Rc<DxvkBuffer>> m_buffers;
+
+    Rc<DxvkBuffer> createBuffer(VkDeviceSize size);
+
+  };
   
 }
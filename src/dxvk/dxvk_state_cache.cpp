@@ -8,92 +8,6 @@ namespace dxvk {
   static const DxvkShaderKey  g_nullShaderKey = DxvkShaderKey();
 
 
-  /**
-   * \brief Packed entry header
-   */
-  struct DxvkStateCacheEntryHeader {
-    uint32_t stageMask : 8;
-    uint32_t entrySize : 24;
-  };
-
-  
-  /**
-   * \brief State cache entry data
-   *
-   * Stores data for a single cache entry and
-   * provides convenience methods to access it.
-   */
-  class DxvkStateCacheEntryData {
-    constexpr static size_t MaxSize = 1024;
-  public:
-
-    size_t size() const {
-      return m_size;
-    }
-
-    const char* data() const {
-      return m_data;
-    }
-
-    Sha1Hash computeHash() const {
-      return Sha1Hash::compute(m_data, m_size);
-    }
-
-    template<typename T>
-    bool read(T& data) {
-      if (m_read + sizeof(T) > m_size)
-        return false;
-      
-      std::memcpy(&data, &m_data[m_read], sizeof(T));
-      m_read += sizeof(T);
-      return true;
-    }
-
-    template<typename T>
-    bool write(const T& data) {
-      if (m_size + sizeof(T) > MaxSize)
-        return false;
-      
-      std::memcpy(&m_data[m_size], &data, sizeof(T));
-      m_size += sizeof(T);
-      return true;
-    }
-
-    bool readFromStream(std::istream& stream, size_t size) {
-      if (size > MaxSize)
-        return false;
-
-      if (!stream.read(m_data, size))
-        return false;
-
-      m_size = size;
-      m_read = 0;
-      return true;
-    }
-
-  private:
-
-    size_t m_size = 0;
-    size_t m_read = 0;
-    char   m_data[MaxSize];
-
-  };
-
-
-  template<typename T>
-  bool readCacheEntryTyped(std::istream& stream, T& entry) {
-    auto data = reinterpret_cast<char*>(&entry);
-    auto size = sizeof(entry);
-
-    if (!stream.read(data, size))
-      return false;
-    
-    Sha1Hash expectedHash = std::exchange(entry.hash, g_nullHash);
-    Sha1Hash computedHash = Sha1Hash::compute(entry);
-    return expectedHash == computedHash;
-  }
-
-
   bool DxvkStateCacheKey::eq(const DxvkStateCacheKey& key) const {
     return this->vs.eq(key.vs)
         && this->tcs.eq(key.tcs)
@@ -122,35 +36,7 @@ namespace dxvk {
           DxvkRenderPassPool*   passManager)
   : m_pipeManager(pipeManager),
     m_passManager(passManager) {
-    bool newFile = !readCacheFile();
-
-    if (newFile) {
-      Logger::warn("DXVK: Creating new state cache file");
-
-      // Start with an empty file
-      std::ofstream file(getCacheFileName(),
-        std::ios_base::binary |
-        std::ios_base::trunc);
-
-      if (!file && env::createDirectory(getCacheDir())) {
-        file = std::ofstream(getCacheFileName(),
-          std::ios_base::binary |
-          std::ios_base::trunc);
-      }
-
-      // Write header with the current version number
-      DxvkStateCacheHeader header;
-
-      auto data = reinterpret_cast<const char*>(&header);
-      auto size = sizeof(header);
-
-      file.write(data, size);
-
-      // Write all valid entries to the cache file in
-      // case we're recovering a corrupted cache file
-      for (auto& e : m_entries)
-        writeCacheEntry(file, e);
-    }
+    m_fileValid = readCacheFile();
 
     // Use half the available CPU cores for pipeline compilation
     uint32_t numCpuCores = dxvk::thread::hardware_concurrency();
@@ -166,11 +52,14 @@ namespace dxvk {
     
     Logger::info(str::format("DXVK: Using ", numWorkers, " compiler threads"));
     
-    // Start the worker threads and the file writer
+    // Start the worker threads and the file writer. Each
+    // worker has its own queue that others can steal from.
+    m_workerQueues = std::make_unique<WorkerQueue[]>(numWorkers);
+    m_workerCount  = numWorkers;
     m_workerBusy.store(numWorkers);
 
     for (uint32_t i = 0; i < numWorkers; i++) {
-      m_workerThreads.emplace_back([this] () { workerFunc(); });
+      m_workerThreads.emplace_back([this, i] () { workerFunc(i); });
 
       // TODO: better solution for this.
 #ifndef DXVK_NATIVE
@@ -207,11 +96,7 @@ namespace dxvk {
       return;
     
     // Do not add an entry that is already in the cache
-    auto entries = m_entryMap.equal_range(shaders);
-
-    for (auto e = entries.first; e != entries.second; e++) {
-      const DxvkStateCacheEntry& entry = m_entries[e->second];
-
+    for (const auto& entry : m_file.getEntries(shaders)) {
       if (entry.format.eq(format) && entry.gpState == state)
         return;
     }
@@ -233,10 +118,8 @@ namespace dxvk {
       return;
 
     // Do not add an entry that is already in the cache
-    auto entries = m_entryMap.equal_range(shaders);
-
-    for (auto e = entries.first; e != entries.second; e++) {
-      if (m_entries[e->second].cpState == state)
+    for (const auto& entry : m_file.getEntries(shaders)) {
+      if (entry.cpState == state)
         return;
     }
 
@@ -264,22 +147,40 @@ namespace dxvk {
     std::unique_lock<std::mutex> workerLock;
 
     auto pipelines = m_pipelineMap.equal_range(key);
+    auto queueTime = WorkerClock::now();
 
     for (auto p = pipelines.first; p != pipelines.second; p++) {
-      WorkerItem item;
-
-      if (!getShaderByKey(p->second.vs,  item.gp.vs)
-       || !getShaderByKey(p->second.tcs, item.gp.tcs)
-       || !getShaderByKey(p->second.tes, item.gp.tes)
-       || !getShaderByKey(p->second.gs,  item.gp.gs)
-       || !getShaderByKey(p->second.fs,  item.gp.fs)
-       || !getShaderByKey(p->second.cs,  item.cp.cs))
+      Rc<WorkerItem> item = new WorkerItem();
+
+      if (!getShaderByKey(p->second.vs,  item->gp.vs)
+       || !getShaderByKey(p->second.tcs, item->gp.tcs)
+       || !getShaderByKey(p->second.tes, item->gp.tes)
+       || !getShaderByKey(p->second.gs,  item->gp.gs)
+       || !getShaderByKey(p->second.fs,  item->gp.fs)
+       || !getShaderByKey(p->second.cs,  item->cp.cs))
         continue;
       
       if (!workerLock)
         workerLock = std::unique_lock<std::mutex>(m_workerLock);
       
-      m_workerQueue.push(item);
+      // The pipeline map stores one entry per state vector,
+      // but one work item compiles all pipelines for a key
+      item->key       = p->second;
+      item->queueTime = queueTime;
+
+      if (!m_workerItems.insert({ item->key, item }).second)
+        continue;
+      
+      // Distribute items across workers in a round-robin
+      // fashion, idle workers will steal them if needed
+      WorkerQueue& queue = m_workerQueues[m_workerNext++ % m_workerCount];
+
+      { std::lock_guard<sync::Spinlock> queueLock(queue.lock);
+        queue.items.push_back(std::move(item));
+      }
+
+      m_statQueued   += 1;
+      m_workerQueued += 1;
     }
 
     if (workerLock)
@@ -287,6 +188,68 @@ namespace dxvk {
   }
 
 
+  void DxvkStateCache::prioritizePipelines(
+    const DxvkGraphicsPipelineShaders&    shaders) {
+    if (!m_workerQueued.load())
+      return;
+
+    DxvkStateCacheKey key;
+    key.vs  = getShaderKey(shaders.vs);
+    key.tcs = getShaderKey(shaders.tcs);
+    key.tes = getShaderKey(shaders.tes);
+    key.gs  = getShaderKey(shaders.gs);
+    key.fs  = getShaderKey(shaders.fs);
+
+    this->prioritizePipelines(key);
+  }
+
+
+  void DxvkStateCache::prioritizePipelines(
+    const DxvkComputePipelineShaders&     shaders) {
+    if (!m_workerQueued.load())
+      return;
+
+    DxvkStateCacheKey key;
+    key.cs  = getShaderKey(shaders.cs);
+
+    this->prioritizePipelines(key);
+  }
+
+
+  void DxvkStateCache::compilePipeline(
+    const DxvkGraphicsPipelineShaders&    shaders,
+    const DxvkGraphicsPipelineStateInfo&  state,
+    const DxvkRenderPass*                 renderPass) {
+    // Items with a render pass compile only that
+    // pipeline and are not tracked by their key
+    Rc<WorkerItem> item = new WorkerItem();
+    item->gp          = shaders;
+    item->gpState     = state;
+    item->renderPass  = renderPass;
+    item->queueTime   = WorkerClock::now();
+    item->prioritized = true;
+
+    std::lock_guard<std::mutex> lock(m_workerLock);
+    m_priorityQueue.push_back(std::move(item));
+
+    m_statQueued      += 1;
+    m_statPrioritized += 1;
+    m_priorityCount   += 1;
+    m_workerQueued    += 1;
+
+    m_workerCond.notify_one();
+  }
+
+
+  void DxvkStateCache::getQueueStats(
+          DxvkPipelineCount&              count) const {
+    count.numQueuedPipelines      = m_statQueued.load();
+    count.numPrioritizedPipelines = m_statPrioritized.load();
+    count.numDequeuedPipelines    = m_statDequeued.load();
+    count.queueWaitTimeUs         = m_statWaitTimeUs.load();
+  }
+
+
   DxvkShaderKey DxvkStateCache::getShaderKey(const Rc<DxvkShader>& shader) const {
     return shader != nullptr ? shader->getShaderKey() : g_nullShaderKey;
   }
@@ -307,13 +270,6 @@ namespace dxvk {
   }
 
 
-  void DxvkStateCache::mapPipelineToEntry(
-    const DxvkStateCacheKey&        key,
-          size_t                    entryId) {
-    m_entryMap.insert({ key, entryId });
-  }
-
-  
   void DxvkStateCache::mapShaderToPipeline(
     const DxvkShaderKey&            shader,
     const DxvkStateCacheKey&        key) {
@@ -323,6 +279,14 @@ namespace dxvk {
 
 
   void DxvkStateCache::compilePipelines(const WorkerItem& item) {
+    if (item.renderPass != nullptr) {
+      auto pipeline = m_pipeManager->createGraphicsPipeline(item.gp);
+
+      if (pipeline != nullptr)
+        pipeline->compilePipeline(item.gpState, item.renderPass);
+      return;
+    }
+
     DxvkStateCacheKey key;
     key.vs  = getShaderKey(item.gp.vs);
     key.tcs = getShaderKey(item.gp.tcs);
@@ -333,587 +297,180 @@ namespace dxvk {
 
     if (item.cp.cs == nullptr) {
       auto pipeline = m_pipeManager->createGraphicsPipeline(item.gp);
-      auto entries = m_entryMap.equal_range(key);
-
-      for (auto e = entries.first; e != entries.second; e++) {
-        const auto& entry = m_entries[e->second];
 
+      for (const auto& entry : m_file.getEntries(key)) {
         auto rp = m_passManager->getRenderPass(entry.format);
         pipeline->compilePipeline(entry.gpState, rp);
       }
     } else {
       auto pipeline = m_pipeManager->createComputePipeline(item.cp);
-      auto entries = m_entryMap.equal_range(key);
 
-      for (auto e = entries.first; e != entries.second; e++) {
-        const auto& entry = m_entries[e->second];
+      for (const auto& entry : m_file.getEntries(key))
         pipeline->compilePipeline(entry.cpState);
-      }
     }
   }
 
 
-  bool DxvkStateCache::readCacheFile() {
-    // Open state file and just fail if it doesn't exist
-    std::ifstream ifile(getCacheFileName(), std::ios_base::binary);
-
-    if (!ifile) {
-      Logger::warn("DXVK: No state cache file found");
-      return false;
-    }
-
-    // The header stores the state cache version,
-    // we need to regenerate it if it's outdated
-    DxvkStateCacheHeader newHeader;
-    DxvkStateCacheHeader curHeader;
-
-    if (!readCacheHeader(ifile, curHeader)) {
-      Logger::warn("DXVK: Failed to read state cache header");
-      return false;
-    }
-
-    // Struct size hasn't changed between v2 and v4
-    size_t expectedSize = newHeader.entrySize;
-
-    if (curHeader.version <= 4)
-      expectedSize = sizeof(DxvkStateCacheEntryV4);
-    else if (curHeader.version <= 5)
-      expectedSize = sizeof(DxvkStateCacheEntryV5);
-    else if (curHeader.version <= 6)
-      expectedSize = sizeof(DxvkStateCacheEntryV6);
-    else if (curHeader.version <= 7)
-      expectedSize = sizeof(DxvkStateCacheEntry);
-
-    if (curHeader.entrySize != expectedSize) {
-      Logger::warn("DXVK: State cache entry size changed");
-      return false;
-    }
-
-    // Discard caches of unsupported versions
-    if (curHeader.version < 2 || curHeader.version > newHeader.version) {
-      Logger::warn("DXVK: State cache version not supported");
-      return false;
-    }
-
-    // Notify user about format conversion
-    if (curHeader.version != newHeader.version)
-      Logger::warn(str::format("DXVK: Updating state cache version to v", newHeader.version));
-
-    // Read actual cache entries from the file.
-    // If we encounter invalid entries, we should
-    // regenerate the entire state cache file.
-    uint32_t numInvalidEntries = 0;
-
-    while (ifile) {
-      DxvkStateCacheEntry entry;
-
-      if (readCacheEntry(curHeader.version, ifile, entry)) {
-        size_t entryId = m_entries.size();
-        m_entries.push_back(entry);
-
-        mapPipelineToEntry(entry.shaders, entryId);
-
-        mapShaderToPipeline(entry.shaders.vs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.tcs, entry.shaders);
-        mapShaderToPipeline(entry.shaders.tes, entry.shaders);
-        mapShaderToPipeline(entry.shaders.gs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.fs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.cs,  entry.shaders);
-      } else if (ifile) {
-        numInvalidEntries += 1;
-      }
-    }
-
-    Logger::info(str::format(
-      "DXVK: Read ", m_entries.size(),
-      " valid state cache entries"));
+  void DxvkStateCache::prioritizePipelines(
+    const DxvkStateCacheKey&        key) {
+    std::lock_guard<std::mutex> lock(m_workerLock);
 
-    if (numInvalidEntries) {
-      Logger::warn(str::format(
-        "DXVK: Skipped ", numInvalidEntries,
-        " invalid state cache entries"));
-      return false;
-    }
-    
-    // Rewrite entire state cache if it is outdated
-    return curHeader.version == newHeader.version;
-  }
+    auto entry = m_workerItems.find(key);
 
+    if (entry == m_workerItems.end() || entry->second->prioritized)
+      return;
 
-  bool DxvkStateCache::readCacheHeader(
-          std::istream&             stream,
-          DxvkStateCacheHeader&     header) const {
-    DxvkStateCacheHeader expected;
+    // The item stays in its worker queue as well, whoever
+    // gets to it first will compile it and the other copy
+    // will be skipped.
+    entry->second->prioritized = true;
+    m_priorityQueue.push_back(entry->second);
 
-    auto data = reinterpret_cast<char*>(&header);
-    auto size = sizeof(header);
+    m_statPrioritized += 1;
+    m_priorityCount   += 1;
+    m_workerQueued    += 1;
 
-    if (!stream.read(data, size))
-      return false;
-    
-    for (uint32_t i = 0; i < 4; i++) {
-      if (expected.magic[i] != header.magic[i])
-        return false;
-    }
-    
-    return true;
+    m_workerCond.notify_one();
   }
 
 
-  bool DxvkStateCache::readCacheEntryV7(
-          uint32_t                  version,
-          std::istream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
-    if (version <= 6) {
-      DxvkStateCacheEntryV6 v6;
+  Rc<DxvkStateCache::WorkerItem> DxvkStateCache::getWorkerItem(
+          uint32_t                  workerId) {
+    Rc<WorkerItem> item;
 
-      if (version <= 4) {
-        DxvkStateCacheEntryV4 v4;
+    // Prioritized items always go first
+    if (m_priorityCount.load()) {
+      std::lock_guard<std::mutex> lock(m_workerLock);
 
-        if (!readCacheEntryTyped(stream, v4))
-          return false;
-
-        if (version == 2)
-          convertEntryV2(v4);
-
-        if (!convertEntryV4(v4, v6))
-          return false;
-      } else if (version <= 5) {
-        DxvkStateCacheEntryV5 v5;
-
-        if (!readCacheEntryTyped(stream, v5))
-          return false;
-
-        if (!convertEntryV5(v5, v6))
-          return false;
-      } else {
-        if (!readCacheEntryTyped(stream, v6))
-          return false;
+      if (!m_priorityQueue.empty()) {
+        item = std::move(m_priorityQueue.front());
+        m_priorityQueue.pop_front();
+        m_priorityCount -= 1;
       }
-
-      return convertEntryV6(v6, entry);
-    } else {
-      return readCacheEntryTyped(stream, entry);
-    }
-  }
-
-
-  bool DxvkStateCache::readCacheEntry(
-          uint32_t                  version,
-          std::istream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
-    if (version < 8)
-      return readCacheEntryV7(version, stream, entry);
-
-    // Read entry metadata and actual data
-    DxvkStateCacheEntryHeader header;
-    DxvkStateCacheEntryData data;
-    Sha1Hash hash;
-  
-    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))
-     || !stream.read(reinterpret_cast<char*>(&hash), sizeof(hash))
-     || !data.readFromStream(stream, header.entrySize))
-      return false;
-
-    // Validate hash, skip entry if invalid
-    if (hash != data.computeHash())
-      return false;
-
-    // Read shader hashes
-    VkShaderStageFlags stageMask = VkShaderStageFlags(header.stageMask);
-    auto keys = &entry.shaders.vs;
-
-    for (uint32_t i = 0; i < 6; i++) {
-      if (stageMask & VkShaderStageFlagBits(1 << i))
-        data.read(keys[i]);
-      else
-        keys[i] = g_nullShaderKey;
     }
 
-    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
-      if (!data.read(entry.cpState.bsBindingMask))
-        return false;
-    } else {
-      // Read packed render pass format
-      uint8_t sampleCount = 0;
-      uint8_t imageFormat = 0;
-      uint8_t imageLayout = 0;
-
-      if (!data.read(sampleCount)
-       || !data.read(imageFormat)
-       || !data.read(imageLayout))
-        return false;
-
-      entry.format.sampleCount = VkSampleCountFlagBits(sampleCount);
-      entry.format.depth.format = VkFormat(imageFormat);
-      entry.format.depth.layout = unpackImageLayout(imageLayout);
-
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(imageFormat)
-         || !data.read(imageLayout))
-          return false;
-
-        entry.format.color[i].format = VkFormat(imageFormat);
-        entry.format.color[i].layout = unpackImageLayout(imageLayout);
-      }
-
-      if (!validateRenderPassFormat(entry.format))
-        return false;
-
-      // Read common pipeline state
-      if (!data.read(entry.gpState.bsBindingMask)
-       || !data.read(entry.gpState.ia)
-       || !data.read(entry.gpState.il)
-       || !data.read(entry.gpState.rs)
-       || !data.read(entry.gpState.ms)
-       || !data.read(entry.gpState.ds)
-       || !data.read(entry.gpState.om)
-       || !data.read(entry.gpState.dsFront)
-       || !data.read(entry.gpState.dsBack))
-        return false;
-
-      if (entry.gpState.il.attributeCount() > MaxNumVertexAttributes
-       || entry.gpState.il.bindingCount() > MaxNumVertexBindings)
-        return false;
-
-      // Read render target swizzles
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(entry.gpState.omSwizzle[i]))
-          return false;
-      }
-
-      // Read render target blend info
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(entry.gpState.omBlend[i]))
-          return false;
-      }
-
-      // Read defined vertex attributes
-      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++) {
-        if (!data.read(entry.gpState.ilAttributes[i]))
-          return false;
-      }
+    // Take items from the front of our own queue, and steal
+    // from the back of other workers' queues if it is empty
+    for (uint32_t i = 0; i < m_workerCount && item == nullptr; i++) {
+      WorkerQueue& queue = m_workerQueues[(workerId + i) % m_workerCount];
+      std::lock_guard<sync::Spinlock> queueLock(queue.lock);
 
-      // Read defined vertex bindings
-      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++) {
-        if (!data.read(entry.gpState.ilBindings[i]))
-          return false;
+      if (!queue.items.empty()) {
+        if (!i) {
+          item = std::move(queue.items.front());
+          queue.items.pop_front();
+        } else {
+          item = std::move(queue.items.back());
+          queue.items.pop_back();
+        }
       }
     }
 
-    // Read non-zero spec constants
-    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
-      ? entry.cpState.sc
-      : entry.gpState.sc;
-
-    uint32_t specConstantMask = 0;
-
-    if (!data.read(specConstantMask))
-      return false;
-
-    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
-      if (specConstantMask & (1 << i)) {
-        if (!data.read(sc.specConstants[i]))
-          return false;
-      }
-    }
+    if (item != nullptr)
+      m_workerQueued -= 1;
 
-    return true;
+    return item;
   }
 
 
-  void DxvkStateCache::writeCacheEntry(
-          std::ostream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
-    DxvkStateCacheEntryData data;
-    VkShaderStageFlags stageMask = 0;
-
-    // Write shader hashes
-    auto keys = &entry.shaders.vs;
-
-    for (uint32_t i = 0; i < 6; i++) {
-      if (!keys[i].eq(g_nullShaderKey)) {
-        stageMask |= VkShaderStageFlagBits(1 << i);
-        data.write(keys[i]);
-      }
-    }
-
-    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
-      // Nothing else here to write out
-      data.write(entry.cpState.bsBindingMask);
-    } else {
-      // Pack render pass format
-      data.write(uint8_t(entry.format.sampleCount));
-      data.write(uint8_t(entry.format.depth.format));
-      data.write(packImageLayout(entry.format.depth.layout));
-
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        data.write(uint8_t(entry.format.color[i].format));
-        data.write(packImageLayout(entry.format.color[i].layout));
-      }
-
-      // Write out common pipeline state
-      data.write(entry.gpState.bsBindingMask);
-      data.write(entry.gpState.ia);
-      data.write(entry.gpState.il);
-      data.write(entry.gpState.rs);
-      data.write(entry.gpState.ms);
-      data.write(entry.gpState.ds);
-      data.write(entry.gpState.om);
-      data.write(entry.gpState.dsFront);
-      data.write(entry.gpState.dsBack);
-
-      // Write out render target swizzles and blend info
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
-        data.write(entry.gpState.omSwizzle[i]);
-
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
-        data.write(entry.gpState.omBlend[i]);
-
-      // Write out input layout for defined attributes
-      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++)
-        data.write(entry.gpState.ilAttributes[i]);
-
-      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++)
-        data.write(entry.gpState.ilBindings[i]);
-    }
-
-    // Write out all non-zero spec constants
-    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
-      ? entry.cpState.sc
-      : entry.gpState.sc;
-
-    uint32_t specConstantMask = 0;
-
-    for (uint32_t i = 0; i < MaxNumSpecConstants; i++)
-      specConstantMask |= sc.specConstants[i] ? (1 << i) : 0;
-
-    data.write(specConstantMask);
+  bool DxvkStateCache::readCacheFile() {
+    // Open state file and just fail if it doesn't exist
+    std::ifstream ifile(getCacheFileName(), std::ios_base::binary);
 
-    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
-      if (specConstantMask & (1 << i))
-        data.write(sc.specConstants[i]);
+    if (!ifile) {
+      Logger::warn("DXVK: No state cache file found");
+      return false;
     }
 
-    // General layout: header -> hash -> data
-    DxvkStateCacheEntryHeader header;
-    header.stageMask = uint8_t(stageMask);
-    header.entrySize = data.size();
-
-    Sha1Hash hash = data.computeHash();
+    if (!m_file.read(ifile))
+      return false;
 
-    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
-    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
-    stream.write(data.data(), data.size());
-    stream.flush();
-  }
+    // Notify user about format conversion
+    DxvkStateCacheHeader newHeader;
 
+    if (m_file.version() != newHeader.version)
+      Logger::warn(str::format("DXVK: Updating state cache version to v", newHeader.version));
 
-  bool DxvkStateCache::convertEntryV2(
-          DxvkStateCacheEntryV4&    entry) const {
-    // Semantics changed:
-    // v2: rsDepthClampEnable
-    // v3: rsDepthClipEnable
-    entry.gpState.rsDepthClipEnable = !entry.gpState.rsDepthClipEnable;
+    // Only the keys are needed to look up pipelines
+    // for a given shader, the actual entries will be
+    // decoded once all shaders become available.
+    m_file.forEachKey([this] (const DxvkStateCacheKey& key) {
+      mapShaderToPipeline(key.vs,  key);
+      mapShaderToPipeline(key.tcs, key);
+      mapShaderToPipeline(key.tes, key);
+      mapShaderToPipeline(key.gs,  key);
+      mapShaderToPipeline(key.fs,  key);
+      mapShaderToPipeline(key.cs,  key);
+    });
 
-    // Frontend changed: Depth bias
-    // will typically be disabled
-    entry.gpState.rsDepthBiasEnable = VK_FALSE;
+    Logger::info(str::format(
+      "DXVK: Read ", m_file.entryCount(),
+      " state cache entries for ", m_file.keyCount(), " pipelines"));
     return true;
   }
 
 
-  bool DxvkStateCache::convertEntryV4(
-    const DxvkStateCacheEntryV4&    in,
-          DxvkStateCacheEntryV6&    out) const {
-    out.shaders = in.shaders;
-    out.format  = in.format;
-    out.hash    = in.hash;
-
-    out.cpState.bsBindingMask           = in.cpState.bsBindingMask;
-    out.gpState.bsBindingMask           = in.gpState.bsBindingMask;
-    
-    out.gpState.iaPrimitiveTopology     = in.gpState.iaPrimitiveTopology;
-    out.gpState.iaPrimitiveRestart      = in.gpState.iaPrimitiveRestart;
-    out.gpState.iaPatchVertexCount      = in.gpState.iaPatchVertexCount;
-    
-    out.gpState.ilAttributeCount        = in.gpState.ilAttributeCount;
-    out.gpState.ilBindingCount          = in.gpState.ilBindingCount;
-
-    for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++)
-      out.gpState.ilAttributes[i]       = in.gpState.ilAttributes[i];
+  void DxvkStateCache::writeCacheFile(
+          std::ofstream&            file) {
+    file = std::ofstream(getCacheFileName(),
+      std::ios_base::binary |
+      std::ios_base::trunc);
 
-    for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
-      out.gpState.ilBindings[i]         = in.gpState.ilBindings[i];
-      out.gpState.ilDivisors[i]         = in.gpState.ilDivisors[i];
+    if (!file && env::createDirectory(getCacheDir())) {
+      file = std::ofstream(getCacheFileName(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
     }
-    
-    out.gpState.rsDepthClipEnable       = in.gpState.rsDepthClipEnable;
-    out.gpState.rsDepthBiasEnable       = in.gpState.rsDepthBiasEnable;
-    out.gpState.rsPolygonMode           = in.gpState.rsPolygonMode;
-    out.gpState.rsCullMode              = in.gpState.rsCullMode;
-    out.gpState.rsFrontFace             = in.gpState.rsFrontFace;
-    out.gpState.rsViewportCount         = in.gpState.rsViewportCount;
-    out.gpState.rsSampleCount           = in.gpState.rsSampleCount;
-    
-    out.gpState.msSampleCount           = in.gpState.msSampleCount;
-    out.gpState.msSampleMask            = in.gpState.msSampleMask;
-    out.gpState.msEnableAlphaToCoverage = in.gpState.msEnableAlphaToCoverage;
-    
-    out.gpState.dsEnableDepthTest       = in.gpState.dsEnableDepthTest;
-    out.gpState.dsEnableDepthWrite      = in.gpState.dsEnableDepthWrite;
-    out.gpState.dsEnableStencilTest     = in.gpState.dsEnableStencilTest;
-    out.gpState.dsDepthCompareOp        = in.gpState.dsDepthCompareOp;
-    out.gpState.dsStencilOpFront        = in.gpState.dsStencilOpFront;
-    out.gpState.dsStencilOpBack         = in.gpState.dsStencilOpBack;
-    
-    out.gpState.omEnableLogicOp         = in.gpState.omEnableLogicOp;
-    out.gpState.omLogicOp               = in.gpState.omLogicOp;
 
-    for (uint32_t i = 0; i < 8; i++) {
-      out.gpState.omBlendAttachments[i] = in.gpState.omBlendAttachments[i];
-      out.gpState.omComponentMapping[i] = in.gpState.omComponentMapping[i];
-    }
+    // Write all valid entries back to the file, this also
+    // drops duplicates and converts outdated cache files
+    size_t entryCount = m_file.write(file);
 
-    return true;
+    Logger::info(str::format("DXVK: Wrote ", entryCount, " state cache entries"));
   }
 
 
-  bool DxvkStateCache::convertEntryV5(
-    const DxvkStateCacheEntryV5&    in,
-          DxvkStateCacheEntryV6&    out) const {
-    out.shaders = in.shaders;
-    out.gpState = in.gpState;
-    out.format  = in.format;
-    out.hash    = in.hash;
-
-    out.cpState.bsBindingMask = in.cpState.bsBindingMask;
-    return true;
-  }
+  void DxvkStateCache::workerFunc(
+          uint32_t                  workerId) {
+    env::setThreadName("dxvk-shader");
 
+    while (!m_stopThreads.load()) {
+      Rc<WorkerItem> item = this->getWorkerItem(workerId);
 
-  bool DxvkStateCache::convertEntryV6(
-    const DxvkStateCacheEntryV6&    in,
-          DxvkStateCacheEntry&      out) const {
-    out.shaders = in.shaders;
-    out.format  = in.format;
-    out.hash    = in.hash;
+      if (item == nullptr) {
+        std::unique_lock<std::mutex> lock(m_workerLock);
 
-    if (in.shaders.cs.eq(g_nullShaderKey)) {
-      // Binding mask
-      out.gpState.bsBindingMask = in.gpState.bsBindingMask;
+        m_workerBusy -= 1;
+        m_workerCond.wait(lock, [this] () {
+          return m_workerQueued.load()
+              || m_stopThreads.load();
+        });
 
-      // Graphics state
-      out.gpState.ia = DxvkIaInfo(
-        in.gpState.iaPrimitiveTopology,
-        in.gpState.iaPrimitiveRestart,
-        in.gpState.iaPatchVertexCount);
-      
-      out.gpState.il = DxvkIlInfo(
-        in.gpState.ilAttributeCount,
-        in.gpState.ilBindingCount);
-      
-      for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++) {
-        out.gpState.ilAttributes[i] = DxvkIlAttribute(
-          in.gpState.ilAttributes[i].location,
-          in.gpState.ilAttributes[i].binding,
-          in.gpState.ilAttributes[i].format,
-          in.gpState.ilAttributes[i].offset);
-      }
-      
-      for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
-        out.gpState.ilBindings[i] = DxvkIlBinding(
-          in.gpState.ilBindings[i].binding,
-          in.gpState.ilBindings[i].stride,
-          in.gpState.ilBindings[i].inputRate,
-          in.gpState.ilDivisors[i]);
-      }
-      
-      out.gpState.rs = DxvkRsInfo(
-        in.gpState.rsDepthClipEnable,
-        in.gpState.rsDepthBiasEnable,
-        in.gpState.rsPolygonMode,
-        in.gpState.rsCullMode,
-        in.gpState.rsFrontFace,
-        in.gpState.rsViewportCount,
-        in.gpState.rsSampleCount);
-
-      out.gpState.ms = DxvkMsInfo(
-        in.gpState.msSampleCount,
-        in.gpState.msSampleMask,
-        in.gpState.msEnableAlphaToCoverage);
-      
-      out.gpState.ds = DxvkDsInfo(
-        in.gpState.dsEnableDepthTest,
-        in.gpState.dsEnableDepthWrite,
-        in.gpState.dsEnableDepthBoundsTest,
-        in.gpState.dsEnableStencilTest,
-        in.gpState.dsDepthCompareOp);
-      
-      out.gpState.dsFront = DxvkDsStencilOp(in.gpState.dsStencilOpFront);
-      out.gpState.dsBack  = DxvkDsStencilOp(in.gpState.dsStencilOpBack);
+        if (m_stopThreads.load())
+          break;
 
-      out.gpState.om = DxvkOmInfo(
-        in.gpState.omEnableLogicOp,
-        in.gpState.omLogicOp);
-      
-      for (uint32_t i = 0; i < 8 && i < MaxNumRenderTargets; i++) {
-        out.gpState.omBlend[i] = DxvkOmAttachmentBlend(
-          in.gpState.omBlendAttachments[i].blendEnable,
-          in.gpState.omBlendAttachments[i].srcColorBlendFactor,
-          in.gpState.omBlendAttachments[i].dstColorBlendFactor,
-          in.gpState.omBlendAttachments[i].colorBlendOp,
-          in.gpState.omBlendAttachments[i].srcAlphaBlendFactor,
-          in.gpState.omBlendAttachments[i].dstAlphaBlendFactor,
-          in.gpState.omBlendAttachments[i].alphaBlendOp,
-          in.gpState.omBlendAttachments[i].colorWriteMask);
-        
-        out.gpState.omSwizzle[i] = DxvkOmAttachmentSwizzle(
-          in.gpState.omComponentMapping[i]);
+        m_workerBusy += 1;
+        continue;
       }
 
-      // Specialization constants
-      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
-        out.cpState.sc.specConstants[i] = in.cpState.scSpecConstants[i];
-    } else {
-      // Binding mask
-      out.cpState.bsBindingMask = in.cpState.bsBindingMask;
-
-      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
-        out.gpState.sc.specConstants[i] = in.gpState.scSpecConstants[i];
-    }
-
-    return true;
-  }
-
-
-  void DxvkStateCache::workerFunc() {
-    env::setThreadName("dxvk-shader");
-
-    while (!m_stopThreads.load()) {
-      WorkerItem item;
-
-      { std::unique_lock<std::mutex> lock(m_workerLock);
+      // Prioritized items are queued twice, only
+      // compile the pipelines for the first one
+      if (item->taken.exchange(true))
+        continue;
 
-        if (m_workerQueue.empty()) {
-          m_workerBusy -= 1;
-          m_workerCond.wait(lock, [this] () {
-            return m_workerQueue.size()
-                || m_stopThreads.load();
-          });
+      if (item->renderPass == nullptr) {
+        std::lock_guard<std::mutex> lock(m_workerLock);
+        m_workerItems.erase(item->key);
+      }
 
-          if (!m_workerQueue.empty())
-            m_workerBusy += 1;
-        }
+      auto waitTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        WorkerClock::now() - item->queueTime);
 
-        if (m_workerQueue.empty())
-          break;
-        
-        item = m_workerQueue.front();
-        m_workerQueue.pop();
-      }
+      m_statQueued     -= 1;
+      m_statDequeued   += 1;
+      m_statWaitTimeUs += waitTime.count();
 
-      compilePipelines(item);
+      compilePipelines(*item);
     }
   }
 
@@ -923,6 +480,17 @@ namespace dxvk {
 
     std::ofstream file;
 
+    // Rewrite the file before appending any new entries
+    // if it does not exist or is not in the v9 format.
+    if (!m_fileValid || m_file.needsCompaction()) {
+      if (m_fileValid)
+        Logger::info("DXVK: Compacting state cache file");
+      else
+        Logger::warn("DXVK: Creating new state cache file");
+
+      writeCacheFile(file);
+    }
+
     while (!m_stopThreads.load()) {
       DxvkStateCacheEntry entry;
 
@@ -940,13 +508,13 @@ namespace dxvk {
         m_writerQueue.pop();
       }
 
-      if (!file) {
+      if (!file.is_open()) {
         file = std::ofstream(getCacheFileName(),
           std::ios_base::binary |
           std::ios_base::app);
       }
 
-      writeCacheEntry(file, entry);
+      DxvkStateCacheFile::appendEntry(file, entry);
     }
   }
 
@@ -972,47 +540,4 @@ namespace dxvk {
     return env::getEnvVar("DXVK_STATE_CACHE_PATH");
   }
 
-
-  uint8_t DxvkStateCache::packImageLayout(
-          VkImageLayout             layout) {
-    switch (layout) {
-      case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL: return 0x80;
-      case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL: return 0x81;
-      default: return uint8_t(layout);
-    }
-  }
-
-
-  VkImageLayout DxvkStateCache::unpackImageLayout(
-          uint8_t                   layout) {
-    switch (layout) {
-      case 0x80: return VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL;
-      case 0x81: return VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
-      default: return VkImageLayout(layout);
-    }
-  }
-
-
-  bool DxvkStateCache::validateRenderPassFormat(
-    const DxvkRenderPassFormat&     format) {
-    bool valid = true;
-
-    if (format.depth.format) {
-      valid &= format.depth.layout == VK_IMAGE_LAYOUT_GENERAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
-    }
-
-    for (uint32_t i = 0; i < MaxNumRenderTargets && valid; i++) {
-      if (format.color[i].format) {
-        valid &= format.color[i].layout == VK_IMAGE_LAYOUT_GENERAL
-              || format.color[i].layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-      }
-    }
-
-    return valid;
-  }
-
 }
@@ -1,13 +1,17 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
 #include <vector>
 
+#include "dxvk_state_cache_file.h"
 #include "dxvk_state_cache_types.h"
 
 namespace dxvk {
@@ -71,6 +75,39 @@ namespace dxvk {
     void registerShader(
       const Rc<DxvkShader>&                 shader);
     
+    /**
+     * \brief Prioritizes pipelines for a set of shaders
+     * 
+     * If pipelines using the given shaders are still
+     * waiting to be compiled, they will be compiled
+     * before any pipelines that were not prioritized.
+     * Called when the shaders are first used together.
+     * \param [in] shaders Pipeline shaders
+     */
+    void prioritizePipelines(
+      const DxvkGraphicsPipelineShaders&    shaders);
+    
+    /**
+     * \brief Prioritizes pipelines for a compute shader
+     * \param [in] shaders Pipeline shaders
+     */
+    void prioritizePipelines(
+      const DxvkComputePipelineShaders&     shaders);
+    
+    /**
+     * \brief Compiles a single graphics pipeline
+     * 
+     * Queues the given pipeline ahead of any pipelines
+     * from the cache file, even if it is not cached.
+     * \param [in] shaders Pipeline shaders
+     * \param [in] state Graphics pipeline state
+     * \param [in] renderPass The render pass
+     */
+    void compilePipeline(
+      const DxvkGraphicsPipelineShaders&    shaders,
+      const DxvkGraphicsPipelineStateInfo&  state,
+      const DxvkRenderPass*                 renderPass);
+    
     /**
      * \brief Checks whether compiler threads are busy
      * \returns \c true if we're compiling shaders
@@ -78,28 +115,49 @@ namespace dxvk {
     bool isCompilingShaders() {
       return m_workerBusy.load() > 0;
     }
+    
+    /**
+     * \brief Queries compiler queue stats
+     * 
+     * Writes the queue depth as well as the number of
+     * prioritized pipelines and the accumulated wait
+     * time of pipelines that have left the queue.
+     * \param [out] count Pipeline count to update
+     */
+    void getQueueStats(
+            DxvkPipelineCount&              count) const;
 
   private:
 
     using WriterItem = DxvkStateCacheEntry;
 
-    struct WorkerItem {
+    using WorkerClock = std::chrono::high_resolution_clock;
+
+    struct WorkerItem : public RcObject {
       DxvkGraphicsPipelineShaders gp;
       DxvkComputePipelineShaders  cp;
+      DxvkStateCacheKey           key;
+      DxvkGraphicsPipelineStateInfo gpState;
+      const DxvkRenderPass*       renderPass  = nullptr;
+      WorkerClock::time_point     queueTime;
+      bool                        prioritized = false;
+      std::atomic<bool>           taken       = { false };
+    };
+
+    struct WorkerQueue {
+      sync::Spinlock              lock;
+      std::deque<Rc<WorkerItem>>  items;
     };
 
     DxvkPipelineManager*              m_pipeManager;
     DxvkRenderPassPool*               m_passManager;
 
-    std::vector<DxvkStateCacheEntry>  m_entries;
+    DxvkStateCacheFile                m_file;
+    bool                              m_fileValid   = false;
     std::atomic<bool>                 m_stopThreads = { false };
 
     std::mutex                        m_entryLock;
 
-    std::unordered_multimap<
-      DxvkStateCacheKey, size_t,
-      DxvkHash, DxvkEq> m_entryMap;
-
     std::unordered_multimap<
       DxvkShaderKey, DxvkStateCacheKey,
       DxvkHash, DxvkEq> m_pipelineMap;
@@ -110,9 +168,24 @@ namespace dxvk {
 
     std::mutex                        m_workerLock;
     std::condition_variable           m_workerCond;
-    std::queue<WorkerItem>            m_workerQueue;
+    std::deque<Rc<WorkerItem>>        m_priorityQueue;
+    std::atomic<uint32_t>             m_priorityCount = { 0u };
+    std::atomic<uint32_t>             m_workerQueued  = { 0u };
     std::atomic<uint32_t>             m_workerBusy;
     std::vector<dxvk::thread>         m_workerThreads;
+    uint32_t                          m_workerCount   = 0;
+    uint32_t                          m_workerNext    = 0;
+
+    std::unique_ptr<WorkerQueue[]>    m_workerQueues;
+
+    std::unordered_map<
+      DxvkStateCacheKey, Rc<WorkerItem>,
+      DxvkHash, DxvkEq> m_workerItems;
+
+    std::atomic<uint32_t>             m_statQueued      = { 0u };
+    std::atomic<uint32_t>             m_statPrioritized = { 0u };
+    std::atomic<uint32_t>             m_statDequeued    = { 0u };
+    std::atomic<uint64_t>             m_statWaitTimeUs  = { 0ull };
 
     std::mutex                        m_writerLock;
     std::condition_variable           m_writerCond;
@@ -126,10 +199,6 @@ namespace dxvk {
       const DxvkShaderKey&            key,
             Rc<DxvkShader>&           shader) const;
     
-    void mapPipelineToEntry(
-      const DxvkStateCacheKey&        key,
-            size_t                    entryId);
-    
     void mapShaderToPipeline(
       const DxvkShaderKey&            shader,
       const DxvkStateCacheKey&        key);
@@ -137,42 +206,19 @@ namespace dxvk {
     void compilePipelines(
       const WorkerItem&               item);
 
+    void prioritizePipelines(
+      const DxvkStateCacheKey&        key);
+
+    Rc<WorkerItem> getWorkerItem(
+            uint32_t                  workerId);
+
     bool readCacheFile();
 
-    bool readCacheHeader(
-            std::istream&             stream,
-            DxvkStateCacheHeader&     header) const;
+    void writeCacheFile(
+            std::ofstream&            file);
 
-    bool readCacheEntryV7(
-            uint32_t                  version,
-            std::istream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
-    
-    bool readCacheEntry(
-            uint32_t                  version,
-            std::istream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
-    
-    void writeCacheEntry(
-            std::ostream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
-    
-    bool convertEntryV2(
-            DxvkStateCacheEntryV4&    entry) const;
-    
-    bool convertEntryV4(
-      const DxvkStateCacheEntryV4&    in,
-            DxvkStateCacheEntryV6&    out) const;
-    
-    bool convertEntryV5(
-      const DxvkStateCacheEntryV5&    in,
-            DxvkStateCacheEntryV6&    out) const;
-    
-    bool convertEntryV6(
-      const DxvkStateCacheEntryV6&    in,
-            DxvkStateCacheEntry&      out) const;
-    
-    void workerFunc();
+    void workerFunc(
+            uint32_t                  workerId);
 
     void writerFunc();
 
@@ -180,15 +226,6 @@ namespace dxvk {
     
     std::string getCacheDir() const;
 
-    static uint8_t packImageLayout(
-            VkImageLayout             layout);
-
-    static VkImageLayout unpackImageLayout(
-            uint8_t                   layout);
-
-    static bool validateRenderPassFormat(
-      const DxvkRenderPassFormat&     format);
-
   };
 
 }
\ No newline at end of file
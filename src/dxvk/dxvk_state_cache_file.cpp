@@ -0,0 +1,939 @@
+#include <cstring>
+
+#include "dxvk_state_cache_file.h"
+
+namespace dxvk {
+
+  static const Sha1Hash       g_nullHash      = Sha1Hash::compute(nullptr, 0);
+  static const DxvkShaderKey  g_nullShaderKey = DxvkShaderKey();
+
+
+  /**
+   * \brief Packed entry header
+   */
+  struct DxvkStateCacheEntryHeader {
+    uint32_t stageMask : 8;
+    uint32_t entrySize : 24;
+  };
+
+  
+  /**
+   * \brief State cache entry data
+   *
+   * Stores data for a single cache entry and
+   * provides convenience methods to access it.
+   */
+  class DxvkStateCacheEntryData {
+    constexpr static size_t MaxSize = 1024;
+  public:
+
+    size_t size() const {
+      return m_size;
+    }
+
+    const char* data() const {
+      return m_data;
+    }
+
+    Sha1Hash computeHash() const {
+      return Sha1Hash::compute(m_data, m_size);
+    }
+
+    template<typename T>
+    bool read(T& data) {
+      if (m_read + sizeof(T) > m_size)
+        return false;
+      
+      std::memcpy(&data, &m_data[m_read], sizeof(T));
+      m_read += sizeof(T);
+      return true;
+    }
+
+    template<typename T>
+    bool write(const T& data) {
+      if (m_size + sizeof(T) > MaxSize)
+        return false;
+      
+      std::memcpy(&m_data[m_size], &data, sizeof(T));
+      m_size += sizeof(T);
+      return true;
+    }
+
+    bool readFromMemory(const char* data, size_t size) {
+      if (size > MaxSize)
+        return false;
+
+      std::memcpy(m_data, data, size);
+
+      m_size = size;
+      m_read = 0;
+      return true;
+    }
+
+  private:
+
+    size_t m_size = 0;
+    size_t m_read = 0;
+    char   m_data[MaxSize];
+
+  };
+
+
+  template<typename T>
+  bool readCacheEntryTyped(std::istream& stream, T& entry) {
+    auto data = reinterpret_cast<char*>(&entry);
+    auto size = sizeof(entry);
+
+    if (!stream.read(data, size))
+      return false;
+    
+    Sha1Hash expectedHash = std::exchange(entry.hash, g_nullHash);
+    Sha1Hash computedHash = Sha1Hash::compute(entry);
+    return expectedHash == computedHash;
+  }
+
+
+  DxvkStateCacheFile::DxvkStateCacheFile() {
+
+  }
+
+
+  DxvkStateCacheFile::~DxvkStateCacheFile() {
+
+  }
+
+
+  bool DxvkStateCacheFile::read(
+          std::istream&             stream) {
+    // The header stores the state cache version,
+    // we need to regenerate it if it's outdated
+    DxvkStateCacheHeader newHeader;
+    DxvkStateCacheHeader curHeader;
+
+    auto data = reinterpret_cast<char*>(&curHeader);
+    auto size = sizeof(curHeader);
+
+    if (!stream.read(data, size)
+     || std::memcmp(curHeader.magic, newHeader.magic, sizeof(curHeader.magic))) {
+      Logger::warn("DXVK: Failed to read state cache header");
+      return false;
+    }
+
+    // Struct size hasn't changed between v2 and v4
+    size_t expectedSize = newHeader.entrySize;
+
+    if (curHeader.version <= 4)
+      expectedSize = sizeof(DxvkStateCacheEntryV4);
+    else if (curHeader.version <= 5)
+      expectedSize = sizeof(DxvkStateCacheEntryV5);
+    else if (curHeader.version <= 6)
+      expectedSize = sizeof(DxvkStateCacheEntryV6);
+    else if (curHeader.version <= 7)
+      expectedSize = sizeof(DxvkStateCacheEntry);
+
+    if (curHeader.entrySize != expectedSize) {
+      Logger::warn("DXVK: State cache entry size changed");
+      return false;
+    }
+
+    // Discard caches of unsupported versions
+    if (curHeader.version < 2 || curHeader.version > newHeader.version) {
+      Logger::warn("DXVK: State cache version not supported");
+      return false;
+    }
+
+    m_version = curHeader.version;
+
+    if (m_version < 8)
+      return readLegacy(stream);
+
+    // Read the rest of the file at once. Entries in
+    // v8 files and entries appended to v9 files use
+    // the same encoding, so they can share the code.
+    auto start = stream.tellg();
+    stream.seekg(0, std::ios_base::end);
+    auto end = stream.tellg();
+    stream.seekg(start);
+
+    m_data.resize(size_t(end - start));
+
+    if (!stream.read(m_data.data(), m_data.size())) {
+      Logger::warn("DXVK: Failed to read state cache file");
+      return false;
+    }
+
+    if (m_version < 9) {
+      readUnindexed(0);
+      return true;
+    }
+
+    return readIndexed();
+  }
+
+
+  bool DxvkStateCacheFile::needsCompaction() const {
+    DxvkStateCacheHeader newHeader;
+
+    return m_version != newHeader.version
+        || m_unindexedCount
+        || m_invalidCount.load()
+        || m_duplicateCount.load();
+  }
+
+
+  const std::vector<DxvkStateCacheEntry>& DxvkStateCacheFile::getEntries(
+    const DxvkStateCacheKey&        key) {
+    static const std::vector<DxvkStateCacheEntry> s_empty;
+
+    auto entry = m_keys.find(key);
+
+    if (entry == m_keys.end())
+      return s_empty;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!entry->second.decoded)
+      decodeKey(entry->second);
+
+    return entry->second.entries;
+  }
+
+
+  void DxvkStateCacheFile::addEntry(
+    const DxvkStateCacheEntry&      entry) {
+    KeyData& key = m_keys[entry.shaders];
+
+    if (!key.decoded)
+      decodeKey(key);
+
+    for (const auto& other : key.entries) {
+      if (isSameEntry(entry, other)) {
+        m_duplicateCount += 1;
+        return;
+      }
+    }
+
+    key.entries.push_back(entry);
+    m_entryCount += 1;
+  }
+
+
+  size_t DxvkStateCacheFile::write(
+          std::ostream&             stream) {
+    // Encode entries for each key into one contiguous
+    // block, so that they can be looked up by offset
+    std::vector<DxvkStateCacheIndexEntry> index;
+    index.reserve(m_keys.size());
+
+    std::ostringstream data;
+    size_t entryCount = 0;
+
+    for (auto& key : m_keys) {
+      // Decoded entries do not change anymore, so we only
+      // need to hold the lock while decoding the key
+      { std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!key.second.decoded)
+          decodeKey(key.second);
+      }
+
+      if (key.second.entries.empty())
+        continue;
+
+      size_t dataOffset = size_t(data.tellp());
+
+      for (const auto& entry : key.second.entries)
+        encodeEntry(data, entry);
+
+      DxvkStateCacheIndexEntry indexEntry;
+      indexEntry.key        = key.first;
+      indexEntry.entryCount = uint32_t(key.second.entries.size());
+      indexEntry.dataSize   = uint32_t(size_t(data.tellp()) - dataOffset);
+      indexEntry.dataOffset = dataOffset;
+      index.push_back(indexEntry);
+
+      entryCount += key.second.entries.size();
+    }
+
+    std::string dataString = data.str();
+
+    DxvkStateCacheHeader header;
+    DxvkStateCacheIndexHeader indexHeader;
+    indexHeader.keyCount    = uint32_t(index.size());
+    indexHeader.entryCount  = uint32_t(entryCount);
+    indexHeader.dataSize    = dataString.size();
+    indexHeader.indexHash   = Sha1Hash::compute(index.data(),
+      index.size() * sizeof(DxvkStateCacheIndexEntry));
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+    stream.write(reinterpret_cast<const char*>(index.data()),
+      index.size() * sizeof(DxvkStateCacheIndexEntry));
+    stream.write(dataString.data(), dataString.size());
+    stream.flush();
+
+    // Everything is decoded now, so we no longer
+    // need to keep the raw file data around
+    { std::lock_guard<std::mutex> lock(m_mutex);
+      std::vector<char>().swap(m_data);
+    }
+
+    m_version         = header.version;
+    m_entryCount      = entryCount;
+    m_unindexedCount  = 0;
+    m_invalidCount    = 0;
+    m_duplicateCount  = 0;
+    return entryCount;
+  }
+
+
+  void DxvkStateCacheFile::appendEntry(
+          std::ostream&             stream,
+    const DxvkStateCacheEntry&      entry) {
+    encodeEntry(stream, entry);
+    stream.flush();
+  }
+
+
+  bool DxvkStateCacheFile::readIndexed() {
+    DxvkStateCacheIndexHeader indexHeader;
+
+    if (m_data.size() < sizeof(indexHeader)) {
+      Logger::warn("DXVK: Failed to read state cache index");
+      return false;
+    }
+
+    std::memcpy(&indexHeader, m_data.data(), sizeof(indexHeader));
+
+    size_t indexOffset = sizeof(indexHeader);
+    size_t indexSize   = size_t(indexHeader.keyCount) * sizeof(DxvkStateCacheIndexEntry);
+    size_t dataOffset  = indexOffset + indexSize;
+
+    if (dataOffset + indexHeader.dataSize > m_data.size()
+     || indexHeader.indexHash != Sha1Hash::compute(&m_data[indexOffset], indexSize)) {
+      Logger::warn("DXVK: Failed to read state cache index");
+      return false;
+    }
+
+    // Only build the key map here, entries are decoded
+    // and validated when their key is first looked up
+    for (uint32_t i = 0; i < indexHeader.keyCount; i++) {
+      DxvkStateCacheIndexEntry indexEntry;
+      std::memcpy(&indexEntry, &m_data[indexOffset + i * sizeof(indexEntry)], sizeof(indexEntry));
+
+      if (indexEntry.dataOffset + indexEntry.dataSize > indexHeader.dataSize) {
+        m_invalidCount += indexEntry.entryCount;
+        continue;
+      }
+
+      KeyData& key = m_keys[indexEntry.key];
+      key.dataOffset  = dataOffset + indexEntry.dataOffset;
+      key.dataSize    = indexEntry.dataSize;
+      key.decoded     = false;
+
+      m_entryCount += indexEntry.entryCount;
+    }
+
+    readUnindexed(dataOffset + indexHeader.dataSize);
+    return true;
+  }
+
+
+  bool DxvkStateCacheFile::readLegacy(
+          std::istream&             stream) {
+    // Read actual cache entries from the file,
+    // converting them to the current format.
+    while (stream) {
+      DxvkStateCacheEntry entry;
+
+      if (!readEntryV7(m_version, stream, entry)) {
+        if (stream)
+          m_invalidCount += 1;
+        continue;
+      }
+
+      // Older versions did not validate render pass
+      // formats, so check those here as well
+      if (entry.shaders.cs.eq(g_nullShaderKey)
+       && !validateRenderPassFormat(entry.format)) {
+        m_invalidCount += 1;
+        continue;
+      }
+
+      m_keys[entry.shaders].entries.push_back(entry);
+      m_entryCount += 1;
+    }
+
+    for (auto& key : m_keys)
+      removeDuplicates(key.second.entries);
+
+    return true;
+  }
+
+
+  void DxvkStateCacheFile::readUnindexed(
+          size_t                    offset) {
+    // Keys that are also in the index are decoded on
+    // first use, the entries will then be merged.
+    while (offset < m_data.size()) {
+      DxvkStateCacheEntry entry;
+      size_t entryOffset = offset;
+
+      if (decodeEntry(m_data.data(), m_data.size(), offset, entry)) {
+        m_keys[entry.shaders].entries.push_back(entry);
+        m_entryCount     += 1;
+        m_unindexedCount += 1;
+      } else {
+        m_invalidCount += 1;
+
+        // Truncated entry, nothing more we can read
+        if (offset == entryOffset)
+          break;
+      }
+    }
+
+    for (auto& key : m_keys) {
+      if (key.second.decoded)
+        removeDuplicates(key.second.entries);
+    }
+  }
+
+
+  void DxvkStateCacheFile::decodeKey(
+          KeyData&                  key) {
+    const char* data = &m_data[key.dataOffset];
+    size_t offset = 0;
+
+    while (offset < key.dataSize) {
+      DxvkStateCacheEntry entry;
+      size_t entryOffset = offset;
+
+      if (decodeEntry(data, key.dataSize, offset, entry)) {
+        key.entries.push_back(entry);
+      } else {
+        m_invalidCount += 1;
+
+        if (offset == entryOffset)
+          break;
+      }
+    }
+
+    removeDuplicates(key.entries);
+    key.decoded = true;
+  }
+
+
+  void DxvkStateCacheFile::removeDuplicates(
+          std::vector<DxvkStateCacheEntry>& entries) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+      const DxvkStateCacheEntry& entry = entries[i];
+      bool duplicate = false;
+
+      for (size_t j = 0; j < count && !duplicate; j++)
+        duplicate = isSameEntry(entry, entries[j]);
+
+      if (!duplicate) {
+        if (count != i)
+          entries[count] = entry;
+        count += 1;
+      }
+    }
+
+    if (count != entries.size()) {
+      m_duplicateCount += entries.size() - count;
+      entries.resize(count);
+    }
+  }
+
+
+  bool DxvkStateCacheFile::isSameEntry(
+    const DxvkStateCacheEntry&      a,
+    const DxvkStateCacheEntry&      b) {
+    return a.shaders.cs.eq(g_nullShaderKey)
+      ? a.format.eq(b.format) && a.gpState == b.gpState
+      : a.cpState == b.cpState;
+  }
+
+
+  bool DxvkStateCacheFile::decodeEntry(
+    const char*                     buffer,
+          size_t                    bufferSize,
+          size_t&                   offset,
+          DxvkStateCacheEntry&      entry) {
+    // Read entry metadata and actual data
+    DxvkStateCacheEntryHeader header;
+    DxvkStateCacheEntryData data;
+    Sha1Hash hash;
+
+    size_t dataOffset = offset + sizeof(header) + sizeof(hash);
+
+    if (dataOffset > bufferSize)
+      return false;
+
+    std::memcpy(&header, &buffer[offset], sizeof(header));
+    std::memcpy(&hash, &buffer[offset + sizeof(header)], sizeof(hash));
+
+    if (dataOffset + header.entrySize > bufferSize)
+      return false;
+
+    // The entry size is known at this point, so
+    // invalid entries can be skipped
+    offset = dataOffset + header.entrySize;
+
+    if (!data.readFromMemory(&buffer[dataOffset], header.entrySize))
+      return false;
+
+    // Validate hash, skip entry if invalid
+    if (hash != data.computeHash())
+      return false;
+
+    // Read shader hashes
+    VkShaderStageFlags stageMask = VkShaderStageFlags(header.stageMask);
+    auto keys = &entry.shaders.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      if (stageMask & VkShaderStageFlagBits(1 << i))
+        data.read(keys[i]);
+      else
+        keys[i] = g_nullShaderKey;
+    }
+
+    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
+      if (!data.read(entry.cpState.bsBindingMask))
+        return false;
+    } else {
+      // Read packed render pass format
+      uint8_t sampleCount = 0;
+      uint8_t imageFormat = 0;
+      uint8_t imageLayout = 0;
+
+      if (!data.read(sampleCount)
+       || !data.read(imageFormat)
+       || !data.read(imageLayout))
+        return false;
+
+      entry.format.sampleCount = VkSampleCountFlagBits(sampleCount);
+      entry.format.depth.format = VkFormat(imageFormat);
+      entry.format.depth.layout = unpackImageLayout(imageLayout);
+
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(imageFormat)
+         || !data.read(imageLayout))
+          return false;
+
+        entry.format.color[i].format = VkFormat(imageFormat);
+        entry.format.color[i].layout = unpackImageLayout(imageLayout);
+      }
+
+      if (!validateRenderPassFormat(entry.format))
+        return false;
+
+      // Read common pipeline state
+      if (!data.read(entry.gpState.bsBindingMask)
+       || !data.read(entry.gpState.ia)
+       || !data.read(entry.gpState.il)
+       || !data.read(entry.gpState.rs)
+       || !data.read(entry.gpState.ms)
+       || !data.read(entry.gpState.ds)
+       || !data.read(entry.gpState.om)
+       || !data.read(entry.gpState.dsFront)
+       || !data.read(entry.gpState.dsBack))
+        return false;
+
+      if (entry.gpState.il.attributeCount() > MaxNumVertexAttributes
+       || entry.gpState.il.bindingCount() > MaxNumVertexBindings)
+        return false;
+
+      // Read render target swizzles
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(entry.gpState.omSwizzle[i]))
+          return false;
+      }
+
+      // Read render target blend info
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(entry.gpState.omBlend[i]))
+          return false;
+      }
+
+      // Read defined vertex attributes
+      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++) {
+        if (!data.read(entry.gpState.ilAttributes[i]))
+          return false;
+      }
+
+      // Read defined vertex bindings
+      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++) {
+        if (!data.read(entry.gpState.ilBindings[i]))
+          return false;
+      }
+    }
+
+    // Read non-zero spec constants
+    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
+      ? entry.cpState.sc
+      : entry.gpState.sc;
+
+    uint32_t specConstantMask = 0;
+
+    if (!data.read(specConstantMask))
+      return false;
+
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
+      if (specConstantMask & (1 << i)) {
+        if (!data.read(sc.specConstants[i]))
+          return false;
+      }
+    }
+
+    return true;
+  }
+
+
+  void DxvkStateCacheFile::encodeEntry(
+          std::ostream&             stream,
+    const DxvkStateCacheEntry&      entry) {
+    DxvkStateCacheEntryData data;
+    VkShaderStageFlags stageMask = 0;
+
+    // Write shader hashes
+    auto keys = &entry.shaders.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      if (!keys[i].eq(g_nullShaderKey)) {
+        stageMask |= VkShaderStageFlagBits(1 << i);
+        data.write(keys[i]);
+      }
+    }
+
+    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
+      // Nothing else here to write out
+      data.write(entry.cpState.bsBindingMask);
+    } else {
+      // Pack render pass format
+      data.write(uint8_t(entry.format.sampleCount));
+      data.write(uint8_t(entry.format.depth.format));
+      data.write(packImageLayout(entry.format.depth.layout));
+
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        data.write(uint8_t(entry.format.color[i].format));
+        data.write(packImageLayout(entry.format.color[i].layout));
+      }
+
+      // Write out common pipeline state
+      data.write(entry.gpState.bsBindingMask);
+      data.write(entry.gpState.ia);
+      data.write(entry.gpState.il);
+      data.write(entry.gpState.rs);
+      data.write(entry.gpState.ms);
+      data.write(entry.gpState.ds);
+      data.write(entry.gpState.om);
+      data.write(entry.gpState.dsFront);
+      data.write(entry.gpState.dsBack);
+
+      // Write out render target swizzles and blend info
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
+        data.write(entry.gpState.omSwizzle[i]);
+
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
+        data.write(entry.gpState.omBlend[i]);
+
+      // Write out input layout for defined attributes
+      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++)
+        data.write(entry.gpState.ilAttributes[i]);
+
+      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++)
+        data.write(entry.gpState.ilBindings[i]);
+    }
+
+    // Write out all non-zero spec constants
+    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
+      ? entry.cpState.sc
+      : entry.gpState.sc;
+
+    uint32_t specConstantMask = 0;
+
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++)
+      specConstantMask |= sc.specConstants[i] ? (1 << i) : 0;
+
+    data.write(specConstantMask);
+
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
+      if (specConstantMask & (1 << i))
+        data.write(sc.specConstants[i]);
+    }
+
+    // General layout: header -> hash -> data
+    DxvkStateCacheEntryHeader header;
+    header.stageMask = uint8_t(stageMask);
+    header.entrySize = data.size();
+
+    Sha1Hash hash = data.computeHash();
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+    stream.write(data.data(), data.size());
+  }
+
+
+  bool DxvkStateCacheFile::readEntryV7(
+          uint32_t                  version,
+          std::istream&             stream,
+          DxvkStateCacheEntry&      entry) {
+    if (version <= 6) {
+      DxvkStateCacheEntryV6 v6;
+
+      if (version <= 4) {
+        DxvkStateCacheEntryV4 v4;
+
+        if (!readCacheEntryTyped(stream, v4))
+          return false;
+
+        if (version == 2)
+          convertEntryV2(v4);
+
+        if (!convertEntryV4(v4, v6))
+          return false;
+      } else if (version <= 5) {
+        DxvkStateCacheEntryV5 v5;
+
+        if (!readCacheEntryTyped(stream, v5))
+          return false;
+
+        if (!convertEntryV5(v5, v6))
+          return false;
+      } else {
+        if (!readCacheEntryTyped(stream, v6))
+          return false;
+      }
+
+      return convertEntryV6(v6, entry);
+    } else {
+      return readCacheEntryTyped(stream, entry);
+    }
+  }
+
+
+  bool DxvkStateCacheFile::convertEntryV2(
+          DxvkStateCacheEntryV4&    entry) {
+    // Semantics changed:
+    // v2: rsDepthClampEnable
+    // v3: rsDepthClipEnable
+    entry.gpState.rsDepthClipEnable = !entry.gpState.rsDepthClipEnable;
+
+    // Frontend changed: Depth bias
+    // will typically be disabled
+    entry.gpState.rsDepthBiasEnable = VK_FALSE;
+    return true;
+  }
+
+
+  bool DxvkStateCacheFile::convertEntryV4(
+    const DxvkStateCacheEntryV4&    in,
+          DxvkStateCacheEntryV6&    out) {
+    out.shaders = in.shaders;
+    out.format  = in.format;
+    out.hash    = in.hash;
+
+    out.cpState.bsBindingMask           = in.cpState.bsBindingMask;
+    out.gpState.bsBindingMask           = in.gpState.bsBindingMask;
+    
+    out.gpState.iaPrimitiveTopology     = in.gpState.iaPrimitiveTopology;
+    out.gpState.iaPrimitiveRestart      = in.gpState.iaPrimitiveRestart;
+    out.gpState.iaPatchVertexCount      = in.gpState.iaPatchVertexCount;
+    
+    out.gpState.ilAttributeCount        = in.gpState.ilAttributeCount;
+    out.gpState.ilBindingCount          = in.gpState.ilBindingCount;
+
+    for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++)
+      out.gpState.ilAttributes[i]       = in.gpState.ilAttributes[i];
+
+    for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
+      out.gpState.ilBindings[i]         = in.gpState.ilBindings[i];
+      out.gpState.ilDivisors[i]         = in.gpState.ilDivisors[i];
+    }
+    
+    out.gpState.rsDepthClipEnable       = in.gpState.rsDepthClipEnable;
+    out.gpState.rsDepthBiasEnable       = in.gpState.rsDepthBiasEnable;
+    out.gpState.rsPolygonMode           = in.gpState.rsPolygonMode;
+    out.gpState.rsCullMode              = in.gpState.rsCullMode;
+    out.gpState.rsFrontFace             = in.gpState.rsFrontFace;
+    out.gpState.rsViewportCount         = in.gpState.rsViewportCount;
+    out.gpState.rsSampleCount           = in.gpState.rsSampleCount;
+    
+    out.gpState.msSampleCount           = in.gpState.msSampleCount;
+    out.gpState.msSampleMask            = in.gpState.msSampleMask;
+    out.gpState.msEnableAlphaToCoverage = in.gpState.msEnableAlphaToCoverage;
+    
+    out.gpState.dsEnableDepthTest       = in.gpState.dsEnableDepthTest;
+    out.gpState.dsEnableDepthWrite      = in.gpState.dsEnableDepthWrite;
+    out.gpState.dsEnableStencilTest     = in.gpState.dsEnableStencilTest;
+    out.gpState.dsDepthCompareOp        = in.gpState.dsDepthCompareOp;
+    out.gpState.dsStencilOpFront        = in.gpState.dsStencilOpFront;
+    out.gpState.dsStencilOpBack         = in.gpState.dsStencilOpBack;
+    
+    out.gpState.omEnableLogicOp         = in.gpState.omEnableLogicOp;
+    out.gpState.omLogicOp               = in.gpState.omLogicOp;
+
+    for (uint32_t i = 0; i < 8; i++) {
+      out.gpState.omBlendAttachments[i] = in.gpState.omBlendAttachments[i];
+      out.gpState.omComponentMapping[i] = in.gpState.omComponentMapping[i];
+    }
+
+    return true;
+  }
+
+
+  bool DxvkStateCacheFile::convertEntryV5(
+    const DxvkStateCacheEntryV5&    in,
+          DxvkStateCacheEntryV6&    out) {
+    out.shaders = in.shaders;
+    out.gpState = in.gpState;
+    out.format  = in.format;
+    out.hash    = in.hash;
+
+    out.cpState.bsBindingMask = in.cpState.bsBindingMask;
+    return true;
+  }
+
+
+  bool DxvkStateCacheFile::convertEntryV6(
+    const DxvkStateCacheEntryV6&    in,
+          DxvkStateCacheEntry&      out) {
+    out.shaders = in.shaders;
+    out.format  = in.format;
+    out.hash    = in.hash;
+
+    if (in.shaders.cs.eq(g_nullShaderKey)) {
+      // Binding mask
+      out.gpState.bsBindingMask = in.gpState.bsBindingMask;
+
+      // Graphics state
+      out.gpState.ia = DxvkIaInfo(
+        in.gpState.iaPrimitiveTopology,
+        in.gpState.iaPrimitiveRestart,
+        in.gpState.iaPatchVertexCount);
+      
+      out.gpState.il = DxvkIlInfo(
+        in.gpState.ilAttributeCount,
+        in.gpState.ilBindingCount);
+      
+      for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++) {
+        out.gpState.ilAttributes[i] = DxvkIlAttribute(
+          in.gpState.ilAttributes[i].location,
+          in.gpState.ilAttributes[i].binding,
+          in.gpState.ilAttributes[i].format,
+          in.gpState.ilAttributes[i].offset);
+      }
+      
+      for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
+        out.gpState.ilBindings[i] = DxvkIlBinding(
+          in.gpState.ilBindings[i].binding,
+          in.gpState.ilBindings[i].stride,
+          in.gpState.ilBindings[i].inputRate,
+          in.gpState.ilDivisors[i]);
+      }
+      
+      out.gpState.rs = DxvkRsInfo(
+        in.gpState.rsDepthClipEnable,
+        in.gpState.rsDepthBiasEnable,
+        in.gpState.rsPolygonMode,
+        in.gpState.rsCullMode,
+        in.gpState.rsFrontFace,
+        in.gpState.rsViewportCount,
+        in.gpState.rsSampleCount);
+
+      out.gpState.ms = DxvkMsInfo(
+        in.gpState.msSampleCount,
+        in.gpState.msSampleMask,
+        in.gpState.msEnableAlphaToCoverage);
+      
+      out.gpState.ds = DxvkDsInfo(
+        in.gpState.dsEnableDepthTest,
+        in.gpState.dsEnableDepthWrite,
+        in.gpState.dsEnableDepthBoundsTest,
+        in.gpState.dsEnableStencilTest,
+        in.gpState.dsDepthCompareOp);
+      
+      out.gpState.dsFront = DxvkDsStencilOp(in.gpState.dsStencilOpFront);
+      out.gpState.dsBack  = DxvkDsStencilOp(in.gpState.dsStencilOpBack);
+
+      out.gpState.om = DxvkOmInfo(
+        in.gpState.omEnableLogicOp,
+        in.gpState.omLogicOp);
+      
+      for (uint32_t i = 0; i < 8 && i < MaxNumRenderTargets; i++) {
+        out.gpState.omBlend[i] = DxvkOmAttachmentBlend(
+          in.gpState.omBlendAttachments[i].blendEnable,
+          in.gpState.omBlendAttachments[i].srcColorBlendFactor,
+          in.gpState.omBlendAttachments[i].dstColorBlendFactor,
+          in.gpState.omBlendAttachments[i].colorBlendOp,
+          in.gpState.omBlendAttachments[i].srcAlphaBlendFactor,
+          in.gpState.omBlendAttachments[i].dstAlphaBlendFactor,
+          in.gpState.omBlendAttachments[i].alphaBlendOp,
+          in.gpState.omBlendAttachments[i].colorWriteMask);
+        
+        out.gpState.omSwizzle[i] = DxvkOmAttachmentSwizzle(
+          in.gpState.omComponentMapping[i]);
+      }
+
+      // Specialization constants
+      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
+        out.cpState.sc.specConstants[i] = in.cpState.scSpecConstants[i];
+    } else {
+      // Binding mask
+      out.cpState.bsBindingMask = in.cpState.bsBindingMask;
+
+      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
+        out.gpState.sc.specConstants[i] = in.gpState.scSpecConstants[i];
+    }
+
+    return true;
+  }
+
+
+  uint8_t DxvkStateCacheFile::packImageLayout(
+          VkImageLayout             layout) {
+    switch (layout) {
+      case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL: return 0x80;
+      case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL: return 0x81;
+      default: return uint8_t(layout);
+    }
+  }
+
+
+  VkImageLayout DxvkStateCacheFile::unpackImageLayout(
+          uint8_t                   layout) {
+    switch (layout) {
+      case 0x80: return VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL;
+      case 0x81: return VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
+      default: return VkImageLayout(layout);
+    }
+  }
+
+
+  bool DxvkStateCacheFile::validateRenderPassFormat(
+    const DxvkRenderPassFormat&     format) {
+    bool valid = true;
+
+    if (format.depth.format) {
+      valid &= format.depth.layout == VK_IMAGE_LAYOUT_GENERAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
+    }
+
+    for (uint32_t i = 0; i < MaxNumRenderTargets && valid; i++) {
+      if (format.color[i].format) {
+        valid &= format.color[i].layout == VK_IMAGE_LAYOUT_GENERAL
+              || format.color[i].layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+      }
+    }
+
+    return valid;
+  }
+
+}
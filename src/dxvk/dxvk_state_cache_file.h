@@ -0,0 +1,250 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "dxvk_state_cache_types.h"
+
+namespace dxvk {
+
+  /**
+   * \brief State cache file
+   *
+   * Reads and writes state cache files. Files in the
+   * current format are read into memory in one go, and
+   * only the index is parsed up front. Entries are then
+   * decoded and validated on first access to their key,
+   * so that startup time does not depend on the number
+   * of pipelines in the file. Files in older formats,
+   * as well as entries appended to an indexed file, are
+   * decoded immediately since they are not indexed.
+   */
+  class DxvkStateCacheFile {
+
+  public:
+
+    DxvkStateCacheFile();
+
+    ~DxvkStateCacheFile();
+
+    /**
+     * \brief Reads a state cache file
+     *
+     * Supports all file versions from v2 onwards.
+     * \param [in] stream Input stream
+     * \returns \c false if the file is not a valid
+     *    state cache file of a supported version
+     */
+    bool read(
+            std::istream&                   stream);
+
+    /**
+     * \brief Version of the file that was read
+     * \returns Format version, or 0 if nothing was read
+     */
+    uint32_t version() const {
+      return m_version;
+    }
+
+    /**
+     * \brief Number of pipeline keys
+     * \returns Number of unique shader combinations
+     */
+    size_t keyCount() const {
+      return m_keys.size();
+    }
+
+    /**
+     * \brief Number of entries
+     *
+     * Counts entries as they were stored in the
+     * file, which may include invalid entries and
+     * duplicates that have not been decoded yet.
+     * \returns Number of state cache entries
+     */
+    size_t entryCount() const {
+      return m_entryCount;
+    }
+
+    /**
+     * \brief Number of invalid entries
+     *
+     * Only includes entries that have been decoded.
+     * \returns Number of entries that were dropped
+     *    because they were corrupted or invalid
+     */
+    size_t invalidCount() const {
+      return m_invalidCount.load();
+    }
+
+    /**
+     * \brief Number of duplicate entries
+     *
+     * Only includes entries that have been decoded
+     * or added to the file after reading it.
+     * \returns Number of entries that were dropped
+     *    because an identical entry already exists
+     */
+    size_t duplicateCount() const {
+      return m_duplicateCount.load();
+    }
+
+    /**
+     * \brief Checks whether the file should be rewritten
+     *
+     * This is the case if the file uses an older format,
+     * if entries were appended after the indexed section,
+     * or if invalid or duplicate entries were found.
+     * \returns \c true if the file should be compacted
+     */
+    bool needsCompaction() const;
+
+    /**
+     * \brief Iterates over pipeline keys
+     *
+     * Does not decode any entries.
+     * \param [in] fn Function that takes a key
+     */
+    template<typename Fn>
+    void forEachKey(const Fn& fn) const {
+      for (const auto& entry : m_keys)
+        fn(entry.first);
+    }
+
+    /**
+     * \brief Retrieves entries for a pipeline key
+     *
+     * Decodes and validates the entries on first access,
+     * invalid and duplicate entries are dropped. This is
+     * thread-safe, but must not be called concurrently
+     * with methods that add entries to the file.
+     * \param [in] key Pipeline key
+     * \returns Valid entries for the given key
+     */
+    const std::vector<DxvkStateCacheEntry>& getEntries(
+      const DxvkStateCacheKey&              key);
+
+    /**
+     * \brief Adds an entry
+     *
+     * Does nothing if an identical entry already exists.
+     * Must not be called concurrently with other methods.
+     * \param [in] entry The entry to add
+     */
+    void addEntry(
+      const DxvkStateCacheEntry&            entry);
+
+    /**
+     * \brief Writes an indexed file
+     *
+     * Decodes all entries and writes the file in the
+     * current format, without any invalid or duplicate
+     * entries. This is thread-safe with respect to
+     * \c getEntries. Since all entries are decoded
+     * afterwards, the raw file data will be released.
+     * \param [in] stream Output stream
+     * \returns Number of entries written
+     */
+    size_t write(
+            std::ostream&                   stream);
+
+    /**
+     * \brief Appends an entry to a file
+     *
+     * Writes a single unindexed entry. The file must be
+     * an indexed file in the current format, or empty
+     * apart from the header. Appended entries will be
+     * indexed the next time the file is compacted.
+     * \param [in] stream Output stream
+     * \param [in] entry The entry to write
+     */
+    static void appendEntry(
+            std::ostream&                   stream,
+      const DxvkStateCacheEntry&            entry);
+
+  private:
+
+    struct KeyData {
+      size_t                            dataOffset = 0;
+      size_t                            dataSize   = 0;
+      bool                              decoded    = true;
+      std::vector<DxvkStateCacheEntry>  entries;
+    };
+
+    std::mutex                        m_mutex;
+    std::vector<char>                 m_data;
+
+    uint32_t                          m_version         = 0;
+    size_t                            m_entryCount      = 0;
+    size_t                            m_unindexedCount  = 0;
+
+    std::atomic<size_t>               m_invalidCount    = { 0u };
+    std::atomic<size_t>               m_duplicateCount  = { 0u };
+
+    std::unordered_map<
+      DxvkStateCacheKey, KeyData,
+      DxvkHash, DxvkEq> m_keys;
+
+    bool readIndexed();
+
+    bool readLegacy(
+            std::istream&             stream);
+
+    void readUnindexed(
+            size_t                    offset);
+
+    void decodeKey(
+            KeyData&                  key);
+
+    void removeDuplicates(
+            std::vector<DxvkStateCacheEntry>& entries);
+
+    static bool isSameEntry(
+      const DxvkStateCacheEntry&      a,
+      const DxvkStateCacheEntry&      b);
+
+    static bool decodeEntry(
+      const char*                     data,
+            size_t                    size,
+            size_t&                   offset,
+            DxvkStateCacheEntry&      entry);
+
+    static void encodeEntry(
+            std::ostream&             stream,
+      const DxvkStateCacheEntry&      entry);
+
+    static bool readEntryV7(
+            uint32_t                  version,
+            std::istream&             stream,
+            DxvkStateCacheEntry&      entry);
+
+    static bool convertEntryV2(
+            DxvkStateCacheEntryV4&    entry);
+
+    static bool convertEntryV4(
+      const DxvkStateCacheEntryV4&    in,
+            DxvkStateCacheEntryV6&    out);
+
+    static bool convertEntryV5(
+      const DxvkStateCacheEntryV5&    in,
+            DxvkStateCacheEntryV6&    out);
+
+    static bool convertEntryV6(
+      const DxvkStateCacheEntryV6&    in,
+            DxvkStateCacheEntry&      out);
+
+    static uint8_t packImageLayout(
+            VkImageLayout             layout);
+
+    static VkImageLayout unpackImageLayout(
+            uint8_t                   layout);
+
+    static bool validateRenderPassFormat(
+      const DxvkRenderPassFormat&     format);
+
+  };
+
+}
@@ -52,13 +52,51 @@ namespace dxvk {
    */
   struct DxvkStateCacheHeader {
     char     magic[4]   = { 'D', 'X', 'V', 'K' };
-    uint32_t version    = 8;
+    uint32_t version    = 9;
     uint32_t entrySize  = 0; /* no longer meaningful */
   };
 
   static_assert(sizeof(DxvkStateCacheHeader) == 12);
 
 
+  /**
+   * \brief State cache index header
+   *
+   * Follows the file header in v9 files. The index
+   * stores one entry per pipeline key, followed by
+   * the data section, which contains all entries for
+   * a given key in one contiguous block. Entries
+   * appended to the file at runtime are stored after
+   * the data section and are not part of the index.
+   */
+  struct DxvkStateCacheIndexHeader {
+    uint32_t keyCount   = 0;
+    uint32_t entryCount = 0;
+    uint64_t dataSize   = 0;
+    Sha1Hash indexHash;
+    uint32_t reserved   = 0;
+  };
+
+  static_assert(sizeof(DxvkStateCacheIndexHeader) == 40);
+
+
+  /**
+   * \brief State cache index entry
+   *
+   * Locates the entries for a single pipeline key
+   * within the data section. The data offset is
+   * relative to the start of the data section.
+   */
+  struct DxvkStateCacheIndexEntry {
+    DxvkStateCacheKey key;
+    uint32_t          entryCount;
+    uint32_t          dataSize;
+    uint64_t          dataOffset;
+  };
+
+  static_assert(sizeof(DxvkStateCacheIndexEntry) == 160);
+
+
   /**
    * \brief Version 4 graphics pipeline state
    */
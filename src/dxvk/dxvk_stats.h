@@ -14,15 +14,31 @@ namespace dxvk {
     CmdDrawCalls,             ///< Number of draw calls
     CmdDispatchCalls,         ///< Number of compute calls
     CmdRenderPassCount,       ///< Number of render passes
+    CmdBarrierCount,          ///< Number of pipeline barriers
+    CmdBarrierSkipped,        ///< Number of barriers found to be redundant
     MemoryAllocationCount,    ///< Number of memory allocations
     MemoryAllocated,          ///< Amount of memory allocated
     MemoryUsed,               ///< Amount of memory used
     PipeCountGraphics,        ///< Number of graphics pipelines
     PipeCountCompute,         ///< Number of compute pipelines
     PipeCompilerBusy,         ///< Boolean indicating compiler activity
+    PipeQueueCount,           ///< Number of queued state cache work items
+    PipeQueuePrioritized,     ///< Number of prioritized work items
+    PipeQueueDequeued,        ///< Number of work items taken from the queue
+    PipeQueueWaitTicks,       ///< Total queue wait time in microseconds
     QueueSubmitCount,         ///< Number of command buffer submissions
     QueuePresentCount,        ///< Number of present calls / frames
     GpuIdleTicks,             ///< GPU idle time in microseconds
+    CsChunkCount,             ///< Number of CS chunks submitted
+    CsChunkBytesUsed,         ///< Amount of command data in CS chunks
+    CsChunkBytesTotal,        ///< Total capacity of submitted CS chunks
+    BufferDiscardCount,       ///< Number of buffer discards
+    BufferDiscardBytes,       ///< Amount of buffer memory discarded
+    DescriptorSetCacheHits,   ///< Number of reused descriptor sets
+    DescriptorSetCacheMisses, ///< Number of written descriptor sets
+    DescriptorWritesSaved,    ///< Number of descriptors not written
+    DescriptorPoolCreated,    ///< Number of descriptor pools created
+    DescriptorPoolReset,      ///< Number of descriptor pool resets
     NumCounters,              ///< Number of counters available
   };
   
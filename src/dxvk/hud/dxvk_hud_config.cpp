@@ -16,6 +16,10 @@ namespace dxvk::hud {
     { "version",      HudElement::DxvkVersion       },
     { "api",          HudElement::DxvkClientApi     },
     { "compiler",     HudElement::CompilerActivity  },
+    { "cschunks",     HudElement::StatCsChunks      },
+    { "memtypes",     HudElement::StatMemoryTypes   },
+    { "discards",     HudElement::StatDiscards      },
+    { "descriptors",  HudElement::StatDescriptors   },
   }};
   
   
@@ -22,6 +22,10 @@ namespace dxvk::hud {
     DxvkVersion       = 8,
     DxvkClientApi     = 9,
     CompilerActivity  = 10,
+    StatCsChunks      = 11,
+    StatMemoryTypes   = 12,
+    StatDiscards      = 13,
+    StatDescriptors   = 14,
   };
   
   using HudElements = Flags<HudElement>;
@@ -26,6 +26,9 @@ namespace dxvk::hud {
     // we don't want to update this every frame
     if (m_elements.test(HudElement::StatGpuLoad))
       this->updateGpuLoad();
+
+    if (m_elements.test(HudElement::StatMemoryTypes))
+      this->updateMemoryTypeStats(device);
   }
   
   
@@ -39,12 +42,24 @@ namespace dxvk::hud {
     if (m_elements.test(HudElement::StatDrawCalls))
       position = this->printDrawCallStats(context, renderer, position);
     
+    if (m_elements.test(HudElement::StatCsChunks))
+      position = this->printCsChunkStats(context, renderer, position);
+    
+    if (m_elements.test(HudElement::StatDiscards))
+      position = this->printDiscardStats(context, renderer, position);
+    
+    if (m_elements.test(HudElement::StatDescriptors))
+      position = this->printDescriptorStats(context, renderer, position);
+    
     if (m_elements.test(HudElement::StatPipelines))
       position = this->printPipelineStats(context, renderer, position);
     
     if (m_elements.test(HudElement::StatMemory))
       position = this->printMemoryStats(context, renderer, position);
     
+    if (m_elements.test(HudElement::StatMemoryTypes))
+      position = this->printMemoryTypeStats(context, renderer, position);
+    
     if (m_elements.test(HudElement::StatGpuLoad))
       position = this->printGpuLoad(context, renderer, position);
     
@@ -76,6 +91,19 @@ namespace dxvk::hud {
   }
 
 
+  void HudStats::updateMemoryTypeStats(const Rc<DxvkDevice>& device) {
+    auto now = std::chrono::high_resolution_clock::now();
+    uint64_t ticks = std::chrono::duration_cast<std::chrono::microseconds>(now - m_memTypeUpdateTime).count();
+
+    // Walking all memory chunks is not free, so
+    // only do this a couple of times per second
+    if (ticks >= 500'000) {
+      m_memTypeUpdateTime = now;
+      m_memTypeStats = device->getMemoryTypeStats();
+    }
+  }
+
+
   HudPos HudStats::printDrawCallStats(
     const Rc<DxvkContext>&  context,
           HudRenderer&      renderer,
@@ -85,10 +113,13 @@ namespace dxvk::hud {
     const uint64_t gpCalls = m_diffCounters.getCtr(DxvkStatCounter::CmdDrawCalls)       / frameCount;
     const uint64_t cpCalls = m_diffCounters.getCtr(DxvkStatCounter::CmdDispatchCalls)   / frameCount;
     const uint64_t rpCalls = m_diffCounters.getCtr(DxvkStatCounter::CmdRenderPassCount) / frameCount;
+    const uint64_t barriers = m_diffCounters.getCtr(DxvkStatCounter::CmdBarrierCount)   / frameCount;
+    const uint64_t skipped  = m_diffCounters.getCtr(DxvkStatCounter::CmdBarrierSkipped) / frameCount;
     
     const std::string strDrawCalls      = str::format("Draw calls:     ", gpCalls);
     const std::string strDispatchCalls  = str::format("Dispatch calls: ", cpCalls);
     const std::string strRenderPasses   = str::format("Render passes:  ", rpCalls);
+    const std::string strBarriers       = str::format("Barriers:       ", barriers, " (", skipped, " avoided)");
     
     renderer.drawText(context, 16.0f,
       { position.x, position.y },
@@ -105,7 +136,12 @@ namespace dxvk::hud {
       { 1.0f, 1.0f, 1.0f, 1.0f },
       strRenderPasses);
     
-    return { position.x, position.y + 64 };
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y + 60.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strBarriers);
+    
+    return { position.x, position.y + 84 };
   }
   
   
@@ -127,6 +163,107 @@ namespace dxvk::hud {
   }
   
   
+  HudPos HudStats::printCsChunkStats(
+    const Rc<DxvkContext>&  context,
+          HudRenderer&      renderer,
+          HudPos            position) {
+    constexpr uint64_t kib = 1024;
+    
+    const uint64_t frameCount = std::max<uint64_t>(m_diffCounters.getCtr(DxvkStatCounter::QueuePresentCount), 1);
+    const uint64_t numChunks  = m_diffCounters.getCtr(DxvkStatCounter::CsChunkCount)      / frameCount;
+    const uint64_t bytesUsed  = m_diffCounters.getCtr(DxvkStatCounter::CsChunkBytesUsed)  / frameCount;
+    const uint64_t bytesTotal = m_diffCounters.getCtr(DxvkStatCounter::CsChunkBytesTotal) / frameCount;
+    
+    const uint64_t fillRatio = bytesTotal ? (100 * bytesUsed) / bytesTotal : 0;
+    
+    const std::string strChunks = str::format("CS chunks:     ", numChunks);
+    const std::string strData   = str::format("CS chunk data: ", bytesUsed / kib, " kB");
+    const std::string strFill   = str::format("CS chunk fill: ", fillRatio, "%");
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strChunks);
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y + 20.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strData);
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y + 40.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strFill);
+    
+    return { position.x, position.y + 64 };
+  }
+  
+  
+  HudPos HudStats::printDiscardStats(
+    const Rc<DxvkContext>&  context,
+          HudRenderer&      renderer,
+          HudPos            position) {
+    constexpr uint64_t kib = 1024;
+    
+    const uint64_t frameCount   = std::max<uint64_t>(m_diffCounters.getCtr(DxvkStatCounter::QueuePresentCount), 1);
+    const uint64_t numDiscards  = m_diffCounters.getCtr(DxvkStatCounter::BufferDiscardCount) / frameCount;
+    const uint64_t bytesDiscard = m_diffCounters.getCtr(DxvkStatCounter::BufferDiscardBytes) / frameCount;
+    
+    const std::string strCount = str::format("Buffer discards: ", numDiscards);
+    const std::string strBytes = str::format("Discarded data:  ", bytesDiscard / kib, " kB");
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strCount);
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y + 20.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strBytes);
+    
+    return { position.x, position.y + 44 };
+  }
+  
+  
+  HudPos HudStats::printDescriptorStats(
+    const Rc<DxvkContext>&  context,
+          HudRenderer&      renderer,
+          HudPos            position) {
+    const uint64_t frameCount   = std::max<uint64_t>(m_diffCounters.getCtr(DxvkStatCounter::QueuePresentCount), 1);
+    const uint64_t numHits      = m_diffCounters.getCtr(DxvkStatCounter::DescriptorSetCacheHits);
+    const uint64_t numMisses    = m_diffCounters.getCtr(DxvkStatCounter::DescriptorSetCacheMisses);
+    const uint64_t numSaved     = m_diffCounters.getCtr(DxvkStatCounter::DescriptorWritesSaved) / frameCount;
+    
+    const uint64_t numSets      = (numHits + numMisses) / frameCount;
+    const uint64_t hitRate      = (100 * numHits) / std::max<uint64_t>(numHits + numMisses, 1);
+    
+    const uint64_t poolsCreated = m_prevCounters.getCtr(DxvkStatCounter::DescriptorPoolCreated);
+    const uint64_t poolResets   = m_diffCounters.getCtr(DxvkStatCounter::DescriptorPoolReset) / frameCount;
+    
+    const std::string strSets   = str::format("Descriptor sets: ", numSets, " (", hitRate, "% cached)");
+    const std::string strSaved  = str::format("Writes saved:    ", numSaved);
+    const std::string strPools  = str::format("Pools:           ", poolsCreated, " (", poolResets, " resets)");
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strSets);
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y + 20.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strSaved);
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y + 40.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strPools);
+    
+    return { position.x, position.y + 64 };
+  }
+  
+  
   HudPos HudStats::printPipelineStats(
     const Rc<DxvkContext>&  context,
           HudRenderer&      renderer,
@@ -147,7 +284,25 @@ namespace dxvk::hud {
       { 1.0f, 1.0f, 1.0f, 1.0f },
       strCpCount);
     
-    return { position.x, position.y + 44.0f };
+    // Only show compiler queue stats if the state cache is used
+    const uint64_t queueCount    = m_prevCounters.getCtr(DxvkStatCounter::PipeQueueCount);
+    const uint64_t queueDequeued = m_prevCounters.getCtr(DxvkStatCounter::PipeQueueDequeued);
+    const uint64_t queuePrio     = m_prevCounters.getCtr(DxvkStatCounter::PipeQueuePrioritized);
+    const uint64_t queueWait     = m_prevCounters.getCtr(DxvkStatCounter::PipeQueueWaitTicks);
+    
+    if (!queueCount && !queueDequeued)
+      return { position.x, position.y + 44.0f };
+    
+    const std::string strQueue = str::format("Compiler queue:     ", queueCount,
+      " (", queuePrio, " prioritized, avg wait ",
+      queueDequeued ? queueWait / (1000 * queueDequeued) : 0, " ms)");
+    
+    renderer.drawText(context, 16.0f,
+      { position.x, position.y + 40.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      strQueue);
+    
+    return { position.x, position.y + 64.0f };
   }
   
   
@@ -177,6 +332,48 @@ namespace dxvk::hud {
   }
 
 
+  HudPos HudStats::printMemoryTypeStats(
+    const Rc<DxvkContext>&  context,
+          HudRenderer&      renderer,
+          HudPos            position) {
+    constexpr uint64_t mib = 1024 * 1024;
+    
+    for (const auto& stats : m_memTypeStats) {
+      const std::string strChunks = str::format("Type ", stats.memTypeId, ": ",
+        stats.chunkCount, " chunks, ",
+        stats.chunkUsed      / mib, " / ",
+        stats.chunkAllocated / mib, " MB used");
+      
+      const std::string strFree = str::format("  Free: ",
+        stats.freeRangeCount, " ranges, largest ",
+        stats.maxFreeRange / mib, " MB");
+      
+      const std::string strDedicated = str::format("  Dedicated: ",
+        stats.dedicatedCount, ", ",
+        stats.dedicatedSize / mib, " MB");
+      
+      renderer.drawText(context, 16.0f,
+        { position.x, position.y },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        strChunks);
+      
+      renderer.drawText(context, 16.0f,
+        { position.x, position.y + 20.0f },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        strFree);
+      
+      renderer.drawText(context, 16.0f,
+        { position.x, position.y + 40.0f },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        strDedicated);
+      
+      position.y += 64.0f;
+    }
+    
+    return position;
+  }
+
+
   HudPos HudStats::printGpuLoad(
     const Rc<DxvkContext>&  context,
           HudRenderer&      renderer,
@@ -220,9 +417,13 @@ namespace dxvk::hud {
   HudElements HudStats::filterElements(HudElements elements) {
     return elements & HudElements(
       HudElement::StatDrawCalls,
+      HudElement::StatCsChunks,
+      HudElement::StatDiscards,
+      HudElement::StatDescriptors,
       HudElement::StatSubmissions,
       HudElement::StatPipelines,
       HudElement::StatMemory,
+      HudElement::StatMemoryTypes,
       HudElement::StatGpuLoad,
       HudElement::CompilerActivity);
   }
@@ -40,13 +40,19 @@ namespace dxvk::hud {
 
     std::chrono::high_resolution_clock::time_point m_gpuLoadUpdateTime;
     std::chrono::high_resolution_clock::time_point m_compilerShowTime;
+    std::chrono::high_resolution_clock::time_point m_memTypeUpdateTime;
 
     uint64_t m_prevGpuIdleTicks = 0;
     uint64_t m_diffGpuIdleTicks = 0;
     
     std::string m_gpuLoadString = "GPU: ";
 
+    std::vector<DxvkMemoryTypeStats> m_memTypeStats;
+
     void updateGpuLoad();
+
+    void updateMemoryTypeStats(
+      const Rc<DxvkDevice>&   device);
     
     HudPos printDrawCallStats(
       const Rc<DxvkContext>&  context,
@@ -58,6 +64,21 @@ namespace dxvk::hud {
             HudRenderer&      renderer,
             HudPos            position);
     
+    HudPos printCsChunkStats(
+      const Rc<DxvkContext>&  context,
+            HudRenderer&      renderer,
+            HudPos            position);
+    
+    HudPos printDiscardStats(
+      const Rc<DxvkContext>&  context,
+            HudRenderer&      renderer,
+            HudPos            position);
+    
+    HudPos printDescriptorStats(
+      const Rc<DxvkContext>&  context,
+            HudRenderer&      renderer,
+            HudPos            position);
+    
     HudPos printPipelineStats(
       const Rc<DxvkContext>&  context,
             HudRenderer&      renderer,
@@ -68,6 +89,11 @@ namespace dxvk::hud {
             HudRenderer&      renderer,
             HudPos            position);
     
+    HudPos printMemoryTypeStats(
+      const Rc<DxvkContext>&  context,
+            HudRenderer&      renderer,
+            HudPos            position);
+    
     HudPos printGpuLoad(
       const Rc<DxvkContext>&  context,
             HudRenderer&      renderer,
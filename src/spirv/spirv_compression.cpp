@@ -1,7 +1,19 @@
+#include <algorithm>
+#include <cstring>
+
 #include "spirv_compression.h"
 
 namespace dxvk {
 
+  /**
+   * \brief Number of bytes to read past the end of the code
+   *
+   * The decoder always reads full DWORDs, so the compressed
+   * buffer is padded to keep the last read in bounds.
+   */
+  constexpr static uint32_t CodePadding = 3;
+
+
   SpirvCompressedBuffer::SpirvCompressedBuffer()
   : m_size(0) {
 
@@ -19,46 +31,33 @@ namespace dxvk {
     // each DWORD, a two-bit integer is stored which indicates
     // the number of bytes it takes in the compressed buffer.
     // This way, it can achieve a compression ratio of ~50%.
-    m_mask.reserve((m_size + NumMaskWords - 1) / NumMaskWords);
-    m_code.reserve((m_size + 1) / 2);
-
-    uint64_t dstWord  = 0;
-    uint32_t dstShift = 0;
-
-    for (uint32_t i = 0; i < m_size; i += NumMaskWords) {
-      uint64_t byteCounts = 0;
-
-      for (uint32_t w = 0; w < NumMaskWords && i + w < m_size; w++) {
-        uint64_t word = data[i + w];
-        uint64_t bytes = 0;
-
-        if      (word < (1 <<  8)) bytes = 0;
-        else if (word < (1 << 16)) bytes = 1;
-        else if (word < (1 << 24)) bytes = 2;
-        else                       bytes = 3;
-
-        byteCounts |= bytes << (2 * w);
-
-        uint32_t bits = 8 * bytes + 8;
-        uint32_t rem  = bit::pack(dstWord, dstShift, word, bits);
-
-        if (unlikely(rem != 0)) {
-          m_code.push_back(dstWord);
-
-          dstWord  = 0;
-          dstShift = 0;
-
-          bit::pack(dstWord, dstShift, word >> (bits - rem), rem);
-        }
+    //
+    // Masks and code are stored in separate byte streams, and
+    // every DWORD starts at a byte boundary, so that neither
+    // encoding nor decoding needs any bit shuffling across
+    // word boundaries. This relies on a little-endian host.
+    m_mask.resize((m_size + 3) / 4);
+    m_code.resize(m_size * sizeof(uint32_t) + CodePadding);
+
+    uint8_t* dst = m_code.data();
+
+    for (uint32_t i = 0; i < m_size; i += 4) {
+      uint32_t count = std::min(m_size - i, 4u);
+      uint32_t mask  = 0;
+
+      for (uint32_t w = 0; w < count; w++) {
+        uint32_t word  = data[i + w];
+        uint32_t bytes = bit::bsr(word | 1) / 8;
+
+        std::memcpy(dst, &word, sizeof(word));
+        dst  += bytes + 1;
+        mask |= bytes << (2 * w);
       }
 
-      m_mask.push_back(byteCounts);
+      m_mask[i / 4] = mask;
     }
 
-    if (dstShift)
-      m_code.push_back(dstWord);
-
-    m_mask.shrink_to_fit();
+    m_code.resize(dst - m_code.data() + CodePadding);
     m_code.shrink_to_fit();
   }
 
@@ -69,42 +68,31 @@ namespace dxvk {
 
 
   SpirvCodeBuffer SpirvCompressedBuffer::decompress() const {
+    static constexpr uint32_t s_byteMasks[4] = {
+      0x000000ffu, 0x0000ffffu, 0x00ffffffu, 0xffffffffu };
+
     SpirvCodeBuffer code(m_size);
     uint32_t* data = code.data();
 
-    if (m_size == 0)
-      return code;
-
-    uint32_t maskIdx = 0;
-    uint32_t codeIdx = 0;
-
-    uint64_t srcWord  = m_code[codeIdx++];
-    uint32_t srcShift = 0;
-
-    for (uint32_t i = 0; i < m_size; i += NumMaskWords) {
-      uint64_t srcMask = m_mask[maskIdx++];
-
-      for (uint32_t w = 0; w < NumMaskWords && i + w < m_size; w++) {
-        uint32_t bits = 8 * ((srcMask & 3) + 1);
+    const uint8_t* src = m_code.data();
 
-        uint64_t word = 0;
-        uint32_t rem = bit::unpack(word, srcWord, srcShift, bits);
+    for (uint32_t i = 0; i < m_size; i += 4) {
+      uint32_t count = std::min(m_size - i, 4u);
+      uint32_t mask  = m_mask[i / 4];
 
-        if (unlikely(rem != 0)) {
-          srcWord  = m_code[codeIdx++];
-          srcShift = 0;
+      for (uint32_t w = 0; w < count; w++) {
+        uint32_t bytes = mask & 0x3;
 
-          uint64_t tmp = 0;
-          bit::unpack(tmp, srcWord, srcShift, rem);
-          word |= tmp << (bits - rem);
-        }
+        uint32_t word;
+        std::memcpy(&word, src, sizeof(word));
+        data[i + w] = word & s_byteMasks[bytes];
 
-        data[i + w] = word;
-        srcMask >>= 2;
+        src  += bytes + 1;
+        mask >>= 2;
       }
     }
 
     return code;
   }
 
-}
\ No newline at end of file
+}
@@ -13,7 +13,7 @@ namespace dxvk {
    * to keep memory footprint low.
    */
   class SpirvCompressedBuffer {
-    constexpr static uint32_t NumMaskWords = 32;
+
   public:
 
     SpirvCompressedBuffer();
@@ -25,12 +25,20 @@ namespace dxvk {
     
     SpirvCodeBuffer decompress() const;
 
+    /**
+     * \brief Compressed size
+     * \returns Size of the compressed data, in bytes
+     */
+    size_t compressedSize() const {
+      return m_mask.size() + m_code.size();
+    }
+
   private:
 
     uint32_t              m_size;
-    std::vector<uint64_t> m_mask;
-    std::vector<uint64_t> m_code;
+    std::vector<uint8_t>  m_mask;
+    std::vector<uint8_t>  m_code;
 
   };
 
-}
\ No newline at end of file
+}
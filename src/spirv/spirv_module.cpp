@@ -364,7 +364,7 @@ namespace dxvk {
   uint32_t SpirvModule::lateConst32(
           uint32_t                typeId) {
     uint32_t resultId = this->allocateId();
-    m_lateConsts.insert(resultId);
+    m_lateConsts.insert({ resultId, m_typeConstDefs.dwords() });
 
     m_typeConstDefs.putIns (spv::OpConstant, 4);
     m_typeConstDefs.putWord(typeId);
@@ -377,19 +377,16 @@ namespace dxvk {
   void SpirvModule::setLateConst(
             uint32_t                constId,
       const uint32_t*               argIds) {
-    for (auto ins : m_typeConstDefs) {
-      if (ins.opCode() != spv::OpConstant
-       && ins.opCode() != spv::OpConstantComposite)
-        continue;
-      
-      if (ins.arg(2) != constId)
-        continue;
-
-      for (uint32_t i = 3; i < ins.length(); i++)
-        ins.setArg(i, argIds[i - 3]);
+    auto entry = m_lateConsts.find(constId);
 
+    if (entry == m_lateConsts.end())
       return;
-    }
+
+    SpirvInstruction ins(m_typeConstDefs.data(),
+      entry->second, m_typeConstDefs.dwords());
+
+    for (uint32_t i = 3; i < ins.length(); i++)
+      ins.setArg(i, argIds[i - 3]);
   }
 
 
@@ -3365,9 +3362,16 @@ namespace dxvk {
           uint32_t                argCount,
     const uint32_t*               argIds) {
     // Since the type info is stored in the code buffer,
-    // we can use the code buffer to look up type IDs as
-    // well. Result IDs are always stored as argument 1.
-    for (auto ins : m_typeConstDefs) {
+    // we only need to store offsets into the code buffer
+    // in the lookup table. Result IDs are always stored
+    // as argument 1.
+    size_t hash = hashTypeConst(op, 0, argCount, argIds);
+    auto range = m_typeLookup.equal_range(hash);
+
+    for (auto e = range.first; e != range.second; e++) {
+      SpirvInstruction ins(m_typeConstDefs.data(),
+        e->second, m_typeConstDefs.dwords());
+
       bool match = ins.opCode() == op
                 && ins.length() == 2 + argCount;
       
@@ -3380,6 +3384,8 @@ namespace dxvk {
     
     // Type not yet declared, create a new one.
     uint32_t resultId = this->allocateId();
+    m_typeLookup.insert({ hash, m_typeConstDefs.dwords() });
+
     m_typeConstDefs.putIns (op, 2 + argCount);
     m_typeConstDefs.putWord(resultId);
     
@@ -3394,8 +3400,16 @@ namespace dxvk {
           uint32_t                typeId,
           uint32_t                argCount,
     const uint32_t*               argIds) {
-    // Avoid declaring constants multiple times
-    for (auto ins : m_typeConstDefs) {
+    // Avoid declaring constants multiple times. Late
+    // constants are not in the lookup table since
+    // their values can change after declaration.
+    size_t hash = hashTypeConst(op, typeId, argCount, argIds);
+    auto range = m_constLookup.equal_range(hash);
+
+    for (auto e = range.first; e != range.second; e++) {
+      SpirvInstruction ins(m_typeConstDefs.data(),
+        e->second, m_typeConstDefs.dwords());
+
       bool match = ins.opCode() == op
                 && ins.length() == 3 + argCount
                 && ins.arg(1)   == typeId;
@@ -3403,17 +3417,14 @@ namespace dxvk {
       for (uint32_t i = 0; i < argCount && match; i++)
         match &= ins.arg(3 + i) == argIds[i];
       
-      if (!match)
-        continue;
-      
-      uint32_t id = ins.arg(2);
-
-      if (m_lateConsts.find(id) == m_lateConsts.end())
-        return id;
+      if (match)
+        return ins.arg(2);
     }
     
     // Constant not yet declared, make a new one
     uint32_t resultId = this->allocateId();
+    m_constLookup.insert({ hash, m_typeConstDefs.dwords() });
+
     m_typeConstDefs.putIns (op, 3 + argCount);
     m_typeConstDefs.putWord(typeId);
     m_typeConstDefs.putWord(resultId);
@@ -3434,6 +3445,28 @@ namespace dxvk {
   }
   
   
+  size_t SpirvModule::hashTypeConst(
+          spv::Op                 op,
+          uint32_t                typeId,
+          uint32_t                argCount,
+    const uint32_t*               argIds) {
+    // FNV-1a over the words that identify the declaration
+    size_t hash = 2166136261u;
+
+    auto addWord = [&hash] (uint32_t word) {
+      hash = (hash ^ word) * 16777619u;
+    };
+
+    addWord(uint32_t(op));
+    addWord(typeId);
+
+    for (uint32_t i = 0; i < argCount; i++)
+      addWord(argIds[i]);
+    
+    return hash;
+  }
+  
+  
   uint32_t SpirvModule::getImageOperandWordCount(const SpirvImageOperands& op) const {
     // Each flag may add one or more operands
     const uint32_t result
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <unordered_map>
 #include <unordered_set>
 
 #include "spirv_code_buffer.h"
@@ -1176,7 +1177,10 @@ namespace dxvk {
     SpirvCodeBuffer m_variables;
     SpirvCodeBuffer m_code;
 
-    std::unordered_set<uint32_t> m_lateConsts;
+    std::unordered_map<uint32_t, size_t> m_lateConsts;
+
+    std::unordered_multimap<size_t, size_t> m_typeLookup;
+    std::unordered_multimap<size_t, size_t> m_constLookup;
     
     uint32_t defType(
             spv::Op                 op, 
@@ -1191,6 +1195,12 @@ namespace dxvk {
     
     void instImportGlsl450();
     
+    static size_t hashTypeConst(
+            spv::Op                 op,
+            uint32_t                typeId,
+            uint32_t                argCount,
+      const uint32_t*               argIds);
+    
     uint32_t getImageOperandWordCount(
       const SpirvImageOperands&     op) const;
     
@@ -0,0 +1,850 @@
+#define SPV_ENABLE_UTILITY_CODE
+
+#include <algorithm>
+#include <cstring>
+
+#include "spirv_optimizer.h"
+
+namespace dxvk {
+
+  SpirvOptimizer::SpirvOptimizer(const SpirvCodeBuffer& code) {
+    const uint32_t* data  = code.data();
+    const uint32_t  count = code.dwords();
+
+    if (count < m_header.size() || data[0] != spv::MagicNumber)
+      throw DxvkError("SpirvOptimizer: Invalid SPIR-V header");
+
+    std::memcpy(m_header.data(), data, sizeof(m_header));
+    m_words.assign(data + m_header.size(), data + count);
+
+    for (uint32_t offset = 0; offset < m_words.size(); ) {
+      uint32_t length = m_words[offset] >> spv::WordCountShift;
+
+      if (!length || offset + length > m_words.size())
+        throw DxvkError("SpirvOptimizer: Invalid instruction");
+
+      m_ins.push_back({ offset, length, false, false });
+      offset += length;
+    }
+
+    this->buildIndex();
+  }
+
+
+  SpirvOptimizer::~SpirvOptimizer() {
+
+  }
+
+
+  void SpirvOptimizer::run(SpirvOptimizerPasses passes) {
+    if (passes.test(SpirvOptimizerPass::ForwardLoads))
+      this->forwardLoads();
+
+    if (passes.test(SpirvOptimizerPass::FoldConstants))
+      this->foldConstants();
+
+    if (passes.test(SpirvOptimizerPass::PruneVariables))
+      this->pruneVariables();
+
+    if (passes.test(SpirvOptimizerPass::EliminateDeadCode))
+      this->eliminateDeadCode();
+  }
+
+
+  SpirvCodeBuffer SpirvOptimizer::getCode() const {
+    SpirvCodeBuffer result;
+
+    for (uint32_t word : m_header)
+      result.putWord(word);
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (m_ins[i].removed)
+        continue;
+
+      const uint32_t* w = words(i);
+      uint32_t length = m_ins[i].length;
+
+      if (opCode(i) != spv::OpEntryPoint) {
+        for (uint32_t j = 0; j < length; j++)
+          result.putWord(w[j]);
+        continue;
+      }
+
+      // Remove pruned variables from the interface. The name
+      // string ends with the first word whose top byte is 0.
+      uint32_t nameEnd = 3;
+
+      while (nameEnd < length && (w[nameEnd++] >> 24));
+
+      std::vector<uint32_t> interfaceIds;
+
+      for (uint32_t j = nameEnd; j < length; j++) {
+        if (getDef(w[j]) != nullptr)
+          interfaceIds.push_back(w[j]);
+      }
+
+      result.putIns(spv::OpEntryPoint, nameEnd + interfaceIds.size());
+
+      for (uint32_t j = 1; j < nameEnd; j++)
+        result.putWord(w[j]);
+
+      for (uint32_t id : interfaceIds)
+        result.putWord(id);
+    }
+
+    return result;
+  }
+
+
+  std::vector<uint32_t> SpirvOptimizer::findInvalidIds() const {
+    std::vector<uint32_t> defCounts(m_defs.size(), 0);
+    std::vector<uint32_t> result;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      uint32_t resultIndex = getResultIndex(opCode(i));
+
+      if (m_ins[i].removed || !resultIndex || resultIndex >= m_ins[i].length)
+        continue;
+
+      // IDs must be below the bound declared in the header
+      uint32_t id = words(i)[resultIndex];
+
+      if (id < defCounts.size())
+        defCounts[id] += 1;
+      else
+        result.push_back(id);
+    }
+
+    std::vector<bool> used(m_defs.size(), false);
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (!m_ins[i].removed)
+        forEachOperand(i, [&used] (uint32_t id) { used[id] = true; });
+    }
+
+    for (uint32_t id = 0; id < defCounts.size(); id++) {
+      if (defCounts[id] > 1 || (used[id] && !defCounts[id]))
+        result.push_back(id);
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+
+  void SpirvOptimizer::buildIndex() {
+    m_defs.assign(m_header[3], InvalidIndex);
+    m_annotations.clear();
+    m_constants.clear();
+
+    bool inFunction = false;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (m_ins[i].removed)
+        continue;
+
+      const uint32_t* w = words(i);
+      spv::Op op = opCode(i);
+
+      if (op == spv::OpFunction)
+        inFunction = true;
+
+      m_ins[i].inFunction = inFunction;
+
+      if (op == spv::OpFunctionEnd)
+        inFunction = false;
+
+      uint32_t resultIndex = getResultIndex(op);
+
+      if (resultIndex && resultIndex < m_ins[i].length && w[resultIndex] < m_defs.size())
+        m_defs[w[resultIndex]] = i;
+
+      if (op == spv::OpName || op == spv::OpDecorate)
+        m_annotations.insert({ w[1], i });
+
+      if (op == spv::OpConstant && m_ins[i].length == 4 && !inFunction)
+        m_constants.insert({ (uint64_t(w[1]) << 32) | w[3], w[2] });
+
+      if (op == spv::OpExtInstImport && m_ins[i].length > 2) {
+        const char* name = reinterpret_cast<const char*>(&w[2]);
+
+        if (!std::strncmp(name, "GLSL.std.450", (m_ins[i].length - 2) * sizeof(uint32_t)))
+          m_glsl450 = w[1];
+      }
+    }
+  }
+
+
+  void SpirvOptimizer::countUses() {
+    m_uses.assign(m_defs.size(), 0);
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (!m_ins[i].removed)
+        forEachOperand(i, [this] (uint32_t id) { m_uses[id] += 1; });
+    }
+  }
+
+
+  void SpirvOptimizer::forwardLoads() {
+    this->countUses();
+
+    // Only consider variables that are exclusively accessed
+    // through plain loads and stores, which rules out any
+    // variables that are accessed through access chains.
+    std::vector<uint32_t> accesses(m_defs.size(), 0);
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (m_ins[i].removed)
+        continue;
+
+      const uint32_t* w = words(i);
+
+      if (opCode(i) == spv::OpLoad && m_ins[i].length == 4 && w[3] < accesses.size())
+        accesses[w[3]] += 1;
+
+      if (opCode(i) == spv::OpStore && m_ins[i].length == 3 && w[1] < accesses.size())
+        accesses[w[1]] += 1;
+    }
+
+    auto isCandidate = [this, &accesses] (uint32_t id) {
+      uint32_t index = getDefIndex(id);
+
+      if (index == InvalidIndex || opCode(index) != spv::OpVariable)
+        return false;
+
+      uint32_t storage = words(index)[3];
+
+      return (storage == spv::StorageClassPrivate || storage == spv::StorageClassFunction)
+          && (m_uses[id] == accesses[id]);
+    };
+
+    // Track the current value of each variable within a block.
+    // Function calls may write private variables, so we need
+    // to forget all values when encountering one.
+    std::unordered_map<uint32_t, uint32_t> values;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (m_ins[i].removed || !m_ins[i].inFunction)
+        continue;
+
+      const uint32_t* w = words(i);
+
+      switch (opCode(i)) {
+        case spv::OpLabel:
+        case spv::OpFunctionCall:
+          values.clear();
+          break;
+
+        case spv::OpStore:
+          if (m_ins[i].length == 3 && isCandidate(w[1]))
+            values[w[1]] = w[2];
+          break;
+
+        case spv::OpLoad:
+          if (m_ins[i].length == 4 && isCandidate(w[3])) {
+            auto entry = values.find(w[3]);
+
+            if (entry != values.end())
+              rewriteToCopy(i, w[1], w[2], entry->second);
+            else
+              values.insert({ w[3], w[2] });
+          } break;
+
+        default:
+          break;
+      }
+    }
+  }
+
+
+  void SpirvOptimizer::foldConstants() {
+    uint32_t firstFunction = InvalidIndex;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (m_ins[i].removed || !m_ins[i].inFunction)
+        continue;
+
+      if (firstFunction == InvalidIndex)
+        firstFunction = i;
+
+      this->foldInstruction(i);
+    }
+
+    // New constants were appended to the instruction list,
+    // move them in front of the first function definition
+    if (m_newConstantCount) {
+      std::rotate(
+        m_ins.begin() + firstFunction,
+        m_ins.end() - m_newConstantCount,
+        m_ins.end());
+
+      m_newConstantCount = 0;
+      this->buildIndex();
+    }
+  }
+
+
+  void SpirvOptimizer::eliminateDeadCode() {
+    this->countUses();
+
+    std::vector<uint32_t> worklist;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (!m_ins[i].removed && isPure(i) && !m_uses[words(i)[2]])
+        worklist.push_back(i);
+    }
+
+    while (!worklist.empty()) {
+      uint32_t index = worklist.back();
+      worklist.pop_back();
+
+      if (!m_ins[index].removed)
+        this->removeInstruction(index, worklist);
+    }
+  }
+
+
+  void SpirvOptimizer::pruneVariables() {
+    this->countUses();
+
+    std::vector<uint32_t> stores(m_defs.size(), 0);
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (!m_ins[i].removed && opCode(i) == spv::OpStore && words(i)[1] < stores.size())
+        stores[words(i)[1]] += 1;
+    }
+
+    // Private and function variables that are never read
+    // can be removed along with all stores, unused inputs
+    // can also be removed from the entry point interface.
+    std::vector<bool> dead(m_defs.size(), false);
+    std::vector<uint32_t> variables;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (m_ins[i].removed || opCode(i) != spv::OpVariable)
+        continue;
+
+      uint32_t id      = words(i)[2];
+      uint32_t storage = words(i)[3];
+
+      bool isDead = false;
+
+      if (storage == spv::StorageClassPrivate || storage == spv::StorageClassFunction)
+        isDead = m_uses[id] == stores[id];
+      else if (storage == spv::StorageClassInput)
+        isDead = m_uses[id] == 0;
+
+      if (isDead) {
+        dead[id] = true;
+        variables.push_back(i);
+      }
+    }
+
+    std::vector<uint32_t> worklist;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (!m_ins[i].removed && opCode(i) == spv::OpStore && dead[words(i)[1]])
+        this->removeInstruction(i, worklist);
+    }
+
+    for (uint32_t index : variables)
+      this->removeInstruction(index, worklist);
+
+    // Values that were only used by removed stores are dead now
+    while (!worklist.empty()) {
+      uint32_t index = worklist.back();
+      worklist.pop_back();
+
+      if (!m_ins[index].removed)
+        this->removeInstruction(index, worklist);
+    }
+  }
+
+
+  bool SpirvOptimizer::foldInstruction(uint32_t index) {
+    const uint32_t* w = words(index);
+    uint32_t length = m_ins[index].length;
+
+    switch (opCode(index)) {
+      case spv::OpBitcast: {
+        uint32_t typeId  = w[1];
+        uint32_t valueId = resolveCopies(w[3]);
+        uint32_t defIndex = getDefIndex(valueId);
+
+        // Bitcast back to the original type
+        if (defIndex != InvalidIndex && opCode(defIndex) == spv::OpBitcast) {
+          uint32_t srcId = resolveCopies(words(defIndex)[3]);
+
+          if (getTypeId(srcId) == typeId) {
+            rewriteToCopy(index, typeId, w[2], srcId);
+            return true;
+          }
+        }
+
+        // Bitcast of a 32-bit scalar constant
+        uint32_t value = 0;
+
+        if (getScalarConstant(valueId, value) && isScalar32BitType(typeId, false)) {
+          uint32_t resultId = w[2];
+          rewriteToCopy(index, typeId, resultId, getConstant(typeId, value));
+          return true;
+        }
+      } return false;
+
+      case spv::OpCompositeExtract: {
+        uint32_t valueId = resolveCopies(w[3]);
+
+        for (uint32_t i = 4; i < length; i++) {
+          uint32_t defIndex = getDefIndex(valueId);
+
+          if (defIndex == InvalidIndex)
+            return false;
+
+          const uint32_t* d = words(defIndex);
+          uint32_t member = w[i];
+
+          if (3 + member >= m_ins[defIndex].length)
+            return false;
+
+          bool canExtract = opCode(defIndex) == spv::OpConstantComposite;
+
+          // Vector constructed from scalars only
+          if (opCode(defIndex) == spv::OpCompositeConstruct) {
+            uint32_t typeIndex = getDefIndex(d[1]);
+
+            canExtract = typeIndex != InvalidIndex
+              && opCode(typeIndex) == spv::OpTypeVector
+              && words(typeIndex)[3] == m_ins[defIndex].length - 3;
+          }
+
+          if (!canExtract)
+            return false;
+
+          valueId = resolveCopies(d[3 + member]);
+        }
+
+        if (getTypeId(valueId) != w[1])
+          return false;
+
+        rewriteToCopy(index, w[1], w[2], valueId);
+      } return true;
+
+      case spv::OpIAdd:
+      case spv::OpISub:
+      case spv::OpIMul:
+      case spv::OpBitwiseAnd:
+      case spv::OpBitwiseOr:
+      case spv::OpBitwiseXor:
+      case spv::OpShiftLeftLogical:
+      case spv::OpShiftRightLogical: {
+        uint32_t a = 0;
+        uint32_t b = 0;
+
+        if (!isScalar32BitType(w[1], true)
+         || !getScalarConstant(resolveCopies(w[3]), a)
+         || !getScalarConstant(resolveCopies(w[4]), b))
+          return false;
+
+        uint32_t result = 0;
+
+        switch (opCode(index)) {
+          case spv::OpIAdd:             result = a + b; break;
+          case spv::OpISub:             result = a - b; break;
+          case spv::OpIMul:             result = a * b; break;
+          case spv::OpBitwiseAnd:       result = a & b; break;
+          case spv::OpBitwiseOr:        result = a | b; break;
+          case spv::OpBitwiseXor:       result = a ^ b; break;
+          case spv::OpShiftLeftLogical:  if (b >= 32) return false; result = a << b; break;
+          case spv::OpShiftRightLogical: if (b >= 32) return false; result = a >> b; break;
+          default: return false;
+        }
+
+        uint32_t typeId   = w[1];
+        uint32_t resultId = w[2];
+        rewriteToCopy(index, typeId, resultId, getConstant(typeId, result));
+      } return true;
+
+      case spv::OpSelect: {
+        uint32_t defIndex = getDefIndex(resolveCopies(w[3]));
+
+        if (defIndex == InvalidIndex)
+          return false;
+
+        if (opCode(defIndex) == spv::OpConstantTrue) {
+          rewriteToCopy(index, w[1], w[2], w[4]);
+          return true;
+        }
+
+        if (opCode(defIndex) == spv::OpConstantFalse) {
+          rewriteToCopy(index, w[1], w[2], w[5]);
+          return true;
+        }
+      } return false;
+
+      default:
+        return false;
+    }
+  }
+
+
+  void SpirvOptimizer::removeInstruction(
+          uint32_t              index,
+          std::vector<uint32_t>& worklist) {
+    m_ins[index].removed = true;
+
+    forEachOperand(index, [this, &worklist] (uint32_t id) {
+      if (!(--m_uses[id])) {
+        uint32_t defIndex = getDefIndex(id);
+
+        if (defIndex != InvalidIndex && isPure(defIndex))
+          worklist.push_back(defIndex);
+      }
+    });
+
+    // Remove debug names and decorations of the result
+    uint32_t resultIndex = getResultIndex(opCode(index));
+
+    if (resultIndex) {
+      auto range = m_annotations.equal_range(words(index)[resultIndex]);
+
+      for (auto e = range.first; e != range.second; e++)
+        m_ins[e->second].removed = true;
+    }
+  }
+
+
+  void SpirvOptimizer::rewriteToCopy(
+          uint32_t              index,
+          uint32_t              typeId,
+          uint32_t              resultId,
+          uint32_t              operandId) {
+    uint32_t* w = words(index);
+    w[0] = spv::OpCopyObject | (4u << spv::WordCountShift);
+    w[1] = typeId;
+    w[2] = resultId;
+    w[3] = operandId;
+
+    m_ins[index].length = 4;
+  }
+
+
+  uint32_t SpirvOptimizer::resolveCopies(
+          uint32_t              id) const {
+    uint32_t index = getDefIndex(id);
+
+    while (index != InvalidIndex && opCode(index) == spv::OpCopyObject) {
+      id    = words(index)[3];
+      index = getDefIndex(id);
+    }
+
+    return id;
+  }
+
+
+  uint32_t SpirvOptimizer::getTypeId(
+          uint32_t              id) const {
+    uint32_t index = getDefIndex(id);
+
+    if (index == InvalidIndex || getResultIndex(opCode(index)) != 2)
+      return 0;
+
+    return words(index)[1];
+  }
+
+
+  bool SpirvOptimizer::getScalarConstant(
+          uint32_t              id,
+          uint32_t&             value) const {
+    uint32_t index = getDefIndex(id);
+
+    if (index == InvalidIndex
+     || opCode(index) != spv::OpConstant
+     || m_ins[index].length != 4
+     || !isScalar32BitType(words(index)[1], false))
+      return false;
+
+    value = words(index)[3];
+    return true;
+  }
+
+
+  bool SpirvOptimizer::isScalar32BitType(
+          uint32_t              typeId,
+          bool                  intOnly) const {
+    uint32_t index = getDefIndex(typeId);
+
+    if (index == InvalidIndex)
+      return false;
+
+    spv::Op op = opCode(index);
+
+    return (op == spv::OpTypeInt || (op == spv::OpTypeFloat && !intOnly))
+        && (words(index)[2] == 32);
+  }
+
+
+  uint32_t SpirvOptimizer::getConstant(
+          uint32_t              typeId,
+          uint32_t              value) {
+    uint64_t key = (uint64_t(typeId) << 32) | value;
+    auto entry = m_constants.find(key);
+
+    if (entry != m_constants.end())
+      return entry->second;
+
+    uint32_t resultId = m_header[3]++;
+    uint32_t offset   = m_words.size();
+
+    m_words.push_back(spv::OpConstant | (4u << spv::WordCountShift));
+    m_words.push_back(typeId);
+    m_words.push_back(resultId);
+    m_words.push_back(value);
+
+    m_defs.resize(m_header[3], InvalidIndex);
+    m_defs[resultId] = m_ins.size();
+
+    m_ins.push_back({ offset, 4, false, false });
+    m_constants.insert({ key, resultId });
+
+    m_newConstantCount += 1;
+    return resultId;
+  }
+
+
+  bool SpirvOptimizer::isPure(
+          uint32_t              index) const {
+    if (!m_ins[index].inFunction)
+      return false;
+
+    switch (opCode(index)) {
+      // Plain loads only, volatile loads have memory operands
+      case spv::OpLoad:
+        return m_ins[index].length == 4;
+
+      case spv::OpExtInst:
+        return m_glsl450 && words(index)[3] == m_glsl450;
+
+      case spv::OpUndef:
+      case spv::OpCopyObject:
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpArrayLength:
+      case spv::OpVectorExtractDynamic:
+      case spv::OpVectorInsertDynamic:
+      case spv::OpVectorShuffle:
+      case spv::OpCompositeConstruct:
+      case spv::OpCompositeExtract:
+      case spv::OpCompositeInsert:
+      case spv::OpSampledImage:
+      case spv::OpImage:
+      case spv::OpImageSampleImplicitLod:
+      case spv::OpImageSampleExplicitLod:
+      case spv::OpImageSampleDrefImplicitLod:
+      case spv::OpImageSampleDrefExplicitLod:
+      case spv::OpImageFetch:
+      case spv::OpImageGather:
+      case spv::OpImageDrefGather:
+      case spv::OpImageRead:
+      case spv::OpImageQuerySizeLod:
+      case spv::OpImageQuerySize:
+      case spv::OpImageQueryLod:
+      case spv::OpImageQueryLevels:
+      case spv::OpImageQuerySamples:
+      case spv::OpConvertFToU:
+      case spv::OpConvertFToS:
+      case spv::OpConvertSToF:
+      case spv::OpConvertUToF:
+      case spv::OpUConvert:
+      case spv::OpSConvert:
+      case spv::OpFConvert:
+      case spv::OpQuantizeToF16:
+      case spv::OpBitcast:
+      case spv::OpSNegate:
+      case spv::OpFNegate:
+      case spv::OpIAdd:
+      case spv::OpFAdd:
+      case spv::OpISub:
+      case spv::OpFSub:
+      case spv::OpIMul:
+      case spv::OpFMul:
+      case spv::OpUDiv:
+      case spv::OpSDiv:
+      case spv::OpFDiv:
+      case spv::OpUMod:
+      case spv::OpSRem:
+      case spv::OpSMod:
+      case spv::OpFRem:
+      case spv::OpFMod:
+      case spv::OpVectorTimesScalar:
+      case spv::OpMatrixTimesScalar:
+      case spv::OpVectorTimesMatrix:
+      case spv::OpMatrixTimesVector:
+      case spv::OpMatrixTimesMatrix:
+      case spv::OpDot:
+      case spv::OpIAddCarry:
+      case spv::OpISubBorrow:
+      case spv::OpUMulExtended:
+      case spv::OpSMulExtended:
+      case spv::OpAny:
+      case spv::OpAll:
+      case spv::OpIsNan:
+      case spv::OpIsInf:
+      case spv::OpLogicalEqual:
+      case spv::OpLogicalNotEqual:
+      case spv::OpLogicalOr:
+      case spv::OpLogicalAnd:
+      case spv::OpLogicalNot:
+      case spv::OpSelect:
+      case spv::OpIEqual:
+      case spv::OpINotEqual:
+      case spv::OpUGreaterThan:
+      case spv::OpSGreaterThan:
+      case spv::OpUGreaterThanEqual:
+      case spv::OpSGreaterThanEqual:
+      case spv::OpULessThan:
+      case spv::OpSLessThan:
+      case spv::OpULessThanEqual:
+      case spv::OpSLessThanEqual:
+      case spv::OpFOrdEqual:
+      case spv::OpFUnordEqual:
+      case spv::OpFOrdNotEqual:
+      case spv::OpFUnordNotEqual:
+      case spv::OpFOrdLessThan:
+      case spv::OpFUnordLessThan:
+      case spv::OpFOrdGreaterThan:
+      case spv::OpFUnordGreaterThan:
+      case spv::OpFOrdLessThanEqual:
+      case spv::OpFUnordLessThanEqual:
+      case spv::OpFOrdGreaterThanEqual:
+      case spv::OpFUnordGreaterThanEqual:
+      case spv::OpShiftRightLogical:
+      case spv::OpShiftRightArithmetic:
+      case spv::OpShiftLeftLogical:
+      case spv::OpBitwiseOr:
+      case spv::OpBitwiseXor:
+      case spv::OpBitwiseAnd:
+      case spv::OpNot:
+      case spv::OpBitFieldInsert:
+      case spv::OpBitFieldSExtract:
+      case spv::OpBitFieldUExtract:
+      case spv::OpBitReverse:
+      case spv::OpBitCount:
+      case spv::OpPhi:
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+
+  template<typename Fn>
+  void SpirvOptimizer::forEachOperand(
+          uint32_t              index,
+    const Fn&                   fn) const {
+    spv::Op op = opCode(index);
+
+    if (isAnnotation(op))
+      return;
+
+    // Operands of instructions that isLiteral does not know
+    // about are all treated as potential IDs. This may keep
+    // some values alive, but never removes anything in use.
+    const uint32_t* w = words(index);
+    uint32_t resultIndex = getResultIndex(op);
+
+    for (uint32_t i = 1; i < m_ins[index].length; i++) {
+      if (i != resultIndex && !isLiteral(op, i) && w[i] < m_defs.size())
+        fn(w[i]);
+    }
+  }
+
+
+  uint32_t SpirvOptimizer::getResultIndex(
+          spv::Op               op) {
+    bool hasResult     = false;
+    bool hasResultType = false;
+    spv::HasResultAndType(op, &hasResult, &hasResultType);
+
+    if (!hasResult)
+      return 0;
+
+    return hasResultType ? 2 : 1;
+  }
+
+
+  bool SpirvOptimizer::isLiteral(
+          spv::Op               op,
+          uint32_t              index) {
+    switch (op) {
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+        return index >= 2;
+
+      case spv::OpTypePointer:
+        return index == 2;
+
+      case spv::OpTypeVector:
+      case spv::OpTypeMatrix:
+      case spv::OpVariable:
+      case spv::OpFunction:
+        return index == 3;
+
+      case spv::OpTypeImage:
+      case spv::OpConstant:
+      case spv::OpSpecConstant:
+      case spv::OpStore:
+      case spv::OpLoopMerge:
+        return index >= 3;
+
+      case spv::OpLoad:
+      case spv::OpCompositeExtract:
+      case spv::OpBranchConditional:
+        return index >= 4;
+
+      case spv::OpCompositeInsert:
+      case spv::OpVectorShuffle:
+        return index >= 5;
+
+      case spv::OpExtInst:
+        return index == 4;
+
+      case spv::OpSelectionMerge:
+        return index == 2;
+
+      case spv::OpSwitch:
+        return index >= 3 && (index & 1);
+
+      default:
+        return false;
+    }
+  }
+
+
+  bool SpirvOptimizer::isAnnotation(
+          spv::Op               op) {
+    switch (op) {
+      case spv::OpCapability:
+      case spv::OpExtension:
+      case spv::OpExtInstImport:
+      case spv::OpMemoryModel:
+      case spv::OpEntryPoint:
+      case spv::OpExecutionMode:
+      case spv::OpSource:
+      case spv::OpSourceExtension:
+      case spv::OpString:
+      case spv::OpName:
+      case spv::OpMemberName:
+      case spv::OpLine:
+      case spv::OpNoLine:
+      case spv::OpModuleProcessed:
+      case spv::OpDecorate:
+      case spv::OpMemberDecorate:
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+}
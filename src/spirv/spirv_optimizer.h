@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "spirv_code_buffer.h"
+#include "spirv_include.h"
+
+namespace dxvk {
+
+  /**
+   * \brief SPIR-V optimization passes
+   */
+  enum class SpirvOptimizerPass : uint32_t {
+    ForwardLoads,       ///< Forward stored values to loads within a block
+    FoldConstants,      ///< Fold constant expressions and redundant casts
+    EliminateDeadCode,  ///< Remove unused side effect free instructions
+    PruneVariables,     ///< Remove unused and write-only variables
+  };
+
+  using SpirvOptimizerPasses = Flags<SpirvOptimizerPass>;
+
+
+  /**
+   * \brief SPIR-V optimizer
+   *
+   * Performs simple optimizations on a complete SPIR-V
+   * module. The DXBC compiler generates very literal
+   * code, e.g. it loads temporary registers from memory
+   * every time they are read, which drivers have to
+   * clean up at pipeline compile time.
+   *
+   * Instructions that do not need to be removed are
+   * rewritten in place to \c OpCopyObject rather than
+   * renaming all uses of their result, since that would
+   * require knowing which operands of every instruction
+   * are IDs. Drivers eliminate copies trivially.
+   */
+  class SpirvOptimizer {
+
+  public:
+
+    SpirvOptimizer(const SpirvCodeBuffer& code);
+    ~SpirvOptimizer();
+
+    /**
+     * \brief Runs optimization passes
+     *
+     * Passes are always run in a fixed order that
+     * lets later passes benefit from earlier ones.
+     * \param [in] passes Passes to run
+     */
+    void run(SpirvOptimizerPasses passes);
+
+    /**
+     * \brief Retrieves optimized code
+     * \returns Optimized SPIR-V module
+     */
+    SpirvCodeBuffer getCode() const;
+
+    /**
+     * \brief Finds invalid ID references
+     *
+     * Looks for IDs that are used as an operand but never
+     * defined, and for IDs that are defined more than once.
+     * Literal operands of instructions that the optimizer
+     * does not know about may be reported as well, so this
+     * is only useful to compare modules before and after
+     * optimization.
+     * \returns Invalid IDs, in ascending order
+     */
+    std::vector<uint32_t> findInvalidIds() const;
+
+  private:
+
+    constexpr static uint32_t InvalidIndex = ~0u;
+
+    struct Instruction {
+      uint32_t offset;
+      uint32_t length;
+      bool     inFunction;
+      bool     removed;
+    };
+
+    std::array<uint32_t, 5>   m_header = { };
+    std::vector<uint32_t>     m_words;
+    std::vector<Instruction>  m_ins;
+
+    std::vector<uint32_t>     m_defs;
+    std::vector<uint32_t>     m_uses;
+
+    std::unordered_multimap<uint32_t, uint32_t> m_annotations;
+
+    std::unordered_map<uint64_t, uint32_t> m_constants;
+    uint32_t                  m_newConstantCount = 0;
+
+    uint32_t                  m_glsl450 = 0;
+
+    void buildIndex();
+
+    void countUses();
+
+    void forwardLoads();
+
+    void foldConstants();
+
+    void eliminateDeadCode();
+
+    void pruneVariables();
+
+    bool foldInstruction(
+            uint32_t              index);
+
+    void removeInstruction(
+            uint32_t              index,
+            std::vector<uint32_t>& worklist);
+
+    void rewriteToCopy(
+            uint32_t              index,
+            uint32_t              typeId,
+            uint32_t              resultId,
+            uint32_t              operandId);
+
+    uint32_t resolveCopies(
+            uint32_t              id) const;
+
+    uint32_t getTypeId(
+            uint32_t              id) const;
+
+    bool getScalarConstant(
+            uint32_t              id,
+            uint32_t&             value) const;
+
+    bool isScalar32BitType(
+            uint32_t              typeId,
+            bool                  intOnly) const;
+
+    uint32_t getConstant(
+            uint32_t              typeId,
+            uint32_t              value);
+
+    bool isPure(
+            uint32_t              index) const;
+
+    uint32_t* words(
+            uint32_t              index) {
+      return &m_words[m_ins[index].offset];
+    }
+
+    const uint32_t* words(
+            uint32_t              index) const {
+      return &m_words[m_ins[index].offset];
+    }
+
+    spv::Op opCode(
+            uint32_t              index) const {
+      return spv::Op(m_words[m_ins[index].offset] & spv::OpCodeMask);
+    }
+
+    const Instruction* getDef(
+            uint32_t              id) const {
+      uint32_t index = id < m_defs.size() ? m_defs[id] : InvalidIndex;
+      return index != InvalidIndex && !m_ins[index].removed ? &m_ins[index] : nullptr;
+    }
+
+    uint32_t getDefIndex(
+            uint32_t              id) const {
+      const Instruction* ins = getDef(id);
+      return ins ? uint32_t(ins - m_ins.data()) : InvalidIndex;
+    }
+
+    template<typename Fn>
+    void forEachOperand(
+            uint32_t              index,
+      const Fn&                   fn) const;
+
+    static uint32_t getResultIndex(
+            spv::Op               op);
+
+    static bool isLiteral(
+            spv::Op               op,
+            uint32_t              index);
+
+    static bool isAnnotation(
+            spv::Op               op);
+
+  };
+
+}
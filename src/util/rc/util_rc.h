@@ -27,6 +27,36 @@ namespace dxvk {
       return --m_refCount;
     }
     
+    /**
+     * \brief Increments reference count if non-zero
+     * 
+     * Used to obtain a reference to an object that may
+     * concurrently be destroyed, e.g. when looking it up
+     * in a registry that it removes itself from.
+     * \returns \c true if a reference was acquired
+     */
+    bool tryIncRef() {
+      uint32_t refCount = m_refCount.load();
+
+      do {
+        if (!refCount)
+          return false;
+      } while (!m_refCount.compare_exchange_weak(refCount, refCount + 1));
+
+      return true;
+    }
+    
+    /**
+     * \brief Checks whether there is only one reference
+     * 
+     * Only meaningful if the caller holds that reference,
+     * since no other thread can acquire a new one then.
+     * \returns \c true if the reference count is one
+     */
+    bool isUnique() const {
+      return m_refCount.load() == 1;
+    }
+    
   private:
     
     std::atomic<uint32_t> m_refCount = { 0u };
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dxvk::sync {
+
+  /**
+   * \brief Multi-producer, single-consumer ring
+   *
+   * Bounded lock-free queue which can be written to by
+   * any number of threads, but must only be read from
+   * by one thread at a time. Each slot carries its own
+   * sequence number, so that producers only contend on
+   * the write position and never block the consumer.
+   * \tparam T Item type, must be default-constructible
+   * \tparam N Capacity, must be a power of two
+   */
+  template<typename T, size_t N>
+  class MpscRing {
+    static_assert(N && !(N & (N - 1)), "Ring capacity must be a power of two");
+  public:
+
+    MpscRing() {
+      for (size_t i = 0; i < N; i++)
+        m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing             (const MpscRing&) = delete;
+    MpscRing& operator = (const MpscRing&) = delete;
+
+    /**
+     * \brief Tries to add an item to the ring
+     *
+     * \param [in] item The item to add
+     * \returns \c false if the ring is full, in which
+     *    case the item will not have been moved from
+     */
+    bool tryPush(T&& item) {
+      size_t pos = m_writePos.load(std::memory_order_relaxed);
+      Slot* slot;
+
+      while (true) {
+        slot = &m_slots[pos & (N - 1)];
+
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(seq) - intptr_t(pos);
+
+        if (diff == 0) {
+          if (m_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = m_writePos.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot->item = std::move(item);
+      slot->seq.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * \brief Tries to remove an item from the ring
+     *
+     * Must only be called from the consumer thread.
+     * \param [out] item The item that was removed
+     * \returns \c false if the ring is empty
+     */
+    bool tryPop(T& item) {
+      size_t pos = m_readPos.load(std::memory_order_relaxed);
+      Slot* slot = &m_slots[pos & (N - 1)];
+
+      if (slot->seq.load(std::memory_order_acquire) != pos + 1)
+        return false;
+
+      item = std::move(slot->item);
+      slot->item = T();
+      slot->seq.store(pos + N, std::memory_order_release);
+
+      m_readPos.store(pos + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+  private:
+
+    struct Slot {
+      std::atomic<size_t> seq;
+      T                   item;
+    };
+
+    alignas(64) std::atomic<size_t> m_writePos = { 0 };
+    alignas(64) std::atomic<size_t> m_readPos  = { 0 };
+    alignas(64) Slot                m_slots[N];
+
+  };
+
+}
@@ -62,6 +62,27 @@ namespace dxvk::bit {
     #endif
   }
 
+  inline uint32_t tzcnt(uint64_t n) {
+    uint32_t lo = uint32_t(n);
+    uint32_t hi = uint32_t(n >> 32);
+    return lo ? tzcnt(lo) : 32 + tzcnt(hi);
+  }
+
+  inline uint32_t bsr(uint64_t n) {
+    #if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(n);
+    #else
+    uint32_t r = 0;
+    r += (n >> (r + 32)) ? 32 : 0;
+    r += (n >> (r + 16)) ? 16 : 0;
+    r += (n >> (r +  8)) ?  8 : 0;
+    r += (n >> (r +  4)) ?  4 : 0;
+    r += (n >> (r +  2)) ?  2 : 0;
+    r += (n >> (r +  1)) ?  1 : 0;
+    return r;
+    #endif
+  }
+
   template<typename T>
   uint32_t pack(T& dst, uint32_t& shift, T src, uint32_t count) {
     constexpr uint32_t Bits = 8 * sizeof(T);
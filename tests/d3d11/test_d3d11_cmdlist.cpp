@@ -0,0 +1,272 @@
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <d3d11_1.h>
+
+#include <windows.h>
+#include <windowsx.h>
+
+#include "../test_utils.h"
+
+using namespace dxvk;
+
+// Runs several threads that record command lists which discard
+// and update buffers, and executes those command lists on the
+// immediate context, which discards and updates the buffers that
+// the command lists read in between. Meant to be run with multiple
+// recording threads, which this test enables unless a config file
+// is set.
+constexpr uint32_t ThreadCount    = 4;
+constexpr uint32_t SlotCount      = 4;
+constexpr uint32_t IterationCount = 1024;
+constexpr uint32_t ReadbackPeriod = 16;
+
+struct Data {
+  uint32_t iteration;
+  uint32_t thread;
+  uint32_t kind;
+  uint32_t check;
+};
+
+Com<ID3D11Device>           g_d3d11Device;
+Com<ID3D11DeviceContext>    g_d3d11Context;
+
+Com<ID3D11Buffer>           g_resultBuffer;
+Com<ID3D11Buffer>           g_readBuffer;
+
+struct ThreadData {
+  Com<ID3D11DeviceContext>  context;
+  Com<ID3D11Buffer>         dynamicBuffer;
+  Com<ID3D11Buffer>         defaultBuffer;
+  Com<ID3D11Buffer>         scratchBuffer;
+  Com<ID3D11Buffer>         sharedDynamicBuffer;
+  Com<ID3D11Buffer>         sharedDefaultBuffer;
+  Com<ID3D11CommandList>    mapList;
+  Com<ID3D11CommandList>    updateList;
+  bool                      failed = false;
+};
+
+std::array<ThreadData, ThreadCount> g_threads;
+
+
+Data makeData(uint32_t iteration, uint32_t thread, uint32_t kind) {
+  return Data { iteration, thread, kind, ~(iteration ^ (thread << 16) ^ (kind << 24)) };
+}
+
+
+bool createBuffer(UINT size, D3D11_USAGE usage, UINT bindFlags, UINT cpuFlags, ID3D11Buffer** ppBuffer) {
+  D3D11_BUFFER_DESC desc;
+  desc.ByteWidth           = size;
+  desc.Usage               = usage;
+  desc.BindFlags           = bindFlags;
+  desc.CPUAccessFlags      = cpuFlags;
+  desc.MiscFlags           = 0;
+  desc.StructureByteStride = 0;
+
+  return SUCCEEDED(g_d3d11Device->CreateBuffer(&desc, nullptr, ppBuffer));
+}
+
+
+void recordCommandLists(uint32_t iteration, uint32_t thread) {
+  ThreadData& data = g_threads[thread];
+
+  D3D11_BOX box = { 0, 0, 0, sizeof(Data), 1, 1 };
+
+  // Command list that discards a dynamic buffer,
+  // which must be executed on the CS thread
+  D3D11_MAPPED_SUBRESOURCE mapped;
+
+  if (FAILED(data.context->Map(data.dynamicBuffer.ptr(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+    data.failed = true;
+    return;
+  }
+
+  Data mapData = makeData(iteration, thread, 0);
+  std::memcpy(mapped.pData, &mapData, sizeof(mapData));
+  data.context->Unmap(data.dynamicBuffer.ptr(), 0);
+
+  data.context->CopySubresourceRegion(g_resultBuffer.ptr(), 0,
+    sizeof(Data) * (SlotCount * thread + 0), 0, 0, data.dynamicBuffer.ptr(), 0, &box);
+
+  if (FAILED(data.context->FinishCommandList(FALSE, &data.mapList))) {
+    data.failed = true;
+    return;
+  }
+
+  // Command list that only updates and discards default buffers,
+  // which may be recorded in parallel, but must not rename them
+  Data updateData = makeData(iteration, thread, 1);
+  data.context->UpdateSubresource(data.defaultBuffer.ptr(), 0, nullptr, &updateData, 0, 0);
+
+  Com<ID3D11DeviceContext1> context1;
+  data.context->QueryInterface(__uuidof(ID3D11DeviceContext1),
+    reinterpret_cast<void**>(&context1));
+
+  if (context1 != nullptr)
+    context1->DiscardResource(data.scratchBuffer.ptr());
+
+  data.context->CopySubresourceRegion(data.scratchBuffer.ptr(), 0,
+    0, 0, 0, data.defaultBuffer.ptr(), 0, &box);
+  data.context->CopySubresourceRegion(g_resultBuffer.ptr(), 0,
+    sizeof(Data) * (SlotCount * thread + 1), 0, 0, data.scratchBuffer.ptr(), 0, &box);
+
+  // Buffers written by the immediate context, the command
+  // list must read the contents they have when it executes
+  data.context->CopySubresourceRegion(g_resultBuffer.ptr(), 0,
+    sizeof(Data) * (SlotCount * thread + 2), 0, 0, data.sharedDynamicBuffer.ptr(), 0, &box);
+  data.context->CopySubresourceRegion(g_resultBuffer.ptr(), 0,
+    sizeof(Data) * (SlotCount * thread + 3), 0, 0, data.sharedDefaultBuffer.ptr(), 0, &box);
+
+  if (FAILED(data.context->FinishCommandList(FALSE, &data.updateList))) {
+    data.failed = true;
+    return;
+  }
+}
+
+
+bool writeSharedBuffers(ThreadData& data, const Data& dynamicData, const Data& defaultData) {
+  D3D11_MAPPED_SUBRESOURCE mapped;
+
+  if (FAILED(g_d3d11Context->Map(data.sharedDynamicBuffer.ptr(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+    return false;
+
+  std::memcpy(mapped.pData, &dynamicData, sizeof(dynamicData));
+  g_d3d11Context->Unmap(data.sharedDynamicBuffer.ptr(), 0);
+
+  g_d3d11Context->UpdateSubresource(data.sharedDefaultBuffer.ptr(), 0, nullptr, &defaultData, 0, 0);
+  return true;
+}
+
+
+bool checkResults(uint32_t iteration) {
+  g_d3d11Context->CopyResource(g_readBuffer.ptr(), g_resultBuffer.ptr());
+
+  D3D11_MAPPED_SUBRESOURCE mapped;
+
+  if (FAILED(g_d3d11Context->Map(g_readBuffer.ptr(), 0, D3D11_MAP_READ, 0, &mapped))) {
+    std::cerr << "Failed to map readback buffer" << std::endl;
+    return false;
+  }
+
+  auto results = reinterpret_cast<const Data*>(mapped.pData);
+  bool success = true;
+
+  for (uint32_t i = 0; i < SlotCount * ThreadCount; i++) {
+    Data expected = makeData(iteration, i / SlotCount, i % SlotCount);
+
+    if (std::memcmp(&results[i], &expected, sizeof(expected))) {
+      std::cerr << "Iteration " << iteration << ", slot " << i << ": Got "
+        << results[i].iteration << ", " << results[i].thread << ", "
+        << results[i].kind << ", " << results[i].check << std::endl;
+      success = false;
+    }
+  }
+
+  g_d3d11Context->Unmap(g_readBuffer.ptr(), 0);
+  return success;
+}
+
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  if (!::GetEnvironmentVariableA("DXVK_CONFIG_FILE", nullptr, 0)) {
+    const char* configPath = "d3d11-cmdlist.conf";
+    std::ofstream config(configPath);
+    config << "d3d11.numRecordingThreads = " << ThreadCount << std::endl;
+    ::SetEnvironmentVariableA("DXVK_CONFIG_FILE", configPath);
+  }
+
+  if (FAILED(D3D11CreateDevice(
+        nullptr, D3D_DRIVER_TYPE_HARDWARE,
+        nullptr, 0, nullptr, 0, D3D11_SDK_VERSION,
+        &g_d3d11Device, nullptr, &g_d3d11Context))) {
+    std::cerr << "Failed to create D3D11 device" << std::endl;
+    return 1;
+  }
+
+  if (!createBuffer(sizeof(Data) * SlotCount * ThreadCount, D3D11_USAGE_DEFAULT,
+        D3D11_BIND_SHADER_RESOURCE, 0, &g_resultBuffer)
+   || !createBuffer(sizeof(Data) * SlotCount * ThreadCount, D3D11_USAGE_STAGING,
+        0, D3D11_CPU_ACCESS_READ, &g_readBuffer)) {
+    std::cerr << "Failed to create result buffers" << std::endl;
+    return 1;
+  }
+
+  for (auto& data : g_threads) {
+    if (FAILED(g_d3d11Device->CreateDeferredContext(0, &data.context))) {
+      std::cerr << "Failed to create deferred context" << std::endl;
+      return 1;
+    }
+
+    if (!createBuffer(sizeof(Data), D3D11_USAGE_DYNAMIC,
+          D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE, &data.dynamicBuffer)
+     || !createBuffer(sizeof(Data), D3D11_USAGE_DEFAULT,
+          D3D11_BIND_CONSTANT_BUFFER, 0, &data.defaultBuffer)
+     || !createBuffer(sizeof(Data), D3D11_USAGE_DEFAULT,
+          D3D11_BIND_CONSTANT_BUFFER, 0, &data.scratchBuffer)
+     || !createBuffer(sizeof(Data), D3D11_USAGE_DYNAMIC,
+          D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE, &data.sharedDynamicBuffer)
+     || !createBuffer(sizeof(Data), D3D11_USAGE_DEFAULT,
+          D3D11_BIND_CONSTANT_BUFFER, 0, &data.sharedDefaultBuffer)) {
+      std::cerr << "Failed to create buffers" << std::endl;
+      return 1;
+    }
+  }
+
+  uint32_t failures = 0;
+
+  for (uint32_t i = 0; i < IterationCount; i++) {
+    std::vector<std::thread> threads;
+
+    for (uint32_t t = 0; t < ThreadCount; t++)
+      threads.emplace_back([i, t] { recordCommandLists(i, t); });
+
+    for (auto& thread : threads)
+      thread.join();
+
+    for (uint32_t t = 0; t < ThreadCount; t++) {
+      ThreadData& data = g_threads[t];
+
+      if (data.failed) {
+        std::cerr << "Failed to record command list" << std::endl;
+        return 1;
+      }
+
+      if (!writeSharedBuffers(data, makeData(i, t, 2), makeData(i, t, 3))) {
+        std::cerr << "Failed to map shared buffer" << std::endl;
+        return 1;
+      }
+
+      // Replay the update list, which is
+      // idempotent, to test resubmission
+      g_d3d11Context->ExecuteCommandList(data.mapList.ptr(), FALSE);
+      g_d3d11Context->ExecuteCommandList(data.updateList.ptr(), FALSE);
+      g_d3d11Context->ExecuteCommandList(data.updateList.ptr(), FALSE);
+
+      // Discard and update the shared buffers again while the
+      // command lists may still be getting recorded. Neither
+      // write must be visible to the command lists above.
+      if (!writeSharedBuffers(data, Data(), Data())) {
+        std::cerr << "Failed to map shared buffer" << std::endl;
+        return 1;
+      }
+
+      data.mapList    = nullptr;
+      data.updateList = nullptr;
+    }
+
+    if ((i + 1) % ReadbackPeriod == 0 && !checkResults(i))
+      failures += 1;
+  }
+
+  std::cout << "Executed " << IterationCount * ThreadCount * 3 << " command lists, "
+            << failures << " readbacks failed" << std::endl;
+
+  g_d3d11Context->ClearState();
+  return failures ? 1 : 0;
+}
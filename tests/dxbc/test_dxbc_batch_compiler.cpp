@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+
+#include "../../src/dxbc/dxbc_module.h"
+#include "../../src/dxvk/dxvk_shader.h"
+
+#include <shellapi.h>
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxbc-batch-compiler.log");
+}
+
+using namespace dxvk;
+
+using BatchClock = std::chrono::high_resolution_clock;
+
+/**
+ * \brief Batch compile job
+ *
+ * One DXBC blob to translate, along
+ * with the SPIR-V output path.
+ */
+struct BatchJob {
+  std::wstring inputPath;
+  std::wstring outputPath;
+  std::string  name;
+};
+
+
+/**
+ * \brief Batch compile result
+ *
+ * Per-shader timing and size statistics. Times
+ * are given in microseconds, sizes in bytes.
+ */
+struct BatchResult {
+  bool      success     = false;
+  uint32_t  worker      = 0;
+  size_t    dxbcSize    = 0;
+  size_t    spirvSize   = 0;
+  uint64_t  readUs      = 0;
+  uint64_t  parseUs     = 0;
+  uint64_t  compileUs   = 0;
+  uint64_t  writeUs     = 0;
+};
+
+
+/**
+ * \brief Work-stealing job pool
+ *
+ * Each worker owns a queue of job indices and pops
+ * work from its front. Once the local queue runs
+ * dry, the worker steals from the back of the other
+ * queues, so that a few very large shaders do not
+ * leave the remaining workers idle.
+ */
+class BatchJobPool {
+
+public:
+
+  BatchJobPool(uint32_t workerCount, size_t jobCount)
+  : m_queues(workerCount) {
+    for (size_t i = 0; i < jobCount; i++)
+      m_queues[i % workerCount].jobs.push_back(i);
+  }
+
+  bool getJob(uint32_t worker, size_t& job) {
+    if (popLocal(worker, job))
+      return true;
+
+    for (uint32_t i = 1; i < m_queues.size(); i++) {
+      uint32_t victim = (worker + i) % m_queues.size();
+
+      if (steal(victim, job)) {
+        m_steals += 1;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  uint64_t stealCount() const {
+    return m_steals.load();
+  }
+
+private:
+
+  struct Queue {
+    std::mutex          mutex;
+    std::deque<size_t>  jobs;
+  };
+
+  std::vector<Queue>    m_queues;
+  std::atomic<uint64_t> m_steals = { 0ull };
+
+  bool popLocal(uint32_t worker, size_t& job) {
+    Queue& queue = m_queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.jobs.empty())
+      return false;
+
+    job = queue.jobs.front();
+    queue.jobs.pop_front();
+    return true;
+  }
+
+  bool steal(uint32_t victim, size_t& job) {
+    Queue& queue = m_queues[victim];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.jobs.empty())
+      return false;
+
+    job = queue.jobs.back();
+    queue.jobs.pop_back();
+    return true;
+  }
+
+};
+
+
+static uint64_t elapsedUs(BatchClock::time_point t0, BatchClock::time_point t1) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+}
+
+
+static std::vector<BatchJob> findJobs(
+  const std::wstring& inputDir,
+  const std::wstring& outputDir) {
+  std::vector<BatchJob> jobs;
+
+  WIN32_FIND_DATAW findData;
+  HANDLE handle = ::FindFirstFileW((inputDir + L"\\*").c_str(), &findData);
+
+  if (handle == INVALID_HANDLE_VALUE)
+    return jobs;
+
+  do {
+    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      continue;
+
+    std::wstring fileName = findData.cFileName;
+    std::wstring baseName = fileName.substr(0, fileName.find_last_of(L'.'));
+
+    BatchJob job;
+    job.inputPath  = inputDir  + L"\\" + fileName;
+    job.outputPath = outputDir + L"\\" + baseName + L".spv";
+    job.name       = str::fromws(fileName.c_str());
+    jobs.push_back(std::move(job));
+  } while (::FindNextFileW(handle, &findData));
+
+  ::FindClose(handle);
+  return jobs;
+}
+
+
+static BatchResult compileJob(
+  const BatchJob&       job,
+  const DxbcModuleInfo& moduleInfo) {
+  BatchResult result;
+
+  try {
+    auto t0 = BatchClock::now();
+
+    std::ifstream ifile(str::fromws(job.inputPath.c_str()), std::ios::binary);
+    std::vector<char> dxbcCode(
+      (std::istreambuf_iterator<char>(ifile)),
+       std::istreambuf_iterator<char>());
+    result.dxbcSize = dxbcCode.size();
+
+    auto t1 = BatchClock::now();
+
+    DxbcReader reader(dxbcCode.data(), dxbcCode.size());
+    DxbcModule module(reader);
+
+    auto t2 = BatchClock::now();
+
+    Rc<DxvkShader> shader = module.compile(moduleInfo, job.name);
+
+    auto t3 = BatchClock::now();
+
+    std::ostringstream spirv;
+    shader->dump(spirv);
+    result.spirvSize = spirv.tellp();
+
+    std::ofstream ofile(str::fromws(job.outputPath.c_str()), std::ios::binary);
+    ofile << spirv.str();
+
+    auto t4 = BatchClock::now();
+
+    result.readUs    = elapsedUs(t0, t1);
+    result.parseUs   = elapsedUs(t1, t2);
+    result.compileUs = elapsedUs(t2, t3);
+    result.writeUs   = elapsedUs(t3, t4);
+    result.success   = true;
+  } catch (const DxvkError& e) {
+    Logger::err(str::format(job.name, ": ", e.message()));
+  }
+
+  return result;
+}
+
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  int     argc = 0;
+  LPWSTR* argv = CommandLineToArgvW(
+    GetCommandLineW(), &argc);
+
+  if (argc < 3) {
+    Logger::err("Usage: dxbc-batch-compiler input_dir output_dir [threads]");
+    return 1;
+  }
+
+  std::wstring inputDir  = argv[1];
+  std::wstring outputDir = argv[2];
+
+  uint32_t workerCount = dxvk::thread::hardware_concurrency();
+
+  if (argc > 3)
+    workerCount = std::wcstoul(argv[3], nullptr, 10);
+
+  if (!workerCount)
+    workerCount = 1;
+
+  DxbcModuleInfo moduleInfo;
+  moduleInfo.options.useSubgroupOpsForAtomicCounters = true;
+  moduleInfo.options.useDemoteToHelperInvocation = true;
+  moduleInfo.options.minSsboAlignment = 4;
+  moduleInfo.xfb = nullptr;
+  moduleInfo.spec = nullptr;
+
+  std::vector<BatchJob>    jobs = findJobs(inputDir, outputDir);
+  std::vector<BatchResult> results(jobs.size());
+
+  if (jobs.empty()) {
+    Logger::err(str::format("No input files found in ", str::fromws(inputDir.c_str())));
+    return 1;
+  }
+
+  Logger::info(str::format("Compiling ", jobs.size(), " shaders on ", workerCount, " threads"));
+
+  BatchJobPool pool(workerCount, jobs.size());
+  std::vector<dxvk::thread> workers;
+
+  auto t0 = BatchClock::now();
+
+  for (uint32_t i = 0; i < workerCount; i++) {
+    workers.emplace_back([&pool, &jobs, &results, &moduleInfo, i] {
+      size_t job;
+
+      while (pool.getJob(i, job)) {
+        results[job] = compileJob(jobs[job], moduleInfo);
+        results[job].worker = i;
+      }
+    });
+  }
+
+  for (auto& worker : workers)
+    worker.join();
+
+  auto t1 = BatchClock::now();
+
+  // Write per-shader statistics as CSV so that
+  // results can be compared across CI runs
+  std::ofstream stats(str::fromws((outputDir + L"\\stats.csv").c_str()));
+  stats << "name,success,worker,dxbc_bytes,spirv_bytes,read_us,parse_us,compile_us,write_us" << std::endl;
+
+  uint32_t failed    = 0;
+  uint64_t compileUs = 0;
+  uint64_t maxUs     = 0;
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const BatchResult& r = results[i];
+
+    stats << jobs[i].name << ","
+          << (r.success ? 1 : 0) << ","
+          << r.worker << ","
+          << r.dxbcSize << ","
+          << r.spirvSize << ","
+          << r.readUs << ","
+          << r.parseUs << ","
+          << r.compileUs << ","
+          << r.writeUs << std::endl;
+
+    if (!r.success)
+      failed += 1;
+
+    compileUs += r.parseUs + r.compileUs;
+    maxUs      = std::max(maxUs, r.parseUs + r.compileUs);
+  }
+
+  uint64_t wallUs = elapsedUs(t0, t1);
+
+  Logger::info(str::format(
+    "Compiled ", jobs.size() - failed, "/", jobs.size(), " shaders\n",
+    "  Wall time:        ", wallUs / 1000, " ms\n",
+    "  Translation time: ", compileUs / 1000, " ms\n",
+    "  Slowest shader:   ", maxUs / 1000, " ms\n",
+    "  Average shader:   ", compileUs / jobs.size(), " us\n",
+    "  Jobs stolen:      ", pool.stealCount()));
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,576 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "../../src/dxbc/dxbc_module.h"
+#include "../../src/dxvk/dxvk_shader.h"
+#include "../../src/spirv/spirv_compression.h"
+#include "../../src/spirv/spirv_module.h"
+
+#include <shellapi.h>
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxbc-compile-bench.log");
+}
+
+using namespace dxvk;
+
+using BenchClock = std::chrono::high_resolution_clock;
+
+/**
+ * \brief Shader to benchmark
+ *
+ * DXBC blobs are loaded up front so that
+ * file I/O does not skew the measurements.
+ */
+struct BenchShader {
+  std::string       name;
+  std::vector<char> code;
+  SpirvCodeBuffer   spirv;
+  uint64_t          compileUs = 0;
+};
+
+
+static uint64_t elapsedUs(BenchClock::time_point t0, BenchClock::time_point t1) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+}
+
+
+static std::vector<BenchShader> loadShaders(const std::wstring& inputDir) {
+  std::vector<BenchShader> shaders;
+
+  WIN32_FIND_DATAW findData;
+  HANDLE handle = ::FindFirstFileW((inputDir + L"\\*").c_str(), &findData);
+
+  if (handle == INVALID_HANDLE_VALUE)
+    return shaders;
+
+  do {
+    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      continue;
+
+    std::wstring path = inputDir + L"\\" + findData.cFileName;
+    std::ifstream file(str::fromws(path.c_str()), std::ios::binary);
+
+    BenchShader shader;
+    shader.name = str::fromws(findData.cFileName);
+    shader.code = std::vector<char>(
+      (std::istreambuf_iterator<char>(file)),
+       std::istreambuf_iterator<char>());
+    shaders.push_back(std::move(shader));
+  } while (::FindNextFileW(handle, &findData));
+
+  ::FindClose(handle);
+  return shaders;
+}
+
+
+/**
+ * \brief Previous type and constant lookup
+ *
+ * Declares types and constants the way SpirvModule
+ * did before it used hash tables, by scanning all
+ * existing declarations. Only kept for comparison.
+ */
+class LegacyTypeConstDefs {
+
+public:
+
+  LegacyTypeConstDefs(uint32_t firstId)
+  : m_id(firstId) { }
+
+  uint32_t constu32(uint32_t v) {
+    std::array<uint32_t, 1> data;
+    std::memcpy(data.data(), &v, sizeof(v));
+
+    return this->defConst(spv::OpConstant,
+      this->defIntType(32, 0), data.size(), data.data());
+  }
+
+  uint32_t constf32(float v) {
+    std::array<uint32_t, 1> data;
+    std::memcpy(data.data(), &v, sizeof(v));
+
+    return this->defConst(spv::OpConstant,
+      this->defFloatType(32), data.size(), data.data());
+  }
+
+  uint32_t defIntType(uint32_t width, uint32_t isSigned) {
+    std::array<uint32_t, 2> args = {{ width, isSigned }};
+    return this->defType(spv::OpTypeInt, args.size(), args.data());
+  }
+
+  uint32_t defFloatType(uint32_t width) {
+    std::array<uint32_t, 1> args = {{ width }};
+    return this->defType(spv::OpTypeFloat, args.size(), args.data());
+  }
+
+  uint32_t defArrayType(uint32_t typeId, uint32_t length) {
+    std::array<uint32_t, 2> args = {{ typeId, length }};
+    return this->defType(spv::OpTypeArray, args.size(), args.data());
+  }
+
+  const SpirvCodeBuffer& code() const {
+    return m_typeConstDefs;
+  }
+
+  uint32_t idBound() const {
+    return m_id;
+  }
+
+private:
+
+  uint32_t        m_id;
+  SpirvCodeBuffer m_typeConstDefs;
+
+  uint32_t defType(
+          spv::Op   op,
+          uint32_t  argCount,
+    const uint32_t* argIds) {
+    for (auto ins : m_typeConstDefs) {
+      bool match = ins.opCode() == op
+                && ins.length() == 2 + argCount;
+
+      for (uint32_t i = 0; i < argCount && match; i++)
+        match &= ins.arg(2 + i) == argIds[i];
+
+      if (match)
+        return ins.arg(1);
+    }
+
+    uint32_t resultId = m_id++;
+    m_typeConstDefs.putIns (op, 2 + argCount);
+    m_typeConstDefs.putWord(resultId);
+
+    for (uint32_t i = 0; i < argCount; i++)
+      m_typeConstDefs.putWord(argIds[i]);
+    return resultId;
+  }
+
+  // Late constants are never used here, so
+  // unlike the original, this does not need
+  // to filter them out
+  uint32_t defConst(
+          spv::Op   op,
+          uint32_t  typeId,
+          uint32_t  argCount,
+    const uint32_t* argIds) {
+    for (auto ins : m_typeConstDefs) {
+      bool match = ins.opCode() == op
+                && ins.length() == 3 + argCount
+                && ins.arg(1)   == typeId;
+
+      for (uint32_t i = 0; i < argCount && match; i++)
+        match &= ins.arg(3 + i) == argIds[i];
+
+      if (match)
+        return ins.arg(2);
+    }
+
+    uint32_t resultId = m_id++;
+    m_typeConstDefs.putIns (op, 3 + argCount);
+    m_typeConstDefs.putWord(typeId);
+    m_typeConstDefs.putWord(resultId);
+
+    for (uint32_t i = 0; i < argCount; i++)
+      m_typeConstDefs.putWord(argIds[i]);
+    return resultId;
+  }
+
+};
+
+
+template<typename Module>
+static void declareTypesAndConsts(Module& module, uint32_t count) {
+  for (uint32_t pass = 0; pass < 2; pass++) {
+    for (uint32_t i = 0; i < count; i++) {
+      module.constu32(i);
+      module.constf32(float(i));
+      module.defArrayType(module.defFloatType(32), module.constu32(i + 1));
+    }
+  }
+}
+
+
+/**
+ * \brief Measures type and constant declarations
+ *
+ * Declares a number of distinct constants and vector
+ * types, then declares all of them a second time so
+ * that every call has to find an existing declaration.
+ * This isolates the cost of the deduplication lookup
+ * from the rest of the DXBC compiler. The previous
+ * lookup runs on the same inputs, and both must emit
+ * the same declarations.
+ * \param [in] count Number of distinct declarations
+ * \returns \c false if the declarations differ
+ */
+static bool runModuleBenchmark(uint32_t count) {
+  // Fresh modules have already allocated some IDs
+  uint32_t firstId = SpirvModule().allocateId();
+
+  auto t0 = BenchClock::now();
+
+  SpirvModule module;
+  declareTypesAndConsts(module, count);
+
+  auto t1 = BenchClock::now();
+
+  LegacyTypeConstDefs legacy(firstId);
+  declareTypesAndConsts(legacy, count);
+
+  auto t2 = BenchClock::now();
+
+  uint64_t currentUs = elapsedUs(t0, t1);
+  uint64_t legacyUs  = elapsedUs(t1, t2);
+
+  Logger::info(str::format("SpirvModule, ", count, " declarations: ",
+    currentUs, " us, previously ", legacyUs, " us (",
+    100 * legacyUs / std::max<uint64_t>(currentUs, 1), "%)"));
+
+  // Type and constant declarations are emitted last
+  // since the module has no variables or code
+  SpirvCodeBuffer code = module.compile();
+
+  const SpirvCodeBuffer& expected = legacy.code();
+  uint32_t offset = code.dwords() - std::min(code.dwords(), expected.dwords());
+
+  bool match = code.dwords() >= 5 + expected.dwords()
+            && code.data()[3] == legacy.idBound()
+            && !std::memcmp(code.data() + offset, expected.data(), expected.size());
+
+  if (!match)
+    Logger::err(str::format("SpirvModule, ", count, " declarations: Output differs from previous lookup"));
+
+  return match;
+}
+
+
+/**
+ * \brief Previous SPIR-V compression format
+ *
+ * Bit-packed variant of the compression scheme that
+ * SpirvCompressedBuffer used before switching to the
+ * byte-aligned format. Only kept for comparison.
+ */
+class LegacyCompressedBuffer {
+  constexpr static uint32_t NumMaskWords = 32;
+public:
+
+  LegacyCompressedBuffer(const SpirvCodeBuffer& code)
+  : m_size(code.dwords()) {
+    const uint32_t* data = code.data();
+
+    m_mask.reserve((m_size + NumMaskWords - 1) / NumMaskWords);
+    m_code.reserve((m_size + 1) / 2);
+
+    uint64_t dstWord  = 0;
+    uint32_t dstShift = 0;
+
+    for (uint32_t i = 0; i < m_size; i += NumMaskWords) {
+      uint64_t byteCounts = 0;
+
+      for (uint32_t w = 0; w < NumMaskWords && i + w < m_size; w++) {
+        uint64_t word = data[i + w];
+        uint64_t bytes = 0;
+
+        if      (word < (1 <<  8)) bytes = 0;
+        else if (word < (1 << 16)) bytes = 1;
+        else if (word < (1 << 24)) bytes = 2;
+        else                       bytes = 3;
+
+        byteCounts |= bytes << (2 * w);
+
+        uint32_t bits = 8 * bytes + 8;
+        uint32_t rem  = bit::pack(dstWord, dstShift, word, bits);
+
+        if (unlikely(rem != 0)) {
+          m_code.push_back(dstWord);
+
+          dstWord  = 0;
+          dstShift = 0;
+
+          bit::pack(dstWord, dstShift, word >> (bits - rem), rem);
+        }
+      }
+
+      m_mask.push_back(byteCounts);
+    }
+
+    if (dstShift)
+      m_code.push_back(dstWord);
+
+    m_mask.shrink_to_fit();
+    m_code.shrink_to_fit();
+  }
+
+  SpirvCodeBuffer decompress() const {
+    SpirvCodeBuffer code(m_size);
+    uint32_t* data = code.data();
+
+    if (m_size == 0)
+      return code;
+
+    uint32_t maskIdx = 0;
+    uint32_t codeIdx = 0;
+
+    uint64_t srcWord  = m_code[codeIdx++];
+    uint32_t srcShift = 0;
+
+    for (uint32_t i = 0; i < m_size; i += NumMaskWords) {
+      uint64_t srcMask = m_mask[maskIdx++];
+
+      for (uint32_t w = 0; w < NumMaskWords && i + w < m_size; w++) {
+        uint32_t bits = 8 * ((srcMask & 3) + 1);
+
+        uint64_t word = 0;
+        uint32_t rem = bit::unpack(word, srcWord, srcShift, bits);
+
+        if (unlikely(rem != 0)) {
+          srcWord  = m_code[codeIdx++];
+          srcShift = 0;
+
+          uint64_t tmp = 0;
+          bit::unpack(tmp, srcWord, srcShift, rem);
+          word |= tmp << (bits - rem);
+        }
+
+        data[i + w] = word;
+        srcMask >>= 2;
+      }
+    }
+
+    return code;
+  }
+
+  size_t compressedSize() const {
+    return sizeof(uint64_t) * (m_mask.size() + m_code.size());
+  }
+
+private:
+
+  uint32_t              m_size;
+  std::vector<uint64_t> m_mask;
+  std::vector<uint64_t> m_code;
+
+};
+
+
+/**
+ * \brief Compression benchmark results
+ *
+ * Sizes are given in bytes, times in microseconds.
+ */
+struct CompressionStats {
+  size_t   compressedSize = 0;
+  uint64_t compressUs     = 0;
+  uint64_t decompressUs   = 0;
+  uint32_t mismatches     = 0;
+};
+
+
+template<typename Codec>
+static void measureCodec(
+  const SpirvCodeBuffer&    code,
+        uint32_t            iterations,
+        CompressionStats&   stats) {
+  Codec compressed(code);
+  stats.compressedSize += compressed.compressedSize();
+
+  SpirvCodeBuffer decompressed = compressed.decompress();
+
+  if (decompressed.dwords() != code.dwords()
+   || std::memcmp(decompressed.data(), code.data(), code.size()))
+    stats.mismatches += 1;
+
+  auto t0 = BenchClock::now();
+
+  for (uint32_t i = 0; i < iterations; i++)
+    Codec buffer(code);
+
+  auto t1 = BenchClock::now();
+
+  for (uint32_t i = 0; i < iterations; i++)
+    compressed.decompress();
+
+  auto t2 = BenchClock::now();
+
+  stats.compressUs   += elapsedUs(t0, t1);
+  stats.decompressUs += elapsedUs(t1, t2);
+}
+
+
+/**
+ * \brief Measures SPIR-V compression
+ *
+ * Compresses and decompresses the SPIR-V code of all
+ * compiled shaders with both the current and previous
+ * compression format, and compares the throughput with
+ * that of a plain copy of the uncompressed code.
+ * \param [in] shaders Compiled shaders
+ * \param [in] iterations Number of iterations
+ * \returns \c false if any shader failed to round-trip
+ */
+static bool runCompressionBenchmark(
+  const std::vector<BenchShader>& shaders,
+        uint32_t                  iterations) {
+  size_t   rawSize = 0;
+  uint64_t copyUs  = 0;
+
+  CompressionStats current;
+  CompressionStats legacy;
+
+  for (const auto& shader : shaders) {
+    if (shader.code.empty())
+      continue;
+
+    rawSize += shader.spirv.size();
+
+    auto t0 = BenchClock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+      SpirvCodeBuffer copy(shader.spirv.dwords(), shader.spirv.data());
+
+    auto t1 = BenchClock::now();
+    copyUs += elapsedUs(t0, t1);
+
+    measureCodec<SpirvCompressedBuffer> (shader.spirv, iterations, current);
+    measureCodec<LegacyCompressedBuffer>(shader.spirv, iterations, legacy);
+  }
+
+  // Bytes per microsecond are equivalent to MB/s
+  auto throughput = [rawSize, iterations] (uint64_t us) {
+    return uint64_t(rawSize) * iterations / std::max<uint64_t>(us, 1);
+  };
+
+  auto percentage = [rawSize] (size_t size) {
+    return 100 * size / std::max<size_t>(rawSize, 1);
+  };
+
+  // Speedup over the previous format, in percent
+  auto speedup = [] (uint64_t oldUs, uint64_t newUs) {
+    return 100 * oldUs / std::max<uint64_t>(newUs, 1);
+  };
+
+  Logger::info(str::format(
+    "SPIR-V compression, ", rawSize / 1024, " kB of code\n",
+    "  Copy:              ", throughput(copyUs), " MB/s\n",
+    "  Current format\n",
+    "    Compressed size: ", current.compressedSize / 1024, " kB (", percentage(current.compressedSize), "%)\n",
+    "    Compress:        ", throughput(current.compressUs), " MB/s\n",
+    "    Decompress:      ", throughput(current.decompressUs), " MB/s\n",
+    "  Previous format\n",
+    "    Compressed size: ", legacy.compressedSize / 1024, " kB (", percentage(legacy.compressedSize), "%)\n",
+    "    Compress:        ", throughput(legacy.compressUs), " MB/s\n",
+    "    Decompress:      ", throughput(legacy.decompressUs), " MB/s\n",
+    "  Relative speed:    ",
+      speedup(legacy.compressUs, current.compressUs), "% compress, ",
+      speedup(legacy.decompressUs, current.decompressUs), "% decompress"));
+
+  if (current.mismatches || legacy.mismatches) {
+    Logger::err(str::format("SPIR-V compression: ",
+      current.mismatches, " current, ", legacy.mismatches, " previous round-trip failures"));
+    return false;
+  }
+
+  return true;
+}
+
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  int     argc = 0;
+  LPWSTR* argv = CommandLineToArgvW(
+    GetCommandLineW(), &argc);
+
+  bool declsMatch = true;
+
+  for (uint32_t count = 256; count <= 16384; count *= 4)
+    declsMatch &= runModuleBenchmark(count);
+
+  if (argc < 2)
+    return declsMatch ? 0 : 1;
+
+  uint32_t iterations = 10;
+
+  if (argc > 2)
+    iterations = std::max<uint32_t>(std::wcstoul(argv[2], nullptr, 10), 1);
+
+  std::vector<BenchShader> shaders = loadShaders(argv[1]);
+
+  if (shaders.empty()) {
+    Logger::err(str::format("No input files found in ", str::fromws(argv[1])));
+    return 1;
+  }
+
+  DxbcModuleInfo moduleInfo;
+  moduleInfo.options.useSubgroupOpsForAtomicCounters = true;
+  moduleInfo.options.useDemoteToHelperInvocation = true;
+  moduleInfo.options.minSsboAlignment = 4;
+  moduleInfo.xfb = nullptr;
+  moduleInfo.spec = nullptr;
+
+  // Compile everything once up front so that shaders which
+  // fail to compile are excluded, and caches are warm
+  uint32_t failed = 0;
+
+  for (auto& shader : shaders) {
+    try {
+      DxbcReader reader(shader.code.data(), shader.code.size());
+      DxbcModule module(reader);
+      shader.spirv = module.compile(moduleInfo, shader.name)->getCode();
+    } catch (const DxvkError& e) {
+      Logger::err(str::format(shader.name, ": ", e.message()));
+      shader.code.clear();
+      failed += 1;
+    }
+  }
+
+  uint64_t totalUs = 0;
+
+  for (auto& shader : shaders) {
+    if (shader.code.empty())
+      continue;
+
+    DxbcReader reader(shader.code.data(), shader.code.size());
+    DxbcModule module(reader);
+
+    auto t0 = BenchClock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+      module.compile(moduleInfo, shader.name);
+
+    auto t1 = BenchClock::now();
+
+    shader.compileUs = elapsedUs(t0, t1) / iterations;
+    totalUs += shader.compileUs;
+  }
+
+  std::sort(shaders.begin(), shaders.end(),
+    [] (const BenchShader& a, const BenchShader& b) {
+      return a.compileUs > b.compileUs;
+    });
+
+  uint32_t compiled = shaders.size() - failed;
+
+  Logger::info(str::format(
+    "Compiled ", compiled, "/", shaders.size(), " shaders, ", iterations, " iterations\n",
+    "  Total time:     ", totalUs / 1000, " ms\n",
+    "  Average shader: ", totalUs / std::max(compiled, 1u), " us"));
+
+  for (uint32_t i = 0; i < std::min(compiled, 5u); i++)
+    Logger::info(str::format("  ", shaders[i].name, ": ", shaders[i].compileUs, " us"));
+
+  if (!runCompressionBenchmark(shaders, iterations))
+    failed += 1;
+
+  return (failed || !declsMatch) ? 1 : 0;
+}
@@ -23,7 +23,7 @@ int WINAPI WinMain(HINSTANCE hInstance,
     GetCommandLineW(), &argc);  
   
   if (argc < 3) {
-    Logger::err("Usage: dxbc-compiler input.dxbc output.spv");
+    Logger::err("Usage: dxbc-compiler input.dxbc output.spv [--optimize]");
     return 1;
   }
   
@@ -45,7 +45,10 @@ int WINAPI WinMain(HINSTANCE hInstance,
     moduleInfo.options.useSubgroupOpsForAtomicCounters = true;
     moduleInfo.options.useDemoteToHelperInvocation = true;
     moduleInfo.options.minSsboAlignment = 4;
+    moduleInfo.options.optimizeSpirv = argc > 3
+      && str::fromws(argv[3]) == "--optimize";
     moduleInfo.xfb = nullptr;
+    moduleInfo.spec = nullptr;
 
     Rc<DxvkShader> shader = module.compile(moduleInfo, ifileName);
     std::ofstream ofile(str::fromws(argv[2]), std::ios::binary);
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include "../../src/dxbc/dxbc_module.h"
+#include "../../src/dxvk/dxvk_shader.h"
+#include "../../src/spirv/spirv_optimizer.h"
+
+#include <shellapi.h>
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxbc-optimizer-test.log");
+}
+
+using namespace dxvk;
+
+/**
+ * \brief Optimizer test statistics
+ */
+struct OptimizerStats {
+  uint32_t tested   = 0;
+  uint32_t failed   = 0;
+  uint32_t skipped  = 0;
+  size_t   rawSize  = 0;
+  size_t   optSize  = 0;
+};
+
+
+static std::vector<uint32_t> getModuleHeader(SpirvCodeBuffer& code) {
+  // Everything that affects the shader interface, except for
+  // the entry point interface list, which may lose inputs
+  std::vector<uint32_t> result;
+
+  for (auto ins : code) {
+    switch (ins.opCode()) {
+      case spv::OpCapability:
+      case spv::OpExtension:
+      case spv::OpMemoryModel:
+      case spv::OpExecutionMode:
+        for (uint32_t i = 0; i < ins.length(); i++)
+          result.push_back(ins.arg(i));
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return result;
+}
+
+
+static uint32_t countOutputStores(SpirvCodeBuffer& code) {
+  std::vector<bool> outputs(code.data()[3], false);
+  uint32_t count = 0;
+
+  for (auto ins : code) {
+    if (ins.opCode() == spv::OpVariable
+     && ins.arg(3) == spv::StorageClassOutput
+     && ins.arg(2) < outputs.size())
+      outputs[ins.arg(2)] = true;
+
+    if (ins.opCode() == spv::OpStore
+     && ins.arg(1) < outputs.size() && outputs[ins.arg(1)])
+      count += 1;
+  }
+
+  return count;
+}
+
+
+static void writeCode(const std::string& path, const SpirvCodeBuffer& code) {
+  std::ofstream file(path, std::ios::binary);
+  code.store(file);
+}
+
+
+/**
+ * \brief Tests the optimizer on a single shader
+ *
+ * Compiles the shader with and without the optimizer
+ * and checks that the optimized module still parses,
+ * does not reference any IDs that are not defined, and
+ * has the same capabilities, execution modes and number
+ * of stores to output variables.
+ */
+static void testShader(
+  const std::string&        name,
+  const std::vector<char>&  dxbc,
+  const std::wstring&       outputDir,
+        OptimizerStats&     stats) {
+  DxbcModuleInfo moduleInfo;
+  moduleInfo.options.useSubgroupOpsForAtomicCounters = true;
+  moduleInfo.options.useDemoteToHelperInvocation = true;
+  moduleInfo.options.minSsboAlignment = 4;
+  moduleInfo.xfb = nullptr;
+  moduleInfo.spec = nullptr;
+
+  SpirvCodeBuffer rawCode;
+
+  try {
+    DxbcReader reader(dxbc.data(), dxbc.size());
+    DxbcModule module(reader);
+    rawCode = module.compile(moduleInfo, name)->getCode();
+  } catch (const DxvkError& e) {
+    // Not an optimizer problem
+    Logger::warn(str::format(name, ": ", e.message()));
+    stats.skipped += 1;
+    return;
+  }
+
+  SpirvCodeBuffer optCode;
+
+  try {
+    SpirvOptimizer optimizer(rawCode);
+    optimizer.run(SpirvOptimizerPasses(
+      SpirvOptimizerPass::ForwardLoads,
+      SpirvOptimizerPass::FoldConstants,
+      SpirvOptimizerPass::EliminateDeadCode,
+      SpirvOptimizerPass::PruneVariables));
+    optCode = optimizer.getCode();
+
+    // Literal operands may show up as invalid IDs,
+    // so only report IDs that were valid before
+    std::vector<uint32_t> rawInvalid = SpirvOptimizer(rawCode).findInvalidIds();
+    std::vector<uint32_t> optInvalid = SpirvOptimizer(optCode).findInvalidIds();
+
+    std::vector<uint32_t> newInvalid;
+    std::set_difference(
+      optInvalid.begin(), optInvalid.end(),
+      rawInvalid.begin(), rawInvalid.end(),
+      std::back_inserter(newInvalid));
+
+    if (!newInvalid.empty())
+      throw DxvkError(str::format("Invalid ID %", newInvalid[0], " in optimized code"));
+
+    if (getModuleHeader(rawCode) != getModuleHeader(optCode))
+      throw DxvkError("Capabilities or execution modes changed");
+
+    if (countOutputStores(rawCode) != countOutputStores(optCode))
+      throw DxvkError("Number of output stores changed");
+  } catch (const DxvkError& e) {
+    Logger::err(str::format(name, ": ", e.message()));
+    stats.failed += 1;
+  }
+
+  stats.tested  += 1;
+  stats.rawSize += rawCode.size();
+  stats.optSize += optCode.size();
+
+  // Dump both versions so that they can be checked
+  // with external tools, e.g. spirv-val or spirv-diff
+  if (!outputDir.empty()) {
+    std::string baseName = str::fromws(outputDir.c_str()) + "\\" + name;
+    writeCode(baseName + ".spv", rawCode);
+    writeCode(baseName + ".opt.spv", optCode);
+  }
+}
+
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  int     argc = 0;
+  LPWSTR* argv = CommandLineToArgvW(
+    GetCommandLineW(), &argc);
+
+  if (argc < 2) {
+    Logger::err("Usage: dxbc-optimizer-test input_dir [output_dir]");
+    return 1;
+  }
+
+  std::wstring inputDir  = argv[1];
+  std::wstring outputDir = argc > 2 ? argv[2] : L"";
+
+  OptimizerStats stats;
+
+  WIN32_FIND_DATAW findData;
+  HANDLE handle = ::FindFirstFileW((inputDir + L"\\*").c_str(), &findData);
+
+  if (handle == INVALID_HANDLE_VALUE) {
+    Logger::err(str::format("No input files found in ", str::fromws(argv[1])));
+    return 1;
+  }
+
+  do {
+    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      continue;
+
+    std::wstring path = inputDir + L"\\" + findData.cFileName;
+    std::ifstream file(str::fromws(path.c_str()), std::ios::binary);
+
+    std::vector<char> dxbc(
+      (std::istreambuf_iterator<char>(file)),
+       std::istreambuf_iterator<char>());
+
+    testShader(str::fromws(findData.cFileName), dxbc, outputDir, stats);
+  } while (::FindNextFileW(handle, &findData));
+
+  ::FindClose(handle);
+
+  Logger::info(str::format(
+    "Tested ", stats.tested, " shaders, ", stats.failed, " failed, ", stats.skipped, " skipped\n",
+    "  Unoptimized: ", stats.rawSize / 1024, " kB\n",
+    "  Optimized:   ", stats.optSize / 1024, " kB (",
+      100 * stats.optSize / std::max<size_t>(stats.rawSize, 1), "%)"));
+
+  return stats.failed ? 1 : 0;
+}
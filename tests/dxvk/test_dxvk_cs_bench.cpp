@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "../../src/dxvk/dxvk_cs.h"
+
+#include <shellapi.h>
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-cs-bench.log");
+}
+
+using namespace dxvk;
+
+using BenchClock = std::chrono::high_resolution_clock;
+
+/**
+ * \brief Runs one benchmark pass
+ *
+ * Each producer thread allocates chunks from the shared
+ * pool, fills them with no-op commands and dispatches
+ * them to the CS thread. The CS thread executes chunks
+ * without a context, which is fine since the commands
+ * never access it.
+ * \param [in] producerCount Number of producer threads
+ * \param [in] chunkCount Number of chunks per producer
+ * \param [in] cmdCount Number of commands per chunk
+ * \returns Chunks per second
+ */
+static double runBenchmark(
+        uint32_t    producerCount,
+        uint32_t    chunkCount,
+        uint32_t    cmdCount) {
+  DxvkCsChunkPool pool;
+  DxvkCsThread    csThread(nullptr);
+
+  std::vector<dxvk::thread> producers;
+
+  auto t0 = BenchClock::now();
+
+  for (uint32_t i = 0; i < producerCount; i++) {
+    producers.emplace_back([&pool, &csThread, chunkCount, cmdCount] {
+      for (uint32_t c = 0; c < chunkCount; c++) {
+        DxvkCsChunkRef chunk(pool.allocChunk(
+          DxvkCsChunk::DefaultSizeClass), &pool);
+
+        for (uint32_t n = 0; n < cmdCount; n++) {
+          auto cmd = [n] (DxvkContext* ctx) { (void) n; };
+          chunk->push(cmd);
+        }
+
+        csThread.dispatchChunk(std::move(chunk));
+      }
+    });
+  }
+
+  for (auto& producer : producers)
+    producer.join();
+
+  csThread.synchronize();
+
+  auto t1 = BenchClock::now();
+
+  double seconds = std::chrono::duration<double>(t1 - t0).count();
+  return double(producerCount * chunkCount) / seconds;
+}
+
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  int     argc = 0;
+  LPWSTR* argv = CommandLineToArgvW(
+    GetCommandLineW(), &argc);
+
+  uint32_t chunkCount = 100000;
+  uint32_t cmdCount   = 16;
+
+  if (argc > 1) chunkCount = std::wcstoul(argv[1], nullptr, 10);
+  if (argc > 2) cmdCount   = std::wcstoul(argv[2], nullptr, 10);
+
+  uint32_t maxProducers = dxvk::thread::hardware_concurrency();
+
+  for (uint32_t producers = 1; producers <= maxProducers; producers *= 2) {
+    double rate = runBenchmark(producers, chunkCount, cmdCount);
+
+    Logger::info(str::format(
+      producers, " producers: ",
+      uint64_t(rate), " chunks/s, ",
+      uint64_t(rate * cmdCount), " cmds/s"));
+  }
+
+  return 0;
+}
@@ -0,0 +1,411 @@
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "../../src/dxvk/dxvk_memory_range.h"
+
+#include <shellapi.h>
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-memory-trace.log");
+}
+
+using namespace dxvk;
+
+using TraceClock = std::chrono::high_resolution_clock;
+
+/**
+ * \brief Trace operation
+ *
+ * One line of a memory trace as written by the memory
+ * allocator when \c DXVK_MEMORY_TRACE is set. For
+ * allocations, the offset is only used to identify
+ * the allocation when it gets freed again.
+ */
+struct TraceOp {
+  char          type;
+  uint32_t      chunk;
+  VkDeviceSize  size;
+  VkDeviceSize  align;
+  VkDeviceSize  offset;
+};
+
+
+/**
+ * \brief Replay statistics
+ */
+struct TraceStats {
+  uint64_t      timeUs        = 0;
+  uint32_t      allocCount    = 0;
+  uint32_t      failedCount   = 0;
+  uint32_t      errorCount    = 0;
+  size_t        freeRanges    = 0;
+  VkDeviceSize  maxFreeRange  = 0;
+};
+
+
+/**
+ * \brief Previous chunk allocator
+ *
+ * Worst-fit allocator on an unsorted free list,
+ * kept here as a baseline for comparisons.
+ */
+class LegacyRangeAllocator {
+
+public:
+
+  LegacyRangeAllocator(VkDeviceSize size) {
+    m_freeList.push_back({ 0, size });
+  }
+
+  bool alloc(VkDeviceSize size, VkDeviceSize align, VkDeviceSize& offset) {
+    if (m_freeList.empty())
+      return false;
+
+    auto bestSlice = m_freeList.begin();
+
+    for (auto slice = m_freeList.begin(); slice != m_freeList.end(); slice++) {
+      if (slice->length == size) {
+        bestSlice = slice;
+        break;
+      } else if (slice->length > bestSlice->length) {
+        bestSlice = slice;
+      }
+    }
+
+    const VkDeviceSize sliceStart = bestSlice->offset;
+    const VkDeviceSize sliceEnd   = bestSlice->offset + bestSlice->length;
+
+    const VkDeviceSize allocStart = dxvk::align(sliceStart, align);
+    const VkDeviceSize allocEnd   = allocStart + size;
+
+    if (allocEnd > sliceEnd)
+      return false;
+
+    m_freeList.erase(bestSlice);
+
+    if (allocStart != sliceStart)
+      m_freeList.push_back({ sliceStart, allocStart - sliceStart });
+
+    if (allocEnd != sliceEnd)
+      m_freeList.push_back({ allocEnd, sliceEnd - allocEnd });
+
+    offset = allocStart;
+    return true;
+  }
+
+  void free(VkDeviceSize offset, VkDeviceSize length) {
+    auto curr = m_freeList.begin();
+
+    while (curr != m_freeList.end()) {
+      if (curr->offset == offset + length) {
+        length += curr->length;
+        curr = m_freeList.erase(curr);
+      } else if (curr->offset + curr->length == offset) {
+        offset -= curr->length;
+        length += curr->length;
+        curr = m_freeList.erase(curr);
+      } else {
+        curr++;
+      }
+    }
+
+    m_freeList.push_back({ offset, length });
+  }
+
+  size_t freeRangeCount() const {
+    return m_freeList.size();
+  }
+
+  VkDeviceSize maxFreeRangeSize() const {
+    VkDeviceSize result = 0;
+
+    for (const auto& slice : m_freeList)
+      result = std::max(result, slice.length);
+
+    return result;
+  }
+
+private:
+
+  struct FreeSlice {
+    VkDeviceSize offset;
+    VkDeviceSize length;
+  };
+
+  std::vector<FreeSlice> m_freeList;
+
+};
+
+
+static std::vector<TraceOp> readTrace(const std::string& path) {
+  std::vector<TraceOp> ops;
+  std::unordered_map<std::string, uint32_t> chunkIds;
+
+  std::ifstream file(path);
+  std::string   line;
+
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+
+    TraceOp     op = { };
+    std::string chunk;
+
+    stream >> op.type >> chunk;
+
+    switch (op.type) {
+      case 'c': stream >> op.size; break;
+      case 'a': stream >> op.size >> op.align >> op.offset; break;
+      case 'f': stream >> op.offset >> op.size; break;
+      default: continue;
+    }
+
+    auto entry = chunkIds.insert({ chunk, uint32_t(chunkIds.size()) });
+    op.chunk = entry.first->second;
+
+    ops.push_back(op);
+  }
+
+  return ops;
+}
+
+
+static std::vector<TraceOp> generateTrace(uint32_t opCount) {
+  constexpr VkDeviceSize ChunkSize = VkDeviceSize(128) << 20;
+  constexpr VkDeviceSize Aligns[]  = { 16, 256, 4096, 65536 };
+  constexpr size_t       LiveCount = 2000;
+
+  std::vector<TraceOp>  ops;
+  std::vector<VkDeviceSize> live;
+
+  std::mt19937 rng(0x4458564b);
+
+  std::uniform_int_distribution<uint32_t> opDist(0, 99);
+  std::uniform_int_distribution<uint32_t> sizeDist(8, 18);
+  std::uniform_int_distribution<uint32_t> alignDist(0, 3);
+
+  ops.push_back({ 'c', 0, ChunkSize, 0, 0 });
+
+  // Use a unique offset for each allocation so that
+  // frees can be matched the same way as in real traces
+  VkDeviceSize nextId = 0;
+
+  for (uint32_t i = 0; i < opCount; i++) {
+    // Keep the number of live allocations roughly stable
+    uint32_t allocRate = live.size() < LiveCount ? 60 : 40;
+
+    if (live.empty() || opDist(rng) < allocRate) {
+      VkDeviceSize size = VkDeviceSize(1) << sizeDist(rng);
+      size += (size - 1) & rng();
+
+      ops.push_back({ 'a', 0, size, Aligns[alignDist(rng)], nextId });
+      live.push_back(nextId++);
+    } else {
+      size_t index = rng() % live.size();
+
+      ops.push_back({ 'f', 0, 0, 0, live[index] });
+
+      live[index] = live.back();
+      live.pop_back();
+    }
+  }
+
+  return ops;
+}
+
+
+/**
+ * \brief Replays a trace
+ *
+ * Allocations that fail during replay are counted, and
+ * frees of those allocations are skipped. Every allocation
+ * is checked against all live allocations in the same chunk.
+ * \param [in] ops Trace operations
+ * \returns Replay statistics
+ */
+template<typename Allocator>
+static TraceStats replayTrace(const std::vector<TraceOp>& ops) {
+  struct Allocation {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+  };
+
+  struct Chunk {
+    std::unique_ptr<Allocator>                      allocator;
+    std::unordered_map<VkDeviceSize, Allocation>    allocations;
+    std::map<VkDeviceSize, VkDeviceSize>            ranges;
+    VkDeviceSize                                    size;
+  };
+
+  std::vector<Chunk> chunks;
+  TraceStats stats;
+
+  auto t0 = TraceClock::now();
+
+  for (const auto& op : ops) {
+    if (op.chunk >= chunks.size())
+      chunks.resize(op.chunk + 1);
+
+    Chunk& chunk = chunks[op.chunk];
+
+    switch (op.type) {
+      case 'c': {
+        chunk.allocator = std::make_unique<Allocator>(op.size);
+        chunk.size = op.size;
+      } break;
+
+      case 'a': {
+        VkDeviceSize size   = dxvk::align(op.size, op.align);
+        VkDeviceSize offset = 0;
+
+        stats.allocCount += 1;
+
+        if (!chunk.allocator || !chunk.allocator->alloc(size, op.align, offset)) {
+          stats.failedCount += 1;
+          break;
+        }
+
+        chunk.allocations[op.offset] = { offset, size };
+
+        // Validate the allocation against all live ranges
+        auto next = chunk.ranges.lower_bound(offset);
+
+        bool valid = offset % op.align == 0
+                  && offset + size <= chunk.size
+                  && (next == chunk.ranges.end() || next->first >= offset + size)
+                  && (next == chunk.ranges.begin() || std::prev(next)->second <= offset);
+
+        if (!valid)
+          stats.errorCount += 1;
+
+        chunk.ranges[offset] = offset + size;
+      } break;
+
+      case 'f': {
+        auto entry = chunk.allocations.find(op.offset);
+
+        if (entry == chunk.allocations.end())
+          break;
+
+        chunk.allocator->free(entry->second.offset, entry->second.size);
+        chunk.ranges.erase(entry->second.offset);
+        chunk.allocations.erase(entry);
+      } break;
+    }
+  }
+
+  auto t1 = TraceClock::now();
+
+  stats.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+
+  for (const auto& chunk : chunks) {
+    if (chunk.allocator) {
+      stats.freeRanges   += chunk.allocator->freeRangeCount();
+      stats.maxFreeRange  = std::max(stats.maxFreeRange, chunk.allocator->maxFreeRangeSize());
+    }
+  }
+
+  return stats;
+}
+
+
+static void printStats(const char* name, const TraceStats& stats) {
+  Logger::info(str::format(name, ":\n",
+    "  Time:           ", stats.timeUs / 1000, " ms\n",
+    "  Allocations:    ", stats.allocCount, "\n",
+    "  Failed:         ", stats.failedCount, "\n",
+    "  Overlaps:       ", stats.errorCount, "\n",
+    "  Free ranges:    ", stats.freeRanges, "\n",
+    "  Largest range:  ", stats.maxFreeRange >> 10, " kB"));
+}
+
+
+/**
+ * \brief Checks basic allocator properties
+ *
+ * Allocates a chunk in pieces with various alignments,
+ * frees everything in a scrambled order and checks that
+ * all free ranges were merged back into one.
+ * \returns \c true if all checks passed
+ */
+static bool testRangeAllocator() {
+  constexpr VkDeviceSize ChunkSize = VkDeviceSize(1) << 24;
+
+  DxvkMemoryRangeAllocator allocator(ChunkSize);
+  std::vector<std::pair<VkDeviceSize, VkDeviceSize>> ranges;
+
+  VkDeviceSize offset = 0;
+  uint32_t     index  = 0;
+
+  while (true) {
+    VkDeviceSize align = VkDeviceSize(16) << (index % 8);
+    VkDeviceSize size  = dxvk::align(VkDeviceSize(100 + 37 * index), align);
+
+    if (!allocator.alloc(size, align, offset))
+      break;
+
+    if (offset % align)
+      return false;
+
+    ranges.push_back({ offset, size });
+    index += 1;
+  }
+
+  if (allocator.freeSize() >= ChunkSize / 2)
+    return false;
+
+  for (size_t i = 0; i < ranges.size(); i++) {
+    size_t j = (i * 7919) % ranges.size();
+    std::swap(ranges[i], ranges[j]);
+  }
+
+  for (const auto& r : ranges)
+    allocator.free(r.first, r.second);
+
+  return allocator.freeSize() == ChunkSize
+      && allocator.freeRangeCount() == 1
+      && allocator.maxFreeRangeSize() == ChunkSize
+      && allocator.alloc(ChunkSize, 1, offset)
+      && offset == 0;
+}
+
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  int     argc = 0;
+  LPWSTR* argv = CommandLineToArgvW(
+    GetCommandLineW(), &argc);
+
+  if (!testRangeAllocator()) {
+    Logger::err("Range allocator test failed");
+    return 1;
+  }
+
+  std::vector<TraceOp> ops;
+
+  if (argc > 1) {
+    ops = readTrace(str::fromws(argv[1]));
+    Logger::info(str::format("Read ", ops.size(), " operations"));
+  } else {
+    ops = generateTrace(1000000);
+    Logger::info(str::format("Generated ", ops.size(), " operations"));
+  }
+
+  TraceStats legacy = replayTrace<LegacyRangeAllocator>(ops);
+  TraceStats ranged = replayTrace<DxvkMemoryRangeAllocator>(ops);
+
+  printStats("Worst-fit free list", legacy);
+  printStats("Segregated free lists", ranged);
+
+  return (legacy.errorCount || ranged.errorCount) ? 1 : 0;
+}
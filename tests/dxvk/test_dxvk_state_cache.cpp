@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+
+#include "../../src/dxvk/dxvk_state_cache_file.h"
+
+#include <shellapi.h>
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-state-cache.log");
+}
+
+using namespace dxvk;
+
+using CacheClock = std::chrono::high_resolution_clock;
+
+static uint64_t elapsedUs(CacheClock::time_point t0) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    CacheClock::now() - t0).count();
+}
+
+
+/**
+ * \brief Input file
+ *
+ * Stores the decoded file along with
+ * the number of valid entries in it.
+ */
+struct CacheInput {
+  std::string                         path;
+  std::unique_ptr<DxvkStateCacheFile> file;
+  bool                                success     = false;
+  size_t                              validCount  = 0;
+  uint64_t                            readUs      = 0;
+};
+
+
+/**
+ * \brief Reads and validates an input file
+ *
+ * Decodes all entries, so that invalid and
+ * duplicate entries are known afterwards.
+ * \param [in] input The input file
+ */
+static void readInput(CacheInput& input) {
+  auto t0 = CacheClock::now();
+
+  std::ifstream stream(input.path, std::ios_base::binary);
+  input.file = std::make_unique<DxvkStateCacheFile>();
+
+  if (!stream || !input.file->read(stream))
+    return;
+
+  input.file->forEachKey([&input] (const DxvkStateCacheKey& key) {
+    input.validCount += input.file->getEntries(key).size();
+  });
+
+  input.success = true;
+  input.readUs  = elapsedUs(t0);
+}
+
+
+/**
+ * \brief Writes per-shader pipeline counts
+ *
+ * Counts the pipelines that each shader is used
+ * in and writes them as CSV, most used first.
+ * \param [in] file Merged state cache file
+ * \param [in] path Output file name
+ */
+static void writeShaderStats(DxvkStateCacheFile& file, const std::string& path) {
+  const DxvkShaderKey nullKey;
+
+  std::unordered_map<DxvkShaderKey, size_t, DxvkHash, DxvkEq> counts;
+
+  file.forEachKey([&] (const DxvkStateCacheKey& key) {
+    size_t entryCount = file.getEntries(key).size();
+
+    for (const DxvkShaderKey* shader = &key.vs; shader <= &key.cs; shader++) {
+      if (!shader->eq(nullKey))
+        counts[*shader] += entryCount;
+    }
+  });
+
+  std::vector<std::pair<DxvkShaderKey, size_t>> sorted(counts.begin(), counts.end());
+
+  std::sort(sorted.begin(), sorted.end(), [] (const auto& a, const auto& b) {
+    return a.second > b.second;
+  });
+
+  std::ofstream stats(path);
+  stats << "shader,pipelines" << std::endl;
+
+  for (const auto& entry : sorted)
+    stats << entry.first.toString() << "," << entry.second << std::endl;
+
+  Logger::info(str::format("Wrote pipeline counts for ", sorted.size(), " shaders to ", path));
+}
+
+
+/**
+ * \brief Merges state cache files
+ *
+ * Reads any number of state cache files of any
+ * supported version on multiple threads, validates
+ * all entries and writes the merged file in the
+ * current indexed format, without any invalid or
+ * duplicate entries. No Vulkan device is required.
+ */
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  int     argc = 0;
+  LPWSTR* argv = CommandLineToArgvW(
+    GetCommandLineW(), &argc);
+
+  if (argc < 3) {
+    Logger::err("Usage: dxvk-state-cache input.dxvk-cache [input.dxvk-cache...] output.dxvk-cache");
+    return 1;
+  }
+
+  std::vector<CacheInput> inputs(argc - 2);
+
+  for (int i = 1; i < argc - 1; i++)
+    inputs[i - 1].path = str::fromws(argv[i]);
+
+  std::string outputPath = str::fromws(argv[argc - 1]);
+
+  // Read and validate input files in parallel
+  uint32_t workerCount = std::min<uint32_t>(
+    dxvk::thread::hardware_concurrency(), inputs.size());
+
+  if (!workerCount)
+    workerCount = 1;
+
+  std::atomic<size_t> nextInput = { 0u };
+  std::vector<dxvk::thread> workers;
+
+  auto t0 = CacheClock::now();
+
+  for (uint32_t i = 0; i < workerCount; i++) {
+    workers.emplace_back([&inputs, &nextInput] {
+      size_t index;
+
+      while ((index = nextInput++) < inputs.size())
+        readInput(inputs[index]);
+    });
+  }
+
+  for (auto& worker : workers)
+    worker.join();
+
+  Logger::info(str::format("Read ", inputs.size(), " files on ", workerCount,
+    " threads in ", elapsedUs(t0) / 1000, " ms"));
+
+  // Merge all entries into one file, the file
+  // itself will discard any duplicates
+  DxvkStateCacheFile output;
+  uint32_t failed = 0;
+
+  for (const auto& input : inputs) {
+    if (!input.success) {
+      Logger::err(str::format(input.path, ": Failed to read file"));
+      failed += 1;
+      continue;
+    }
+
+    Logger::info(str::format(input.path, ":\n",
+      "  Version:        v", input.file->version(), "\n",
+      "  Pipelines:      ", input.file->keyCount(), "\n",
+      "  Valid entries:  ", input.validCount, "\n",
+      "  Invalid:        ", input.file->invalidCount(), "\n",
+      "  Duplicates:     ", input.file->duplicateCount(), "\n",
+      "  Read time:      ", input.readUs / 1000, " ms"));
+
+    input.file->forEachKey([&] (const DxvkStateCacheKey& key) {
+      for (const auto& entry : input.file->getEntries(key))
+        output.addEntry(entry);
+    });
+  }
+
+  if (failed == inputs.size())
+    return 1;
+
+  std::ofstream stream(outputPath, std::ios_base::binary | std::ios_base::trunc);
+
+  if (!stream) {
+    Logger::err(str::format("Failed to open ", outputPath));
+    return 1;
+  }
+
+  // Writing the file resets its statistics
+  size_t mergedCount = output.duplicateCount();
+
+  t0 = CacheClock::now();
+  size_t entryCount = output.write(stream);
+
+  if (!stream.good()) {
+    Logger::err(str::format("Failed to write ", outputPath));
+    return 1;
+  }
+
+  Logger::info(str::format(outputPath, ":\n",
+    "  Pipelines:      ", output.keyCount(), "\n",
+    "  Entries:        ", entryCount, "\n",
+    "  Merged:         ", mergedCount, "\n",
+    "  Write time:     ", elapsedUs(t0) / 1000, " ms"));
+
+  writeShaderStats(output, outputPath + ".csv");
+  return failed ? 1 : 0;
+}